@@ -88,6 +88,9 @@ extern "C"
 #define EXOSIP_OPT_ADD_ACCOUNT_INFO (EXOSIP_OPT_BASE_OPTION+13)
 #define EXOSIP_OPT_DNS_CAPABILITIES (EXOSIP_OPT_BASE_OPTION+14)
 #define EXOSIP_OPT_SET_DSCP (EXOSIP_OPT_BASE_OPTION+15)
+#define EXOSIP_OPT_SET_WORKER_THREADS (EXOSIP_OPT_BASE_OPTION+16) /* parse incoming messages on N threads (OSIP_MT only): set before eXosip_listen_addr */
+#define EXOSIP_OPT_SET_DNS_SERVER (EXOSIP_OPT_BASE_OPTION+17) /* "ip[:port]" of the server for NAPTR/SRV/A queries (res_query backend), NULL for the system one */
+#define EXOSIP_OPT_SET_MAX_REFRESH_RATE (EXOSIP_OPT_BASE_OPTION+18) /* int: registrations, subscriptions and publications refreshed per second, 0 for no limit */
 
   /* non standard option: need a compilation flag to activate */
 #define EXOSIP_OPT_KEEP_ALIVE_OPTIONS_METHOD (EXOSIP_OPT_BASE_OPTION+1000)
@@ -213,6 +216,10 @@ int eXosip_dnsutils_dns_process(struct osip_naptr *output_record, int force);
  * Set a callback to get sent and received SIP messages.
  *
  * @param cbsipCallback the callback to retreive messages.
+ *
+ * With EXOSIP_OPT_SET_WORKER_THREADS, received messages are reported
+ * from the worker threads, without eXosip_lock(). The calls are made
+ * one at a time, but the callback must not call eXosip functions.
  */
   int eXosip_set_cbsip_message (CbSipCallback cbsipCallback);
 
@@ -373,6 +373,20 @@ void eXosip_event_free(eXosip_event_t *je);
  */
 eXosip_event_t *eXosip_event_wait(int tv_s, int tv_ms);
 
+/**
+ * Wait for several eXosip events at once.
+ * Up to max events are stored in events, oldest first. The call returns
+ * as soon as one event is available or when the timeout expires. Each
+ * event must be released with eXosip_event_free.
+ *
+ * @param events    array receiving the events.
+ * @param max       size of the array.
+ * @param tv_s      timeout value (seconds).
+ * @param tv_ms     timeout value (mseconds).
+ * @return the number of events stored, 0 on timeout.
+ */
+int eXosip_event_wait_batch(eXosip_event_t **events, int max, int tv_s, int tv_ms);
+
 /**
  * Wait for next eXosip event.
  *
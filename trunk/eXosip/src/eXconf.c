@@ -68,6 +68,26 @@ eXosip_set_cbsip_message(
     return 0;
 }
 
+/* worker threads report the messages they receive: one call at a time */
+void
+_eXosip_cbsip_message(
+    osip_message_t *sip,
+    int            received)
+{
+    if (eXosip.cbsipCallback == NULL)
+        return;
+#ifdef OSIP_MT
+    if (eXosip.j_cbsip_mutex != NULL)
+    {
+        osip_mutex_lock(eXosip.j_cbsip_mutex);
+        eXosip.cbsipCallback(sip, received);
+        osip_mutex_unlock(eXosip.j_cbsip_mutex);
+        return;
+    }
+#endif
+    eXosip.cbsipCallback(sip, received);
+}
+
 void
 eXosip_masquerade_contact(
     const char *public_address,
@@ -194,6 +214,8 @@ eXosip_quit(
         osip_free((struct osip_thread *) eXosip.j_thread);
     }
 
+    _eXosip_worker_stop();
+
     jpipe_close(eXosip.j_socketctl);
     jpipe_close(eXosip.j_socketctl_event);
 #endif
@@ -272,15 +294,7 @@ eXosip_quit(
     eXosip_kill_transaction(&eXosip.j_osip->osip_nist_transactions);
     osip_release(eXosip.j_osip);
 
-    {
-        eXosip_event_t *ev;
-
-        for (ev = osip_fifo_tryget(eXosip.j_events); ev != NULL;
-             ev = osip_fifo_tryget(eXosip.j_events))
-            eXosip_event_free(ev);
-    }
-
-    osip_fifo_free(eXosip.j_events);
+    _eXosip_events_free();
 
     for (jauthinfo = eXosip.authinfos; jauthinfo != NULL;
          jauthinfo = eXosip.authinfos)
@@ -289,20 +303,7 @@ eXosip_quit(
         osip_free(jauthinfo);
     }
 
-    {
-        struct eXosip_http_auth *http_auth;
-        int                     pos;
-
-        /* update entries with same call_id */
-        for (pos = 0; pos < MAX_EXOSIP_HTTP_AUTH; pos++)
-        {
-            http_auth = &eXosip.http_auths[pos];
-            if (http_auth->pszCallId[0] == '\0')
-                continue;
-            osip_proxy_authenticate_free(http_auth->wa);
-            memset(http_auth, 0, sizeof(struct eXosip_http_auth));
-        }
-    }
+    _eXosip_nonce_free();
 
     eXtl_udp.tl_free();
     eXtl_tcp.tl_free();
@@ -312,6 +313,10 @@ eXosip_quit(
     #endif
     eXtl_tls.tl_free();
 #endif
+    _eXtl_poll_free();
+    _eXosip_index_free();
+    _eXosip_resolver_free();
+    _eXosip_refresh_free();
 
     memset(&eXosip, 0, sizeof(eXosip));
     eXosip.j_stop_ua = -1;
@@ -746,6 +751,20 @@ eXosip_init(
     i                = osip_list_init(&eXosip.j_transactions);
     eXosip.j_reg     = NULL;
 
+    i = _eXosip_index_init();
+    if (i == 0)
+    {
+        i = _eXosip_resolver_init();
+        if (i != 0)
+            _eXosip_index_free();
+    }
+    if (i != 0)
+    {
+        osip_free(eXosip.user_agent);
+        eXosip.user_agent = NULL;
+        return i;
+    }
+
 #ifdef OSIP_MT
     #if !defined (_WIN32_WCE)
     eXosip.j_cond = (struct osip_cond *) osip_cond_init();
@@ -753,6 +772,8 @@ eXosip_init(
     {
         osip_free(eXosip.user_agent);
         eXosip.user_agent = NULL;
+        _eXosip_resolver_free();
+        _eXosip_index_free();
         return OSIP_NOMEM;
     }
     #endif
@@ -762,6 +783,8 @@ eXosip_init(
     {
         osip_free(eXosip.user_agent);
         eXosip.user_agent = NULL;
+        _eXosip_resolver_free();
+        _eXosip_index_free();
     #if !defined (_WIN32_WCE)
         osip_cond_destroy((struct osip_cond *) eXosip.j_cond);
         eXosip.j_cond     = NULL;
@@ -796,11 +819,15 @@ eXosip_init(
         return OSIP_UNDEFINED_ERROR;
 #endif
 
-    /* To be changed in osip! */
-    eXosip.j_events = (osip_fifo_t *) osip_malloc(sizeof(osip_fifo_t));
-    if (eXosip.j_events == NULL)
-        return OSIP_NOMEM;
-    osip_fifo_init(eXosip.j_events);
+    /* sockets are watched with epoll when available, select() otherwise */
+    _eXtl_poll_init();
+#ifdef OSIP_MT
+    _eXtl_poll_add(jpipe_get_read_descr(eXosip.j_socketctl), NULL, NULL);
+#endif
+
+    i = _eXosip_events_init();
+    if (i != 0)
+        return i;
 
     eXosip.use_rport  = 1;
     eXosip.dns_capabilities   = 2;
@@ -829,42 +856,23 @@ eXosip_execute(
     osip_timers_gettimeout(eXosip.j_osip, &lower_tv);
     if (lower_tv.tv_sec > 10)
     {
-        eXosip_reg_t *jr;
-        time_t       now;
+        time_t next;
+        time_t now;
         now             = time(NULL);
 
         lower_tv.tv_sec = 10;
 
+        /* first registration, subscription or publication to refresh */
         eXosip_lock();
-        for (jr = eXosip.j_reg; jr != NULL; jr = jr->next)
-        {
-            if (jr->r_id >= 1 && jr->r_last_tr != NULL)
-            {
-                if (jr->r_reg_period == 0)
-                {
-                    /* skip refresh! */
-                }
-                else if (now - jr->r_last_tr->birth_time > jr->r_reg_period - (jr->r_reg_period / 10))
-                {
-                    /* automatic refresh at "timeout - 10%" */
-                    lower_tv.tv_sec = 1;
-                }
-            }
-        }
+        next = _eXosip_refresh_next();
         eXosip_unlock();
+        if (next != 0 && next - now < 10)
+            lower_tv.tv_sec = (next - now < 1) ? 1 : (long) (next - now);
 
-        if (lower_tv.tv_sec == 1)
-        {
-            OSIP_TRACE(osip_trace
-                           (__FILE__, __LINE__, OSIP_INFO2, NULL,
-                           "eXosip: Reseting timer to 1s before waking up!\n"));
-        }
-        else
-        {
-            OSIP_TRACE(osip_trace
-                           (__FILE__, __LINE__, OSIP_INFO2, NULL,
-                           "eXosip: Reseting timer to 10s before waking up!\n"));
-        }
+        OSIP_TRACE(osip_trace
+                       (__FILE__, __LINE__, OSIP_INFO2, NULL,
+                       "eXosip: Reseting timer to %lis before waking up!\n",
+                       (long) lower_tv.tv_sec));
     }
     else
     {
@@ -1101,6 +1109,7 @@ eXosip_set_option(
                                             entry->host))
                 {
                     eXosip.dns_entries[i].host[0] = '\0';
+                    _eXosip_resolver_flush();
                     OSIP_TRACE(osip_trace
                                    (__FILE__, __LINE__, OSIP_INFO2, NULL,
                                    "eXosip option set: dns cache deleted :%s\n",
@@ -1207,6 +1216,33 @@ eXosip_set_option(
         /* 0x1A by default */
         eXosip.dscp             = val;
         break;
+    case EXOSIP_OPT_SET_WORKER_THREADS:
+        val                     = *((int *) value);
+#ifdef OSIP_MT
+        /* transports must not be running while the pool changes */
+        if (eXosip.j_thread != NULL)
+            return OSIP_WRONG_STATE;
+        _eXosip_worker_stop();
+        if (val > 0)
+            return _eXosip_worker_start(val);
+#else
+        if (val > 0)
+            return OSIP_UNDEFINED_ERROR;
+#endif
+        break;
+    case EXOSIP_OPT_SET_DNS_SERVER:
+        tmp = (char *) value;
+        /* read by the resolver thread: kept by the resolver */
+        _eXosip_resolver_set_dns_server(tmp);
+        OSIP_TRACE(osip_trace
+                       (__FILE__, __LINE__, OSIP_INFO1, NULL,
+                       "eXosip option set: dns_server:%s!\n",
+                       (tmp != NULL) ? tmp : ""));
+        break;
+    case EXOSIP_OPT_SET_MAX_REFRESH_RATE:
+        val                     = *((int *) value);
+        eXosip.max_refresh_rate = val;
+        break;
     default:
         return OSIP_BADPARAMETER;
     }
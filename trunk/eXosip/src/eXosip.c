@@ -679,81 +679,114 @@ eXosip_default_action(
         return 1;
 }
 
-void
-eXosip_automatic_refresh(
-    void)
+static int
+_eXosip_subscribe_refresh(
+    eXosip_subscribe_t *js,
+    time_t             now)
 {
-    eXosip_subscribe_t *js;
-    eXosip_dialog_t    *jd;
-
-    eXosip_reg_t       *jr;
-    time_t             now;
-
-    now = time(NULL);
+    eXosip_dialog_t *jd;
+    int             sent = 0;
 
-    for (js = eXosip.j_subscribes; js != NULL; js = js->next)
+    for (jd = js->s_dialogs; jd != NULL; jd = jd->next)
     {
-        for (jd = js->s_dialogs; jd != NULL; jd = jd->next)
+        if (jd->d_dialog != NULL && (jd->d_id >= 1))    /* finished call */
         {
-            if (jd->d_dialog != NULL && (jd->d_id >= 1))    /* finished call */
-            {
-                osip_transaction_t *out_tr = NULL;
+            osip_transaction_t *out_tr = NULL;
 
-                out_tr = osip_list_get(jd->d_out_trs, 0);
-                if (out_tr == NULL)
-                    out_tr = js->s_out_tr;
+            out_tr = osip_list_get(jd->d_out_trs, 0);
+            if (out_tr == NULL)
+                out_tr = js->s_out_tr;
 
-                if (js->s_reg_period == 0 || out_tr == NULL)
-                {}
-                else if (now - out_tr->birth_time > js->s_reg_period - (js->s_reg_period / 10))     /* will expires in js->s_reg_period/10: send refresh! */
-                {
-                    int i;
+            if (js->s_reg_period == 0 || out_tr == NULL)
+            {}
+            else if (now - out_tr->birth_time > _eXosip_refresh_delay(&js->s_refresh, js->s_reg_period))     /* will expire in 10% to 20% of js->s_reg_period: send refresh! */
+            {
+                int i;
 
-                    i = _eXosip_subscribe_automatic_refresh(js, jd, out_tr);
-                    if (i != 0)
-                    {
-                        OSIP_TRACE(osip_trace
-                                       (__FILE__, __LINE__, OSIP_ERROR, NULL,
-                                       "eXosip: could not send subscribe for refresh\n"));
-                    }
+                i = _eXosip_subscribe_automatic_refresh(js, jd, out_tr);
+                if (i != 0)
+                {
+                    OSIP_TRACE(osip_trace
+                                   (__FILE__, __LINE__, OSIP_ERROR, NULL,
+                                   "eXosip: could not send subscribe for refresh\n"));
                 }
+                else
+                    sent++;
             }
         }
     }
+    return sent;
+}
 
-    for (jr = eXosip.j_reg; jr != NULL; jr = jr->next)
+static int
+_eXosip_register_refresh(
+    eXosip_reg_t *jr,
+    time_t       now)
+{
+    int sent = 0;
+
+    if (jr->r_id >= 1 && jr->r_last_tr != NULL)
     {
-        if (jr->r_id >= 1 && jr->r_last_tr != NULL)
+        if (jr->r_reg_period == 0)
         {
-            if (jr->r_reg_period == 0)
-            {
-                /* skip refresh! */
-            }
-            else if (now - jr->r_last_tr->birth_time > 900)
-            {
-                /* automatic refresh */
-                eXosip_register_send_register(jr->r_id, NULL);
+            /* skip refresh! */
+        }
+        else if (now - jr->r_last_tr->birth_time
+                 > _eXosip_refresh_delay(&jr->r_refresh, EXOSIP_REFRESH_MAX_PERIOD))
+        {
+            /* automatic refresh */
+            if (eXosip_register_send_register(jr->r_id, NULL) == 0)
+                sent++;
     #if TARGET_OS_IPHONE
-            }
-            else if (now - jr->r_last_tr->birth_time > jr->r_reg_period - 630)
-            {
-                eXosip_register_send_register(jr->r_id, NULL);
+        }
+        else if (now - jr->r_last_tr->birth_time > jr->r_reg_period - 630)
+        {
+            if (eXosip_register_send_register(jr->r_id, NULL) == 0)
+                sent++;
     #endif
-            }
-            else if (now - jr->r_last_tr->birth_time > jr->r_reg_period - (jr->r_reg_period / 10))
-            {
-                /* automatic refresh at "timeout - 10%" */
-                eXosip_register_send_register(jr->r_id, NULL);
-            }
-            else if (now - jr->r_last_tr->birth_time > 120 &&
-                     (jr->r_last_tr->last_response == NULL
-                      || (!MSG_IS_STATUS_2XX(jr->r_last_tr->last_response))))
-            {
-                /* automatic refresh */
-                eXosip_register_send_register(jr->r_id, NULL);
-            }
+        }
+        else if (now - jr->r_last_tr->birth_time
+                 > _eXosip_refresh_delay(&jr->r_refresh, jr->r_reg_period))
+        {
+            /* automatic refresh at "timeout - 10% to 20%" */
+            if (eXosip_register_send_register(jr->r_id, NULL) == 0)
+                sent++;
+        }
+        else if (now - jr->r_last_tr->birth_time > 120 &&
+                 (jr->r_last_tr->last_response == NULL
+                  || (!MSG_IS_STATUS_2XX(jr->r_last_tr->last_response))))
+        {
+            /* automatic refresh */
+            if (eXosip_register_send_register(jr->r_id, NULL) == 0)
+                sent++;
         }
     }
+    return sent;
+}
+
+void
+eXosip_automatic_refresh(
+    void)
+{
+    struct eXosip_refresh **due;
+    time_t                now;
+    int                   nb;
+    int                   pos;
+
+    now = time(NULL);
+
+    /* only the entries with something to do are visited */
+    nb = _eXosip_refresh_due(now, &due);
+    for (pos = 0; pos < nb && _eXosip_refresh_allowed(now); pos++)
+    {
+        if (due[pos]->type == EXOSIP_REFRESH_SUBSCRIBE)
+            _eXosip_refresh_sent(now, _eXosip_subscribe_refresh((eXosip_subscribe_t *) due[pos]->owner, now));
+        else if (due[pos]->type == EXOSIP_REFRESH_REG)
+            _eXosip_refresh_sent(now, _eXosip_register_refresh((eXosip_reg_t *) due[pos]->owner, now));
+        /* publications are refreshed by eXosip_automatic_action() */
+
+        _eXosip_refresh_update(due[pos]);
+    }
 }
 
 #endif
@@ -813,22 +846,250 @@ eXosip_retransmit_lost200ok()
     return;
 }
 
+#ifndef MINISIZE
+
+static int
+_eXosip_subscribe_action(
+    eXosip_subscribe_t *js,
+    time_t             now)
+{
+    eXosip_dialog_t *jd;
+    int             sent = 0;
+
+    if (js->s_id < 1)
+    {}
+    else if (js->s_dialogs == NULL)
+    {
+        osip_transaction_t *out_tr = NULL;
+
+        out_tr = js->s_out_tr;
+
+        if (out_tr != NULL
+            && (out_tr->state == NICT_TERMINATED
+                || out_tr->state == NICT_COMPLETED) &&
+            now - out_tr->birth_time < 120 &&
+            out_tr->orig_request != NULL &&
+            out_tr->last_response != NULL &&
+            (out_tr->last_response->status_code == 401
+             || out_tr->last_response->status_code == 407
+             || out_tr->last_response->status_code == 423))
+        {
+            /* retry with credential */
+            if (js->s_retry < 3)
+            {
+                int i;
+
+                i = _eXosip_subscribe_send_request_with_credential(js, NULL,
+                                                                   out_tr);
+                if (i != 0)
+                {
+                    OSIP_TRACE(osip_trace
+                                   (__FILE__, __LINE__, OSIP_ERROR, NULL,
+                                   "eXosip: could not clone msg for authentication\n"));
+                }
+                else
+                    sent++;
+                js->s_retry++;
+            }
+        }
+    }
+
+    for (jd = js->s_dialogs; jd != NULL; jd = jd->next)
+    {
+        if (jd->d_dialog != NULL)   /* finished call */
+        {
+            if (jd->d_id >= 1)
+            {
+                osip_transaction_t *out_tr = NULL;
+
+                out_tr = osip_list_get(jd->d_out_trs, 0);
+                if (out_tr == NULL)
+                    out_tr = js->s_out_tr;
+
+                if (out_tr != NULL
+                    && (out_tr->state == NICT_TERMINATED
+                        || out_tr->state == NICT_COMPLETED) &&
+                    now - out_tr->birth_time < 120 &&
+                    out_tr->orig_request != NULL &&
+                    out_tr->last_response != NULL &&
+                    (out_tr->last_response->status_code == 401
+                     || out_tr->last_response->status_code == 407))
+                {
+                    /* retry with credential */
+                    if (jd->d_retry < 3)
+                    {
+                        int i;
+                        i = _eXosip_subscribe_send_request_with_credential(js,
+                                                                           jd,
+                                                                           out_tr);
+                        if (i != 0)
+                        {
+                            OSIP_TRACE(osip_trace
+                                           (__FILE__, __LINE__, OSIP_ERROR,
+                                           NULL,
+                                           "eXosip: could not clone suscbribe for authentication\n"));
+                        }
+                        else
+                            sent++;
+                        jd->d_retry++;
+                    }
+                }
+                else if (js->s_reg_period == 0 || out_tr == NULL)
+                {}
+                else if (now - out_tr->birth_time > _eXosip_refresh_delay(&js->s_refresh, js->s_reg_period))     /* will expire in 10% to 20% of js->s_reg_period: send refresh! */
+                {
+                    int i;
+
+                    i = _eXosip_subscribe_automatic_refresh(js, jd, out_tr);
+                    if (i != 0)
+                    {
+                        OSIP_TRACE(osip_trace
+                                       (__FILE__, __LINE__, OSIP_ERROR, NULL,
+                                       "eXosip: could not clone subscribe for refresh\n"));
+                    }
+                    else
+                        sent++;
+                }
+            }
+        }
+    }
+    return sent;
+}
+
+static int
+_eXosip_publish_action(
+    eXosip_pub_t *jpub,
+    time_t       now)
+{
+    int sent = 0;
+
+    if (jpub->p_id >= 1 && jpub->p_last_tr != NULL)
+    {
+        if (jpub->p_period != 0
+            && now - jpub->p_last_tr->birth_time
+            > _eXosip_refresh_delay(&jpub->p_refresh, EXOSIP_REFRESH_MAX_PERIOD))
+        {
+            /* automatic refresh */
+            if (_eXosip_publish_refresh(NULL, &jpub->p_last_tr, NULL) == 0)
+                sent++;
+        }
+        else if (jpub->p_period != 0
+                 && now - jpub->p_last_tr->birth_time
+                 > _eXosip_refresh_delay(&jpub->p_refresh, jpub->p_period))
+        {
+            /* automatic refresh */
+            if (_eXosip_publish_refresh(NULL, &jpub->p_last_tr, NULL) == 0)
+                sent++;
+        }
+        else if (jpub->p_period != 0
+                 && now - jpub->p_last_tr->birth_time > 120
+                 && (jpub->p_last_tr->last_response == NULL
+                     ||
+                     (!MSG_IS_STATUS_2XX(jpub->p_last_tr->last_response))))
+        {
+            /* automatic refresh */
+            if (_eXosip_publish_refresh(NULL, &jpub->p_last_tr, NULL) == 0)
+                sent++;
+        }
+        else if (now - jpub->p_last_tr->birth_time < 120 &&
+                 jpub->p_last_tr->orig_request != NULL &&
+                 (jpub->p_last_tr->last_response != NULL
+                  && (jpub->p_last_tr->last_response->status_code == 401
+                      || jpub->p_last_tr->last_response->status_code ==
+                      407)))
+        {
+            if (jpub->p_retry < 3)
+            {
+                /* TODO: improve support for several retries when
+                   several credentials are needed */
+                if (_eXosip_retry_with_auth(NULL, &jpub->p_last_tr, NULL) == 0)
+                    sent++;
+                jpub->p_retry++;
+            }
+        }
+        else if (now - jpub->p_last_tr->birth_time < 120 &&
+                 jpub->p_last_tr->orig_request != NULL &&
+                 (jpub->p_last_tr->last_response != NULL
+                  && (jpub->p_last_tr->last_response->status_code == 412
+                      || jpub->p_last_tr->last_response->status_code ==
+                      423)))
+        {
+            if (_eXosip_publish_refresh(NULL, &jpub->p_last_tr, NULL) == 0)
+                sent++;
+        }
+    }
+    return sent;
+}
+
+#endif
+
+static int
+_eXosip_register_action(
+    eXosip_reg_t *jr,
+    time_t       now)
+{
+    int sent = 0;
+
+    if (jr->r_id >= 1 && jr->r_last_tr != NULL)
+    {
+        if (jr->r_reg_period != 0
+            && now - jr->r_last_tr->birth_time
+            > _eXosip_refresh_delay(&jr->r_refresh, EXOSIP_REFRESH_MAX_PERIOD))
+        {
+            /* automatic refresh */
+            if (eXosip_register_send_register(jr->r_id, NULL) == 0)
+                sent++;
+        }
+        else if (jr->r_reg_period != 0
+                 && now - jr->r_last_tr->birth_time
+                 > _eXosip_refresh_delay(&jr->r_refresh, jr->r_reg_period))
+        {
+            /* automatic refresh */
+            if (eXosip_register_send_register(jr->r_id, NULL) == 0)
+                sent++;
+        }
+        else if (jr->r_reg_period != 0
+                 && now - jr->r_last_tr->birth_time > 120
+                 && (jr->r_last_tr->last_response == NULL
+                     || (!MSG_IS_STATUS_2XX(jr->r_last_tr->last_response))))
+        {
+            /* automatic refresh */
+            if (eXosip_register_send_register(jr->r_id, NULL) == 0)
+                sent++;
+        }
+        else if (now - jr->r_last_tr->birth_time < 120 &&
+                 jr->r_last_tr->orig_request != NULL &&
+                 (jr->r_last_tr->last_response != NULL
+                  && (jr->r_last_tr->last_response->status_code == 401
+                      || jr->r_last_tr->last_response->status_code == 407
+                      || jr->r_last_tr->last_response->status_code == 423)))
+        {
+            if (jr->r_retry < 3)
+            {
+                /* TODO: improve support for several retries when
+                   several credentials are needed */
+                if (eXosip_register_send_register(jr->r_id, NULL) == 0)
+                    sent++;
+                jr->r_retry++;
+            }
+        }
+    }
+    return sent;
+}
+
 void
 eXosip_automatic_action(
     void)
 {
-    eXosip_call_t      *jc;
-    eXosip_dialog_t    *jd;
-#ifndef MINISIZE
-    eXosip_subscribe_t *js;
-    eXosip_notify_t    *jn;
-#endif
-
-    eXosip_reg_t       *jr;
+    eXosip_call_t         *jc;
+    eXosip_dialog_t       *jd;
 #ifndef MINISIZE
-    eXosip_pub_t       *jpub;
+    eXosip_notify_t       *jn;
 #endif
-    time_t             now;
+    struct eXosip_refresh **due;
+    int                   nb;
+    int                   pos;
+    time_t                now;
 
     now = time(NULL);
 
@@ -1057,101 +1318,6 @@ eXosip_automatic_action(
 
 #ifndef MINISIZE
 
-    for (js = eXosip.j_subscribes; js != NULL; js = js->next)
-    {
-        if (js->s_id < 1)
-        {}
-        else if (js->s_dialogs == NULL)
-        {
-            osip_transaction_t *out_tr = NULL;
-
-            out_tr = js->s_out_tr;
-
-            if (out_tr != NULL
-                && (out_tr->state == NICT_TERMINATED
-                    || out_tr->state == NICT_COMPLETED) &&
-                now - out_tr->birth_time < 120 &&
-                out_tr->orig_request != NULL &&
-                out_tr->last_response != NULL &&
-                (out_tr->last_response->status_code == 401
-                 || out_tr->last_response->status_code == 407
-                 || out_tr->last_response->status_code == 423))
-            {
-                /* retry with credential */
-                if (js->s_retry < 3)
-                {
-                    int i;
-
-                    i = _eXosip_subscribe_send_request_with_credential(js, NULL,
-                                                                       out_tr);
-                    if (i != 0)
-                    {
-                        OSIP_TRACE(osip_trace
-                                       (__FILE__, __LINE__, OSIP_ERROR, NULL,
-                                       "eXosip: could not clone msg for authentication\n"));
-                    }
-                    js->s_retry++;
-                }
-            }
-        }
-
-        for (jd = js->s_dialogs; jd != NULL; jd = jd->next)
-        {
-            if (jd->d_dialog != NULL)   /* finished call */
-            {
-                if (jd->d_id >= 1)
-                {
-                    osip_transaction_t *out_tr = NULL;
-
-                    out_tr = osip_list_get(jd->d_out_trs, 0);
-                    if (out_tr == NULL)
-                        out_tr = js->s_out_tr;
-
-                    if (out_tr != NULL
-                        && (out_tr->state == NICT_TERMINATED
-                            || out_tr->state == NICT_COMPLETED) &&
-                        now - out_tr->birth_time < 120 &&
-                        out_tr->orig_request != NULL &&
-                        out_tr->last_response != NULL &&
-                        (out_tr->last_response->status_code == 401
-                         || out_tr->last_response->status_code == 407))
-                    {
-                        /* retry with credential */
-                        if (jd->d_retry < 3)
-                        {
-                            int i;
-                            i = _eXosip_subscribe_send_request_with_credential(js,
-                                                                               jd,
-                                                                               out_tr);
-                            if (i != 0)
-                            {
-                                OSIP_TRACE(osip_trace
-                                               (__FILE__, __LINE__, OSIP_ERROR,
-                                               NULL,
-                                               "eXosip: could not clone suscbribe for authentication\n"));
-                            }
-                            jd->d_retry++;
-                        }
-                    }
-                    else if (js->s_reg_period == 0 || out_tr == NULL)
-                    {}
-                    else if (now - out_tr->birth_time > js->s_reg_period - (js->s_reg_period / 10))     /* will expires in js->s_reg_period/10 sec: send refresh! */
-                    {
-                        int i;
-
-                        i = _eXosip_subscribe_automatic_refresh(js, jd, out_tr);
-                        if (i != 0)
-                        {
-                            OSIP_TRACE(osip_trace
-                                           (__FILE__, __LINE__, OSIP_ERROR, NULL,
-                                           "eXosip: could not clone subscribe for refresh\n"));
-                        }
-                    }
-                }
-            }
-        }
-    }
-
     for (jn = eXosip.j_notifies; jn != NULL; jn = jn->next)
     {
         for (jd = jn->n_dialogs; jd != NULL; jd = jd->next)
@@ -1197,99 +1363,22 @@ eXosip_automatic_action(
 
 #endif
 
-    for (jr = eXosip.j_reg; jr != NULL; jr = jr->next)
+    /* registrations, subscriptions and publications: only the entries
+       with something to do are visited */
+    nb = _eXosip_refresh_due(now, &due);
+    for (pos = 0; pos < nb && _eXosip_refresh_allowed(now); pos++)
     {
-        if (jr->r_id >= 1 && jr->r_last_tr != NULL)
-        {
-            if (jr->r_reg_period != 0 && now - jr->r_last_tr->birth_time > 900)
-            {
-                /* automatic refresh */
-                eXosip_register_send_register(jr->r_id, NULL);
-            }
-            else if (jr->r_reg_period != 0
-                     && now - jr->r_last_tr->birth_time > jr->r_reg_period - (jr->r_reg_period / 10))
-            {
-                /* automatic refresh */
-                eXosip_register_send_register(jr->r_id, NULL);
-            }
-            else if (jr->r_reg_period != 0
-                     && now - jr->r_last_tr->birth_time > 120
-                     && (jr->r_last_tr->last_response == NULL
-                         || (!MSG_IS_STATUS_2XX(jr->r_last_tr->last_response))))
-            {
-                /* automatic refresh */
-                eXosip_register_send_register(jr->r_id, NULL);
-            }
-            else if (now - jr->r_last_tr->birth_time < 120 &&
-                     jr->r_last_tr->orig_request != NULL &&
-                     (jr->r_last_tr->last_response != NULL
-                      && (jr->r_last_tr->last_response->status_code == 401
-                          || jr->r_last_tr->last_response->status_code == 407
-                          || jr->r_last_tr->last_response->status_code == 423)))
-            {
-                if (jr->r_retry < 3)
-                {
-                    /* TODO: improve support for several retries when
-                       several credentials are needed */
-                    eXosip_register_send_register(jr->r_id, NULL);
-                    jr->r_retry++;
-                }
-            }
-        }
-    }
-
+        if (due[pos]->type == EXOSIP_REFRESH_REG)
+            _eXosip_refresh_sent(now, _eXosip_register_action((eXosip_reg_t *) due[pos]->owner, now));
 #ifndef MINISIZE
-    for (jpub = eXosip.j_pub; jpub != NULL; jpub = jpub->next)
-    {
-        if (jpub->p_id >= 1 && jpub->p_last_tr != NULL)
-        {
-            if (jpub->p_period != 0 && now - jpub->p_last_tr->birth_time > 900)
-            {
-                /* automatic refresh */
-                _eXosip_publish_refresh(NULL, &jpub->p_last_tr, NULL);
-            }
-            else if (jpub->p_period != 0
-                     && now - jpub->p_last_tr->birth_time > jpub->p_period - (jpub->p_period / 10))
-            {
-                /* automatic refresh */
-                _eXosip_publish_refresh(NULL, &jpub->p_last_tr, NULL);
-            }
-            else if (jpub->p_period != 0
-                     && now - jpub->p_last_tr->birth_time > 120
-                     && (jpub->p_last_tr->last_response == NULL
-                         ||
-                         (!MSG_IS_STATUS_2XX(jpub->p_last_tr->last_response))))
-            {
-                /* automatic refresh */
-                _eXosip_publish_refresh(NULL, &jpub->p_last_tr, NULL);
-            }
-            else if (now - jpub->p_last_tr->birth_time < 120 &&
-                     jpub->p_last_tr->orig_request != NULL &&
-                     (jpub->p_last_tr->last_response != NULL
-                      && (jpub->p_last_tr->last_response->status_code == 401
-                          || jpub->p_last_tr->last_response->status_code ==
-                          407)))
-            {
-                if (jpub->p_retry < 3)
-                {
-                    /* TODO: improve support for several retries when
-                       several credentials are needed */
-                    _eXosip_retry_with_auth(NULL, &jpub->p_last_tr, NULL);
-                    jpub->p_retry++;
-                }
-            }
-            else if (now - jpub->p_last_tr->birth_time < 120 &&
-                     jpub->p_last_tr->orig_request != NULL &&
-                     (jpub->p_last_tr->last_response != NULL
-                      && (jpub->p_last_tr->last_response->status_code == 412
-                          || jpub->p_last_tr->last_response->status_code ==
-                          423)))
-            {
-                _eXosip_publish_refresh(NULL, &jpub->p_last_tr, NULL);
-            }
-        }
-    }
+        else if (due[pos]->type == EXOSIP_REFRESH_SUBSCRIBE)
+            _eXosip_refresh_sent(now, _eXosip_subscribe_action((eXosip_subscribe_t *) due[pos]->owner, now));
+        else if (due[pos]->type == EXOSIP_REFRESH_PUBLISH)
+            _eXosip_refresh_sent(now, _eXosip_publish_action((eXosip_pub_t *) due[pos]->owner, now));
 #endif
+
+        _eXosip_refresh_update(due[pos]);
+    }
 }
 
 void
@@ -1314,6 +1403,7 @@ eXosip_update()
         {
             jc->c_id = static_id;
             static_id++;
+            _eXosip_index_add(EXOSIP_INDEX_CALL, jc->c_id, jc, NULL);
         }
         for (jd = jc->c_dialogs; jd != NULL; jd = jd->next)
         {
@@ -1323,10 +1413,15 @@ eXosip_update()
                 {
                     jd->d_id = static_id;
                     static_id++;
+                    _eXosip_index_add(EXOSIP_INDEX_CALL, jd->d_id, jc, jd);
                 }
             }
             else
+            {
+                if (jd->d_id > 0)
+                    _eXosip_index_remove(EXOSIP_INDEX_CALL, jd->d_id, jd);
                 jd->d_id = -1;
+            }
         }
     }
 
@@ -1337,6 +1432,7 @@ eXosip_update()
         {
             js->s_id = static_id;
             static_id++;
+            _eXosip_index_add(EXOSIP_INDEX_SUBSCRIBE, js->s_id, js, NULL);
         }
         for (jd = js->s_dialogs; jd != NULL; jd = jd->next)
         {
@@ -1346,10 +1442,15 @@ eXosip_update()
                 {
                     jd->d_id = static_id;
                     static_id++;
+                    _eXosip_index_add(EXOSIP_INDEX_SUBSCRIBE, jd->d_id, js, jd);
                 }
             }
             else
+            {
+                if (jd->d_id > 0)
+                    _eXosip_index_remove(EXOSIP_INDEX_SUBSCRIBE, jd->d_id, jd);
                 jd->d_id = -1;
+            }
         }
     }
 
@@ -1359,6 +1460,7 @@ eXosip_update()
         {
             jn->n_id = static_id;
             static_id++;
+            _eXosip_index_add(EXOSIP_INDEX_NOTIFY, jn->n_id, jn, NULL);
         }
         for (jd = jn->n_dialogs; jd != NULL; jd = jd->next)
         {
@@ -1368,10 +1470,15 @@ eXosip_update()
                 {
                     jd->d_id = static_id;
                     static_id++;
+                    _eXosip_index_add(EXOSIP_INDEX_NOTIFY, jd->d_id, jn, jd);
                 }
             }
             else
+            {
+                if (jd->d_id > 0)
+                    _eXosip_index_remove(EXOSIP_INDEX_NOTIFY, jd->d_id, jd);
                 jd->d_id = -1;
+            }
         }
     }
 #endif
@@ -1513,69 +1620,67 @@ eXosip_add_authentication_information(
     {
         /* we can add all credential that belongs to the same call-id */
         struct eXosip_http_auth *http_auth;
-        int                     pos;
 
         /* update entries with same call_id */
-        for (pos = 0; pos < MAX_EXOSIP_HTTP_AUTH; pos++)
+        for (http_auth = _eXosip_find_nonce(req->call_id->number, NULL);
+             http_auth != NULL;
+             http_auth = _eXosip_find_nonce(req->call_id->number, http_auth))
         {
-            http_auth = &eXosip.http_auths[pos];
-            if (http_auth->pszCallId[0] == '\0')
-                continue;
-            if (osip_strcasecmp(http_auth->pszCallId, req->call_id->number) == 0)
-            {
-                char *uri;
+            char       *uri;
+            const char *ha1;
 
-                authinfo =
-                    eXosip_find_authentication_info(req->from->url->username,
-                                                    http_auth->wa->realm);
-                if (authinfo == NULL)
-                {
-                    if (http_auth->wa->realm != NULL)
-                        OSIP_TRACE(osip_trace
-                                       (__FILE__, __LINE__, OSIP_INFO2, NULL,
-                                       "authinfo: No authentication found for %s %s\n",
-                                       req->from->url->username,
-                                       http_auth->wa->realm));
-                    return OSIP_NOTFOUND;
-                }
+            authinfo =
+                eXosip_find_authentication_info(req->from->url->username,
+                                                http_auth->wa->realm);
+            if (authinfo == NULL)
+            {
+                if (http_auth->wa->realm != NULL)
+                    OSIP_TRACE(osip_trace
+                                   (__FILE__, __LINE__, OSIP_INFO2, NULL,
+                                   "authinfo: No authentication found for %s %s\n",
+                                   req->from->url->username,
+                                   http_auth->wa->realm));
+                return OSIP_NOTFOUND;
+            }
 
-                i = osip_uri_to_str(req->req_uri, &uri);
-                if (i != 0)
-                    return i;
-
-                http_auth->iNonceCount++;
-                if (http_auth->answer_code == 401)
-                    /*osip_strcasecmp(req->sip_method, "REGISTER")==0) */
-                    i = __eXosip_create_authorization_header(http_auth->wa, uri,
-                                                             authinfo->userid,
-                                                             authinfo->passwd,
-                                                             authinfo->ha1, &aut,
-                                                             req->sip_method,
-                                                             http_auth->pszCNonce,
-                                                             http_auth->iNonceCount);
+            i = osip_uri_to_str(req->req_uri, &uri);
+            if (i != 0)
+                return i;
+
+            ha1 = _eXosip_get_ha1(authinfo, http_auth->wa->realm,
+                                  http_auth->wa->algorithm);
+            http_auth->iNonceCount++;
+            if (http_auth->answer_code == 401)
+                /*osip_strcasecmp(req->sip_method, "REGISTER")==0) */
+                i = __eXosip_create_authorization_header(http_auth->wa, uri,
+                                                         authinfo->userid,
+                                                         authinfo->passwd,
+                                                         ha1, &aut,
+                                                         req->sip_method,
+                                                         http_auth->pszCNonce,
+                                                         http_auth->iNonceCount);
+            else
+                i = __eXosip_create_proxy_authorization_header(http_auth->wa,
+                                                               uri,
+                                                               authinfo->userid,
+                                                               authinfo->passwd,
+                                                               ha1,
+                                                               &aut,
+                                                               req->sip_method,
+                                                               http_auth->pszCNonce,
+                                                               http_auth->iNonceCount);
+
+            osip_free(uri);
+            if (i != 0)
+                return i;
+
+            if (aut != NULL)
+            {
+                if (osip_strcasecmp(req->sip_method, "REGISTER") == 0)
+                    osip_list_add(&req->authorizations, aut, -1);
                 else
-                    i = __eXosip_create_proxy_authorization_header(http_auth->wa,
-                                                                   uri,
-                                                                   authinfo->userid,
-                                                                   authinfo->passwd,
-                                                                   authinfo->ha1,
-                                                                   &aut,
-                                                                   req->sip_method,
-                                                                   http_auth->pszCNonce,
-                                                                   http_auth->iNonceCount);
-
-                osip_free(uri);
-                if (i != 0)
-                    return i;
-
-                if (aut != NULL)
-                {
-                    if (osip_strcasecmp(req->sip_method, "REGISTER") == 0)
-                        osip_list_add(&req->authorizations, aut, -1);
-                    else
-                        osip_list_add(&req->proxy_authorizations, aut, -1);
-                    osip_message_force_update(req);
-                }
+                    osip_list_add(&req->proxy_authorizations, aut, -1);
+                osip_message_force_update(req);
             }
         }
         return OSIP_SUCCESS;
@@ -1615,7 +1720,10 @@ eXosip_add_authentication_information(
         i = __eXosip_create_authorization_header(wwwauth, uri,
                                                  authinfo->userid,
                                                  authinfo->passwd,
-                                                 authinfo->ha1, &aut,
+                                                 _eXosip_get_ha1(authinfo,
+                                                                 wwwauth->realm,
+                                                                 wwwauth->algorithm),
+                                                 &aut,
                                                  req->sip_method, "0a4f113b", 1);
         osip_free(uri);
         if (i != 0)
@@ -1678,7 +1786,9 @@ eXosip_add_authentication_information(
         i = __eXosip_create_proxy_authorization_header(proxyauth, uri,
                                                        authinfo->userid,
                                                        authinfo->passwd,
-                                                       authinfo->ha1,
+                                                       _eXosip_get_ha1(authinfo,
+                                                                       proxyauth->realm,
+                                                                       proxyauth->algorithm),
                                                        &proxy_aut, req->sip_method,
                                                        "0a4f113b", 1);
         osip_free(uri);
@@ -1767,6 +1877,7 @@ eXosip_mark_all_registrations_expired()
         {
             jr->r_last_tr->birth_time -= jr->r_reg_period;
             wakeup                     = 1;
+            _eXosip_refresh_update(&jr->r_refresh);
         }
     }
     if (wakeup)
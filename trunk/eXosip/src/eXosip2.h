@@ -140,6 +140,22 @@ struct __eXosip_sockaddr {
 };
     #endif
 
+    #define EXOSIP_REFRESH_REG        1
+    #define EXOSIP_REFRESH_SUBSCRIBE  2
+    #define EXOSIP_REFRESH_PUBLISH    3
+
+    #define EXOSIP_REFRESH_MAX_PERIOD 1000  /* refreshed at least every 800-900s */
+
+/* place of a registration, subscription or publication in the refresh
+   scheduler (jrefresh.c) */
+struct eXosip_refresh {
+    int    type;
+    void   *owner;
+    time_t deadline;
+    int    pos;                 /* 0: not scheduled */
+    int    jitter;              /* 1-1000, 0: not chosen yet */
+};
+
 typedef struct eXosip_dialog_t eXosip_dialog_t;
 
 struct eXosip_dialog_t {
@@ -180,6 +196,8 @@ struct eXosip_subscribe_t {
     osip_transaction_t *s_inc_tr;
     osip_transaction_t *s_out_tr;
 
+    struct eXosip_refresh s_refresh;
+
     eXosip_subscribe_t *next;
     eXosip_subscribe_t *parent;
 };
@@ -235,6 +253,7 @@ struct eXosip_reg_t {
 
     osip_transaction_t       *r_last_tr;
     int                      r_retry; /* avoid too many unsuccessfull retry */
+    struct eXosip_refresh    r_refresh;
 
     struct __eXosip_sockaddr addr;
     int                      len;
@@ -256,6 +275,7 @@ struct eXosip_pub_t {
 
     osip_transaction_t *p_last_tr;
     int                p_retry;
+    struct eXosip_refresh p_refresh;
     eXosip_pub_t       *next;
     eXosip_pub_t       *parent;
 };
@@ -277,6 +297,8 @@ struct jauthinfo_t {
     char        passwd[50];
     char        ha1[50];
     char        realm[50];
+    char        cache_realm[50];    /* realm of cache_ha1 */
+    char        cache_ha1[33];      /* H(A1) computed from passwd */
     jauthinfo_t *parent;
     jauthinfo_t *next;
 };
@@ -302,6 +324,11 @@ int __eXosip_create_proxy_authorization_header(osip_proxy_authenticate_t *wa,
 int _eXosip_store_nonce(const char *call_id, osip_proxy_authenticate_t *wa,
                         int answer_code);
 int _eXosip_delete_nonce(const char *call_id);
+struct eXosip_http_auth *_eXosip_find_nonce(const char *call_id,
+                                            struct eXosip_http_auth *previous);
+void _eXosip_nonce_free(void);
+const char *_eXosip_get_ha1(jauthinfo_t *authinfo, const char *realm,
+                            const char *algorithm);
 
 eXosip_event_t *eXosip_event_init_for_call(int type, eXosip_call_t *jc,
                                            eXosip_dialog_t *jd,
@@ -323,12 +350,16 @@ eXosip_event_t *eXosip_event_init_for_reg(int type, eXosip_reg_t *jr,
 eXosip_event_t *eXosip_event_init_for_message(int                type,
                                               osip_transaction_t *tr);
 
+int _eXosip_events_init(void);
+void _eXosip_events_free(void);
 int eXosip_event_init(eXosip_event_t **je, int type);
 void report_call_event(int evt, eXosip_call_t *jc, eXosip_dialog_t *jd,
                        osip_transaction_t *tr);
 void report_event(eXosip_event_t *je, osip_message_t *sip);
 int eXosip_event_add(eXosip_event_t *je);
 eXosip_event_t *eXosip_event_wait(int tv_s, int tv_ms);
+int eXosip_event_wait_batch(eXosip_event_t **events, int max, int tv_s,
+                            int tv_ms);
 eXosip_event_t *eXosip_event_get(void);
 
 typedef void (*eXosip_callback_t) (int type, eXosip_event_t *);
@@ -343,6 +374,7 @@ char *strdup_printf(const char *fmt, ...);
         osip_free(__strmsg);        \
     } while (0);
 
+/* initial size of the TCP/TLS connection tables: they grow on demand */
     #ifndef EXOSIP_MAX_SOCKETS
         #define EXOSIP_MAX_SOCKETS 200
     #endif
@@ -393,9 +425,22 @@ int _eXosip_sendto(int s, const void *buf, size_t len, int flags,
         #define MAX_EXOSIP_ACCOUNT_INFO 10
     #endif
 
-    #ifndef MAX_EXOSIP_HTTP_AUTH
-        #define MAX_EXOSIP_HTTP_AUTH    100
-    #endif
+    #define EXOSIP_INDEX_CALL      1
+    #define EXOSIP_INDEX_SUBSCRIBE 2
+    #define EXOSIP_INDEX_NOTIFY    3
+    #define EXOSIP_INDEX_REG       4
+
+typedef struct eXosip_index_entry eXosip_index_entry_t;
+
+struct eXosip_index_entry {
+    int                  type;  /* EXOSIP_INDEX_* */
+    int                  id;    /* c_id, s_id, n_id, r_id or d_id */
+    void                 *owner; /* eXosip_call_t, eXosip_subscribe_t... */
+    eXosip_dialog_t      *jd;   /* NULL for the owner itself */
+    char                 *call_id; /* dialogs only */
+    eXosip_index_entry_t *next_id;
+    eXosip_index_entry_t *next_call_id;
+};
 
 typedef struct eXosip_t eXosip_t;
 
@@ -427,11 +472,21 @@ struct eXosip_t {
     void                       *j_thread;
     jpipe_t                    *j_socketctl;
     jpipe_t                    *j_socketctl_event;
+    struct eXosip_worker       *j_workers;
+    int                        j_nb_workers;
+    struct osip_mutex          *j_cbsip_mutex; /* set while workers run */
     #endif
 
-    osip_fifo_t                *j_events;
+    osip_mpsc_fifo_t           *j_events;
+    #ifdef OSIP_MT
+    void                       *j_events_mutex;  /* serializes consumers */
+    volatile int               j_events_wakeup;  /* wakeup not consumed yet */
+    #endif
 
     jauthinfo_t                *authinfos;
+    struct eXosip_nonce        **nonce_buckets; /* challenges by Call-ID */
+    unsigned int               nonce_nb_buckets;
+    unsigned int               nonce_count;
 
     int                        keep_alive;
     int                        keep_alive_options;
@@ -445,6 +500,7 @@ struct eXosip_t {
     int                        use_rport;
     int                        dns_capabilities;
     int                        dscp;
+    int                        max_refresh_rate; /* per second, 0: no limit */
     char                       ipv4_for_gateway[256];
     char                       ipv6_for_gateway[256];
     #ifndef MINISIZE
@@ -452,7 +508,6 @@ struct eXosip_t {
     #endif
     struct eXosip_dns_cache    dns_entries[MAX_EXOSIP_DNS_ENTRY];
     struct eXosip_account_info account_entries[MAX_EXOSIP_ACCOUNT_INFO];
-    struct eXosip_http_auth    http_auths[MAX_EXOSIP_HTTP_AUTH];
 
     CbSipCallback              cbsipCallback;
 };
@@ -480,6 +535,18 @@ int eXosip_guess_ip_for_via(int family, char *address, int size);
 int eXosip_get_addrinfo(struct addrinfo **addrinfo, const char *hostname,
                         int service, int protocol);
 
+/**
+ * Same as eXosip_get_addrinfo(), without waiting for the resolver when
+ * the transaction can send its request later: returns 1 while the
+ * host name is being resolved.
+ *
+ * @param tr        transaction of the message.
+ * @param sip       message to send.
+ */
+int _eXosip_get_addrinfo_async(osip_transaction_t *tr, osip_message_t *sip,
+                               struct addrinfo **addrinfo, const char *hostname,
+                               int service, int protocol);
+
 int eXosip_set_callbacks(osip_t *osip);
 int cb_snd_message(osip_transaction_t *tr, osip_message_t *sip,
                    char *host, int port, int out_socket);
@@ -560,6 +627,15 @@ int eXosip_subscribe_dialog_find(int nid, eXosip_subscribe_t **js,
                                  eXosip_dialog_t **jd);
     #endif
 int eXosip_call_find(int cid, eXosip_call_t **jc);
+
+int _eXosip_index_init(void);
+void _eXosip_index_free(void);
+int _eXosip_index_add(int type, int id, void *owner, eXosip_dialog_t *jd);
+void _eXosip_index_remove(int type, int id, void *object);
+eXosip_index_entry_t *_eXosip_index_find(int type, int id);
+int _eXosip_index_match_as_uas(int type, osip_message_t *request,
+                               void **owner, eXosip_dialog_t **jd);
+
 int eXosip_dialog_set_200ok(eXosip_dialog_t *_jd, osip_message_t *_200Ok);
 
 int _eXosip_answer_invite_123456xx(eXosip_call_t *jc, eXosip_dialog_t *jd,
@@ -671,10 +747,51 @@ int _eXosip_transaction_init(osip_transaction_t **transaction,
 
 int _eXosip_srv_lookup(osip_message_t *sip, osip_naptr_t **naptr_record);
 
+typedef int (*eXosip_naptr_resolve_t)(osip_naptr_t *record, const char *domain,
+                                      int *ttl);
+
+/* addresses kept for a host name */
+    #define EXOSIP_RESOLVER_MAX_ADDR 8
+
+int _eXosip_resolver_init(void);
+void _eXosip_resolver_free(void);
+void _eXosip_resolver_flush(void);
+void _eXosip_resolver_set_dns_server(const char *server);
+int _eXosip_resolver_get_dns_server(char *server, size_t size);
+int _eXosip_resolver_addr(const char *name, int family, int wait,
+                          char ip[][65], int max);
+void _eXosip_resolver_addr_store(const char *name, int family,
+                                 char ip[][65], int nb, int ttl);
+int _eXosip_resolver_naptr(osip_naptr_t *record, const char *domain,
+                           eXosip_naptr_resolve_t resolve);
+int _eXosip_resolver_naptr_process(osip_naptr_t *record);
+int _eXosip_resolver_naptr_expired(const char *domain);
+
+void _eXosip_refresh_update(struct eXosip_refresh *refresh);
+void _eXosip_refresh_remove(struct eXosip_refresh *refresh);
+void _eXosip_refresh_free(void);
+int _eXosip_refresh_delay(struct eXosip_refresh *refresh, int period);
+int _eXosip_refresh_due(time_t now, struct eXosip_refresh ***due);
+int _eXosip_refresh_allowed(time_t now);
+void _eXosip_refresh_sent(time_t now, int nb);
+time_t _eXosip_refresh_next(void);
+
 void _eXosip_dnsutils_release(osip_naptr_t *naptr_record);
+int _eXosip_dnsutils_addr_lookup(const char *name, int family, char ip[][65],
+                                 int max, int *ttl_min);
+void _eXosip_dnsutils_close(void);
 
 int _eXosip_handle_incoming_message(char *buf, size_t len, int socket,
                                     char *host, int port);
+int _eXosip_process_incoming_message(char *buf, size_t len, int socket,
+                                     char *host, int port);
+void _eXosip_cbsip_message(osip_message_t *sip, int received);
+    #ifdef OSIP_MT
+int _eXosip_worker_start(int nb_workers);
+void _eXosip_worker_stop(void);
+int _eXosip_worker_dispatch(char *buf, size_t len, int socket,
+                            char *host, int port);
+    #endif
 
     #ifdef __cplusplus
 }
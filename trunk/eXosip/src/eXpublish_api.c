@@ -188,6 +188,7 @@ eXosip_publish(
     if (pub->p_last_tr != NULL)
         osip_list_add(&eXosip.j_transactions, pub->p_last_tr, 0);
     pub->p_last_tr          = transaction;
+    _eXosip_refresh_update(&pub->p_refresh);
 
     sipevent                = osip_new_outgoing_sipmessage(message);
     sipevent->transactionid = transaction->transactionid;
@@ -32,16 +32,10 @@ static eXosip_reg_t *
 eXosip_reg_find(
     int rid)
 {
-    eXosip_reg_t *jr;
+    eXosip_reg_t *jr = NULL;
 
-    for (jr = eXosip.j_reg; jr != NULL; jr = jr->next)
-    {
-        if (jr->r_id == rid)
-        {
-            return jr;
-        }
-    }
-    return NULL;
+    eXosip_reg_find_id(&jr, rid);
+    return jr;
 }
 
 int
@@ -104,6 +98,7 @@ _eXosip_register_build_register(
             tr            = jr->r_last_tr;
             jr->r_last_tr = NULL;
             osip_list_add(&eXosip.j_transactions, tr, 0);
+            _eXosip_refresh_update(&jr->r_refresh);
 
             /* modify the REGISTER request */
             {
@@ -392,6 +387,7 @@ eXosip_register_send_register(
     }
 
     jr->r_last_tr           = transaction;
+    _eXosip_refresh_update(&jr->r_refresh);
 
     /* send REGISTER */
     sipevent                = osip_new_outgoing_sipmessage(reg);
@@ -0,0 +1,795 @@
+/*
+   eXosip - This is the eXtended osip library.
+   Copyright (C) 2002,2003,2004,2005,2006,2007  Aymeric MOIZARD  - jack@atosc.org
+
+   eXosip is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   eXosip is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef ENABLE_MPATROL
+    #include <mpatrol.h>
+#endif
+
+#include "eXosip2.h"
+
+extern eXosip_t eXosip;
+
+/*
+   Cache of the DNS answers and asynchronous resolver.
+
+   Answers are cached by name and type:
+     - EXOSIP_RESOLVER_ADDR: addresses of a host name (up to
+       EXOSIP_RESOLVER_MAX_ADDR), kept for the smallest TTL of the A or
+       AAAA records. Names the DNS does not know (hosts file...) are
+       resolved with getaddrinfo(), which does not give the TTL: they
+       are kept EXOSIP_RESOLVER_ADDR_TTL seconds.
+     - EXOSIP_RESOLVER_NAPTR: NAPTR and SRV records of a domain, as an
+       osip_naptr_t, kept for the smallest TTL of the records.
+   Failures are cached EXOSIP_RESOLVER_NEGATIVE_TTL seconds.
+
+   With OSIP_MT, queries are run by a resolver thread:
+     - the record of a NAPTR query stays in OSIP_NAPTR_STATE_INPROGRESS
+       and is completed by _eXosip_resolver_naptr_process() once the
+       answer is in the cache.
+     - _eXosip_resolver_addr() returns 0 until the addresses are known,
+       if the caller can retry later: the transactions retry their
+       message (see _eXosip_get_addrinfo_async()).
+   A query for a name already being resolved waits for the same answer.
+
+   The resolver thread is the only one using the DNS state of
+   _eXosip_dnsutils_addr_lookup() and of the NAPTR queries: it is
+   rebuilt by the thread when the DNS server option changes. A caller
+   which cannot wait for the thread uses getaddrinfo().
+
+   The least recently used entries are released when the cache is full.
+ */
+
+    #define EXOSIP_RESOLVER_MAX_ENTRIES  256
+    #define EXOSIP_RESOLVER_HASH_SIZE    64
+    #define EXOSIP_RESOLVER_ADDR_TTL     60
+    #define EXOSIP_RESOLVER_NEGATIVE_TTL 30
+
+    #define EXOSIP_RESOLVER_ADDR         1
+    #define EXOSIP_RESOLVER_NAPTR        2
+
+    #define EXOSIP_RESOLVER_PENDING      0
+    #define EXOSIP_RESOLVER_DONE         1
+    #define EXOSIP_RESOLVER_FAILED       2
+
+typedef struct eXosip_resolver_entry eXosip_resolver_entry_t;
+
+struct eXosip_resolver_entry {
+    eXosip_resolver_entry_t *next;  /* lru list: most recently used first */
+    eXosip_resolver_entry_t *prev;
+    eXosip_resolver_entry_t *hnext; /* hash chain */
+    int                     type;
+    int                     family;
+    char                    name[256];
+    int                     state;
+    int                     version; /* of the DNS server option */
+    time_t                  expires;
+    int                     nb_ip;   /* EXOSIP_RESOLVER_ADDR */
+    char                    ip[EXOSIP_RESOLVER_MAX_ADDR][65];
+    osip_naptr_t            *naptr;  /* EXOSIP_RESOLVER_NAPTR */
+    eXosip_naptr_resolve_t  resolve;
+};
+
+static eXosip_resolver_entry_t *resolver_hash[EXOSIP_RESOLVER_HASH_SIZE];
+static eXosip_resolver_entry_t *resolver_lru_head;
+static eXosip_resolver_entry_t *resolver_lru_tail;
+static int                     resolver_count;
+
+/* EXOSIP_OPT_SET_DNS_SERVER: the version changes with the option */
+static char                    resolver_dns_server[64];
+static int                     resolver_dns_version;
+
+    #ifdef OSIP_MT
+static struct osip_mutex       *resolver_mutex;
+static struct osip_thread      *resolver_thread;
+static osip_fifo_t             *resolver_queue;
+static int                     resolver_stop;   /* set to stop the thread */
+
+        #define RESOLVER_LOCK()     osip_mutex_lock(resolver_mutex)
+        #define RESOLVER_UNLOCK()   osip_mutex_unlock(resolver_mutex)
+        #define RESOLVER_OWNS_DNS() (resolver_mutex == NULL)
+    #else
+        #define RESOLVER_LOCK()
+        #define RESOLVER_UNLOCK()
+        #define RESOLVER_OWNS_DNS() 1
+    #endif
+
+static unsigned int
+_eXosip_resolver_hash(
+    int        type,
+    const char *name)
+{
+    unsigned int hash = 5381 + type;
+
+    while (*name != '\0')
+    {
+        unsigned char c = (unsigned char) *name;
+
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        hash = ((hash << 5) + hash) + c;
+        name++;
+    }
+    return hash % EXOSIP_RESOLVER_HASH_SIZE;
+}
+
+static void
+_eXosip_resolver_lru_unlink(
+    eXosip_resolver_entry_t *entry)
+{
+    if (entry->prev != NULL)
+        entry->prev->next = entry->next;
+    else
+        resolver_lru_head = entry->next;
+    if (entry->next != NULL)
+        entry->next->prev = entry->prev;
+    else
+        resolver_lru_tail = entry->prev;
+    entry->next = NULL;
+    entry->prev = NULL;
+}
+
+static void
+_eXosip_resolver_lru_push(
+    eXosip_resolver_entry_t *entry)
+{
+    entry->prev = NULL;
+    entry->next = resolver_lru_head;
+    if (resolver_lru_head != NULL)
+        resolver_lru_head->prev = entry;
+    resolver_lru_head = entry;
+    if (resolver_lru_tail == NULL)
+        resolver_lru_tail = entry;
+}
+
+static void
+_eXosip_resolver_release(
+    eXosip_resolver_entry_t *entry)
+{
+    eXosip_resolver_entry_t **prev;
+
+    prev = &resolver_hash[_eXosip_resolver_hash(entry->type, entry->name)];
+    while (*prev != entry)
+        prev = &(*prev)->hnext;
+    *prev = entry->hnext;
+
+    _eXosip_resolver_lru_unlink(entry);
+    resolver_count--;
+    osip_free(entry->naptr);
+    osip_free(entry);
+}
+
+static eXosip_resolver_entry_t *
+_eXosip_resolver_find(
+    int        type,
+    int        family,
+    const char *name)
+{
+    eXosip_resolver_entry_t *entry;
+
+    for (entry = resolver_hash[_eXosip_resolver_hash(type, name)];
+         entry != NULL; entry = entry->hnext)
+    {
+        if (entry->type == type && entry->family == family
+            && osip_strcasecmp(entry->name, name) == 0)
+        {
+            /* most recently used */
+            _eXosip_resolver_lru_unlink(entry);
+            _eXosip_resolver_lru_push(entry);
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static eXosip_resolver_entry_t *
+_eXosip_resolver_add(
+    int        type,
+    int        family,
+    const char *name)
+{
+    eXosip_resolver_entry_t *entry;
+    unsigned int            slot;
+
+    if (strlen(name) >= sizeof(entry->name))
+        return NULL;
+
+    /* release the least recently used answers (never a pending query) */
+    for (entry = resolver_lru_tail;
+         entry != NULL && resolver_count >= EXOSIP_RESOLVER_MAX_ENTRIES;)
+    {
+        eXosip_resolver_entry_t *prev = entry->prev;
+
+        if (entry->state != EXOSIP_RESOLVER_PENDING)
+            _eXosip_resolver_release(entry);
+        entry = prev;
+    }
+
+    entry = (eXosip_resolver_entry_t *) osip_malloc(sizeof(eXosip_resolver_entry_t));
+    if (entry == NULL)
+        return NULL;
+    memset(entry, 0, sizeof(eXosip_resolver_entry_t));
+    entry->type    = type;
+    entry->family  = family;
+    entry->state   = EXOSIP_RESOLVER_PENDING;
+    entry->version = resolver_dns_version;
+    osip_strncpy(entry->name, name, sizeof(entry->name) - 1);
+
+    slot                = _eXosip_resolver_hash(type, name);
+    entry->hnext        = resolver_hash[slot];
+    resolver_hash[slot] = entry;
+    _eXosip_resolver_lru_push(entry);
+    resolver_count++;
+    return entry;
+}
+
+/* give the answer to an entry: called with the lock */
+static void
+_eXosip_resolver_done(
+    eXosip_resolver_entry_t *entry,
+    int                     state,
+    int                     ttl)
+{
+    /* answer of the previous DNS server: for the waiting callers only */
+    if (entry->version != resolver_dns_version)
+        ttl = 0;
+    entry->expires = time(NULL) + ttl;
+    entry->state   = state;
+}
+
+/* store the answer of a NAPTR query: called without the lock */
+static void
+_eXosip_resolver_naptr_resolve(
+    eXosip_resolver_entry_t *entry)
+{
+    osip_naptr_t *naptr;
+    int          ttl = EXOSIP_RESOLVER_NEGATIVE_TTL;
+    int          state;
+
+    naptr = (osip_naptr_t *) osip_malloc(sizeof(osip_naptr_t));
+    if (naptr != NULL)
+    {
+        memset(naptr, 0, sizeof(osip_naptr_t));
+        entry->resolve(naptr, entry->name, &ttl);
+    }
+
+    if (naptr == NULL || naptr->naptr_state == OSIP_NAPTR_STATE_RETRYLATER)
+    {
+        /* temporary failure: give the answer to the waiting records only */
+        state = EXOSIP_RESOLVER_FAILED;
+        ttl   = 0;
+    }
+    else if (naptr->naptr_state == OSIP_NAPTR_STATE_SRVDONE)
+        state = EXOSIP_RESOLVER_DONE;
+    else
+    {
+        state = EXOSIP_RESOLVER_FAILED;
+        ttl   = EXOSIP_RESOLVER_NEGATIVE_TTL;
+    }
+
+    RESOLVER_LOCK();
+    entry->naptr = naptr;
+    _eXosip_resolver_done(entry, state, ttl);
+    RESOLVER_UNLOCK();
+}
+
+/* addresses of a host name with getaddrinfo(): hosts file, system DNS */
+static int
+_eXosip_resolver_getaddrinfo(
+    const char *name,
+    int        family,
+    char       ip[][65],
+    int        max)
+{
+    struct addrinfo hints;
+    struct addrinfo *addrinfo;
+    struct addrinfo *elem;
+    int             nb = 0;
+    int             error;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = family;
+    hints.ai_socktype = SOCK_DGRAM; /* one answer per address */
+    hints.ai_protocol = IPPROTO_UDP;
+    error             = getaddrinfo(name, NULL, &hints, &addrinfo);
+    if (error != 0)
+    {
+        OSIP_TRACE(osip_trace
+                       (__FILE__, __LINE__, OSIP_INFO2, NULL,
+                       "getaddrinfo failure. %s (%d)\n", name, error));
+        return (error == EAI_NONAME) ? OSIP_NOTFOUND : OSIP_UNKNOWN_HOST;
+    }
+
+    for (elem = addrinfo; elem != NULL && nb < max; elem = elem->ai_next)
+    {
+        if (getnameinfo(elem->ai_addr, elem->ai_addrlen, ip[nb], 65, NULL, 0,
+                        NI_NUMERICHOST) == 0)
+            nb++;
+    }
+    freeaddrinfo(addrinfo);
+    return (nb > 0) ? nb : OSIP_NOTFOUND;
+}
+
+/*
+   addresses of a host name: called without the lock. use_dns is set
+   when the caller may use the DNS state (see RESOLVER_OWNS_DNS()).
+   Returns the number of addresses and their TTL, or an error and the
+   time to keep it.
+ */
+static int
+_eXosip_resolver_addr_lookup(
+    const char *name,
+    int        family,
+    int        use_dns,
+    char       ip[][65],
+    int        *ttl)
+{
+    int nb = OSIP_UNDEFINED_ERROR;
+    int i;
+
+    if (use_dns)
+    {
+        *ttl = 0x7fffffff;
+        nb   = _eXosip_dnsutils_addr_lookup(name, family, ip, EXOSIP_RESOLVER_MAX_ADDR, ttl);
+        if (nb > 0)
+            return nb;
+    }
+
+    /* not in the DNS (hosts file...), or no DNS API giving the TTL */
+    i = _eXosip_resolver_getaddrinfo(name, family, ip, EXOSIP_RESOLVER_MAX_ADDR);
+    if (i > 0)
+        *ttl = EXOSIP_RESOLVER_ADDR_TTL;
+    else if (i == OSIP_NOTFOUND || nb == OSIP_NOTFOUND)
+    {
+        *ttl = EXOSIP_RESOLVER_NEGATIVE_TTL;
+        i    = OSIP_UNKNOWN_HOST;
+    }
+    else
+    {
+        /* temporary failure: give the answer to the waiting callers only */
+        *ttl = 0;
+        i    = OSIP_UNKNOWN_HOST;
+    }
+    return i;
+}
+
+/* called with the lock */
+static void
+_eXosip_resolver_addr_set(
+    eXosip_resolver_entry_t *entry,
+    char                    ip[][65],
+    int                     nb,
+    int                     ttl)
+{
+    if (nb > 0)
+    {
+        memcpy(entry->ip, ip, nb * sizeof(entry->ip[0]));
+        entry->nb_ip = nb;
+        _eXosip_resolver_done(entry, EXOSIP_RESOLVER_DONE, ttl);
+    }
+    else
+    {
+        entry->nb_ip = 0;
+        _eXosip_resolver_done(entry, EXOSIP_RESOLVER_FAILED, ttl);
+    }
+}
+
+/* called with the lock */
+static int
+_eXosip_resolver_addr_copy(
+    eXosip_resolver_entry_t *entry,
+    char                    ip[][65],
+    int                     max)
+{
+    int nb;
+
+    if (entry->state != EXOSIP_RESOLVER_DONE)
+        return OSIP_UNKNOWN_HOST;
+    nb = (entry->nb_ip < max) ? entry->nb_ip : max;
+    memcpy(ip, entry->ip, nb * sizeof(entry->ip[0]));
+    return nb;
+}
+
+    #ifdef OSIP_MT
+
+/* store the addresses of a host name: called by the resolver thread */
+static void
+_eXosip_resolver_addr_resolve(
+    eXosip_resolver_entry_t *entry)
+{
+    char ip[EXOSIP_RESOLVER_MAX_ADDR][65];
+    int  ttl;
+    int  nb;
+
+    nb = _eXosip_resolver_addr_lookup(entry->name, entry->family, 1, ip, &ttl);
+    RESOLVER_LOCK();
+    _eXosip_resolver_addr_set(entry, ip, nb, ttl);
+    RESOLVER_UNLOCK();
+}
+
+static void *
+_eXosip_resolver_thread(
+    void *arg)
+{
+    for (;;)
+    {
+        eXosip_resolver_entry_t *entry;
+
+        int                     stop;
+
+        entry = (eXosip_resolver_entry_t *) osip_fifo_get(resolver_queue);
+        RESOLVER_LOCK();
+        stop = resolver_stop;
+        RESOLVER_UNLOCK();
+        if (stop)
+            break;
+        if (entry == NULL)
+            continue;
+
+        if (entry->type == EXOSIP_RESOLVER_ADDR)
+            _eXosip_resolver_addr_resolve(entry);
+        else
+            _eXosip_resolver_naptr_resolve(entry);
+        /* let the transactions retry their message */
+        __eXosip_wakeup();
+    }
+    _eXosip_dnsutils_close();
+    osip_thread_exit();
+    return NULL;
+}
+
+    #endif
+
+/* give an entry to the resolver thread */
+static int
+_eXosip_resolver_queue(
+    eXosip_resolver_entry_t *entry)
+{
+    #ifdef OSIP_MT
+    if (resolver_mutex != NULL)
+    {
+        if (resolver_thread == NULL)
+            resolver_thread = osip_thread_create(20000, _eXosip_resolver_thread, NULL);
+        if (resolver_thread != NULL && osip_fifo_add(resolver_queue, entry) == 0)
+            return OSIP_SUCCESS;
+    }
+    #endif
+    return OSIP_UNDEFINED_ERROR;
+}
+
+int
+_eXosip_resolver_init(
+    void)
+{
+    _eXosip_resolver_free();
+    #ifdef OSIP_MT
+    resolver_mutex = (struct osip_mutex *) osip_mutex_init();
+    if (resolver_mutex == NULL)
+        return OSIP_NOMEM;
+    resolver_queue = (osip_fifo_t *) osip_malloc(sizeof(osip_fifo_t));
+    if (resolver_queue == NULL)
+    {
+        osip_mutex_destroy(resolver_mutex);
+        resolver_mutex = NULL;
+        return OSIP_NOMEM;
+    }
+    osip_fifo_init(resolver_queue);
+    #endif
+    return OSIP_SUCCESS;
+}
+
+void
+_eXosip_resolver_free(
+    void)
+{
+    #ifdef OSIP_MT
+    if (resolver_thread != NULL)
+    {
+        /* wake the thread up even when the queue is full */
+        RESOLVER_LOCK();
+        resolver_stop = 1;
+        RESOLVER_UNLOCK();
+        osip_sem_post(resolver_queue->qisempty);
+        osip_thread_join(resolver_thread);
+        osip_free(resolver_thread);
+        resolver_thread = NULL;
+        resolver_stop   = 0;
+    }
+    if (resolver_mutex != NULL)
+    {
+        /* pending queries were released with their entries */
+        while (osip_fifo_tryget(resolver_queue) != NULL)
+        {}
+        osip_fifo_free(resolver_queue);
+        resolver_queue = NULL;
+        osip_mutex_destroy(resolver_mutex);
+        resolver_mutex = NULL;
+    }
+    #endif
+    while (resolver_lru_head != NULL)
+        _eXosip_resolver_release(resolver_lru_head);
+    /* like the other options, the DNS server is not kept by eXosip_quit() */
+    if (resolver_dns_server[0] != '\0')
+    {
+        resolver_dns_server[0] = '\0';
+        resolver_dns_version++;
+    }
+}
+
+/* called with the lock */
+static void
+_eXosip_resolver_release_answers(
+    void)
+{
+    eXosip_resolver_entry_t *entry;
+
+    for (entry = resolver_lru_head; entry != NULL;)
+    {
+        eXosip_resolver_entry_t *next = entry->next;
+
+        if (entry->state != EXOSIP_RESOLVER_PENDING)
+            _eXosip_resolver_release(entry);
+        entry = next;
+    }
+}
+
+void
+_eXosip_resolver_flush(
+    void)
+{
+    RESOLVER_LOCK();
+    _eXosip_resolver_release_answers();
+    RESOLVER_UNLOCK();
+}
+
+void
+_eXosip_resolver_set_dns_server(
+    const char *server)
+{
+    RESOLVER_LOCK();
+    memset(resolver_dns_server, '\0', sizeof(resolver_dns_server));
+    if (server != NULL)
+        osip_strncpy(resolver_dns_server, server, sizeof(resolver_dns_server) - 1);
+    resolver_dns_version++;
+    /* answers of the previous server are not used */
+    _eXosip_resolver_release_answers();
+    RESOLVER_UNLOCK();
+}
+
+int
+_eXosip_resolver_get_dns_server(
+    char   *server,
+    size_t size)
+{
+    int version;
+
+    RESOLVER_LOCK();
+    osip_strncpy(server, resolver_dns_server, size - 1);
+    version = resolver_dns_version;
+    RESOLVER_UNLOCK();
+    return version;
+}
+
+int
+_eXosip_resolver_addr(
+    const char *name,
+    int        family,
+    int        wait,
+    char       ip[][65],
+    int        max)
+{
+    eXosip_resolver_entry_t *entry;
+    char                    answer[EXOSIP_RESOLVER_MAX_ADDR][65];
+    int                     ttl;
+    int                     nb;
+
+    if (name == NULL || name[0] == '\0' || max <= 0)
+        return OSIP_BADPARAMETER;
+
+    RESOLVER_LOCK();
+    entry = _eXosip_resolver_find(EXOSIP_RESOLVER_ADDR, family, name);
+    if (entry != NULL && entry->state != EXOSIP_RESOLVER_PENDING
+        && entry->expires <= time(NULL))
+    {
+        _eXosip_resolver_release(entry);
+        entry = NULL;
+    }
+    if (entry != NULL)
+    {
+        if (entry->state != EXOSIP_RESOLVER_PENDING)
+            nb = _eXosip_resolver_addr_copy(entry, ip, max);
+        else if (wait == 0)
+            nb = 0;                 /* wait for the same answer */
+        else
+            entry = NULL;           /* resolved again below */
+        RESOLVER_UNLOCK();
+        if (entry != NULL)
+            return nb;
+    }
+    else
+    {
+        entry = _eXosip_resolver_add(EXOSIP_RESOLVER_ADDR, family, name);
+        RESOLVER_UNLOCK();
+        if (entry != NULL)
+        {
+            OSIP_TRACE(osip_trace
+                           (__FILE__, __LINE__, OSIP_INFO2, NULL,
+                           "eXosip: resolving '%s'\n", name));
+            if (wait == 0 && _eXosip_resolver_queue(entry) == OSIP_SUCCESS)
+                return 0;
+        }
+    }
+
+    /* the caller cannot wait for the resolver thread (or there is none) */
+    nb = _eXosip_resolver_addr_lookup(name, family, RESOLVER_OWNS_DNS(), answer, &ttl);
+    if (entry != NULL)
+    {
+        RESOLVER_LOCK();
+        _eXosip_resolver_addr_set(entry, answer, nb, ttl);
+        RESOLVER_UNLOCK();
+    }
+    if (nb <= 0)
+        return nb;
+    if (nb > max)
+        nb = max;
+    memcpy(ip, answer, nb * sizeof(answer[0]));
+    return nb;
+}
+
+void
+_eXosip_resolver_addr_store(
+    const char *name,
+    int        family,
+    char       ip[][65],
+    int        nb,
+    int        ttl)
+{
+    eXosip_resolver_entry_t *entry;
+
+    RESOLVER_LOCK();
+    entry = _eXosip_resolver_find(EXOSIP_RESOLVER_ADDR, family, name);
+    if (entry == NULL)
+        entry = _eXosip_resolver_add(EXOSIP_RESOLVER_ADDR, family, name);
+    /* a pending entry belongs to the resolver thread */
+    else if (entry->state == EXOSIP_RESOLVER_PENDING)
+        entry = NULL;
+    if (entry != NULL)
+        _eXosip_resolver_addr_set(entry, ip, nb, ttl);
+    RESOLVER_UNLOCK();
+}
+
+static void
+_eXosip_resolver_naptr_copy(
+    osip_naptr_t *record,
+    osip_naptr_t *answer)
+{
+    void *arg          = record->arg;
+    int  keep_in_cache = record->keep_in_cache;
+
+    memcpy(record, answer, sizeof(osip_naptr_t));
+    record->arg           = arg;
+    record->keep_in_cache = keep_in_cache;
+}
+
+int
+_eXosip_resolver_naptr(
+    osip_naptr_t           *record,
+    const char             *domain,
+    eXosip_naptr_resolve_t resolve)
+{
+    eXosip_resolver_entry_t *entry;
+    int                     queue = 0;
+
+    if (record == NULL || domain == NULL || strlen(domain) >= sizeof(entry->name))
+        return OSIP_BADPARAMETER;
+
+    snprintf(record->domain, sizeof(record->domain), "%s", domain);
+    record->naptr_state = OSIP_NAPTR_STATE_INPROGRESS;
+
+    RESOLVER_LOCK();
+    entry = _eXosip_resolver_find(EXOSIP_RESOLVER_NAPTR, 0, domain);
+    if (entry != NULL && entry->state != EXOSIP_RESOLVER_PENDING
+        && entry->expires <= time(NULL))
+    {
+        _eXosip_resolver_release(entry);
+        entry = NULL;
+    }
+    if (entry == NULL)
+    {
+        entry = _eXosip_resolver_add(EXOSIP_RESOLVER_NAPTR, 0, domain);
+        if (entry == NULL)
+        {
+            RESOLVER_UNLOCK();
+            record->naptr_state = OSIP_NAPTR_STATE_RETRYLATER;
+            return OSIP_NOMEM;
+        }
+        entry->resolve = resolve;
+        queue          = 1;
+    }
+    else if (entry->state != EXOSIP_RESOLVER_PENDING)
+    {
+        if (entry->naptr != NULL)
+            _eXosip_resolver_naptr_copy(record, entry->naptr);
+        else
+            record->naptr_state = OSIP_NAPTR_STATE_RETRYLATER;
+    }
+    RESOLVER_UNLOCK();
+
+    if (queue == 0)
+        return OSIP_SUCCESS;
+
+    OSIP_TRACE(osip_trace
+                   (__FILE__, __LINE__, OSIP_INFO2, NULL,
+                   "eXosip: resolving '%s NAPTR'\n", domain));
+    if (_eXosip_resolver_queue(entry) == OSIP_SUCCESS)
+        return OSIP_SUCCESS;
+
+    if (!RESOLVER_OWNS_DNS())
+    {
+        /* the DNS state belongs to the resolver thread: retry later */
+        RESOLVER_LOCK();
+        _eXosip_resolver_done(entry, EXOSIP_RESOLVER_FAILED, 0);
+        RESOLVER_UNLOCK();
+        return _eXosip_resolver_naptr_process(record);
+    }
+
+    /* no resolver thread: resolve now */
+    _eXosip_resolver_naptr_resolve(entry);
+    return _eXosip_resolver_naptr_process(record);
+}
+
+int
+_eXosip_resolver_naptr_process(
+    osip_naptr_t *record)
+{
+    eXosip_resolver_entry_t *entry;
+
+    if (record == NULL)
+        return OSIP_BADPARAMETER;
+    if (record->naptr_state != OSIP_NAPTR_STATE_INPROGRESS)
+        return OSIP_SUCCESS;
+
+    RESOLVER_LOCK();
+    entry = _eXosip_resolver_find(EXOSIP_RESOLVER_NAPTR, 0, record->domain);
+    if (entry == NULL)
+        record->naptr_state = OSIP_NAPTR_STATE_RETRYLATER;  /* flushed */
+    else if (entry->state != EXOSIP_RESOLVER_PENDING)
+    {
+        if (entry->naptr != NULL)
+            _eXosip_resolver_naptr_copy(record, entry->naptr);
+        else
+            record->naptr_state = OSIP_NAPTR_STATE_RETRYLATER;
+    }
+    RESOLVER_UNLOCK();
+    return OSIP_SUCCESS;
+}
+
+int
+_eXosip_resolver_naptr_expired(
+    const char *domain)
+{
+    eXosip_resolver_entry_t *entry;
+    int                     expired;
+
+    RESOLVER_LOCK();
+    entry   = _eXosip_resolver_find(EXOSIP_RESOLVER_NAPTR, 0, domain);
+    expired = (entry == NULL
+               || (entry->state != EXOSIP_RESOLVER_PENDING && entry->expires <= time(NULL)));
+    RESOLVER_UNLOCK();
+    return expired;
+}
@@ -297,6 +297,7 @@ dtls_tl_free(
     memset(dtls_firewall_ip,   0, sizeof(dtls_firewall_ip));
     memset(dtls_firewall_port, 0, sizeof(dtls_firewall_port));
     memset(&ai_addr,           0, sizeof(struct sockaddr_storage));
+    _eXtl_poll_del(dtls_socket);
     if (dtls_socket > 0)
         close(dtls_socket);
     dtls_socket = 0;
@@ -415,6 +416,7 @@ dtls_tl_open(
     }
 
     dtls_socket = sock;
+    _eXtl_poll_add(dtls_socket, &eXtl_dtls, NULL);
 
     if (eXtl_dtls.proto_port == 0)
     {
@@ -766,7 +768,7 @@ dtls_tl_send_message(
     size_t                   length = 0;
     struct addrinfo          *addrinfo;
     struct __eXosip_sockaddr addr;
-    char                     *message;
+    const char               *message;
 
     char                     ipbuf[INET6_ADDRSTRLEN];
     int                      i;
@@ -916,7 +918,12 @@ dtls_tl_send_message(
                     if (srv->ipaddress[0])
                         i = eXosip_get_addrinfo(&addrinfo, srv->ipaddress, srv->port, IPPROTO_UDP);
                     else
-                        i = eXosip_get_addrinfo(&addrinfo, srv->srv, srv->port, IPPROTO_UDP);
+                        i = _eXosip_get_addrinfo_async(tr, sip, &addrinfo, srv->srv, srv->port, IPPROTO_UDP);
+                    if (i == 1)
+                    {
+                        /* 4: keep waiting (address of the target not received) */
+                        return OSIP_SUCCESS + 1;
+                    }
                     if (i == 0)
                     {
                         host = srv->srv;
@@ -955,7 +962,12 @@ dtls_tl_send_message(
     /* if SRV was used, destination may be already found */
     if (i != 0)
     {
-        i = eXosip_get_addrinfo(&addrinfo, host, port, IPPROTO_UDP);
+        i = _eXosip_get_addrinfo_async(tr, sip, &addrinfo, host, port, IPPROTO_UDP);
+        if (i == 1)
+        {
+            /* keep waiting (address not received) */
+            return OSIP_SUCCESS + 1;
+        }
     }
 
     if (i != 0)
@@ -980,7 +992,7 @@ dtls_tl_send_message(
         {
             osip_list_remove(&sip->routes, 0);
         }
-        i = osip_message_to_str(sip, &message, &length);
+        i = osip_message_to_str_cached(sip, &message, &length);
         if (tag == NULL && route != NULL && route->url != NULL)
         {
             osip_list_add(&sip->routes, route, 0);
@@ -1096,7 +1108,6 @@ dtls_tl_send_message(
 
             memset(&dtls_socket_tab[pos], 0, sizeof(struct socket_tab));
 
-            osip_free(message);
             return -1;
         }
 
@@ -1112,7 +1123,6 @@ dtls_tl_send_message(
 
             memset(&dtls_socket_tab[pos], 0, sizeof(struct socket_tab));
 
-            osip_free(message);
             return -1;
         }
 
@@ -1155,13 +1165,11 @@ dtls_tl_send_message(
             /* rotate on failure! */
             if (eXosip_dnsutils_rotate_srv(&naptr_record->sipdtls_record) > 0)
             {
-                osip_free(message);
                 return OSIP_SUCCESS; /* retry for next retransmission! */
             }
         }
         #endif
         /* SIP_NETWORK_ERROR; */
-        osip_free(message);
         return -1;
     }
 
@@ -1179,7 +1187,6 @@ dtls_tl_send_message(
         }
     }
 
-    osip_free(message);
     return OSIP_SUCCESS;
 }
 
@@ -1219,6 +1226,7 @@ dtls_tl_set_socket(
     int socket)
 {
     dtls_socket = socket;
+    _eXtl_poll_add(dtls_socket, &eXtl_dtls, NULL);
 
     return OSIP_SUCCESS;
 }
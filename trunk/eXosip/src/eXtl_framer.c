@@ -0,0 +1,190 @@
+/*
+   eXosip - This is the eXtended osip library.
+   Copyright (C) 2002,2003,2004,2005,2006,2007  Aymeric MOIZARD  - jack@atosc.org
+
+   eXosip is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   eXosip is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef ENABLE_MPATROL
+    #include <mpatrol.h>
+#endif
+
+#include "eXosip2.h"
+
+/*
+   Framing of the SIP messages received on a stream (tcp and tls).
+
+   The receive buffer of a connection may hold several messages, or
+   only the beginning of one. The framer remembers, for the message at
+   the start of the buffer, how far it has already searched for the
+   end of the headers and, once found, the size of the headers and the
+   Content-Length: each byte is scanned once whatever the number of
+   recv() needed to get a large message.
+
+   The positions are relative to the start of the buffer, so the
+   transport may realloc it or memmove the unconsumed bytes to its start
+   between two calls.
+ */
+
+    #define END_HEADERS_STR "\r\n\r\n"
+    #define END_HEADERS_LEN 4
+
+/* Like strstr, but works for haystack that may contain binary data and is
+   not NUL-terminated. */
+static const char *
+buffer_find(
+    const char *haystack,
+    size_t     haystack_len,
+    const char *needle)
+{
+    const char *search = haystack, *end = haystack + haystack_len;
+    const char *p;
+    size_t     len = strlen(needle);
+
+    while (search < end &&
+           (p = memchr(search, *needle, end - search)) != NULL)
+    {
+        if (p + len > end)
+            break;
+        if (memcmp(p, needle, len) == 0)
+            return (p);
+        search = p + 1;
+    }
+
+    return (NULL);
+}
+
+/* find "Content-Length" or "l" in the headers, in a single pass.
+   return -1 when there is none. */
+static int
+_eXtl_framer_content_length(
+    const char *buf,
+    const char *end_headers)
+{
+    const char *p = buf;
+
+    while (p < end_headers)
+    {
+        const char *name;
+        size_t     name_len;
+
+        /* next line; end_headers points on the last CRLF */
+        p = memchr(p, '\n', end_headers - p);
+        if (p == NULL)
+            break;
+        p++;
+
+        name = p;
+        while (p < end_headers && *p != ':' && *p != ' ' && *p != '\t' && *p != '\r')
+            p++;
+        name_len = p - name;
+        while (p < end_headers && (*p == ' ' || *p == '\t'))
+            p++;
+
+        if (p < end_headers && *p == ':'
+            && ((name_len == 14 && osip_strncasecmp(name, "content-length", 14) == 0)
+                || (name_len == 1 && (*name == 'l' || *name == 'L'))))
+        {
+            int clen = 0;
+
+            p++;
+            while (p < end_headers && (*p == ' ' || *p == '\t'))
+                p++;
+            while (p < end_headers && *p >= '0' && *p <= '9')
+            {
+                clen = clen * 10 + (*p - '0');
+                p++;
+            }
+            return clen;
+        }
+    }
+    return -1;
+}
+
+int
+_eXtl_framer_consume(
+    struct eXtl_framer *framer,
+    char               *buf,
+    size_t             buflen,
+    int                socket,
+    char               *remote_ip,
+    int                remote_port)
+{
+    size_t consumed = 0;
+
+    while (buflen > 0)
+    {
+        size_t msglen;
+
+        if (framer->header_len == 0)
+        {
+            const char *end_headers;
+            size_t     start = 0;
+            int        clen;
+
+            /* CRLFCRLF may have been cut by the previous read */
+            if (framer->scan_pos >= END_HEADERS_LEN)
+                start = framer->scan_pos - (END_HEADERS_LEN - 1);
+
+            end_headers = buffer_find(buf + start, buflen - start, END_HEADERS_STR);
+            if (end_headers == NULL)
+            {
+                framer->scan_pos = buflen;
+                break;
+            }
+
+            if (end_headers == buf)
+            {
+                /* skip tcp standard keep-alive */
+                OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
+                                      "socket %s:%i: standard keep alive received (CRLFCRLF)\n",
+                                      remote_ip, remote_port));
+                consumed        += END_HEADERS_LEN;
+                buflen          -= END_HEADERS_LEN;
+                buf             += END_HEADERS_LEN;
+                framer->scan_pos = 0;
+                continue;
+            }
+
+            clen = _eXtl_framer_content_length(buf, end_headers + 2);
+            if (clen < 0)
+            {
+                /* Oops, no content-length header.	Presume 0 so we
+                   consume the headers and make forward progress.  This permits
+                   server-side keepalive of "\r\n\r\n". */
+                OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
+                                      "socket %s:%i: message has no content-length\n",
+                                      remote_ip, remote_port));
+                clen = 0;
+            }
+            framer->header_len     = end_headers - buf + END_HEADERS_LEN;
+            framer->content_length = clen;
+        }
+
+        /* do we have the whole message? */
+        msglen = framer->header_len + framer->content_length;
+        if (msglen > buflen)
+            break;
+
+        /* yep; handle the message */
+        _eXosip_handle_incoming_message(buf, msglen, socket, remote_ip, remote_port);
+        consumed += msglen;
+        buflen   -= msglen;
+        buf      += msglen;
+        memset(framer, 0, sizeof(struct eXtl_framer));
+    }
+
+    return (int) consumed;
+}
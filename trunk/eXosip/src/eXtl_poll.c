@@ -0,0 +1,284 @@
+/*
+   eXosip - This is the eXtended osip library.
+   Copyright (C) 2002,2003,2004,2005,2006,2007  Aymeric MOIZARD  - jack@atosc.org
+
+   eXosip is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   eXosip is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef ENABLE_MPATROL
+    #include <mpatrol.h>
+#endif
+
+#include "eXosip2.h"
+#include "eXtransport.h"
+
+#ifdef HAVE_SYS_EPOLL_H
+
+    #include <sys/epoll.h>
+    #include <unistd.h>
+
+extern eXosip_t eXosip;
+
+/*
+   epoll backend for eXosip_read_message().
+
+   The transports register their sockets once, when they are opened or
+   accepted, and remove them before closing them. eXosip_read_message()
+   then waits on the epoll descriptor and only visits the sockets that
+   are readable, instead of rebuilding fd_sets for every socket of every
+   transport.
+
+   A ready socket is given to tl_read_fd() of its transport. Transports
+   without tl_read_fd() get a fd_set that contains the socket alone.
+ */
+
+    #define EXTL_POLL_MAX_EVENTS 64
+
+struct eXtl_poll_owner {
+    int                  used;
+    struct eXtl_protocol *tl;   /* NULL: the wakeup pipe */
+    void                 *ctx;
+};
+
+static int                    poll_fd = -1;
+static struct eXtl_poll_owner *poll_owners;
+static int                    poll_owners_size;
+
+int
+_eXtl_poll_init(
+    void)
+{
+    if (poll_fd >= 0)
+        return OSIP_SUCCESS;
+
+    poll_fd = epoll_create(EXOSIP_MAX_SOCKETS);
+    if (poll_fd < 0)
+    {
+        OSIP_TRACE(osip_trace
+                       (__FILE__, __LINE__, OSIP_WARNING, NULL,
+                       "eXosip: epoll_create failed, using select()\n"));
+        return OSIP_UNDEFINED_ERROR;
+    }
+    return OSIP_SUCCESS;
+}
+
+void
+_eXtl_poll_free(
+    void)
+{
+    if (poll_fd >= 0)
+        close(poll_fd);
+    poll_fd          = -1;
+    osip_free(poll_owners);
+    poll_owners      = NULL;
+    poll_owners_size = 0;
+}
+
+int
+_eXtl_poll_enabled(
+    void)
+{
+    return poll_fd >= 0;
+}
+
+int
+_eXtl_poll_add(
+    int                  fd,
+    struct eXtl_protocol *tl,
+    void                 *ctx)
+{
+    struct epoll_event ev;
+
+    if (poll_fd < 0)
+        return OSIP_SUCCESS;    /* select() is in use */
+    if (fd < 0)
+        return OSIP_BADPARAMETER;
+
+    if (fd >= poll_owners_size)
+    {
+        struct eXtl_poll_owner *owners;
+        int                    size = poll_owners_size * 2;
+
+        if (size < 64)
+            size = 64;
+        while (size <= fd)
+            size *= 2;
+        owners = (struct eXtl_poll_owner *) osip_realloc(poll_owners,
+                                                         size * sizeof(struct eXtl_poll_owner));
+        if (owners == NULL)
+            return OSIP_NOMEM;
+        memset(owners + poll_owners_size, 0,
+               (size - poll_owners_size) * sizeof(struct eXtl_poll_owner));
+        poll_owners      = owners;
+        poll_owners_size = size;
+    }
+
+    /* level triggered: the transports read once per wakeup */
+    memset(&ev, 0, sizeof(ev));
+    ev.events  = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(poll_fd, poll_owners[fd].used ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+                  fd, &ev) != 0)
+    {
+        OSIP_TRACE(osip_trace
+                       (__FILE__, __LINE__, OSIP_ERROR, NULL,
+                       "eXosip: cannot add socket %i to epoll: %s\n",
+                       fd, strerror(errno)));
+        return OSIP_UNDEFINED_ERROR;
+    }
+
+    poll_owners[fd].used = 1;
+    poll_owners[fd].tl   = tl;
+    poll_owners[fd].ctx  = ctx;
+    return OSIP_SUCCESS;
+}
+
+void
+_eXtl_poll_del(
+    int fd)
+{
+    struct epoll_event ev;
+
+    if (poll_fd < 0 || fd < 0 || fd >= poll_owners_size || !poll_owners[fd].used)
+        return;
+
+    /* kernels before 2.6.9 want a non NULL event */
+    memset(&ev, 0, sizeof(ev));
+    epoll_ctl(poll_fd, EPOLL_CTL_DEL, fd, &ev);
+    memset(&poll_owners[fd], 0, sizeof(struct eXtl_poll_owner));
+}
+
+int
+_eXtl_poll_wait(
+    int sec_max,
+    int usec_max)
+{
+    struct epoll_event events[EXTL_POLL_MAX_EVENTS];
+    int                timeout = -1;
+    int                nb;
+    int                i;
+
+    if ((sec_max != -1) && (usec_max != -1))
+        timeout = sec_max * 1000 + (usec_max + 999) / 1000;
+
+    nb = epoll_wait(poll_fd, events, EXTL_POLL_MAX_EVENTS, timeout);
+    if (nb < 0)
+    {
+        if (errno == EINTR)
+            return 0;
+        return -1;
+    }
+
+    for (i = 0; i < nb; i++)
+    {
+        int                    fd = events[i].data.fd;
+        struct eXtl_poll_owner *owner;
+
+        /* may have been closed while handling a previous event */
+        if (fd >= poll_owners_size || !poll_owners[fd].used)
+            continue;
+        owner = &poll_owners[fd];
+
+        if (owner->tl == NULL)
+        {
+    #ifdef OSIP_MT
+            char buf2[500];
+
+            jpipe_read(eXosip.j_socketctl, buf2, 499);
+    #endif
+            continue;
+        }
+        if (eXosip.j_stop_ua != 0)
+            continue;
+
+        if (owner->tl->tl_read_fd != NULL)
+            owner->tl->tl_read_fd(fd, owner->ctx);
+        else if (fd < FD_SETSIZE)
+        {
+            fd_set osip_fdset;
+            fd_set osip_wrset;
+
+            FD_ZERO(&osip_fdset);
+            FD_ZERO(&osip_wrset);
+            eXFD_SET(fd, &osip_fdset);
+            owner->tl->tl_read_message(&osip_fdset, &osip_wrset);
+        }
+    }
+    return nb;
+}
+
+#endif
+
+#if !defined(WIN32) && !defined(_WIN32_WCE)
+    #include <poll.h>
+#endif
+
+/* listening, UDP, DTLS and wakeup sockets of the select() loop */
+#define EXTL_SELECT_RESERVED 8
+
+/*
+   Without epoll, eXosip_read_message() puts every socket in one fd_set.
+   On win32, a fd_set holds FD_SETSIZE sockets of any value; elsewhere,
+   it holds the descriptors below FD_SETSIZE. The transports refuse the
+   connections that would not fit, instead of never reading them.
+ */
+int
+_eXtl_select_fits(
+    int sock,
+    int nb_sockets)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (_eXtl_poll_enabled())
+        return 1;
+#endif
+#if defined(WIN32) || defined(_WIN32_WCE)
+    return nb_sockets + EXTL_SELECT_RESERVED < FD_SETSIZE;
+#else
+    return sock < FD_SETSIZE;
+#endif
+}
+
+/*
+   Wait until one socket is readable (wr == 0) or writable (wr != 0).
+   Returns like select(): >0 when ready, 0 on timeout, <0 on error.
+   poll() has no FD_SETSIZE limit; win32 keeps select(), whose fd_set
+   takes any socket value.
+ */
+int
+_eXtl_wait_socket(
+    int sock,
+    int wr,
+    int timeout_ms)
+{
+#if defined(WIN32) || defined(_WIN32_WCE)
+    struct timeval tv;
+    fd_set         fdset;
+
+    tv.tv_sec  = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    FD_ZERO(&fdset);
+    eXFD_SET(sock, &fdset);
+    if (wr)
+        return select(sock + 1, NULL, &fdset, NULL, &tv);
+    return select(sock + 1, &fdset, NULL, NULL, &tv);
+#else
+    struct pollfd pfd;
+
+    pfd.fd      = sock;
+    pfd.events  = wr ? POLLOUT : POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, timeout_ms);
+#endif
+}
@@ -74,6 +74,7 @@ struct _tcp_sockets {
     char             *buf;     /* recv buffer */
     size_t           bufsize;  /* allocated size of buf */
     size_t           buflen;   /* current length of buf */
+    struct eXtl_framer framer; /* framing state of buf */
     char             *sendbuf; /* send buffer */
     size_t           sendbufsize;
     size_t           sendbuflen;
@@ -95,7 +96,11 @@ struct _tcp_sockets {
 
 static int _tcp_tl_send_sockinfo(struct _tcp_sockets *sockinfo, const char *msg, int msglen);
 
-static struct _tcp_sockets tcp_socket_tab[EXOSIP_MAX_SOCKETS];
+/* The table starts with EXOSIP_MAX_SOCKETS entries and doubles when
+   they are all in use. Entries are allocated one by one and never
+   move: the poll loop and the callers keep pointers to them. */
+static struct _tcp_sockets **tcp_socket_tab;
+static int                 tcp_socket_tab_size;
 
 static int
 tcp_tl_init(
@@ -103,7 +108,8 @@ tcp_tl_init(
 {
     tcp_socket = 0;
     memset(&ai_addr,          0, sizeof(struct sockaddr_storage));
-    memset(&tcp_socket_tab,   0, sizeof(struct _tcp_sockets) * EXOSIP_MAX_SOCKETS);
+    tcp_socket_tab      = NULL;
+    tcp_socket_tab_size = 0;
     memset(tcp_firewall_ip,   0, sizeof(tcp_firewall_ip));
     memset(tcp_firewall_port, 0, sizeof(tcp_firewall_port));
     return OSIP_SUCCESS;
@@ -113,6 +119,7 @@ static void
 _tcp_tl_close_sockinfo(
     struct _tcp_sockets *sockinfo)
 {
+    _eXtl_poll_del(sockinfo->socket);
     closesocket(sockinfo->socket);
     if (sockinfo->buf != NULL)
         osip_free(sockinfo->buf);
@@ -141,20 +148,80 @@ tcp_tl_free(
     memset(tcp_firewall_ip,   0, sizeof(tcp_firewall_ip));
     memset(tcp_firewall_port, 0, sizeof(tcp_firewall_port));
     memset(&ai_addr,          0, sizeof(struct sockaddr_storage));
+    _eXtl_poll_del(tcp_socket);
     if (tcp_socket > 0)
         closesocket(tcp_socket);
 
-    for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
+    for (pos = 0; pos < tcp_socket_tab_size; pos++)
     {
-        if (tcp_socket_tab[pos].socket > 0)
+        if (tcp_socket_tab[pos]->socket > 0)
         {
-            _tcp_tl_close_sockinfo(&tcp_socket_tab[pos]);
+            _tcp_tl_close_sockinfo(tcp_socket_tab[pos]);
         }
+        osip_free(tcp_socket_tab[pos]);
     }
+    osip_free(tcp_socket_tab);
+    tcp_socket_tab      = NULL;
+    tcp_socket_tab_size = 0;
 
     return OSIP_SUCCESS;
 }
 
+static int
+_tcp_tl_nb_sockets(
+    void)
+{
+    int pos;
+    int nb = 0;
+
+    for (pos = 0; pos < tcp_socket_tab_size; pos++)
+    {
+        if (tcp_socket_tab[pos]->socket > 0)
+            nb++;
+    }
+    return nb;
+}
+
+static int
+_tcp_tl_new_sockinfo(
+    void)
+{
+    struct _tcp_sockets **tab;
+    int                 size;
+    int                 pos;
+
+    for (pos = 0; pos < tcp_socket_tab_size; pos++)
+    {
+        if (tcp_socket_tab[pos]->socket == 0)
+            return pos;
+    }
+
+    size = tcp_socket_tab_size * 2;
+    if (size < EXOSIP_MAX_SOCKETS)
+        size = EXOSIP_MAX_SOCKETS;
+    tab  = (struct _tcp_sockets **) osip_realloc(tcp_socket_tab,
+                                                 size * sizeof(struct _tcp_sockets *));
+    if (tab == NULL)
+        return -1;
+    tcp_socket_tab = tab;
+
+    for (pos = tcp_socket_tab_size; pos < size; pos++)
+    {
+        tcp_socket_tab[pos] = (struct _tcp_sockets *) osip_malloc(sizeof(struct _tcp_sockets));
+        if (tcp_socket_tab[pos] == NULL)
+            break;
+        memset(tcp_socket_tab[pos], 0, sizeof(struct _tcp_sockets));
+    }
+    if (pos == tcp_socket_tab_size)
+        return -1;
+
+    OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO2, NULL,
+                          "tcp_socket_tab grown to %i entries\n", pos));
+    size                = tcp_socket_tab_size;
+    tcp_socket_tab_size = pos;
+    return size;
+}
+
 static int
 tcp_tl_open(
     void)
@@ -262,6 +329,7 @@ tcp_tl_open(
     }
 
     tcp_socket = sock;
+    _eXtl_poll_add(tcp_socket, &eXtl_tcp, NULL);
 
     if (eXtl_tcp.proto_port == 0)
     {
@@ -297,129 +365,21 @@ tcp_tl_set_fdset(
     if (tcp_socket > *fd_max)
         *fd_max = tcp_socket;
 
-    for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
+    for (pos = 0; pos < tcp_socket_tab_size; pos++)
     {
-        if (tcp_socket_tab[pos].socket > 0)
+        if (tcp_socket_tab[pos]->socket > 0)
         {
-            eXFD_SET(tcp_socket_tab[pos].socket, osip_fdset);
-            if (tcp_socket_tab[pos].socket > *fd_max)
-                *fd_max = tcp_socket_tab[pos].socket;
-            if (tcp_socket_tab[pos].sendbuflen > 0)
-                eXFD_SET(tcp_socket_tab[pos].socket, osip_wrset);
+            eXFD_SET(tcp_socket_tab[pos]->socket, osip_fdset);
+            if (tcp_socket_tab[pos]->socket > *fd_max)
+                *fd_max = tcp_socket_tab[pos]->socket;
+            if (tcp_socket_tab[pos]->sendbuflen > 0)
+                eXFD_SET(tcp_socket_tab[pos]->socket, osip_wrset);
         }
     }
 
     return OSIP_SUCCESS;
 }
 
-/* Like strstr, but works for haystack that may contain binary data and is
-   not NUL-terminated. */
-static char *
-buffer_find(
-    const char *haystack,
-    size_t     haystack_len,
-    const char *needle)
-{
-    const char *search = haystack, *end = haystack + haystack_len;
-    char       *p;
-    size_t     len = strlen(needle);
-
-    while (search < end &&
-           (p = memchr(search, *needle, end - search)) != NULL)
-    {
-        if (p + len > end)
-            break;
-        if (memcmp(p, needle, len) == 0)
-            return (p);
-        search = p + 1;
-    }
-
-    return (NULL);
-}
-
-#define END_HEADERS_STR          "\r\n\r\n"
-#define CLEN_HEADER_STR          "\r\ncontent-length:"
-#define CLEN_HEADER_COMPACT_STR  "\r\nl:"
-#define CLEN_HEADER_STR2         "\r\ncontent-length "
-#define CLEN_HEADER_COMPACT_STR2 "\r\nl "
-#define const_strlen(x) (sizeof((x)) - 1)
-
-/* consume any complete messages in sockinfo->buf and
-   return the total number of bytes consumed */
-static int
-handle_messages(
-    struct _tcp_sockets *sockinfo)
-{
-    int    consumed = 0;
-    char   *buf     = sockinfo->buf;
-    size_t buflen   = sockinfo->buflen;
-    char   *end_headers;
-    while (buflen > 0 && (end_headers = buffer_find(buf, buflen, END_HEADERS_STR)) != NULL)
-    {
-        int  clen, msglen;
-        char *clen_header;
-
-        if (buf == end_headers)
-        {
-            /* skip tcp standard keep-alive */
-            OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
-                                  "socket %s:%i: standard keep alive received (CRLFCRLF)\n",
-                                  sockinfo->remote_ip, sockinfo->remote_port, buf));
-            consumed += 4;
-            buflen   -= 4;
-            buf      += 4;
-            continue;
-        }
-
-        /* stuff a nul in so we can use osip_strcasestr */
-        *end_headers = '\0';
-
-        /* ok we have complete headers, find content-length: or l: */
-        clen_header  = osip_strcasestr(buf, CLEN_HEADER_STR);
-        if (!clen_header)
-            clen_header = osip_strcasestr(buf, CLEN_HEADER_STR2);
-        if (!clen_header)
-            clen_header = osip_strcasestr(buf, CLEN_HEADER_COMPACT_STR);
-        if (!clen_header)
-            clen_header = osip_strcasestr(buf, CLEN_HEADER_COMPACT_STR2);
-        if (clen_header != NULL)
-        {
-            clen_header = strchr(clen_header, ':');
-            clen_header++;
-        }
-        if (!clen_header)
-        {
-            /* Oops, no content-length header.	Presume 0 (below) so we
-                consume the headers and make forward progress.  This permits
-                server-side keepalive of "\r\n\r\n". */
-            OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
-                                  "socket %s:%i: message has no content-length: <%s>\n",
-                                  sockinfo->remote_ip, sockinfo->remote_port, buf));
-        }
-        clen         = clen_header ? atoi(clen_header) : 0;
-
-        /* undo our overwrite and advance end_headers */
-        *end_headers = END_HEADERS_STR[0];
-        end_headers += const_strlen(END_HEADERS_STR);
-
-        /* do we have the whole message? */
-        msglen       = end_headers - buf + clen;
-        if (msglen > buflen)
-        {
-            /* nope */
-            return consumed;
-        }
-        /* yep; handle the message */
-        _eXosip_handle_incoming_message(buf, msglen, sockinfo->socket,
-                                        sockinfo->remote_ip, sockinfo->remote_port);
-        consumed += msglen;
-        buflen   -= msglen;
-        buf      += msglen;
-    }
-
-    return consumed;
-}
-
 static int
 _tcp_tl_recv(
     struct _tcp_sockets *sockinfo)
@@ -481,7 +441,9 @@ _tcp_tl_recv(
         OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
                               "socket %s:%i: read %d bytes\n", sockinfo->remote_ip, sockinfo->remote_port, r));
         sockinfo->buflen += r;
-        consumed          = handle_messages(sockinfo);
+        consumed          = _eXtl_framer_consume(&sockinfo->framer, sockinfo->buf,
+                                                 sockinfo->buflen, sockinfo->socket,
+                                                 sockinfo->remote_ip, sockinfo->remote_port);
         if (consumed == 0)
         {
             return OSIP_SUCCESS;
@@ -503,156 +465,175 @@ _tcp_tl_recv(
 }
 
 static int
-tcp_tl_read_message(
-    fd_set *osip_fdset,
-    fd_set *osip_wrset)
+_tcp_tl_accept(
+    void)
 {
-    int pos = 0;
-
-    if (FD_ISSET(tcp_socket, osip_fdset))
-    {
-        /* accept incoming connection */
-        char                    src6host[NI_MAXHOST];
-        int                     recvport = 0;
-        struct sockaddr_storage sa;
-        int                     sock;
-        int                     i;
+    /* accept incoming connection */
+    char                    src6host[NI_MAXHOST];
+    int                     recvport = 0;
+    struct sockaddr_storage sa;
+    int                     sock;
+    int                     i;
+    int                     pos;
 
 #ifdef __linux
-        socklen_t               slen;
+    socklen_t               slen;
 #else
-        int                     slen;
+    int                     slen;
 #endif
-        if (eXtl_tcp.proto_family == AF_INET)
-            slen = sizeof(struct sockaddr_in);
-        else
-            slen = sizeof(struct sockaddr_in6);
+    if (eXtl_tcp.proto_family == AF_INET)
+        slen = sizeof(struct sockaddr_in);
+    else
+        slen = sizeof(struct sockaddr_in6);
 
-        for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
-        {
-            if (tcp_socket_tab[pos].socket == 0)
-                break;
-        }
-        if (pos == EXOSIP_MAX_SOCKETS)
-        {
-            /* delete an old one! */
-            pos = 0;
-            if (tcp_socket_tab[pos].socket > 0)
-            {
-                _tcp_tl_close_sockinfo(&tcp_socket_tab[pos]);
-            }
-            memset(&tcp_socket_tab[pos], 0, sizeof(tcp_socket_tab[pos]));
-        }
+    pos = _tcp_tl_new_sockinfo();
+    if (pos < 0)
+        return OSIP_NOMEM;
 
-        OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO3, NULL,
-                              "creating TCP socket at index: %i\n", pos));
-        sock = accept(tcp_socket, (struct sockaddr *) &sa, &slen);
-        if (sock < 0)
-        {
+    OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO3, NULL,
+                          "creating TCP socket at index: %i\n", pos));
+    sock = accept(tcp_socket, (struct sockaddr *) &sa, &slen);
+    if (sock < 0)
+    {
 #if defined(EBADF)
-            int status = ex_errno;
+        int status = ex_errno;
 #endif
-            OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
-                                  "Error accepting TCP socket\n"));
+        OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
+                              "Error accepting TCP socket\n"));
 #if defined(EBADF)
-            if (status == EBADF)
-            {
-                OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
-                                      "Error accepting TCP socket: EBADF\n"));
-                memset(&ai_addr, 0, sizeof(struct sockaddr_storage));
-                if (tcp_socket > 0)
-                    closesocket(tcp_socket);
-                tcp_tl_open();
-            }
-#endif
-        }
-        else
+        if (status == EBADF)
         {
-            tcp_socket_tab[pos].socket = sock;
-            OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
-                                  "New TCP connection accepted\n"));
+            OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
+                                  "Error accepting TCP socket: EBADF\n"));
+            memset(&ai_addr, 0, sizeof(struct sockaddr_storage));
+            _eXtl_poll_del(tcp_socket);
+            if (tcp_socket > 0)
+                closesocket(tcp_socket);
+            tcp_tl_open();
+        }
+#endif
+    }
+    else if (!_eXtl_select_fits(sock, _tcp_tl_nb_sockets()))
+    {
+        OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_WARNING, NULL,
+                              "TCP connection refused: too many sockets for select()\n"));
+        closesocket(sock);
+        return -1;
+    }
+    else
+    {
+        tcp_socket_tab[pos]->socket = sock;
+        _eXtl_poll_add(sock, &eXtl_tcp, tcp_socket_tab[pos]);
+        OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
+                              "New TCP connection accepted\n"));
 
-            memset(src6host, 0, sizeof(src6host));
+        memset(src6host, 0, sizeof(src6host));
 
-            if (eXtl_tcp.proto_family == AF_INET)
-                recvport = ntohs(((struct sockaddr_in *) &sa)->sin_port);
-            else
-                recvport = ntohs(((struct sockaddr_in6 *) &sa)->sin6_port);
+        if (eXtl_tcp.proto_family == AF_INET)
+            recvport = ntohs(((struct sockaddr_in *) &sa)->sin_port);
+        else
+            recvport = ntohs(((struct sockaddr_in6 *) &sa)->sin6_port);
 
 #if defined(__arc__)
-            {
-                struct sockaddr_in *fromsa = (struct sockaddr_in *) &sa;
-                char               *tmp;
-                tmp = inet_ntoa(fromsa->sin_addr);
-                if (tmp == NULL)
-                {
-                    OSIP_TRACE(osip_trace
-                                   (__FILE__, __LINE__, OSIP_ERROR, NULL,
-                                   "Message received from: NULL:%i inet_ntoa failure\n",
-                                   recvport));
-                }
-                else
-                {
-                    snprintf(src6host, sizeof(src6host), "%s", tmp);
-                    OSIP_TRACE(osip_trace
-                                   (__FILE__, __LINE__, OSIP_INFO1, NULL,
-                                   "Message received from: %s:%i\n", src6host,
-                                   recvport));
-                    osip_strncpy(tcp_socket_tab[pos].remote_ip, src6host,
-                                 sizeof(tcp_socket_tab[pos].remote_ip) - 1);
-                    tcp_socket_tab[pos].remote_port = recvport;
-                }
-            }
-#else
-            i = getnameinfo((struct sockaddr *) &sa, slen,
-                            src6host, NI_MAXHOST, NULL, 0, NI_NUMERICHOST);
-
-            if (i != 0)
+        {
+            struct sockaddr_in *fromsa = (struct sockaddr_in *) &sa;
+            char               *tmp;
+            tmp = inet_ntoa(fromsa->sin_addr);
+            if (tmp == NULL)
             {
                 OSIP_TRACE(osip_trace
                                (__FILE__, __LINE__, OSIP_ERROR, NULL,
-                               "Message received from: NULL:%i getnameinfo failure\n",
+                               "Message received from: NULL:%i inet_ntoa failure\n",
                                recvport));
-                snprintf(src6host, sizeof(src6host), "127.0.0.1");
             }
             else
             {
+                snprintf(src6host, sizeof(src6host), "%s", tmp);
                 OSIP_TRACE(osip_trace
                                (__FILE__, __LINE__, OSIP_INFO1, NULL,
-                               "Message received from: %s:%i\n", src6host, recvport));
-                osip_strncpy(tcp_socket_tab[pos].remote_ip, src6host,
-                             sizeof(tcp_socket_tab[pos].remote_ip) - 1);
-                tcp_socket_tab[pos].remote_port = recvport;
+                               "Message received from: %s:%i\n", src6host,
+                               recvport));
+                osip_strncpy(tcp_socket_tab[pos]->remote_ip, src6host,
+                             sizeof(tcp_socket_tab[pos]->remote_ip) - 1);
+                tcp_socket_tab[pos]->remote_port = recvport;
             }
-#endif
         }
+#else
+        i = getnameinfo((struct sockaddr *) &sa, slen,
+                        src6host, NI_MAXHOST, NULL, 0, NI_NUMERICHOST);
+
+        if (i != 0)
+        {
+            OSIP_TRACE(osip_trace
+                           (__FILE__, __LINE__, OSIP_ERROR, NULL,
+                           "Message received from: NULL:%i getnameinfo failure\n",
+                           recvport));
+            snprintf(src6host, sizeof(src6host), "127.0.0.1");
+        }
+        else
+        {
+            OSIP_TRACE(osip_trace
+                           (__FILE__, __LINE__, OSIP_INFO1, NULL,
+                           "Message received from: %s:%i\n", src6host, recvport));
+            osip_strncpy(tcp_socket_tab[pos]->remote_ip, src6host,
+                         sizeof(tcp_socket_tab[pos]->remote_ip) - 1);
+            tcp_socket_tab[pos]->remote_port = recvport;
+        }
+#endif
     }
 
-    for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
+    return OSIP_SUCCESS;
+}
+
+static int
+tcp_tl_read_message(
+    fd_set *osip_fdset,
+    fd_set *osip_wrset)
+{
+    int pos = 0;
+
+    if (FD_ISSET(tcp_socket, osip_fdset))
+        _tcp_tl_accept();
+
+    for (pos = 0; pos < tcp_socket_tab_size; pos++)
     {
-        if (tcp_socket_tab[pos].socket > 0)
+        if (tcp_socket_tab[pos]->socket > 0)
         {
-            if (FD_ISSET(tcp_socket_tab[pos].socket, osip_wrset))
-                _tcp_tl_send_sockinfo(&tcp_socket_tab[pos], NULL, 0);
-            if (FD_ISSET(tcp_socket_tab[pos].socket, osip_fdset))
-                _tcp_tl_recv(&tcp_socket_tab[pos]);
+            if (FD_ISSET(tcp_socket_tab[pos]->socket, osip_wrset))
+                _tcp_tl_send_sockinfo(tcp_socket_tab[pos], NULL, 0);
+            if (FD_ISSET(tcp_socket_tab[pos]->socket, osip_fdset))
+                _tcp_tl_recv(tcp_socket_tab[pos]);
         }
     }
 
     return OSIP_SUCCESS;
 }
 
+static int
+tcp_tl_read_fd(
+    int  fd,
+    void *ctx)
+{
+    struct _tcp_sockets *sockinfo = (struct _tcp_sockets *) ctx;
+
+    if (fd == tcp_socket)
+        return _tcp_tl_accept();
+    if (sockinfo == NULL || sockinfo->socket != fd)
+        return OSIP_UNDEFINED_ERROR;
+    return _tcp_tl_recv(sockinfo);
+}
+
 static struct _tcp_sockets *
 _tcp_tl_find_sockinfo(
     int sock)
 {
     int pos;
 
-    for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
+    for (pos = 0; pos < tcp_socket_tab_size; pos++)
     {
-        if (tcp_socket_tab[pos].socket == sock)
+        if (tcp_socket_tab[pos]->socket == sock)
         {
-            return &tcp_socket_tab[pos];
+            return tcp_socket_tab[pos];
         }
     }
     return NULL;
@@ -665,12 +646,12 @@ _tcp_tl_find_socket(
 {
     int pos;
 
-    for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
+    for (pos = 0; pos < tcp_socket_tab_size; pos++)
     {
-        if (tcp_socket_tab[pos].socket != 0)
+        if (tcp_socket_tab[pos]->socket != 0)
         {
-            if (0 == osip_strcasecmp(tcp_socket_tab[pos].remote_ip, host)
-                && port == tcp_socket_tab[pos].remote_port)
+            if (0 == osip_strcasecmp(tcp_socket_tab[pos]->remote_ip, host)
+                && port == tcp_socket_tab[pos]->remote_port)
                 return pos;
         }
     }
@@ -682,17 +663,10 @@ _tcp_tl_is_connected(
     int sock)
 {
     int            res;
-    struct timeval tv;
-    fd_set         wrset;
     int            valopt;
     socklen_t      sock_len;
-    tv.tv_sec  = SOCKET_TIMEOUT / 1000;
-    tv.tv_usec = (SOCKET_TIMEOUT % 1000) * 1000;
 
-    FD_ZERO(&wrset);
-    FD_SET(sock, &wrset);
-
-    res = select(sock + 1, NULL, &wrset, NULL, &tv);
+    res = _eXtl_wait_socket(sock, 1, SOCKET_TIMEOUT);
     if (res > 0)
     {
         sock_len = sizeof(int);
@@ -745,25 +719,25 @@ _tcp_tl_check_connected()
     int pos;
     int res;
 
-    for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
+    for (pos = 0; pos < tcp_socket_tab_size; pos++)
     {
-        if (tcp_socket_tab[pos].socket > 0
-            && tcp_socket_tab[pos].ai_addrlen > 0)
+        if (tcp_socket_tab[pos]->socket > 0
+            && tcp_socket_tab[pos]->ai_addrlen > 0)
         {
-            res = connect(tcp_socket_tab[pos].socket, &tcp_socket_tab[pos].ai_addr, tcp_socket_tab[pos].ai_addrlen);
+            res = connect(tcp_socket_tab[pos]->socket, &tcp_socket_tab[pos]->ai_addr, tcp_socket_tab[pos]->ai_addrlen);
             if (res < 0)
             {
                 int status = ex_errno;
 #if defined(_WIN32_WCE) || defined(WIN32)
                 if (status == WSAEISCONN)
                 {
-                    tcp_socket_tab[pos].ai_addrlen = 0;   /* already connected */
+                    tcp_socket_tab[pos]->ai_addrlen = 0;   /* already connected */
                     continue;
                 }
 #else
                 if (status == EISCONN)
                 {
-                    tcp_socket_tab[pos].ai_addrlen = 0;   /* already connected */
+                    tcp_socket_tab[pos]->ai_addrlen = 0;   /* already connected */
                     continue;
                 }
 #endif
@@ -777,29 +751,29 @@ _tcp_tl_check_connected()
                     OSIP_TRACE(osip_trace
                                    (__FILE__, __LINE__, OSIP_INFO2, NULL,
                                    "_tcp_tl_check_connected: Cannot connect socket node:%s:%i, socket %d [pos=%d], family:%d, %s[%d]\n",
-                                   tcp_socket_tab[pos].remote_ip,
-                                   tcp_socket_tab[pos].remote_port,
-                                   tcp_socket_tab[pos].socket,
+                                   tcp_socket_tab[pos]->remote_ip,
+                                   tcp_socket_tab[pos]->remote_port,
+                                   tcp_socket_tab[pos]->socket,
                                    pos,
-                                   tcp_socket_tab[pos].ai_addr.sa_family,
+                                   tcp_socket_tab[pos]->ai_addr.sa_family,
                                    strerror(status),
                                    status));
-                    _tcp_tl_close_sockinfo(&tcp_socket_tab[pos]);
+                    _tcp_tl_close_sockinfo(tcp_socket_tab[pos]);
                     continue;
                 }
                 else
                 {
-                    res = _tcp_tl_is_connected(tcp_socket_tab[pos].socket);
+                    res = _tcp_tl_is_connected(tcp_socket_tab[pos]->socket);
                     if (res > 0)
                     {
                         OSIP_TRACE(osip_trace
                                        (__FILE__, __LINE__, OSIP_INFO2, NULL,
                                        "_tcp_tl_check_connected: socket node:%s:%i, socket %d [pos=%d], family:%d, in progress\n",
-                                       tcp_socket_tab[pos].remote_ip,
-                                       tcp_socket_tab[pos].remote_port,
-                                       tcp_socket_tab[pos].socket,
+                                       tcp_socket_tab[pos]->remote_ip,
+                                       tcp_socket_tab[pos]->remote_port,
+                                       tcp_socket_tab[pos]->socket,
                                        pos,
-                                       tcp_socket_tab[pos].ai_addr.sa_family));
+                                       tcp_socket_tab[pos]->ai_addr.sa_family));
                         continue;
                     }
                     else if (res == 0)
@@ -807,13 +781,13 @@ _tcp_tl_check_connected()
                         OSIP_TRACE(osip_trace
                                        (__FILE__, __LINE__, OSIP_INFO1, NULL,
                                        "_tcp_tl_check_connected: socket node:%s:%i , socket %d [pos=%d], family:%d, connected\n",
-                                       tcp_socket_tab[pos].remote_ip,
-                                       tcp_socket_tab[pos].remote_port,
-                                       tcp_socket_tab[pos].socket,
+                                       tcp_socket_tab[pos]->remote_ip,
+                                       tcp_socket_tab[pos]->remote_port,
+                                       tcp_socket_tab[pos]->socket,
                                        pos,
-                                       tcp_socket_tab[pos].ai_addr.sa_family));
+                                       tcp_socket_tab[pos]->ai_addr.sa_family));
                         /* stop calling "connect()" */
-                        tcp_socket_tab[pos].ai_addrlen = 0;
+                        tcp_socket_tab[pos]->ai_addrlen = 0;
                         continue;
                     }
                     else
@@ -821,12 +795,12 @@ _tcp_tl_check_connected()
                         OSIP_TRACE(osip_trace
                                        (__FILE__, __LINE__, OSIP_INFO2, NULL,
                                        "_tcp_tl_check_connected: socket node:%s:%i, socket %d [pos=%d], family:%d, error\n",
-                                       tcp_socket_tab[pos].remote_ip,
-                                       tcp_socket_tab[pos].remote_port,
-                                       tcp_socket_tab[pos].socket,
+                                       tcp_socket_tab[pos]->remote_ip,
+                                       tcp_socket_tab[pos]->remote_port,
+                                       tcp_socket_tab[pos]->socket,
                                        pos,
-                                       tcp_socket_tab[pos].ai_addr.sa_family));
-                        _tcp_tl_close_sockinfo(&tcp_socket_tab[pos]);
+                                       tcp_socket_tab[pos]->ai_addr.sa_family));
+                        _tcp_tl_close_sockinfo(tcp_socket_tab[pos]);
                         continue;
                     }
                 }
@@ -836,13 +810,13 @@ _tcp_tl_check_connected()
                 OSIP_TRACE(osip_trace
                                (__FILE__, __LINE__, OSIP_INFO1, NULL,
                                "_tcp_tl_check_connected: socket node:%s:%i , socket %d [pos=%d], family:%d, connected (with connect)\n",
-                               tcp_socket_tab[pos].remote_ip,
-                               tcp_socket_tab[pos].remote_port,
-                               tcp_socket_tab[pos].socket,
+                               tcp_socket_tab[pos]->remote_ip,
+                               tcp_socket_tab[pos]->remote_port,
+                               tcp_socket_tab[pos]->socket,
                                pos,
-                               tcp_socket_tab[pos].ai_addr.sa_family));
+                               tcp_socket_tab[pos]->ai_addr.sa_family));
                 /* stop calling "connect()" */
-                tcp_socket_tab[pos].ai_addrlen = 0;
+                tcp_socket_tab[pos]->ai_addrlen = 0;
             }
         }
     }
@@ -868,30 +842,13 @@ _tcp_tl_connect_socket(
     selected_ai_addrlen = 0;
     memset(&selected_ai_addr, 0, sizeof(struct sockaddr));
 
-    for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
-    {
-        if (tcp_socket_tab[pos].socket == 0)
-        {
-            break;
-        }
-    }
-
-    if (pos == EXOSIP_MAX_SOCKETS)
+    pos = _tcp_tl_new_sockinfo();
+    if (pos < 0)
     {
         OSIP_TRACE(osip_trace
                        (__FILE__, __LINE__, OSIP_ERROR, NULL,
-                       "tcp_socket_tab is full - cannot create new socket!\n"));
-#ifdef DELETE_OLD_SOCKETS
-        /* delete an old one! */
-        pos = 0;
-        if (tcp_socket_tab[pos].socket > 0)
-        {
-            _tcp_tl_close_sockinfo(&tcp_socket_tab[pos]);
-        }
-        memset(&tcp_socket_tab[pos], 0, sizeof(tcp_socket_tab[pos]));
-#else
+                       "tcp_socket_tab cannot grow - cannot create new socket!\n"));
         return -1;
-#endif
     }
 
     res = eXosip_get_addrinfo(&addrinfo, host, port, IPPROTO_TCP);
@@ -935,6 +892,17 @@ _tcp_tl_connect_socket(
             continue;
         }
 
+        if (!_eXtl_select_fits(sock, _tcp_tl_nb_sockets()))
+        {
+            closesocket(sock);
+            sock = -1;
+            OSIP_TRACE(osip_trace
+                           (__FILE__, __LINE__, OSIP_WARNING, NULL,
+                           "Cannot connect socket node:%s, too many sockets for select()\n",
+                           host));
+            break;
+        }
+
         if (curinfo->ai_family == AF_INET6)
         {
 #ifdef IPV6_V6ONLY
@@ -1072,22 +1040,22 @@ _tcp_tl_connect_socket(
                 else if (res == 0)
                 {
 #ifdef MULTITASKING_ENABLED
-                    tcp_socket_tab[pos].readStream  = NULL;
-                    tcp_socket_tab[pos].writeStream = NULL;
+                    tcp_socket_tab[pos]->readStream  = NULL;
+                    tcp_socket_tab[pos]->writeStream = NULL;
                     CFStreamCreatePairWithSocket(kCFAllocatorDefault, sock,
-                                                 &tcp_socket_tab[pos].readStream, &tcp_socket_tab[pos].writeStream);
-                    if (tcp_socket_tab[pos].readStream != NULL)
-                        CFReadStreamSetProperty(tcp_socket_tab[pos].readStream, kCFStreamNetworkServiceType, kCFStreamNetworkServiceTypeVoIP);
-                    if (tcp_socket_tab[pos].writeStream != NULL)
-                        CFWriteStreamSetProperty(tcp_socket_tab[pos].writeStream, kCFStreamNetworkServiceType, kCFStreamNetworkServiceTypeVoIP);
-                    if (CFReadStreamOpen(tcp_socket_tab[pos].readStream))
+                                                 &tcp_socket_tab[pos]->readStream, &tcp_socket_tab[pos]->writeStream);
+                    if (tcp_socket_tab[pos]->readStream != NULL)
+                        CFReadStreamSetProperty(tcp_socket_tab[pos]->readStream, kCFStreamNetworkServiceType, kCFStreamNetworkServiceTypeVoIP);
+                    if (tcp_socket_tab[pos]->writeStream != NULL)
+                        CFWriteStreamSetProperty(tcp_socket_tab[pos]->writeStream, kCFStreamNetworkServiceType, kCFStreamNetworkServiceTypeVoIP);
+                    if (CFReadStreamOpen(tcp_socket_tab[pos]->readStream))
                     {
                         OSIP_TRACE(osip_trace
                                        (__FILE__, __LINE__, OSIP_INFO1, NULL,
                                        "CFReadStreamOpen Succeeded!\n"));
                     }
 
-                    CFWriteStreamOpen(tcp_socket_tab[pos].writeStream);
+                    CFWriteStreamOpen(tcp_socket_tab[pos]->writeStream);
 #endif
                     OSIP_TRACE(osip_trace
                                    (__FILE__, __LINE__, OSIP_INFO1, NULL,
@@ -1111,21 +1079,22 @@ _tcp_tl_connect_socket(
 
     if (sock > 0)
     {
-        tcp_socket_tab[pos].socket     = sock;
+        tcp_socket_tab[pos]->socket     = sock;
+        _eXtl_poll_add(sock, &eXtl_tcp, tcp_socket_tab[pos]);
 
-        tcp_socket_tab[pos].ai_addrlen = selected_ai_addrlen;
-        memset(&tcp_socket_tab[pos].ai_addr, 0, sizeof(struct sockaddr));
+        tcp_socket_tab[pos]->ai_addrlen = selected_ai_addrlen;
+        memset(&tcp_socket_tab[pos]->ai_addr, 0, sizeof(struct sockaddr));
         if (selected_ai_addrlen > 0)
-            memcpy(&tcp_socket_tab[pos].ai_addr, &selected_ai_addr, selected_ai_addrlen);
+            memcpy(&tcp_socket_tab[pos]->ai_addr, &selected_ai_addr, selected_ai_addrlen);
 
         if (src6host[0] == '\0')
-            osip_strncpy(tcp_socket_tab[pos].remote_ip, host,
-                         sizeof(tcp_socket_tab[pos].remote_ip) - 1);
+            osip_strncpy(tcp_socket_tab[pos]->remote_ip, host,
+                         sizeof(tcp_socket_tab[pos]->remote_ip) - 1);
         else
-            osip_strncpy(tcp_socket_tab[pos].remote_ip, src6host,
-                         sizeof(tcp_socket_tab[pos].remote_ip) - 1);
+            osip_strncpy(tcp_socket_tab[pos]->remote_ip, src6host,
+                         sizeof(tcp_socket_tab[pos]->remote_ip) - 1);
 
-        tcp_socket_tab[pos].remote_port = port;
+        tcp_socket_tab[pos]->remote_port = port;
 
         return pos;
     }
@@ -1148,17 +1117,11 @@ _tcp_tl_send_sockinfo(
             int status = ex_errno;
             if (is_wouldblock_error(status))
             {
-                struct timeval tv;
-                fd_set         wrset;
-                tv.tv_sec  = SOCKET_TIMEOUT / 1000;
-                tv.tv_usec = (SOCKET_TIMEOUT % 1000) * 1000;
-                if (tv.tv_usec == 0)
-                    tv.tv_usec += 10000;
+                int timeout = SOCKET_TIMEOUT;
+                if (timeout % 1000 == 0)
+                    timeout += 10;
 
-                FD_ZERO(&wrset);
-                FD_SET(sockinfo->socket, &wrset);
-
-                i = select(sockinfo->socket + 1, NULL, &wrset, NULL, &tv);
+                i = _eXtl_wait_socket(sockinfo->socket, 1, timeout);
                 if (i > 0)
                 {
                     continue;
@@ -1227,7 +1190,7 @@ tcp_tl_send_message(
     int                out_socket)
 {
     size_t       length        = 0;
-    char         *message      = NULL;
+    const char   *message      = NULL;
     int          i;
     int          pos           = -1;
     osip_naptr_t *naptr_record = NULL;
@@ -1371,7 +1334,7 @@ tcp_tl_send_message(
         {
             osip_list_remove(&sip->routes, 0);
         }
-        i = osip_message_to_str(sip, &message, &length);
+        i = osip_message_to_str_cached(sip, &message, &length);
         if (tag == NULL && route != NULL && route->url != NULL)
         {
             osip_list_add(&sip->routes, route, 0);
@@ -1380,7 +1343,6 @@ tcp_tl_send_message(
 
     if (i != 0 || length <= 0)
     {
-        osip_free(message);
         return -1;
     }
 
@@ -1389,22 +1351,22 @@ tcp_tl_send_message(
 
     if (out_socket > 0)
     {
-        for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
+        for (pos = 0; pos < tcp_socket_tab_size; pos++)
         {
-            if (tcp_socket_tab[pos].socket != 0)
+            if (tcp_socket_tab[pos]->socket != 0)
             {
-                if (tcp_socket_tab[pos].socket == out_socket)
+                if (tcp_socket_tab[pos]->socket == out_socket)
                 {
-                    out_socket = tcp_socket_tab[pos].socket;
+                    out_socket = tcp_socket_tab[pos]->socket;
                     OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
                                           "reusing REQUEST connection (to dest=%s:%i)\n",
-                                          tcp_socket_tab[pos].remote_ip,
-                                          tcp_socket_tab[pos].remote_port));
+                                          tcp_socket_tab[pos]->remote_ip,
+                                          tcp_socket_tab[pos]->remote_port));
                     break;
                 }
             }
         }
-        if (pos == EXOSIP_MAX_SOCKETS)
+        if (pos == tcp_socket_tab_size)
             out_socket = 0;
     }
 
@@ -1416,22 +1378,30 @@ tcp_tl_send_message(
         {
             OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
                                   "reusing connection (to dest=%s:%i)\n",
-                                  tcp_socket_tab[pos].remote_ip,
-                                  tcp_socket_tab[pos].remote_port));
+                                  tcp_socket_tab[pos]->remote_ip,
+                                  tcp_socket_tab[pos]->remote_port));
         }
 
         /* Step 2: create new socket with host:port */
         if (pos < 0)
         {
+            struct addrinfo *addrinfo = NULL;
+
+            /* keep waiting (address not received): the connection
+               finds the address in the resolver cache */
+            i = _eXosip_get_addrinfo_async(tr, sip, &addrinfo, host, port, IPPROTO_TCP);
+            if (i == 1)
+                return OSIP_SUCCESS + 1;
+            if (addrinfo != NULL)
+                eXosip_freeaddrinfo(addrinfo);
             pos = _tcp_tl_connect_socket(host, port);
         }
         if (pos >= 0)
-            out_socket = tcp_socket_tab[pos].socket;
+            out_socket = tcp_socket_tab[pos]->socket;
     }
 
     if (out_socket <= 0)
     {
-        osip_free(message);
         return -1;
     }
 
@@ -1444,7 +1414,6 @@ tcp_tl_send_message(
                        (__FILE__, __LINE__, OSIP_INFO2, NULL,
                        "socket node:%s, socket %d [pos=%d], in progress\n",
                        host, out_socket, pos));
-        osip_free(message);
         if (tr != NULL && now - tr->birth_time > 10 && now - tr->birth_time < 13)
         {
             /* avoid doing this twice... */
@@ -1478,36 +1447,35 @@ tcp_tl_send_message(
                        (__FILE__, __LINE__, OSIP_ERROR, NULL,
                        "socket node:%s, socket %d [pos=%d], socket error\n",
                        host, out_socket, pos));
-        osip_free(message);
         return -1;
     }
 
 #ifdef MULTITASKING_ENABLED
 
-    if (pos >= 0 && tcp_socket_tab[pos].readStream == NULL)
+    if (pos >= 0 && tcp_socket_tab[pos]->readStream == NULL)
     {
-        tcp_socket_tab[pos].readStream  = NULL;
-        tcp_socket_tab[pos].writeStream = NULL;
+        tcp_socket_tab[pos]->readStream  = NULL;
+        tcp_socket_tab[pos]->writeStream = NULL;
         CFStreamCreatePairWithSocket(kCFAllocatorDefault, out_socket,
-                                     &tcp_socket_tab[pos].readStream, &tcp_socket_tab[pos].writeStream);
-        if (tcp_socket_tab[pos].readStream != NULL)
-            CFReadStreamSetProperty(tcp_socket_tab[pos].readStream, kCFStreamNetworkServiceType, kCFStreamNetworkServiceTypeVoIP);
-        if (tcp_socket_tab[pos].writeStream != NULL)
-            CFWriteStreamSetProperty(tcp_socket_tab[pos].writeStream, kCFStreamNetworkServiceType, kCFStreamNetworkServiceTypeVoIP);
-        if (CFReadStreamOpen(tcp_socket_tab[pos].readStream))
+                                     &tcp_socket_tab[pos]->readStream, &tcp_socket_tab[pos]->writeStream);
+        if (tcp_socket_tab[pos]->readStream != NULL)
+            CFReadStreamSetProperty(tcp_socket_tab[pos]->readStream, kCFStreamNetworkServiceType, kCFStreamNetworkServiceTypeVoIP);
+        if (tcp_socket_tab[pos]->writeStream != NULL)
+            CFWriteStreamSetProperty(tcp_socket_tab[pos]->writeStream, kCFStreamNetworkServiceType, kCFStreamNetworkServiceTypeVoIP);
+        if (CFReadStreamOpen(tcp_socket_tab[pos]->readStream))
         {
             OSIP_TRACE(osip_trace
                            (__FILE__, __LINE__, OSIP_INFO1, NULL,
                            "CFReadStreamOpen Succeeded!\n"));
         }
 
-        CFWriteStreamOpen(tcp_socket_tab[pos].writeStream);
+        CFWriteStreamOpen(tcp_socket_tab[pos]->writeStream);
         OSIP_TRACE(osip_trace
                        (__FILE__, __LINE__, OSIP_INFO1, NULL,
                        "socket node:%s:%i , socket %d [pos=%d], family:?, connected\n",
-                       tcp_socket_tab[pos].remote_ip,
-                       tcp_socket_tab[pos].remote_port,
-                       tcp_socket_tab[pos].socket, pos));
+                       tcp_socket_tab[pos]->remote_ip,
+                       tcp_socket_tab[pos]->remote_port,
+                       tcp_socket_tab[pos]->socket, pos));
     }
 #endif
 
@@ -1515,7 +1483,6 @@ tcp_tl_send_message(
                           "Message sent: (to dest=%s:%i) \n%s\n",
                           host, port, message));
     i = _tcp_tl_send(out_socket, (const void *)message, length);
-    osip_free(message);
     return i;
 }
 
@@ -1566,19 +1533,19 @@ tcp_tl_keepalive(
     if (tcp_socket <= 0)
         return OSIP_UNDEFINED_ERROR;
 
-    for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
+    for (pos = 0; pos < tcp_socket_tab_size; pos++)
     {
-        if (tcp_socket_tab[pos].socket > 0)
+        if (tcp_socket_tab[pos]->socket > 0)
         {
-            i = _tcp_tl_is_connected(tcp_socket_tab[pos].socket);
+            i = _tcp_tl_is_connected(tcp_socket_tab[pos]->socket);
             if (i > 0)
             {
                 OSIP_TRACE(osip_trace
                                (__FILE__, __LINE__, OSIP_INFO2, NULL,
                                "tcp_tl_keepalive socket node:%s:%i, socket %d [pos=%d], in progress\n",
-                               tcp_socket_tab[pos].remote_ip,
-                               tcp_socket_tab[pos].remote_port,
-                               tcp_socket_tab[pos].socket, pos));
+                               tcp_socket_tab[pos]->remote_ip,
+                               tcp_socket_tab[pos]->remote_port,
+                               tcp_socket_tab[pos]->socket, pos));
                 continue;
             }
             else if (i == 0)
@@ -1586,19 +1553,19 @@ tcp_tl_keepalive(
                 OSIP_TRACE(osip_trace
                                (__FILE__, __LINE__, OSIP_INFO2, NULL,
                                "tcp_tl_keepalive socket node:%s:%i , socket %d [pos=%d], connected\n",
-                               tcp_socket_tab[pos].remote_ip,
-                               tcp_socket_tab[pos].remote_port,
-                               tcp_socket_tab[pos].socket, pos));
+                               tcp_socket_tab[pos]->remote_ip,
+                               tcp_socket_tab[pos]->remote_port,
+                               tcp_socket_tab[pos]->socket, pos));
             }
             else
             {
                 OSIP_TRACE(osip_trace
                                (__FILE__, __LINE__, OSIP_ERROR, NULL,
                                "tcp_tl_keepalive socket node:%s:%i, socket %d [pos=%d], socket error\n",
-                               tcp_socket_tab[pos].remote_ip,
-                               tcp_socket_tab[pos].remote_port,
-                               tcp_socket_tab[pos].socket, pos));
-                _tcp_tl_close_sockinfo(&tcp_socket_tab[pos]);
+                               tcp_socket_tab[pos]->remote_ip,
+                               tcp_socket_tab[pos]->remote_port,
+                               tcp_socket_tab[pos]->socket, pos));
+                _tcp_tl_close_sockinfo(tcp_socket_tab[pos]);
                 continue;
             }
             if (eXosip.keep_alive > 0)
@@ -1620,14 +1587,14 @@ tcp_tl_keepalive(
                     memset(locip, '\0', sizeof(locip));
                     locport = 0;
 
-                    snprintf(to, sizeof(to), "<sip:%s:%d>", tcp_socket_tab[pos].remote_ip, tcp_socket_tab[pos].remote_port);
-                    _tcp_tl_get_socket_info(tcp_socket_tab[pos].socket, locip, sizeof(locip), &locport);
+                    snprintf(to, sizeof(to), "<sip:%s:%d>", tcp_socket_tab[pos]->remote_ip, tcp_socket_tab[pos]->remote_port);
+                    _tcp_tl_get_socket_info(tcp_socket_tab[pos]->socket, locip, sizeof(locip), &locport);
                     if (locip[0] == '\0')
                     {
                         OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_WARNING, NULL,
                                               "tcp_tl_keepalive socket node:%s , socket %d [pos=%d], failed to create sip options message\n",
-                                              tcp_socket_tab[pos].remote_ip,
-                                              tcp_socket_tab[pos].socket,
+                                              tcp_socket_tab[pos]->remote_ip,
+                                              tcp_socket_tab[pos]->socket,
                                               pos));
                         continue;
                     }
@@ -1645,11 +1612,11 @@ tcp_tl_keepalive(
                         {
                             OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO2, NULL,
                                                   "tcp_tl_keepalive socket node:%s , socket %d [pos=%d], sending sip options\n\r%s",
-                                                  tcp_socket_tab[pos].remote_ip,
-                                                  tcp_socket_tab[pos].socket,
+                                                  tcp_socket_tab[pos]->remote_ip,
+                                                  tcp_socket_tab[pos]->socket,
                                                   pos,
                                                   message));
-                            i = send(tcp_socket_tab[pos].socket, (const void *) message, length, 0);
+                            i = send(tcp_socket_tab[pos]->socket, (const void *) message, length, 0);
                             osip_free(message);
                             if (i > 0)
                             {
@@ -1662,8 +1629,8 @@ tcp_tl_keepalive(
                         {
                             OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_WARNING, NULL,
                                                   "tcp_tl_keepalive socket node:%s , socket %d [pos=%d], failed to convert sip options message\n",
-                                                  tcp_socket_tab[pos].remote_ip,
-                                                  tcp_socket_tab[pos].socket,
+                                                  tcp_socket_tab[pos]->remote_ip,
+                                                  tcp_socket_tab[pos]->socket,
                                                   pos));
                         }
                     }
@@ -1671,15 +1638,15 @@ tcp_tl_keepalive(
                     {
                         OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_WARNING, NULL,
                                               "tcp_tl_keepalive socket node:%s , socket %d [pos=%d], failed to create sip options message\n",
-                                              tcp_socket_tab[pos].remote_ip,
-                                              tcp_socket_tab[pos].socket,
+                                              tcp_socket_tab[pos]->remote_ip,
+                                              tcp_socket_tab[pos]->socket,
                                               pos));
                     }
                     eXosip_unlock();
                     continue;
                 }
 #endif
-                i = send(tcp_socket_tab[pos].socket, (const void *) buf, 4, 0);
+                i = send(tcp_socket_tab[pos]->socket, (const void *) buf, 4, 0);
             }
         }
     }
@@ -1691,6 +1658,7 @@ tcp_tl_set_socket(
     int socket)
 {
     tcp_socket = socket;
+    _eXtl_poll_add(tcp_socket, &eXtl_tcp, NULL);
 
     return OSIP_SUCCESS;
 }
@@ -1754,5 +1722,6 @@ struct eXtl_protocol eXtl_tcp = {
     &tcp_tl_keepalive,
     &tcp_tl_set_socket,
     &tcp_tl_masquerade_contact,
-    &tcp_tl_get_masquerade_contact
+    &tcp_tl_get_masquerade_contact,
+    &tcp_tl_read_fd
 };
\ No newline at end of file
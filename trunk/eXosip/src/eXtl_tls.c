@@ -125,6 +125,7 @@ struct socket_tab {
     char             *buf;     /* recv buffer */
     size_t           bufsize;  /* allocated size of buf */
     size_t           buflen;   /* current length of buf */
+    struct eXtl_framer framer; /* framing state of buf */
     char             *sendbuf; /* send buffer */
     size_t           sendbufsize;
     size_t           sendbuflen;
@@ -144,7 +145,11 @@ struct socket_tab {
         #define EXOSIP_MAX_SOCKETS 100
     #endif
 
-static struct socket_tab tls_socket_tab[EXOSIP_MAX_SOCKETS];
+/* The table starts with EXOSIP_MAX_SOCKETS entries and doubles when
+   they are all in use. Entries are allocated one by one and never
+   move: the poll loop and the callers keep pointers to them. */
+static struct socket_tab **tls_socket_tab;
+static int               tls_socket_tab_size;
 
 static int
 tls_tl_init(
@@ -154,7 +159,8 @@ tls_tl_init(
     server_ctx = NULL;
     client_ctx = NULL;
     memset(&ai_addr,                  0, sizeof(struct sockaddr_storage));
-    memset(&tls_socket_tab,           0, sizeof(struct socket_tab) * EXOSIP_MAX_SOCKETS);
+    tls_socket_tab      = NULL;
+    tls_socket_tab_size = 0;
     memset(tls_firewall_ip,           0, sizeof(tls_firewall_ip));
     memset(tls_firewall_port,         0, sizeof(tls_firewall_port));
     memset(&eXosip_tls_ctx_params,    0, sizeof(eXosip_tls_ctx_t));
@@ -178,6 +184,7 @@ _tls_tl_close_sockinfo(
         }
         if (sockinfo->ssl_ctx != NULL)
             SSL_CTX_free(sockinfo->ssl_ctx);
+        _eXtl_poll_del(sockinfo->socket);
         closesocket(sockinfo->socket);
     }
     if (sockinfo->buf != NULL)
@@ -212,10 +219,14 @@ tls_tl_free(
         SSL_CTX_free(client_ctx);
     client_ctx = NULL;
 
-    for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
+    for (pos = 0; pos < tls_socket_tab_size; pos++)
     {
-        _tls_tl_close_sockinfo(&tls_socket_tab[pos]);
+        _tls_tl_close_sockinfo(tls_socket_tab[pos]);
+        osip_free(tls_socket_tab[pos]);
     }
+    osip_free(tls_socket_tab);
+    tls_socket_tab      = NULL;
+    tls_socket_tab_size = 0;
 
     #if 0
     /* this would break other ssl usage */
@@ -226,11 +237,10 @@ tls_tl_free(
     CRYPTO_cleanup_all_ex_data();
     #endif
 
-    memset(&tls_socket_tab,   0, sizeof(struct socket_tab) * EXOSIP_MAX_SOCKETS);
-
     memset(tls_firewall_ip,   0, sizeof(tls_firewall_ip));
     memset(tls_firewall_port, 0, sizeof(tls_firewall_port));
     memset(&ai_addr,          0, sizeof(struct sockaddr_storage));
+    _eXtl_poll_del(tls_socket);
     if (tls_socket > 0)
         close(tls_socket);
     tls_socket = 0;
@@ -243,6 +253,61 @@ tls_tl_free(
     return OSIP_SUCCESS;
 }
 
+static int
+_tls_tl_nb_sockets(
+    void)
+{
+    int pos;
+    int nb = 0;
+
+    for (pos = 0; pos < tls_socket_tab_size; pos++)
+    {
+        if (tls_socket_tab[pos]->socket > 0)
+            nb++;
+    }
+    return nb;
+}
+
+static int
+_tls_tl_new_sockinfo(
+    void)
+{
+    struct socket_tab **tab;
+    int               size;
+    int               pos;
+
+    for (pos = 0; pos < tls_socket_tab_size; pos++)
+    {
+        if (tls_socket_tab[pos]->socket == 0)
+            return pos;
+    }
+
+    size = tls_socket_tab_size * 2;
+    if (size < EXOSIP_MAX_SOCKETS)
+        size = EXOSIP_MAX_SOCKETS;
+    tab  = (struct socket_tab **) osip_realloc(tls_socket_tab,
+                                               size * sizeof(struct socket_tab *));
+    if (tab == NULL)
+        return -1;
+    tls_socket_tab = tab;
+
+    for (pos = tls_socket_tab_size; pos < size; pos++)
+    {
+        tls_socket_tab[pos] = (struct socket_tab *) osip_malloc(sizeof(struct socket_tab));
+        if (tls_socket_tab[pos] == NULL)
+            break;
+        memset(tls_socket_tab[pos], 0, sizeof(struct socket_tab));
+    }
+    if (pos == tls_socket_tab_size)
+        return -1;
+
+    OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO2, NULL,
+                          "tls_socket_tab grown to %i entries\n", pos));
+    size                = tls_socket_tab_size;
+    tls_socket_tab_size = pos;
+    return size;
+}
+
 static void
 tls_dump_cert_info(
     const char *s,
@@ -1684,6 +1749,7 @@ tls_tl_open(
     }
 
     tls_socket = sock;
+    _eXtl_poll_add(tls_socket, &eXtl_tls, NULL);
 
     if (eXtl_tls.proto_port == 0)
     {
@@ -1719,15 +1785,15 @@ tls_tl_set_fdset(
     if (tls_socket > *fd_max)
         *fd_max = tls_socket;
 
-    for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
+    for (pos = 0; pos < tls_socket_tab_size; pos++)
     {
-        if (tls_socket_tab[pos].socket > 0)
+        if (tls_socket_tab[pos]->socket > 0)
         {
-            eXFD_SET(tls_socket_tab[pos].socket, osip_fdset);
-            if (tls_socket_tab[pos].socket > *fd_max)
-                *fd_max = tls_socket_tab[pos].socket;
-            if (tls_socket_tab[pos].sendbuflen > 0)
-                eXFD_SET(tls_socket_tab[pos].socket, osip_wrset);
+            eXFD_SET(tls_socket_tab[pos]->socket, osip_fdset);
+            if (tls_socket_tab[pos]->socket > *fd_max)
+                *fd_max = tls_socket_tab[pos]->socket;
+            if (tls_socket_tab[pos]->sendbuflen > 0)
+                eXFD_SET(tls_socket_tab[pos]->socket, osip_wrset);
         }
     }
 
@@ -1893,18 +1959,11 @@ _tls_tl_is_connected(
     int sock)
 {
     int            res;
-    struct timeval tv;
-    fd_set         wrset;
     int            valopt;
     socklen_t      sock_len;
-    tv.tv_sec  = SOCKET_TIMEOUT / 1000;
-    tv.tv_usec = (SOCKET_TIMEOUT % 1000) * 1000;
 
-                  FD_ZERO(&wrset);
-                  FD_SET(sock, &wrset);
-
-                  res = select(sock + 1, NULL, &wrset, NULL, &tv);
-                  if (res > 0)
+    res = _eXtl_wait_socket(sock, 1, SOCKET_TIMEOUT);
+    if (res > 0)
     {
         sock_len = sizeof(int);
         if (getsockopt(sock, SOL_SOCKET, SO_ERROR, (void *) (&valopt), &sock_len)
@@ -1956,32 +2015,32 @@ _tls_tl_check_connected()
     int pos;
     int res;
 
-    for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
+    for (pos = 0; pos < tls_socket_tab_size; pos++)
     {
-        if (tls_socket_tab[pos].socket > 0
-            && tls_socket_tab[pos].ai_addrlen > 0)
+        if (tls_socket_tab[pos]->socket > 0
+            && tls_socket_tab[pos]->ai_addrlen > 0)
         {
-            if (tls_socket_tab[pos].ssl_state > 0)
+            if (tls_socket_tab[pos]->ssl_state > 0)
             {
                 /* already connected */
-                tls_socket_tab[pos].ai_addrlen = 0;
+                tls_socket_tab[pos]->ai_addrlen = 0;
                 continue;
             }
 
-            res = connect(tls_socket_tab[pos].socket, &tls_socket_tab[pos].ai_addr, tls_socket_tab[pos].ai_addrlen);
+            res = connect(tls_socket_tab[pos]->socket, &tls_socket_tab[pos]->ai_addr, tls_socket_tab[pos]->ai_addrlen);
             if (res < 0)
             {
                 int status = ex_errno;
     #if defined(_WIN32_WCE) || defined(WIN32)
                 if (status == WSAEISCONN)
                 {
-                    tls_socket_tab[pos].ai_addrlen = 0;   /* already connected */
+                    tls_socket_tab[pos]->ai_addrlen = 0;   /* already connected */
                     continue;
                 }
     #else
                 if (status == EISCONN)
                 {
-                    tls_socket_tab[pos].ai_addrlen = 0;   /* already connected */
+                    tls_socket_tab[pos]->ai_addrlen = 0;   /* already connected */
                     continue;
                 }
     #endif
@@ -1995,29 +2054,29 @@ _tls_tl_check_connected()
                     OSIP_TRACE(osip_trace
                                    (__FILE__, __LINE__, OSIP_INFO2, NULL,
                                    "_tls_tl_check_connected: Cannot connect socket node:%s:%i, socket %d [pos=%d], family:%d, %s[%d]\n",
-                                   tls_socket_tab[pos].remote_ip,
-                                   tls_socket_tab[pos].remote_port,
-                                   tls_socket_tab[pos].socket,
+                                   tls_socket_tab[pos]->remote_ip,
+                                   tls_socket_tab[pos]->remote_port,
+                                   tls_socket_tab[pos]->socket,
                                    pos,
-                                   tls_socket_tab[pos].ai_addr.sa_family,
+                                   tls_socket_tab[pos]->ai_addr.sa_family,
                                    strerror(status),
                                    status));
-                    _tls_tl_close_sockinfo(&tls_socket_tab[pos]);
+                    _tls_tl_close_sockinfo(tls_socket_tab[pos]);
                     continue;
                 }
                 else
                 {
-                    res = _tls_tl_is_connected(tls_socket_tab[pos].socket);
+                    res = _tls_tl_is_connected(tls_socket_tab[pos]->socket);
                     if (res > 0)
                     {
                         OSIP_TRACE(osip_trace
                                        (__FILE__, __LINE__, OSIP_INFO2, NULL,
                                        "_tls_tl_check_connected: socket node:%s:%i, socket %d [pos=%d], family:%d, in progress\n",
-                                       tls_socket_tab[pos].remote_ip,
-                                       tls_socket_tab[pos].remote_port,
-                                       tls_socket_tab[pos].socket,
+                                       tls_socket_tab[pos]->remote_ip,
+                                       tls_socket_tab[pos]->remote_port,
+                                       tls_socket_tab[pos]->socket,
                                        pos,
-                                       tls_socket_tab[pos].ai_addr.sa_family));
+                                       tls_socket_tab[pos]->ai_addr.sa_family));
                         continue;
                     }
                     else if (res == 0)
@@ -2025,14 +2084,14 @@ _tls_tl_check_connected()
                         OSIP_TRACE(osip_trace
                                        (__FILE__, __LINE__, OSIP_INFO1, NULL,
                                        "_tls_tl_check_connected: socket node:%s:%i , socket %d [pos=%d], family:%d, connected\n",
-                                       tls_socket_tab[pos].remote_ip,
-                                       tls_socket_tab[pos].remote_port,
-                                       tls_socket_tab[pos].socket,
+                                       tls_socket_tab[pos]->remote_ip,
+                                       tls_socket_tab[pos]->remote_port,
+                                       tls_socket_tab[pos]->socket,
                                        pos,
-                                       tls_socket_tab[pos].ai_addr.sa_family));
+                                       tls_socket_tab[pos]->ai_addr.sa_family));
                         /* stop calling "connect()" */
-                        tls_socket_tab[pos].ai_addrlen = 0;
-                        tls_socket_tab[pos].ssl_state = 1;
+                        tls_socket_tab[pos]->ai_addrlen = 0;
+                        tls_socket_tab[pos]->ssl_state = 1;
                         continue;
                     }
                     else
@@ -2040,12 +2099,12 @@ _tls_tl_check_connected()
                         OSIP_TRACE(osip_trace
                                        (__FILE__, __LINE__, OSIP_INFO2, NULL,
                                        "_tls_tl_check_connected: socket node:%s:%i, socket %d [pos=%d], family:%d, error\n",
-                                       tls_socket_tab[pos].remote_ip,
-                                       tls_socket_tab[pos].remote_port,
-                                       tls_socket_tab[pos].socket,
+                                       tls_socket_tab[pos]->remote_ip,
+                                       tls_socket_tab[pos]->remote_port,
+                                       tls_socket_tab[pos]->socket,
                                        pos,
-                                       tls_socket_tab[pos].ai_addr.sa_family));
-                        _tls_tl_close_sockinfo(&tls_socket_tab[pos]);
+                                       tls_socket_tab[pos]->ai_addr.sa_family));
+                        _tls_tl_close_sockinfo(tls_socket_tab[pos]);
                         continue;
                     }
                 }
@@ -2055,13 +2114,13 @@ _tls_tl_check_connected()
                 OSIP_TRACE(osip_trace
                                (__FILE__, __LINE__, OSIP_INFO1, NULL,
                                "_tls_tl_check_connected: socket node:%s:%i , socket %d [pos=%d], family:%d, connected (with connect)\n",
-                               tls_socket_tab[pos].remote_ip,
-                               tls_socket_tab[pos].remote_port,
-                               tls_socket_tab[pos].socket,
+                               tls_socket_tab[pos]->remote_ip,
+                               tls_socket_tab[pos]->remote_port,
+                               tls_socket_tab[pos]->socket,
                                pos,
-                               tls_socket_tab[pos].ai_addr.sa_family));
+                               tls_socket_tab[pos]->ai_addr.sa_family));
                 /* stop calling "connect()" */
-                tls_socket_tab[pos].ai_addrlen = 0;
+                tls_socket_tab[pos]->ai_addrlen = 0;
             }
         }
     }
@@ -2116,9 +2175,7 @@ _tls_tl_ssl_connect_socket(
 
     do
     {
-        struct timeval tv;
-        int            fd;
-        fd_set         readfds;
+        int fd;
 
         res = SSL_connect(sockinfo->ssl_conn);
         res = SSL_get_error(sockinfo->ssl_conn, res);
@@ -2137,15 +2194,11 @@ _tls_tl_ssl_connect_socket(
             return -1;
         }
 
-        tv.tv_sec = SOCKET_TIMEOUT / 1000;
-        tv.tv_usec = (SOCKET_TIMEOUT % 1000) * 1000;
         OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO2, NULL,
                               "SSL_connect retry\n"));
 
-        fd = SSL_get_fd(sockinfo->ssl_conn);
-        FD_ZERO(&readfds);
-        FD_SET(fd, &readfds);
-        res = select(fd + 1, &readfds, NULL, NULL, &tv);
+        fd  = SSL_get_fd(sockinfo->ssl_conn);
+        res = _eXtl_wait_socket(fd, 0, SOCKET_TIMEOUT);
         if (res < 0)
         {
             OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO2, NULL,
@@ -2247,114 +2300,6 @@ _tls_tl_ssl_connect_socket(
     return 0;
 }
 
-/* Like strstr, but works for haystack that may contain binary data and is
-   not NUL-terminated. */
-static char *
-buffer_find(
-    const char *haystack,
-    size_t     haystack_len,
-    const char *needle)
-{
-    const char *search = haystack, *end = haystack + haystack_len;
-    char       *p;
-    size_t     len = strlen(needle);
-
-    while (search < end &&
-           (p = memchr(search, *needle, end - search)) != NULL)
-    {
-        if (p + len > end)
-            break;
-        if (memcmp(p, needle, len) == 0)
-            return (p);
-        search = p + 1;
-    }
-
-    return (NULL);
-}
-
-    #define END_HEADERS_STR          "\r\n\r\n"
-    #define CLEN_HEADER_STR          "\r\ncontent-length:"
-    #define CLEN_HEADER_COMPACT_STR  "\r\nl:"
-    #define CLEN_HEADER_STR2         "\r\ncontent-length "
-    #define CLEN_HEADER_COMPACT_STR2 "\r\nl "
-    #define const_strlen(x) (sizeof((x)) - 1)
-
-/* consume any complete messages in sockinfo->buf and
-   return the total number of bytes consumed */
-static int
-handle_messages(
-    struct socket_tab *sockinfo)
-{
-    int    consumed = 0;
-    char   *buf     = sockinfo->buf;
-    size_t buflen   = sockinfo->buflen;
-    char   *end_headers;
-    while (buflen > 0 && (end_headers = buffer_find(buf, buflen, END_HEADERS_STR)) != NULL)
-    {
-        int  clen, msglen;
-        char *clen_header;
-
-        if (buf == end_headers)
-        {
-            /* skip tcp standard keep-alive */
-            OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
-                                  "socket %s:%i: standard keep alive received (CRLFCRLF)\n",
-                                  sockinfo->remote_ip, sockinfo->remote_port, buf));
-            consumed += 4;
-            buflen   -= 4;
-            buf      += 4;
-            continue;
-        }
-
-        /* stuff a nul in so we can use osip_strcasestr */
-        *end_headers = '\0';
-
-        /* ok we have complete headers, find content-length: or l: */
-        clen_header  = osip_strcasestr(buf, CLEN_HEADER_STR);
-        if (!clen_header)
-            clen_header = osip_strcasestr(buf, CLEN_HEADER_STR2);
-        if (!clen_header)
-            clen_header = osip_strcasestr(buf, CLEN_HEADER_COMPACT_STR);
-        if (!clen_header)
-            clen_header = osip_strcasestr(buf, CLEN_HEADER_COMPACT_STR2);
-        if (clen_header != NULL)
-        {
-            clen_header = strchr(clen_header, ':');
-            clen_header++;
-        }
-        if (!clen_header)
-        {
-            /* Oops, no content-length header.	Presume 0 (below) so we
-                consume the headers and make forward progress.  This permits
-                server-side keepalive of "\r\n\r\n". */
-            OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
-                                  "socket %s:%i: message has no content-length: <%s>\n",
-                                  sockinfo->remote_ip, sockinfo->remote_port, buf));
-        }
-        clen         = clen_header ? atoi(clen_header) : 0;
-
-        /* undo our overwrite and advance end_headers */
-        *end_headers = END_HEADERS_STR[0];
-        end_headers += const_strlen(END_HEADERS_STR);
-
-        /* do we have the whole message? */
-        msglen       = end_headers - buf + clen;
-        if (msglen > buflen)
-        {
-            /* nope */
-            return consumed;
-        }
-        /* yep; handle the message */
-        _eXosip_handle_incoming_message(buf, msglen, sockinfo->socket,
-                                        sockinfo->remote_ip, sockinfo->remote_port);
-        consumed += msglen;
-        buflen   -= msglen;
-        buf      += msglen;
-    }
-
-    return consumed;
-}
-
 static int
 _tls_tl_recv(
     struct socket_tab *sockinfo)
@@ -2515,7 +2460,9 @@ _tls_tl_recv(
         OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
                               "socket %s:%i: read %d bytes\n", sockinfo->remote_ip, sockinfo->remote_port, r));
         sockinfo->buflen += rlen;
-        consumed          = handle_messages(sockinfo);
+        consumed          = _eXtl_framer_consume(&sockinfo->framer, sockinfo->buf,
+                                                 sockinfo->buflen, sockinfo->socket,
+                                                 sockinfo->remote_ip, sockinfo->remote_port);
         if (consumed == 0)
         {
             return OSIP_SUCCESS;
@@ -2537,202 +2484,221 @@ _tls_tl_recv(
 }
 
 static int
-tls_tl_read_message(
-    fd_set *osip_fdset,
-    fd_set *osip_wrset)
+_tls_tl_accept(
+    void)
 {
-    int pos = 0;
-
-    if (FD_ISSET(tls_socket, osip_fdset))
-    {
-        /* accept incoming connection */
-        char                    src6host[NI_MAXHOST];
-        int                     recvport = 0;
-        struct sockaddr_storage sa;
-        int                     sock;
-        int                     i;
+    /* accept incoming connection */
+    char                    src6host[NI_MAXHOST];
+    int                     recvport = 0;
+    struct sockaddr_storage sa;
+    int                     sock;
+    int                     i;
+    int                     pos;
+
+#ifdef __linux
+    socklen_t               slen;
+#else
+    int                     slen;
+#endif
 
-    #ifdef __linux
-        socklen_t               slen;
-    #else
-        int                     slen;
-    #endif
+    SSL                     *ssl = NULL;
+    BIO                     *sbio;
 
-        SSL                     *ssl = NULL;
-        BIO                     *sbio;
+    if (eXtl_tls.proto_family == AF_INET)
+        slen = sizeof(struct sockaddr_in);
+    else
+        slen = sizeof(struct sockaddr_in6);
 
-        if (eXtl_tls.proto_family == AF_INET)
-            slen = sizeof(struct sockaddr_in);
-        else
-            slen = sizeof(struct sockaddr_in6);
+    pos = _tls_tl_new_sockinfo();
+    if (pos < 0)
+        return OSIP_NOMEM;
 
-        for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
+    OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO3, NULL,
+                          "creating TLS socket at index: %i\n", pos));
+    sock = accept(tls_socket, (struct sockaddr *) &sa, &slen);
+    if (sock < 0)
+    {
+#if defined(EBADF)
+        int status = ex_errno;
+#endif
+        OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
+                              "Error accepting TLS socket\n"));
+#if defined(EBADF)
+        if (status == EBADF)
         {
-            if (tls_socket_tab[pos].socket <= 0)
-                break;
+            OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
+                                  "Error accepting TLS socket: EBADF\n"));
+            memset(&ai_addr, 0, sizeof(struct sockaddr_storage));
+            _eXtl_poll_del(tls_socket);
+            if (tls_socket > 0)
+                closesocket(tls_socket);
+            tls_tl_open();
         }
-        if (pos == EXOSIP_MAX_SOCKETS)
+#endif
+    }
+    else if (!_eXtl_select_fits(sock, _tls_tl_nb_sockets()))
+    {
+        OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_WARNING, NULL,
+                              "TLS connection refused: too many sockets for select()\n"));
+        closesocket(sock);
+        return -1;
+    }
+    else
+    {
+        if (server_ctx == NULL)
         {
-            /* delete an old one! */
-            pos = 0;
-            if (tls_socket_tab[pos].socket > 0)
-            {
-                _tls_tl_close_sockinfo(&tls_socket_tab[pos]);
-            }
-            memset(&tls_socket_tab[pos], 0, sizeof(struct socket_tab));
+            OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
+                                  "TLS connection rejected\n"));
+            close(sock);
+            return -1;
         }
 
-        OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO3, NULL,
-                              "creating TLS socket at index: %i\n", pos));
-        sock = accept(tls_socket, (struct sockaddr *) &sa, &slen);
-        if (sock < 0)
+        if (!SSL_CTX_check_private_key(server_ctx))
         {
-    #if defined(EBADF)
-            int status = ex_errno;
-    #endif
             OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
-                                  "Error accepting TLS socket\n"));
-    #if defined(EBADF)
-            if (status == EBADF)
-            {
-                OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
-                                      "Error accepting TLS socket: EBADF\n"));
-                memset(&ai_addr, 0, sizeof(struct sockaddr_storage));
-                if (tls_socket > 0)
-                    closesocket(tls_socket);
-                tls_tl_open();
-            }
-    #endif
+                                  "SSL CTX private key check error\n"));
         }
-        else
-        {
-            if (server_ctx == NULL)
-            {
-                OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
-                                      "TLS connection rejected\n"));
-                close(sock);
-                return -1;
-            }
-
-            if (!SSL_CTX_check_private_key(server_ctx))
-            {
-                OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
-                                      "SSL CTX private key check error\n"));
-            }
 
-            ssl = SSL_new(server_ctx);
-            if (ssl == NULL)
-            {
-                OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
-                                      "Cannot create ssl connection context\n"));
-                return -1;
-            }
-
-            if (!SSL_check_private_key(ssl))
-            {
-                OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
-                                      "SSL private key check error\n"));
-            }
+        ssl = SSL_new(server_ctx);
+        if (ssl == NULL)
+        {
+            OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
+                                  "Cannot create ssl connection context\n"));
+            return -1;
+        }
 
-            sbio = BIO_new_socket(sock, BIO_NOCLOSE);
-            if (sbio == NULL)
-            {
-                OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
-                                      "BIO_new_socket error\n"));
-            }
+        if (!SSL_check_private_key(ssl))
+        {
+            OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
+                                  "SSL private key check error\n"));
+        }
 
-            SSL_set_bio(ssl, sbio, sbio);   /* cannot fail */
+        sbio = BIO_new_socket(sock, BIO_NOCLOSE);
+        if (sbio == NULL)
+        {
+            OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
+                                  "BIO_new_socket error\n"));
+        }
 
-            i = SSL_accept(ssl);
-            if (i <= 0)
-            {
-                OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
-                                      "SSL_accept error: %s\n",
-                                      ERR_error_string(ERR_get_error(), NULL)));
-                i = SSL_get_error(ssl, i);
-                print_ssl_error(i);
+        SSL_set_bio(ssl, sbio, sbio);   /* cannot fail */
 
-                SSL_shutdown(ssl);
-                close(sock);
-                SSL_free(ssl);
-                return -1;
-            }
+        i = SSL_accept(ssl);
+        if (i <= 0)
+        {
+            OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
+                                  "SSL_accept error: %s\n",
+                                  ERR_error_string(ERR_get_error(), NULL)));
+            i = SSL_get_error(ssl, i);
+            print_ssl_error(i);
 
-            OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
-                                  "New TLS connection accepted\n"));
+            SSL_shutdown(ssl);
+            close(sock);
+            SSL_free(ssl);
+            return -1;
+        }
 
-            tls_socket_tab[pos].socket    = sock;
-            tls_socket_tab[pos].ssl_conn  = ssl;
-            tls_socket_tab[pos].ssl_state = 2;
+        OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
+                              "New TLS connection accepted\n"));
 
-            memset(src6host, 0, sizeof(src6host));
+        tls_socket_tab[pos]->socket    = sock;
+        _eXtl_poll_add(sock, &eXtl_tls, tls_socket_tab[pos]);
+        tls_socket_tab[pos]->ssl_conn  = ssl;
+        tls_socket_tab[pos]->ssl_state = 2;
 
-            if (eXtl_tls.proto_family == AF_INET)
-                recvport = ntohs(((struct sockaddr_in *) &sa)->sin_port);
-            else
-                recvport = ntohs(((struct sockaddr_in6 *) &sa)->sin6_port);
+        memset(src6host, 0, sizeof(src6host));
 
-    #if defined(__arc__)
-            {
-                struct sockaddr_in *fromsa = (struct sockaddr_in *) &sa;
-                char               *tmp;
-                tmp = inet_ntoa(fromsa->sin_addr);
-                if (tmp == NULL)
-                {
-                    OSIP_TRACE(osip_trace
-                                   (__FILE__, __LINE__, OSIP_ERROR, NULL,
-                                   "Message received from: NULL:%i inet_ntoa failure\n",
-                                   recvport));
-                }
-                else
-                {
-                    snprintf(src6host, sizeof(src6host), "%s", tmp);
-                    OSIP_TRACE(osip_trace
-                                   (__FILE__, __LINE__, OSIP_INFO1, NULL,
-                                   "Message received from: %s:%i\n", src6host,
-                                   recvport));
-                    osip_strncpy(tls_socket_tab[pos].remote_ip, src6host,
-                                 sizeof(tls_socket_tab[pos].remote_ip) - 1);
-                    tls_socket_tab[pos].remote_port = recvport;
-                }
-            }
-    #else
-            i = getnameinfo((struct sockaddr *) &sa, slen,
-                            src6host, NI_MAXHOST, NULL, 0, NI_NUMERICHOST);
+        if (eXtl_tls.proto_family == AF_INET)
+            recvport = ntohs(((struct sockaddr_in *) &sa)->sin_port);
+        else
+            recvport = ntohs(((struct sockaddr_in6 *) &sa)->sin6_port);
 
-            if (i != 0)
+#if defined(__arc__)
+        {
+            struct sockaddr_in *fromsa = (struct sockaddr_in *) &sa;
+            char               *tmp;
+            tmp = inet_ntoa(fromsa->sin_addr);
+            if (tmp == NULL)
             {
                 OSIP_TRACE(osip_trace
                                (__FILE__, __LINE__, OSIP_ERROR, NULL,
-                               "Message received from: NULL:%i getnameinfo failure\n",
+                               "Message received from: NULL:%i inet_ntoa failure\n",
                                recvport));
-                snprintf(src6host, sizeof(src6host), "127.0.0.1");
             }
             else
             {
+                snprintf(src6host, sizeof(src6host), "%s", tmp);
                 OSIP_TRACE(osip_trace
                                (__FILE__, __LINE__, OSIP_INFO1, NULL,
-                               "Message received from: %s:%i\n", src6host, recvport));
-                osip_strncpy(tls_socket_tab[pos].remote_ip, src6host,
-                             sizeof(tls_socket_tab[pos].remote_ip) - 1);
-                tls_socket_tab[pos].remote_port = recvport;
+                               "Message received from: %s:%i\n", src6host,
+                               recvport));
+                osip_strncpy(tls_socket_tab[pos]->remote_ip, src6host,
+                             sizeof(tls_socket_tab[pos]->remote_ip) - 1);
+                tls_socket_tab[pos]->remote_port = recvport;
             }
-    #endif
         }
+#else
+        i = getnameinfo((struct sockaddr *) &sa, slen,
+                        src6host, NI_MAXHOST, NULL, 0, NI_NUMERICHOST);
+
+        if (i != 0)
+        {
+            OSIP_TRACE(osip_trace
+                           (__FILE__, __LINE__, OSIP_ERROR, NULL,
+                           "Message received from: NULL:%i getnameinfo failure\n",
+                           recvport));
+            snprintf(src6host, sizeof(src6host), "127.0.0.1");
+        }
+        else
+        {
+            OSIP_TRACE(osip_trace
+                           (__FILE__, __LINE__, OSIP_INFO1, NULL,
+                           "Message received from: %s:%i\n", src6host, recvport));
+            osip_strncpy(tls_socket_tab[pos]->remote_ip, src6host,
+                         sizeof(tls_socket_tab[pos]->remote_ip) - 1);
+            tls_socket_tab[pos]->remote_port = recvport;
+        }
+#endif
     }
 
-    for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
+    return OSIP_SUCCESS;
+}
+
+static int
+tls_tl_read_message(
+    fd_set *osip_fdset,
+    fd_set *osip_wrset)
+{
+    int pos = 0;
+
+    if (FD_ISSET(tls_socket, osip_fdset))
+        _tls_tl_accept();
+
+    for (pos = 0; pos < tls_socket_tab_size; pos++)
     {
-        if (tls_socket_tab[pos].socket > 0)
+        if (tls_socket_tab[pos]->socket > 0)
         {
-            if (FD_ISSET(tls_socket_tab[pos].socket, osip_fdset))
-                _tls_tl_recv(&tls_socket_tab[pos]);
+            if (FD_ISSET(tls_socket_tab[pos]->socket, osip_fdset))
+                _tls_tl_recv(tls_socket_tab[pos]);
         }
     }
 
     return OSIP_SUCCESS;
 }
 
+static int
+tls_tl_read_fd(
+    int  fd,
+    void *ctx)
+{
+    struct socket_tab *sockinfo = (struct socket_tab *) ctx;
+
+    if (fd == tls_socket)
+        return _tls_tl_accept();
+    if (sockinfo == NULL || sockinfo->socket != fd)
+        return OSIP_UNDEFINED_ERROR;
+    return _tls_tl_recv(sockinfo);
+}
+
 static int
 _tls_tl_find_socket(
     char *host,
@@ -2740,12 +2706,12 @@ _tls_tl_find_socket(
 {
     int pos;
 
-    for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
+    for (pos = 0; pos < tls_socket_tab_size; pos++)
     {
-        if (tls_socket_tab[pos].socket != 0)
+        if (tls_socket_tab[pos]->socket != 0)
         {
-            if (0 == osip_strcasecmp(tls_socket_tab[pos].remote_ip, host)
-                && port == tls_socket_tab[pos].remote_port)
+            if (0 == osip_strcasecmp(tls_socket_tab[pos]->remote_ip, host)
+                && port == tls_socket_tab[pos]->remote_port)
                 return pos;
         }
     }
@@ -2772,15 +2738,8 @@ _tls_tl_connect_socket(
     selected_ai_addrlen = 0;
     memset(&selected_ai_addr, 0, sizeof(struct sockaddr));
 
-    for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
-    {
-        if (tls_socket_tab[pos].socket == 0)
-        {
-            break;
-        }
-    }
-
-    if (pos == EXOSIP_MAX_SOCKETS)
+    pos = _tls_tl_new_sockinfo();
+    if (pos < 0)
         return -1;
 
     res = eXosip_get_addrinfo(&addrinfo, host, port, IPPROTO_TCP);
@@ -2830,6 +2789,17 @@ _tls_tl_connect_socket(
             continue;
         }
 
+        if (!_eXtl_select_fits(sock, _tls_tl_nb_sockets()))
+        {
+            closesocket(sock);
+            sock = -1;
+            OSIP_TRACE(osip_trace
+                           (__FILE__, __LINE__, OSIP_WARNING, NULL,
+                           "eXosip: Cannot connect to %s, too many sockets for select()\n",
+                           host));
+            break;
+        }
+
         if (curinfo->ai_family == AF_INET6)
         {
     #ifdef IPV6_V6ONLY
@@ -2972,22 +2942,22 @@ _tls_tl_connect_socket(
                 else if (res == 0)
                 {
     #ifdef MULTITASKING_ENABLED
-                    tls_socket_tab[pos].readStream  = NULL;
-                    tls_socket_tab[pos].writeStream = NULL;
+                    tls_socket_tab[pos]->readStream  = NULL;
+                    tls_socket_tab[pos]->writeStream = NULL;
                     CFStreamCreatePairWithSocket(kCFAllocatorDefault, sock,
-                                                 &tls_socket_tab[pos].readStream, &tls_socket_tab[pos].writeStream);
-                    if (tls_socket_tab[pos].readStream != NULL)
-                        CFReadStreamSetProperty(tls_socket_tab[pos].readStream, kCFStreamNetworkServiceType, kCFStreamNetworkServiceTypeVoIP);
-                    if (tls_socket_tab[pos].writeStream != NULL)
-                        CFWriteStreamSetProperty(tls_socket_tab[pos].writeStream, kCFStreamNetworkServiceType, kCFStreamNetworkServiceTypeVoIP);
-                    if (CFReadStreamOpen(tls_socket_tab[pos].readStream))
+                                                 &tls_socket_tab[pos]->readStream, &tls_socket_tab[pos]->writeStream);
+                    if (tls_socket_tab[pos]->readStream != NULL)
+                        CFReadStreamSetProperty(tls_socket_tab[pos]->readStream, kCFStreamNetworkServiceType, kCFStreamNetworkServiceTypeVoIP);
+                    if (tls_socket_tab[pos]->writeStream != NULL)
+                        CFWriteStreamSetProperty(tls_socket_tab[pos]->writeStream, kCFStreamNetworkServiceType, kCFStreamNetworkServiceTypeVoIP);
+                    if (CFReadStreamOpen(tls_socket_tab[pos]->readStream))
                     {
                         OSIP_TRACE(osip_trace
                                        (__FILE__, __LINE__, OSIP_INFO2, NULL,
                                        "CFReadStreamOpen Succeeded!\n"));
                     }
 
-                    CFWriteStreamOpen(tls_socket_tab[pos].writeStream);
+                    CFWriteStreamOpen(tls_socket_tab[pos]->writeStream);
     #endif
                     OSIP_TRACE(osip_trace
                                    (__FILE__, __LINE__, OSIP_INFO2, NULL,
@@ -3012,31 +2982,32 @@ _tls_tl_connect_socket(
 
     if (sock > 0)
     {
-        tls_socket_tab[pos].socket     = sock;
+        tls_socket_tab[pos]->socket     = sock;
+        _eXtl_poll_add(sock, &eXtl_tls, tls_socket_tab[pos]);
 
-        tls_socket_tab[pos].ai_addrlen = selected_ai_addrlen;
-        memset(&tls_socket_tab[pos].ai_addr, 0, sizeof(struct sockaddr));
+        tls_socket_tab[pos]->ai_addrlen = selected_ai_addrlen;
+        memset(&tls_socket_tab[pos]->ai_addr, 0, sizeof(struct sockaddr));
         if (selected_ai_addrlen > 0)
-            memcpy(&tls_socket_tab[pos].ai_addr, &selected_ai_addr, selected_ai_addrlen);
+            memcpy(&tls_socket_tab[pos]->ai_addr, &selected_ai_addr, selected_ai_addrlen);
 
         if (src6host[0] == '\0')
-            osip_strncpy(tls_socket_tab[pos].remote_ip, host,
-                         sizeof(tls_socket_tab[pos].remote_ip) - 1);
+            osip_strncpy(tls_socket_tab[pos]->remote_ip, host,
+                         sizeof(tls_socket_tab[pos]->remote_ip) - 1);
         else
-            osip_strncpy(tls_socket_tab[pos].remote_ip, src6host,
-                         sizeof(tls_socket_tab[pos].remote_ip) - 1);
+            osip_strncpy(tls_socket_tab[pos]->remote_ip, src6host,
+                         sizeof(tls_socket_tab[pos]->remote_ip) - 1);
 
-        tls_socket_tab[pos].remote_port = port;
-        tls_socket_tab[pos].ssl_conn    = NULL;
-        tls_socket_tab[pos].ssl_state   = ssl_state;
-        tls_socket_tab[pos].ssl_ctx     = NULL;
+        tls_socket_tab[pos]->remote_port = port;
+        tls_socket_tab[pos]->ssl_conn    = NULL;
+        tls_socket_tab[pos]->ssl_state   = ssl_state;
+        tls_socket_tab[pos]->ssl_ctx     = NULL;
 
-        if (tls_socket_tab[pos].ssl_state == 1)     /* TCP connected but not TLS connected */
+        if (tls_socket_tab[pos]->ssl_state == 1)     /* TCP connected but not TLS connected */
         {
-            res = _tls_tl_ssl_connect_socket(&tls_socket_tab[pos]);
+            res = _tls_tl_ssl_connect_socket(tls_socket_tab[pos]);
             if (res < 0)
             {
-                _tls_tl_close_sockinfo(&tls_socket_tab[pos]);
+                _tls_tl_close_sockinfo(tls_socket_tab[pos]);
                 return -1;
             }
         }
@@ -3055,7 +3026,7 @@ tls_tl_send_message(
     int                out_socket)
 {
     size_t       length = 0;
-    char         *message;
+    const char   *message;
     int          i;
 
     int          pos;
@@ -3205,7 +3176,7 @@ tls_tl_send_message(
         {
             osip_list_remove(&sip->routes, 0);
         }
-        i = osip_message_to_str(sip, &message, &length);
+        i = osip_message_to_str_cached(sip, &message, &length);
         if (tag == NULL && route != NULL && route->url != NULL)
         {
             osip_list_add(&sip->routes, route, 0);
@@ -3222,23 +3193,23 @@ tls_tl_send_message(
 
     if (out_socket > 0)
     {
-        for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
+        for (pos = 0; pos < tls_socket_tab_size; pos++)
         {
-            if (tls_socket_tab[pos].socket != 0)
+            if (tls_socket_tab[pos]->socket != 0)
             {
-                if (tls_socket_tab[pos].socket == out_socket)
+                if (tls_socket_tab[pos]->socket == out_socket)
                 {
-                    out_socket = tls_socket_tab[pos].socket;
-                    ssl        = tls_socket_tab[pos].ssl_conn;
+                    out_socket = tls_socket_tab[pos]->socket;
+                    ssl        = tls_socket_tab[pos]->ssl_conn;
                     OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
                                           "reusing REQUEST connection (to dest=%s:%i)\n",
-                                          tls_socket_tab[pos].remote_ip,
-                                          tls_socket_tab[pos].remote_port));
+                                          tls_socket_tab[pos]->remote_ip,
+                                          tls_socket_tab[pos]->remote_port));
                     break;
                 }
             }
         }
-        if (pos == EXOSIP_MAX_SOCKETS)
+        if (pos == tls_socket_tab_size)
             out_socket = 0;
     }
 
@@ -3250,22 +3221,30 @@ tls_tl_send_message(
         /* Step 2: create new socket with host:port */
         if (pos < 0)
         {
+            struct addrinfo *addrinfo = NULL;
+
+            /* keep waiting (address not received): the connection
+               finds the address in the resolver cache */
+            i = _eXosip_get_addrinfo_async(tr, sip, &addrinfo, host, port, IPPROTO_TCP);
+            if (i == 1)
+                return OSIP_SUCCESS + 1;
+            if (addrinfo != NULL)
+                eXosip_freeaddrinfo(addrinfo);
             pos = _tls_tl_connect_socket(host, port);
         }
         if (pos >= 0)
         {
-            out_socket = tls_socket_tab[pos].socket;
-            ssl        = tls_socket_tab[pos].ssl_conn;
+            out_socket = tls_socket_tab[pos]->socket;
+            ssl        = tls_socket_tab[pos]->ssl_conn;
         }
     }
 
     if (out_socket <= 0)
     {
-        osip_free(message);
         return -1;
     }
 
-    if (tls_socket_tab[pos].ssl_state == 0)
+    if (tls_socket_tab[pos]->ssl_state == 0)
     {
         i = _tls_tl_is_connected(out_socket);
         if (i > 0)
@@ -3276,7 +3255,6 @@ tls_tl_send_message(
                            (__FILE__, __LINE__, OSIP_INFO2, NULL,
                            "socket node:%s, socket %d [pos=%d], in progress\n",
                            host, out_socket, pos));
-            osip_free(message);
             if (tr != NULL && now - tr->birth_time > 10 && now - tr->birth_time < 13)
             {
                 /* avoid doing this twice... */
@@ -3302,8 +3280,8 @@ tls_tl_send_message(
                            (__FILE__, __LINE__, OSIP_INFO2, NULL,
                            "socket node:%s , socket %d [pos=%d], connected\n",
                            host, out_socket, pos));
-            tls_socket_tab[pos].ssl_state  = 1;
-            tls_socket_tab[pos].ai_addrlen = 0;
+            tls_socket_tab[pos]->ssl_state  = 1;
+            tls_socket_tab[pos]->ai_addrlen = 0;
         }
         else
         {
@@ -3311,18 +3289,16 @@ tls_tl_send_message(
                            (__FILE__, __LINE__, OSIP_ERROR, NULL,
                            "socket node:%s, socket %d [pos=%d], socket error\n",
                            host, out_socket, pos));
-            osip_free(message);
             return -1;
         }
     }
 
-    if (tls_socket_tab[pos].ssl_state == 1)     /* TCP connected but not TLS connected */
+    if (tls_socket_tab[pos]->ssl_state == 1)     /* TCP connected but not TLS connected */
     {
-        i = _tls_tl_ssl_connect_socket(&tls_socket_tab[pos]);
+        i = _tls_tl_ssl_connect_socket(tls_socket_tab[pos]);
         if (i < 0)
         {
-            _tls_tl_close_sockinfo(&tls_socket_tab[pos]);
-            osip_free(message);
+            _tls_tl_close_sockinfo(tls_socket_tab[pos]);
             return -1;
         }
         else if (i > 0)
@@ -3331,37 +3307,35 @@ tls_tl_send_message(
                            (__FILE__, __LINE__, OSIP_INFO2, NULL,
                            "socket node:%s, socket %d [pos=%d], connected (ssl in progress)\n",
                            host, out_socket, pos));
-            osip_free(message);
             return 1;
         }
-        ssl = tls_socket_tab[pos].ssl_conn;
+        ssl = tls_socket_tab[pos]->ssl_conn;
     }
 
     if (ssl == NULL)
     {
-        osip_free(message);
         return -1;
     }
 
     #ifdef MULTITASKING_ENABLED
-    if (tls_socket_tab[pos].readStream == NULL)
-    {
-        tls_socket_tab[pos].readStream  = NULL;
-        tls_socket_tab[pos].writeStream = NULL;
-        CFStreamCreatePairWithSocket(kCFAllocatorDefault, tls_socket_tab[pos].socket,
-                                     &tls_socket_tab[pos].readStream, &tls_socket_tab[pos].writeStream);
-        if (tls_socket_tab[pos].readStream != NULL)
-            CFReadStreamSetProperty(tls_socket_tab[pos].readStream, kCFStreamNetworkServiceType, kCFStreamNetworkServiceTypeVoIP);
-        if (tls_socket_tab[pos].writeStream != NULL)
-            CFWriteStreamSetProperty(tls_socket_tab[pos].writeStream, kCFStreamNetworkServiceType, kCFStreamNetworkServiceTypeVoIP);
-        if (CFReadStreamOpen(tls_socket_tab[pos].readStream))
+    if (tls_socket_tab[pos]->readStream == NULL)
+    {
+        tls_socket_tab[pos]->readStream  = NULL;
+        tls_socket_tab[pos]->writeStream = NULL;
+        CFStreamCreatePairWithSocket(kCFAllocatorDefault, tls_socket_tab[pos]->socket,
+                                     &tls_socket_tab[pos]->readStream, &tls_socket_tab[pos]->writeStream);
+        if (tls_socket_tab[pos]->readStream != NULL)
+            CFReadStreamSetProperty(tls_socket_tab[pos]->readStream, kCFStreamNetworkServiceType, kCFStreamNetworkServiceTypeVoIP);
+        if (tls_socket_tab[pos]->writeStream != NULL)
+            CFWriteStreamSetProperty(tls_socket_tab[pos]->writeStream, kCFStreamNetworkServiceType, kCFStreamNetworkServiceTypeVoIP);
+        if (CFReadStreamOpen(tls_socket_tab[pos]->readStream))
         {
             OSIP_TRACE(osip_trace
                            (__FILE__, __LINE__, OSIP_INFO2, NULL,
                            "CFReadStreamOpen Succeeded!\n"));
         }
 
-        CFWriteStreamOpen(tls_socket_tab[pos].writeStream);
+        CFWriteStreamOpen(tls_socket_tab[pos]->writeStream);
     }
     #endif
 
@@ -3382,13 +3356,11 @@ tls_tl_send_message(
                 continue;
             print_ssl_error(i);
 
-            osip_free(message);
             return -1;
         }
         break;
     }
 
-    osip_free(message);
     return OSIP_SUCCESS;
 }
 
@@ -3408,19 +3380,19 @@ tls_tl_keepalive(
     if (tls_socket <= 0)
         return OSIP_UNDEFINED_ERROR;
 
-    for (pos = 0; pos < EXOSIP_MAX_SOCKETS; pos++)
+    for (pos = 0; pos < tls_socket_tab_size; pos++)
     {
-        if (tls_socket_tab[pos].socket > 0 && tls_socket_tab[pos].ssl_state > 2)
+        if (tls_socket_tab[pos]->socket > 0 && tls_socket_tab[pos]->ssl_state > 2)
         {
-            SSL_set_mode(tls_socket_tab[pos].ssl_conn, SSL_MODE_AUTO_RETRY);
+            SSL_set_mode(tls_socket_tab[pos]->ssl_conn, SSL_MODE_AUTO_RETRY);
 
             while (1)
             {
-                i = SSL_write(tls_socket_tab[pos].ssl_conn, (const void *) buf, 4);
+                i = SSL_write(tls_socket_tab[pos]->ssl_conn, (const void *) buf, 4);
 
                 if (i <= 0)
                 {
-                    i = SSL_get_error(tls_socket_tab[pos].ssl_conn, i);
+                    i = SSL_get_error(tls_socket_tab[pos]->ssl_conn, i);
                     if (i == SSL_ERROR_WANT_READ || i == SSL_ERROR_WANT_WRITE)
                         continue;
                     print_ssl_error(i);
@@ -3437,6 +3409,7 @@ tls_tl_set_socket(
     int socket)
 {
     tls_socket = socket;
+    _eXtl_poll_add(tls_socket, &eXtl_tls, NULL);
 
     return OSIP_SUCCESS;
 }
@@ -3500,7 +3473,8 @@ struct eXtl_protocol eXtl_tls = {
     &tls_tl_keepalive,
     &tls_tl_set_socket,
     &tls_tl_masquerade_contact,
-    &tls_tl_get_masquerade_contact
+    &tls_tl_get_masquerade_contact,
+    &tls_tl_read_fd
 };
 
 #else
@@ -17,6 +17,10 @@
    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#if defined(__linux) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE             /* recvmmsg() */
+#endif
+
 #ifdef ENABLE_MPATROL
 #include <mpatrol.h>
 #endif
@@ -36,6 +40,14 @@ extern eXosip_t eXosip;
 #define strerror(X) "-1"
 #endif
 
+/* number of datagrams read for each select() wakeup */
+#if defined(__linux) && defined(MSG_WAITFORONE)
+#define UDP_TL_USE_RECVMMSG
+#define UDP_TL_RECV_BATCH 16
+#else
+#define UDP_TL_RECV_BATCH 1
+#endif
+
 void udp_tl_learn_port_from_via(osip_message_t *sip);
 
 static int                     udp_socket;
@@ -44,11 +56,15 @@ static struct sockaddr_storage ai_addr;
 static char                    udp_firewall_ip[64];
 static char                    udp_firewall_port[10];
 
+/* receive buffers, kept from one read to the next */
+static char                    *udp_recv_buf;
+
 static int
 udp_tl_init(
     void)
 {
     udp_socket = 0;
+    udp_recv_buf = NULL;
     memset(&ai_addr, 0, sizeof(struct sockaddr_storage));
     memset(udp_firewall_ip, 0, sizeof(udp_firewall_ip));
     memset(udp_firewall_port, 0, sizeof(udp_firewall_port));
@@ -62,8 +78,11 @@ udp_tl_free(
     memset(udp_firewall_ip, 0, sizeof(udp_firewall_ip));
     memset(udp_firewall_port, 0, sizeof(udp_firewall_port));
     memset(&ai_addr, 0, sizeof(struct sockaddr_storage));
+    _eXtl_poll_del(udp_socket);
     if (udp_socket > 0)
         close(udp_socket);
+    osip_free(udp_recv_buf);
+    udp_recv_buf = NULL;
 
     return OSIP_SUCCESS;
 }
@@ -181,6 +200,7 @@ udp_tl_open(
     }
 
     udp_socket = sock;
+    _eXtl_poll_add(udp_socket, &eXtl_udp, NULL);
 
     if (eXtl_udp.proto_family == AF_INET)
     {
@@ -277,123 +297,169 @@ udp_tl_learn_port_from_via(
     return;
 }
 
-// receive a sip message through UDP socket
-static int
-udp_tl_read_message(
-    fd_set *osip_fdset,
-    fd_set *osip_wrset)
-{
-    char *buf;
-    int  i;
-
-    if (udp_socket <= 0)
-        return -1;
-
-    if (FD_ISSET(udp_socket, osip_fdset))
-    {
-        struct sockaddr_storage sa;
-
+// handle one datagram read from the UDP socket
+static void
+udp_tl_recv_datagram(
+    char                    *buf,
+    int                     i,
+    struct sockaddr_storage *sa,
 #ifdef __linux
-        socklen_t               slen;
+    socklen_t               slen)
 #else
-        int                     slen;
+    int                     slen)
 #endif
-        if (eXtl_udp.proto_family == AF_INET)
-            slen = sizeof(struct sockaddr_in);
-        else
-            slen = sizeof(struct sockaddr_in6);
-
-        buf = (char *)osip_malloc(SIP_MESSAGE_MAX_LENGTH * sizeof(char) + 1);
-        if (buf == NULL)
-            return OSIP_NOMEM;
-
-        i = recvfrom(udp_socket, buf,
-            SIP_MESSAGE_MAX_LENGTH, 0, (struct sockaddr *) &sa, &slen);
-
-        if (i > 5)
-        {
-            char src6host[NI_MAXHOST];
-            int  recvport = 0;
-            int  err;
+{
+    if (i > 5)
+    {
+        char src6host[NI_MAXHOST];
+        int  recvport = 0;
+        int  err;
 
-            buf[i] = '\0';
-            OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
-                "Received message: \n%s\n", buf));
+        buf[i] = '\0';
+        OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
+            "Received message: \n%s\n", buf));
 
-            memset(src6host, 0, sizeof(src6host));
+        memset(src6host, 0, sizeof(src6host));
 
-            if (eXtl_udp.proto_family == AF_INET)
-                recvport = ntohs(((struct sockaddr_in *) &sa)->sin_port);
-            else
-                recvport = ntohs(((struct sockaddr_in6 *) &sa)->sin6_port);
+        if (eXtl_udp.proto_family == AF_INET)
+            recvport = ntohs(((struct sockaddr_in *) sa)->sin_port);
+        else
+            recvport = ntohs(((struct sockaddr_in6 *) sa)->sin6_port);
 
 #if defined(__arc__)
-            {
-                struct sockaddr_in *fromsa = (struct sockaddr_in *) &sa;
-                char               *tmp;
-                tmp = inet_ntoa(fromsa->sin_addr);
-                if (tmp == NULL)
-                {
-                    OSIP_TRACE(osip_trace
-                    (__FILE__, __LINE__, OSIP_ERROR, NULL,
-                        "Message received from: NULL:%i inet_ntoa failure\n",
-                        recvport));
-                }
-                else
-                {
-                    snprintf(src6host, sizeof(src6host), "%s", tmp);
-                    OSIP_TRACE(osip_trace
-                    (__FILE__, __LINE__, OSIP_INFO1, NULL,
-                        "Message received from: %s:%i\n", src6host,
-                        recvport));
-                }
-            }
-#else
-            err = getnameinfo((struct sockaddr *) &sa, slen,
-                src6host, NI_MAXHOST, NULL, 0, NI_NUMERICHOST);
-
-            if (err != 0)
+        {
+            struct sockaddr_in *fromsa = (struct sockaddr_in *) sa;
+            char               *tmp;
+            tmp = inet_ntoa(fromsa->sin_addr);
+            if (tmp == NULL)
             {
                 OSIP_TRACE(osip_trace
                 (__FILE__, __LINE__, OSIP_ERROR, NULL,
-                    "Message received from: NULL:%i getnameinfo failure\n",
+                    "Message received from: NULL:%i inet_ntoa failure\n",
                     recvport));
-                snprintf(src6host, sizeof(src6host), "127.0.0.1");
             }
             else
             {
+                snprintf(src6host, sizeof(src6host), "%s", tmp);
                 OSIP_TRACE(osip_trace
                 (__FILE__, __LINE__, OSIP_INFO1, NULL,
-                    "Message received from: %s:%i\n", src6host, recvport));
+                    "Message received from: %s:%i\n", src6host,
+                    recvport));
             }
-#endif
+        }
+#else
+        err = getnameinfo((struct sockaddr *) sa, slen,
+            src6host, NI_MAXHOST, NULL, 0, NI_NUMERICHOST);
 
+        if (err != 0)
+        {
+            OSIP_TRACE(osip_trace
+            (__FILE__, __LINE__, OSIP_ERROR, NULL,
+                "Message received from: NULL:%i getnameinfo failure\n",
+                recvport));
+            snprintf(src6host, sizeof(src6host), "127.0.0.1");
+        }
+        else
+        {
             OSIP_TRACE(osip_trace
             (__FILE__, __LINE__, OSIP_INFO1, NULL,
                 "Message received from: %s:%i\n", src6host, recvport));
-
-            _eXosip_handle_incoming_message(buf, i, udp_socket, src6host,
-                recvport);
         }
+#endif
+
+        OSIP_TRACE(osip_trace
+        (__FILE__, __LINE__, OSIP_INFO1, NULL,
+            "Message received from: %s:%i\n", src6host, recvport));
+
+        _eXosip_handle_incoming_message(buf, i, udp_socket, src6host,
+            recvport);
+    }
 #ifndef MINISIZE
-        else if (i < 0)
-        {
-            OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
-                "Could not read socket\n"));
+    else if (i < 0)
+    {
+        OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_ERROR, NULL,
+            "Could not read socket\n"));
 #ifdef _WIN32
-            OSIP_TRACE(osip_trace
-            (__FILE__, __LINE__, OSIP_ERROR, NULL, "err: %s\n",
-                strerror(errno)));
+        OSIP_TRACE(osip_trace
+        (__FILE__, __LINE__, OSIP_ERROR, NULL, "err: %s\n",
+            strerror(errno)));
 #endif
-        }
+    }
+    else
+    {
+        OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
+            "Dummy SIP message received\n"));
+    }
+#endif
+}
+
+// receive sip messages through UDP socket
+static int
+udp_tl_read_message(
+    fd_set *osip_fdset,
+    fd_set *osip_wrset)
+{
+    if (udp_socket <= 0)
+        return -1;
+
+    if (FD_ISSET(udp_socket, osip_fdset))
+    {
+#ifdef UDP_TL_USE_RECVMMSG
+        struct mmsghdr          msgs[UDP_TL_RECV_BATCH];
+        struct iovec            iovecs[UDP_TL_RECV_BATCH];
+        struct sockaddr_storage sas[UDP_TL_RECV_BATCH];
+        int                     k;
+#else
+        struct sockaddr_storage sa;
+#endif
+#ifdef __linux
+        socklen_t               slen;
+#else
+        int                     slen;
+#endif
+        int                     i;
+
+        if (eXtl_udp.proto_family == AF_INET)
+            slen = sizeof(struct sockaddr_in);
         else
+            slen = sizeof(struct sockaddr_in6);
+
+        /* the buffers are reused: the message is parsed (or copied for
+           the worker threads) before the next read. */
+        if (udp_recv_buf == NULL)
         {
-            OSIP_TRACE(osip_trace(__FILE__, __LINE__, OSIP_INFO1, NULL,
-                "Dummy SIP message received\n"));
+            udp_recv_buf = (char *)osip_malloc(UDP_TL_RECV_BATCH
+                * (SIP_MESSAGE_MAX_LENGTH + 1));
+            if (udp_recv_buf == NULL)
+                return OSIP_NOMEM;
         }
-#endif
 
-        osip_free(buf);
+#ifdef UDP_TL_USE_RECVMMSG
+        memset(msgs, 0, sizeof(msgs));
+        for (k = 0; k < UDP_TL_RECV_BATCH; k++)
+        {
+            iovecs[k].iov_base            = udp_recv_buf + k * (SIP_MESSAGE_MAX_LENGTH + 1);
+            iovecs[k].iov_len             = SIP_MESSAGE_MAX_LENGTH;
+            msgs[k].msg_hdr.msg_iov       = &iovecs[k];
+            msgs[k].msg_hdr.msg_iovlen    = 1;
+            msgs[k].msg_hdr.msg_name      = &sas[k];
+            msgs[k].msg_hdr.msg_namelen   = slen;
+        }
+
+        /* everything already queued on the socket, without blocking */
+        i = recvmmsg(udp_socket, msgs, UDP_TL_RECV_BATCH, MSG_DONTWAIT, NULL);
+        if (i < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            udp_tl_recv_datagram(udp_recv_buf, i, &sas[0], slen);
+        for (k = 0; k < i; k++)
+        {
+            udp_tl_recv_datagram((char *) iovecs[k].iov_base, (int) msgs[k].msg_len,
+                &sas[k], msgs[k].msg_hdr.msg_namelen);
+        }
+#else
+        i = recvfrom(udp_socket, udp_recv_buf,
+            SIP_MESSAGE_MAX_LENGTH, 0, (struct sockaddr *) &sa, &slen);
+        udp_tl_recv_datagram(udp_recv_buf, i, &sa, slen);
+#endif
     }
 
     return OSIP_SUCCESS;
@@ -518,7 +584,7 @@ udp_tl_send_message(
     size_t                   length = 0;
     struct addrinfo          *addrinfo;
     struct __eXosip_sockaddr addr;
-    char                     *message = NULL;
+    const char               *message = NULL;
 
     char                     ipbuf[INET6_ADDRSTRLEN];
     int                      i;
@@ -657,7 +723,12 @@ udp_tl_send_message(
                     if (srv->ipaddress[0])
                         i = eXosip_get_addrinfo(&addrinfo, srv->ipaddress, srv->port, IPPROTO_UDP);
                     else
-                        i = eXosip_get_addrinfo(&addrinfo, srv->srv, srv->port, IPPROTO_UDP);
+                        i = _eXosip_get_addrinfo_async(tr, sip, &addrinfo, srv->srv, srv->port, IPPROTO_UDP);
+                    if (i == 1)
+                    {
+                        /* 4: keep waiting (address of the target not received) */
+                        return OSIP_SUCCESS + 1;
+                    }
                     if (i == 0)
                     {
                         host = srv->srv;
@@ -696,7 +767,12 @@ udp_tl_send_message(
     /* if SRV was used, destination may be already found */
     if (i != 0)
     {
-        i = eXosip_get_addrinfo(&addrinfo, host, port, IPPROTO_UDP);
+        i = _eXosip_get_addrinfo_async(tr, sip, &addrinfo, host, port, IPPROTO_UDP);
+        if (i == 1)
+        {
+            /* keep waiting (address not received) */
+            return OSIP_SUCCESS + 1;
+        }
     }
 
     if (i != 0)
@@ -721,7 +797,7 @@ udp_tl_send_message(
         {
             osip_list_remove(&sip->routes, 0);
         }
-        i = osip_message_to_str(sip, &message, &length);
+        i = osip_message_to_str_cached(sip, &message, &length);
         if (tag == NULL && route != NULL && route->url != NULL)
         {
             osip_list_add(&sip->routes, route, 0);
@@ -730,7 +806,6 @@ udp_tl_send_message(
 
     if (i != 0 || length <= 0)
     {
-        osip_free(message);
         return -1;
     }
 
@@ -789,13 +864,11 @@ udp_tl_send_message(
             /* rotate on failure! */
             if (eXosip_dnsutils_rotate_srv(&naptr_record->sipudp_record) > 0)
             {
-                osip_free(message);
                 return OSIP_SUCCESS + 1; /* retry for next retransmission! */
             }
         }
 #endif
         /* SIP_NETWORK_ERROR; */
-        osip_free(message);
         return -1;
     }
 
@@ -834,7 +907,6 @@ udp_tl_send_message(
                         host, port,
                         naptr_record->sipudp_record.srventry[naptr_record->sipudp_record.index].srv,
                         naptr_record->sipudp_record.srventry[naptr_record->sipudp_record.index].port));
-                    osip_free(message);
                     return OSIP_SUCCESS + 1; /* retry for next retransmission! */
                 }
             }
@@ -842,7 +914,6 @@ udp_tl_send_message(
     }
 #endif
 
-    osip_free(message);
     return OSIP_SUCCESS;
 }
 
@@ -885,6 +956,7 @@ udp_tl_set_socket(
     int socket)
 {
     udp_socket = socket;
+    _eXtl_poll_add(udp_socket, &eXtl_udp, NULL);
 
     return OSIP_SUCCESS;
 }
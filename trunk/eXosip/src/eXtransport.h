@@ -58,6 +58,8 @@ struct eXtl_protocol {
     int  (*tl_masquerade_contact) (const char *ip, int port);
     int  (*tl_get_masquerade_contact) (char *ip, int ip_size, char *port,
                                        int port_size);
+    /* optional: read from a socket returned by epoll (see eXtl_poll.c) */
+    int  (*tl_read_fd) (int fd, void *ctx);
 };
 
 extern struct eXtl_protocol eXtl_udp;
@@ -73,4 +75,31 @@ extern struct eXtl_protocol eXtl_dtls;
     #define eXFD_SET(A, B) FD_SET(A, B)
 #endif
 
+/* state of the message at the start of a stream receive buffer */
+struct eXtl_framer {
+    size_t scan_pos;        /* bytes already searched for CRLFCRLF */
+    size_t header_len;      /* 0 until CRLFCRLF is found */
+    size_t content_length;
+};
+
+int _eXtl_framer_consume(struct eXtl_framer *framer, char *buf, size_t buflen,
+                         int socket, char *remote_ip, int remote_port);
+
+#ifdef HAVE_SYS_EPOLL_H
+int _eXtl_poll_init(void);
+void _eXtl_poll_free(void);
+int _eXtl_poll_enabled(void);
+int _eXtl_poll_add(int fd, struct eXtl_protocol *tl, void *ctx);
+void _eXtl_poll_del(int fd);
+int _eXtl_poll_wait(int sec_max, int usec_max);
+#else
+    #define _eXtl_poll_init()
+    #define _eXtl_poll_free()
+    #define _eXtl_poll_add(fd, tl, ctx)
+    #define _eXtl_poll_del(fd)
+#endif
+
+int _eXtl_select_fits(int sock, int nb_sockets);
+int _eXtl_wait_socket(int sock, int wr, int timeout_ms);
+
 #endif
\ No newline at end of file
@@ -421,6 +421,19 @@ eXosip_get_addrinfo(
     return OSIP_SUCCESS;
 }
 
+int
+_eXosip_get_addrinfo_async(
+    osip_transaction_t *tr,
+    osip_message_t     *sip,
+    struct addrinfo    **addrinfo,
+    const char         *hostname,
+    int                port,
+    int                protocol)
+{
+    /* no resolver cache with gethostbyname() */
+    return eXosip_get_addrinfo(addrinfo, hostname, port, protocol);
+}
+
 #endif
 
 #if defined(WIN32) || defined(_WIN32_WCE)
@@ -823,18 +836,21 @@ strdup_printf(
 
 #if !defined(USE_GETHOSTBYNAME)
 
-int
-eXosip_get_addrinfo(
+/* wait is 0 when the caller can retry later: returns 1 while resolving */
+static int
+_eXosip_get_addrinfo(
     struct addrinfo **addrinfo,
     const char      *hostname,
     int             service,
-    int             protocol)
+    int             protocol,
+    int             wait)
 {
     struct addrinfo hints;
     char            portbuf[10];
     int             error;
     int             i;
 
+    *addrinfo = NULL;
     if (hostname == NULL)
         return OSIP_BADPARAMETER;
 
@@ -882,7 +898,40 @@ eXosip_get_addrinfo(
         hints.ai_socktype = SOCK_STREAM;
 
     hints.ai_protocol = protocol;   /* IPPROTO_UDP or IPPROTO_TCP */
-    error             = getaddrinfo(hostname, portbuf, &hints, addrinfo);
+
+    /* host names go through the resolver cache */
+    if (strchr(hostname, ':') == NULL && INADDR_NONE == inet_addr(hostname))
+    {
+        char            ip[EXOSIP_RESOLVER_MAX_ADDR][65];
+        struct addrinfo **last = addrinfo;
+        int             nb;
+
+        nb = _eXosip_resolver_addr(hostname, hints.ai_family, wait, ip,
+                                   EXOSIP_RESOLVER_MAX_ADDR);
+        if (nb == 0)
+            return 1;           /* the caller retries later */
+        if (nb < 0)
+        {
+            OSIP_TRACE(osip_trace
+                           (__FILE__, __LINE__, OSIP_INFO2, NULL,
+                           "getaddrinfo failure (cached). %s:%s\n", hostname, portbuf));
+            return OSIP_UNKNOWN_HOST;
+        }
+
+        /* one list with all the addresses: freeaddrinfo() releases
+           the elements one by one */
+        hints.ai_flags |= AI_NUMERICHOST;
+        for (i = 0; i < nb; i++)
+        {
+            if (getaddrinfo(ip[i], portbuf, &hints, last) != 0)
+                continue;
+            while (*last != NULL)
+                last = &(*last)->ai_next;
+        }
+        error = (*addrinfo == NULL) ? EAI_NONAME : 0;
+    }
+    else
+        error = getaddrinfo(hostname, portbuf, &hints, addrinfo);
     if (osip_strcasecmp(hostname, "0.0.0.0") != 0)
     {
         OSIP_TRACE(osip_trace
@@ -922,6 +971,31 @@ eXosip_get_addrinfo(
     return OSIP_SUCCESS;
 }
 
+int
+eXosip_get_addrinfo(
+    struct addrinfo **addrinfo,
+    const char      *hostname,
+    int             service,
+    int             protocol)
+{
+    return _eXosip_get_addrinfo(addrinfo, hostname, service, protocol, 1);
+}
+
+int
+_eXosip_get_addrinfo_async(
+    osip_transaction_t *tr,
+    osip_message_t     *sip,
+    struct addrinfo    **addrinfo,
+    const char         *hostname,
+    int                service,
+    int                protocol)
+{
+    /* only the requests of the client transactions are sent again */
+    int wait = (tr == NULL || sip == NULL || !MSG_IS_REQUEST(sip) || MSG_IS_ACK(sip));
+
+    return _eXosip_get_addrinfo(addrinfo, hostname, service, protocol, wait);
+}
+
 #endif
 
 static void
@@ -3240,9 +3314,213 @@ typedef union {
             #define T_NAPTR 35
         #endif
 
+        #ifndef T_A
+            #define T_A     1
+        #endif
+
+        #ifndef T_AAAA
+            #define T_AAAA  28
+        #endif
+
+        #define EXOSIP_DNSUTILS_RES_STATE
+
+/*
+   resolver state of the queries: used by the resolver thread only
+   (eXresolver.c), and rebuilt when EXOSIP_OPT_SET_DNS_SERVER changes,
+   so that clearing the option gives the system servers back.
+ */
+static struct __res_state dnsutils_res;
+static int                dnsutils_res_version = -1;
+
+static res_state
+_eXosip_dnsutils_res(
+    void)
+{
+    struct sockaddr_in addr;
+    char               server[64];
+    char               *port;
+    int                version;
+
+    memset(server, '\0', sizeof(server));
+    version = _eXosip_resolver_get_dns_server(server, sizeof(server));
+    if (version == dnsutils_res_version)
+        return &dnsutils_res;
+
+    _eXosip_dnsutils_close();
+    memset(&dnsutils_res, 0, sizeof(dnsutils_res));
+    if (res_ninit(&dnsutils_res) != 0)
+    {
+        OSIP_TRACE(osip_trace
+                       (__FILE__, __LINE__, OSIP_ERROR, NULL,
+                       "eXosip: res_ninit failed\n"));
+        return NULL;
+    }
+    dnsutils_res_version = version;
+    if (server[0] == '\0')
+        return &dnsutils_res;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(53);
+    port            = strchr(server, ':');
+    if (port != NULL)
+    {
+        *port         = '\0';
+        addr.sin_port = htons((unsigned short) osip_atoi(port + 1));
+    }
+    if (inet_pton(AF_INET, server, &addr.sin_addr) != 1)
+    {
+        OSIP_TRACE(osip_trace
+                       (__FILE__, __LINE__, OSIP_ERROR, NULL,
+                       "eXosip: bad dns server '%s': using the system ones\n", server));
+        return &dnsutils_res;
+    }
+    dnsutils_res.nscount        = 1;
+    dnsutils_res.nsaddr_list[0] = addr;
+    return &dnsutils_res;
+}
+
+void
+_eXosip_dnsutils_close(
+    void)
+{
+    if (dnsutils_res_version < 0)
+        return;
+    res_nclose(&dnsutils_res);
+    dnsutils_res_version = -1;
+}
+
+/* A or AAAA records of a host name, with the smallest TTL */
+int
+_eXosip_dnsutils_addr_lookup(
+    const char *name,
+    int        family,
+    char       ip[][65],
+    int        max,
+    int        *ttl_min)
+{
+    querybuf      answer;           /* answer buffer from nameserver */
+    int           n;
+    int           ancount, qdcount; /* answer count and query count */
+    HEADER        *hp;              /* answer buffer header */
+    char          hostbuf[256];
+    unsigned char *msg, *eom, *cp;  /* answer buffer positions */
+    int           dlen, type, aclass;
+    long          ttl;
+    int           qtype = (family == AF_INET6) ? T_AAAA : T_A;
+    int           answerno;
+    res_state     res;
+
+    res = _eXosip_dnsutils_res();
+    if (res == NULL)
+        return OSIP_UNDEFINED_ERROR;
+
+    OSIP_TRACE(osip_trace
+                   (__FILE__, __LINE__, OSIP_INFO2, NULL,
+                   "About to ask for '%s IN %s'\n", name, (qtype == T_A) ? "A" : "AAAA"));
+
+    n = res_nquery(res, name, C_IN, qtype, (unsigned char *) &answer, sizeof(answer));
+
+    if (n < (int) sizeof(HEADER))
+    {
+        int hstatus = h_errno;
+
+        if (hstatus == HOST_NOT_FOUND || hstatus == NO_DATA)
+            return OSIP_NOTFOUND;
+        return OSIP_UNKNOWN_HOST;
+    }
+
+    /* browse message and search for DNS answers part */
+    hp      = (HEADER *) &answer;
+    qdcount = ntohs(hp->qdcount);
+    ancount = ntohs(hp->ancount);
+
+    msg     = (unsigned char *) (&answer);
+    eom     = (unsigned char *) (&answer) + n;
+    cp      = (unsigned char *) (&answer) + sizeof(HEADER);
+
+    while (qdcount-- > 0 && cp < eom)
+    {
+        n = dn_expand(msg, eom, cp, (char *) hostbuf, 256);
+        if (n < 0)
+            return OSIP_UNDEFINED_ERROR;
+        cp += n + QFIXEDSZ;
+    }
+
+    /* loop through the answer buffer: CNAME and A/AAAA records */
+    answerno = 0;
+    while (ancount-- > 0 && cp < eom && answerno < max)
+    {
+        n = dn_expand(msg, eom, cp, (char *) hostbuf, 256);
+        if (n < 0 || cp + n + RRFIXEDSZ > eom)
+            return OSIP_UNDEFINED_ERROR;
+
+        cp += n;
+
+        #if defined(__NetBSD__) || defined(__OpenBSD__) || \
+        defined(OLD_NAMESER) || defined(__FreeBSD__)
+        type = _get_short(cp);
+        cp  += sizeof(u_short);
+        #elif defined(__APPLE_CC__)
+        GETSHORT(type, cp);
+        #else
+        NS_GET16(type, cp);
+        #endif
+
+        #if defined(__NetBSD__) || defined(__OpenBSD__) || \
+        defined(OLD_NAMESER) || defined(__FreeBSD__)
+        aclass = _get_short(cp);
+        cp    += sizeof(u_short);
+        #elif defined(__APPLE_CC__)
+        GETSHORT(aclass, cp);
+        #else
+        NS_GET16(aclass, cp);
+        #endif
+
+        #if defined(__NetBSD__) || defined(__OpenBSD__) || \
+        defined(OLD_NAMESER) || defined(__FreeBSD__)
+        ttl = _get_long(cp);
+        cp += sizeof(u_long);
+        #elif defined(__APPLE_CC__)
+        GETLONG(ttl, cp);
+        #else
+        NS_GET32(ttl, cp);
+        #endif
+
+        #if defined(__NetBSD__) || defined(__OpenBSD__) || \
+        defined(OLD_NAMESER) || defined(__FreeBSD__)
+        dlen = _get_short(cp);
+        cp  += sizeof(u_short);
+        #elif defined(__APPLE_CC__)
+        GETSHORT(dlen, cp);
+        #else
+        NS_GET16(dlen, cp);
+        #endif
+
+        if (cp + dlen > eom)
+            return OSIP_UNDEFINED_ERROR;
+        if (aclass == C_IN && (type == qtype || type == T_CNAME)
+            && ttl < *ttl_min)
+            *ttl_min = (int) ttl;
+        if (aclass == C_IN && type == qtype
+            && dlen == ((qtype == T_A) ? 4 : 16)
+            && inet_ntop(family, cp, ip[answerno], 65) != NULL)
+        {
+            OSIP_TRACE(osip_trace
+                           (__FILE__, __LINE__, OSIP_INFO2, NULL,
+                           "%s -> %s (ttl %li)\n", name, ip[answerno], ttl));
+            answerno++;
+        }
+        cp += dlen;
+    }
+
+    return (answerno > 0) ? answerno : OSIP_NOTFOUND;
+}
+
 static int
 _eXosip_dnsutils_srv_lookup(
-    struct osip_srv_record *output_srv)
+    struct osip_srv_record *output_srv,
+    int                    *ttl_min)
 {
     querybuf      answer;           /* answer buffer from nameserver */
     int           n;
@@ -3253,6 +3531,7 @@ _eXosip_dnsutils_srv_lookup(
     int           dlen, type, aclass, pref, weight, port;
     long          ttl;
     int           answerno;
+    res_state     res;
 
     if (output_srv->name[0] == '\0')
     {
@@ -3270,7 +3549,10 @@ _eXosip_dnsutils_srv_lookup(
                    (__FILE__, __LINE__, OSIP_INFO2, NULL,
                    "About to ask for '%s IN SRV'\n", output_srv->name));
 
-    n = res_query(output_srv->name, C_IN, T_SRV, (unsigned char *) &answer, sizeof(answer));
+    res = _eXosip_dnsutils_res();
+    if (res == NULL)
+        return OSIP_UNDEFINED_ERROR;
+    n = res_nquery(res, output_srv->name, C_IN, T_SRV, (unsigned char *) &answer, sizeof(answer));
 
     if (n < (int) sizeof(HEADER))
     {
@@ -3363,6 +3645,8 @@ _eXosip_dnsutils_srv_lookup(
             cp += dlen;
             continue;
         }
+        if (ttl < *ttl_min)
+            *ttl_min = (int) ttl;
         #if defined(__NetBSD__) || defined(__OpenBSD__) || \
         defined(OLD_NAMESER) || defined(__FreeBSD__)
         pref = _get_short(cp);
@@ -3431,7 +3715,8 @@ _eXosip_dnsutils_srv_lookup(
 
 static int
 eXosip_dnsutils_srv_lookup(
-    struct osip_naptr *output_record)
+    struct osip_naptr *output_record,
+    int               *ttl_min)
 {
     if (output_record->naptr_state == OSIP_NAPTR_STATE_SRVDONE)
         return OSIP_SUCCESS;
@@ -3442,11 +3727,11 @@ eXosip_dnsutils_srv_lookup(
     output_record->sipdtls_record.srv_state = OSIP_SRV_STATE_NOTSUPPORTED;
     output_record->sipsctp_record.srv_state = OSIP_SRV_STATE_NOTSUPPORTED;
 
-    _eXosip_dnsutils_srv_lookup(&output_record->sipudp_record);
-    _eXosip_dnsutils_srv_lookup(&output_record->siptcp_record);
-    _eXosip_dnsutils_srv_lookup(&output_record->siptls_record);
-    _eXosip_dnsutils_srv_lookup(&output_record->sipdtls_record);
-    /* _eXosip_dnsutils_srv_lookup(&output_record->sipsctp_record); */
+    _eXosip_dnsutils_srv_lookup(&output_record->sipudp_record, ttl_min);
+    _eXosip_dnsutils_srv_lookup(&output_record->siptcp_record, ttl_min);
+    _eXosip_dnsutils_srv_lookup(&output_record->siptls_record, ttl_min);
+    _eXosip_dnsutils_srv_lookup(&output_record->sipdtls_record, ttl_min);
+    /* _eXosip_dnsutils_srv_lookup(&output_record->sipsctp_record, ttl_min); */
 
     if (output_record->sipudp_record.srv_state == OSIP_SRV_STATE_COMPLETED)
         output_record->naptr_state = OSIP_NAPTR_STATE_SRVDONE;
@@ -3467,7 +3752,8 @@ eXosip_dnsutils_srv_lookup(
 static int
 eXosip_dnsutils_naptr_lookup(
     osip_naptr_t *output_record,
-    const char   *domain)
+    const char   *domain,
+    int          *ttl_min)
 {
     querybuf      answer;           /* answer buffer from nameserver */
     int           n;
@@ -3479,6 +3765,7 @@ eXosip_dnsutils_naptr_lookup(
     int           dlen, type, aclass;
     long          ttl;
     int           answerno;
+    res_state     res;
 
     output_record->naptr_state = OSIP_NAPTR_STATE_RETRYLATER;
     if (domain == NULL)
@@ -3489,9 +3776,13 @@ eXosip_dnsutils_naptr_lookup(
 
     snprintf(output_record->domain, sizeof(output_record->domain), "%s", domain);
 
+    res = _eXosip_dnsutils_res();
+    if (res == NULL)
+        return OSIP_SUCCESS;    /* OSIP_NAPTR_STATE_RETRYLATER */
+
     output_record->naptr_state = OSIP_NAPTR_STATE_INPROGRESS;
 
-    n                          = res_query(domain, C_IN, T_NAPTR, (unsigned char *) &answer, sizeof(answer));
+    n                          = res_nquery(res, domain, C_IN, T_NAPTR, (unsigned char *) &answer, sizeof(answer));
 
     OSIP_TRACE(osip_trace
                    (__FILE__, __LINE__, OSIP_INFO2, NULL,
@@ -3613,6 +3904,8 @@ eXosip_dnsutils_naptr_lookup(
             cp += dlen;
             continue;
         }
+        if (ttl < *ttl_min)
+            *ttl_min = (int) ttl;
 
         memset(&anaptr, 0, sizeof(osip_naptr_t));
 
@@ -3702,6 +3995,56 @@ eXosip_dnsutils_naptr_lookup(
     return OSIP_SUCCESS;
 }
 
+/* NAPTR, SRV and A queries of a domain: called by the resolver thread */
+static int
+_eXosip_dnsutils_resolve(
+    osip_naptr_t *output_record,
+    const char   *domain,
+    int          *ttl_min)
+{
+    int                    i;
+    struct osip_srv_record *srv_record[4];
+    int                    n;
+
+    *ttl_min = 0x7fffffff;
+    i        = eXosip_dnsutils_naptr_lookup(output_record, domain, ttl_min);
+    if (i < 0)
+        return i;
+    if (output_record->naptr_state != OSIP_NAPTR_STATE_NAPTRDONE)
+        return OSIP_SUCCESS;
+
+    eXosip_dnsutils_srv_lookup(output_record, ttl_min);
+    if (output_record->naptr_state != OSIP_NAPTR_STATE_SRVDONE)
+        return OSIP_SUCCESS;
+
+    /* resolve the targets now: the transports will find them in the
+       resolver cache (after the entries of EXOSIP_OPT_ADD_DNS_CACHE) */
+    srv_record[0] = &output_record->sipudp_record;
+    srv_record[1] = &output_record->siptcp_record;
+    srv_record[2] = &output_record->siptls_record;
+    srv_record[3] = &output_record->sipdtls_record;
+    for (n = 0; n < 4; n++)
+    {
+        int pos;
+
+        for (pos = 0; pos < 10 && srv_record[n]->srventry[pos].srv[0] != '\0'; pos++)
+        {
+            osip_srv_entry_t *srv    = &srv_record[n]->srventry[pos];
+            int              family  = ipv6_enable ? AF_INET6 : AF_INET;
+            int              ttl     = 0x7fffffff;
+            char             ip[EXOSIP_RESOLVER_MAX_ADDR][65];
+            int              nb;
+
+            nb = _eXosip_dnsutils_addr_lookup(srv->srv, family, ip,
+                                              EXOSIP_RESOLVER_MAX_ADDR, &ttl);
+            if (nb <= 0)
+                continue;       /* resolved later, with getaddrinfo() */
+            _eXosip_resolver_addr_store(srv->srv, family, ip, nb, ttl);
+        }
+    }
+    return OSIP_SUCCESS;
+}
+
 struct osip_naptr *
 eXosip_dnsutils_naptr(
     const char *domain,
@@ -3711,7 +4054,6 @@ eXosip_dnsutils_naptr(
 {
     struct osip_naptr *naptr_record;
     int               pos;
-    int               i;
     int               not_in_list = 0;
 
     if (dnsutils_list == NULL)
@@ -3752,9 +4094,7 @@ eXosip_dnsutils_naptr(
         naptr_record = (osip_naptr_t *) osip_list_get(dnsutils_list, pos);
 
         /* process all */
-        if (naptr_record->naptr_state == OSIP_NAPTR_STATE_NAPTRDONE
-            || naptr_record->naptr_state == OSIP_NAPTR_STATE_SRVINPROGRESS)
-            eXosip_dnsutils_srv_lookup(naptr_record);
+        _eXosip_resolver_naptr_process(naptr_record);
 
         naptr_record = NULL;
         pos++;
@@ -3775,9 +4115,10 @@ eXosip_dnsutils_naptr(
             if (naptr_record->naptr_state == OSIP_NAPTR_STATE_RETRYLATER)
                 break;
 
-            if (naptr_record->naptr_state == OSIP_NAPTR_STATE_NAPTRDONE
-                || naptr_record->naptr_state == OSIP_NAPTR_STATE_SRVINPROGRESS)
-                eXosip_dnsutils_srv_lookup(naptr_record);
+            /* the records are not kept longer than their TTL */
+            if (naptr_record->naptr_state != OSIP_NAPTR_STATE_INPROGRESS
+                && _eXosip_resolver_naptr_expired(domain))
+                break;
 
             return naptr_record;
         }
@@ -3829,23 +4170,9 @@ eXosip_dnsutils_naptr(
         naptr_record->keep_in_cache = 1;
     }
 
-    i = eXosip_dnsutils_naptr_lookup(naptr_record, domain);
-    if (i < 0)
-    {
-        if (keep_in_cache <= 0)
-        {
-            return naptr_record;
-        }
-        if (not_in_list == 1)
-        {
-            osip_list_add(dnsutils_list, naptr_record, -1);
-        }
-        return naptr_record;
-    }
-
-    if (naptr_record->naptr_state == OSIP_NAPTR_STATE_NAPTRDONE
-        || naptr_record->naptr_state == OSIP_NAPTR_STATE_SRVINPROGRESS)
-        eXosip_dnsutils_srv_lookup(naptr_record);
+    /* the answer may already be in the resolver cache, or will be given
+       to the record by eXosip_dnsutils_dns_process() */
+    _eXosip_resolver_naptr(naptr_record, domain, _eXosip_dnsutils_resolve);
 
     if (keep_in_cache <= 0)
     {
@@ -3861,7 +4188,7 @@ eXosip_dnsutils_dns_process(
     osip_naptr_t *naptr_record,
     int          force)
 {
-    return OSIP_SUCCESS;
+    return _eXosip_resolver_naptr_process(naptr_record);
 }
 
 void
@@ -3931,4 +4258,27 @@ _eXosip_dnsutils_release(
     return;
 }
 
+#endif
+
+#ifndef EXOSIP_DNSUTILS_RES_STATE
+
+/* no resolver API giving the TTL: eXresolver.c uses getaddrinfo() */
+int
+_eXosip_dnsutils_addr_lookup(
+    const char *name,
+    int        family,
+    char       ip[][65],
+    int        max,
+    int        *ttl_min)
+{
+    return OSIP_UNDEFINED_ERROR;
+}
+
+void
+_eXosip_dnsutils_close(
+    void)
+{
+    return;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,291 @@
+/*
+   eXosip - This is the eXtended osip library.
+   Copyright (C) 2002,2003,2004,2005,2006,2007  Aymeric MOIZARD  - jack@atosc.org
+
+   eXosip is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   eXosip is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef ENABLE_MPATROL
+    #include <mpatrol.h>
+#endif
+
+#include "eXosip2.h"
+
+extern eXosip_t eXosip;
+
+#ifdef OSIP_MT
+
+/*
+   Incoming message workers.
+
+   When EXOSIP_OPT_SET_WORKER_THREADS is set, the transport layers hand
+   the received buffers to a pool of threads instead of parsing them
+   on the eXosip thread. Each message goes to the worker selected by a
+   hash of its Call-ID: all messages of a dialog are parsed and matched
+   against their transaction by the same thread, in the order they were
+   received.
+
+   A worker parses the message, gives it to its transaction with
+   osip_find_transaction_and_add_event() and wakes up the eXosip thread.
+   Messages with no transaction are processed under eXosip_lock(). The
+   transaction state machines are still run by eXosip_execute(), under
+   eXosip_lock(): their callbacks use the calls, dialogs and
+   registrations that this lock protects.
+
+   The callback of eXosip_set_cbsip_message() is called by the workers
+   for received messages, without eXosip_lock(). j_cbsip_mutex makes
+   these calls, and the ones for sent messages, one at a time.
+
+   Each queue holds at most MAX_LEN messages. A semaphore counts the
+   free places: when a worker falls behind, the transport sleeps on it
+   until the worker takes the next message, and the backlog stays in
+   the socket buffers.
+ */
+
+typedef struct eXosip_worker_job eXosip_worker_job_t;
+
+struct eXosip_worker_job {
+    char   *buf;                /* NULL: the worker must exit */
+    size_t length;
+    int    socket;
+    char   *host;
+    int    port;
+};
+
+struct eXosip_worker {
+    struct osip_thread *thread;
+    osip_fifo_t        *queue;
+    struct osip_sem    *slots;  /* free places in queue */
+};
+
+static unsigned int
+_eXosip_worker_hash_callid(
+    const char *buf,
+    size_t     length)
+{
+    const char *end = buf + length;
+    const char *p   = buf;
+
+    /* skip the start line */
+    while (p < end && *p != '\n')
+        p++;
+
+    while (p < end)
+    {
+        const char *name;
+        size_t     name_len;
+
+        p++;
+        if (p >= end || *p == '\r' || *p == '\n')
+            break;              /* end of headers */
+
+        name = p;
+        while (p < end && *p != ':' && *p != ' ' && *p != '\t' && *p != '\n')
+            p++;
+        name_len = p - name;
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+
+        if (p < end && *p == ':'
+            && ((name_len == 7 && osip_strncasecmp(name, "call-id", 7) == 0)
+                || (name_len == 1 && (*name == 'i' || *name == 'I'))))
+        {
+            unsigned int hash = 5381;
+
+            p++;
+            while (p < end && (*p == ' ' || *p == '\t'))
+                p++;
+            while (p < end && *p != '\r' && *p != '\n' && *p != ' ' && *p != '\t')
+            {
+                hash = ((hash << 5) + hash) + (unsigned char) *p;
+                p++;
+            }
+            return hash;
+        }
+
+        while (p < end && *p != '\n')
+            p++;
+    }
+    return 0;
+}
+
+static void *
+_eXosip_worker_thread(
+    void *arg)
+{
+    struct eXosip_worker *worker = (struct eXosip_worker *) arg;
+
+    for (;;)
+    {
+        eXosip_worker_job_t *job = (eXosip_worker_job_t *) osip_fifo_get(worker->queue);
+
+        if (job == NULL)
+            continue;
+        osip_sem_post(worker->slots);
+        if (job->buf == NULL)
+        {
+            osip_free(job);
+            break;
+        }
+
+        _eXosip_process_incoming_message(job->buf, job->length, job->socket,
+                                         job->host, job->port);
+        osip_free(job);
+
+        /* new events are pending in the transactions: let eXosip_execute()
+           run the state machines once the queue is drained. */
+        if (osip_fifo_size(worker->queue) <= 0)
+            __eXosip_wakeup();
+    }
+    osip_thread_exit();
+    return NULL;
+}
+
+int
+_eXosip_worker_start(
+    int nb_workers)
+{
+    struct eXosip_worker *workers;
+    int                  i;
+
+    if (nb_workers <= 0)
+        return OSIP_BADPARAMETER;
+    if (eXosip.j_workers != NULL)
+        return OSIP_WRONG_STATE;
+
+    workers = (struct eXosip_worker *) osip_malloc(nb_workers * sizeof(struct eXosip_worker));
+    if (workers == NULL)
+        return OSIP_NOMEM;
+    memset(workers, 0, nb_workers * sizeof(struct eXosip_worker));
+
+    eXosip.j_cbsip_mutex = (struct osip_mutex *) osip_mutex_init();
+    if (eXosip.j_cbsip_mutex == NULL)
+    {
+        osip_free(workers);
+        return OSIP_NOMEM;
+    }
+
+    for (i = 0; i < nb_workers; i++)
+    {
+        workers[i].queue = (osip_fifo_t *) osip_malloc(sizeof(osip_fifo_t));
+        workers[i].slots = osip_sem_init(MAX_LEN);
+        if (workers[i].queue != NULL)
+            osip_fifo_init(workers[i].queue);
+        if (workers[i].queue != NULL && workers[i].slots != NULL)
+            workers[i].thread = osip_thread_create(20000, _eXosip_worker_thread, &workers[i]);
+        if (workers[i].thread == NULL)
+        {
+            OSIP_TRACE(osip_trace
+                           (__FILE__, __LINE__, OSIP_ERROR, NULL,
+                           "eXosip: Cannot start worker thread!\n"));
+            if (workers[i].queue != NULL)
+                osip_fifo_free(workers[i].queue);
+            if (workers[i].slots != NULL)
+                osip_sem_destroy(workers[i].slots);
+            eXosip.j_workers    = workers;
+            eXosip.j_nb_workers = i;
+            _eXosip_worker_stop();
+            return OSIP_UNDEFINED_ERROR;
+        }
+    }
+
+    eXosip.j_workers    = workers;
+    eXosip.j_nb_workers = nb_workers;
+    return OSIP_SUCCESS;
+}
+
+void
+_eXosip_worker_stop(
+    void)
+{
+    struct eXosip_worker *workers = eXosip.j_workers;
+    int                  i;
+
+    if (workers == NULL)
+        return;
+
+    for (i = 0; i < eXosip.j_nb_workers; i++)
+    {
+        eXosip_worker_job_t *job;
+
+        /* the exit job is queued after the pending messages */
+        job = (eXosip_worker_job_t *) osip_malloc(sizeof(eXosip_worker_job_t));
+        if (job != NULL)
+        {
+            memset(job, 0, sizeof(eXosip_worker_job_t));
+            osip_sem_wait(workers[i].slots);
+            osip_fifo_add(workers[i].queue, job);
+        }
+        osip_thread_join(workers[i].thread);
+        osip_free(workers[i].thread);
+
+        for (job = (eXosip_worker_job_t *) osip_fifo_tryget(workers[i].queue);
+             job != NULL;
+             job = (eXosip_worker_job_t *) osip_fifo_tryget(workers[i].queue))
+            osip_free(job);
+        osip_fifo_free(workers[i].queue);
+        osip_sem_destroy(workers[i].slots);
+    }
+
+    eXosip.j_workers    = NULL;
+    eXosip.j_nb_workers = 0;
+    osip_free(workers);
+    osip_mutex_destroy(eXosip.j_cbsip_mutex);
+    eXosip.j_cbsip_mutex = NULL;
+}
+
+int
+_eXosip_worker_dispatch(
+    char   *buf,
+    size_t length,
+    int    socket,
+    char   *host,
+    int    port)
+{
+    struct eXosip_worker *worker;
+    eXosip_worker_job_t  *job;
+    size_t               host_len = strlen(host);
+
+    worker = &eXosip.j_workers[_eXosip_worker_hash_callid(buf, length)
+                               % eXosip.j_nb_workers];
+
+    /* the job, the message and the host are in one block */
+    job = (eXosip_worker_job_t *) osip_malloc(sizeof(eXosip_worker_job_t)
+                                              + length + 1 + host_len + 1);
+    if (job == NULL)
+        return OSIP_NOMEM;
+    job->buf    = (char *) (job + 1);
+    job->length = length;
+    job->socket = socket;
+    job->host   = job->buf + length + 1;
+    job->port   = port;
+    memcpy(job->buf, buf, length);
+    job->buf[length] = '\0';
+    memcpy(job->host, host, host_len + 1);
+
+    /* a full queue slows down the transport instead of losing messages:
+       the eXosip thread does not hold eXosip_lock() here, so the worker
+       always makes progress. */
+    osip_sem_wait(worker->slots);
+    if (osip_fifo_add(worker->queue, job) != 0)
+    {
+        osip_sem_post(worker->slots);
+        osip_free(job);
+        return OSIP_UNDEFINED_ERROR;
+    }
+    return OSIP_SUCCESS;
+}
+
+#endif
@@ -800,7 +800,7 @@ __eXosip_create_authorization_header(
                 osip_free(pszQop);
                 return OSIP_NOMEM;
             }
-            snprintf(szNonceCount, 9, "%.8i", iNonceCount);
+            snprintf(szNonceCount, 9, "%.8x", iNonceCount);
 
             pszCNonce = osip_strdup(pCNonce);
             if (pszCNonce == NULL)
@@ -1097,7 +1097,7 @@ __eXosip_create_proxy_authorization_header(
                 osip_free(pszQop);
                 return OSIP_NOMEM;
             }
-            snprintf(szNonceCount, 9, "%.8i", iNonceCount);
+            snprintf(szNonceCount, 9, "%.8x", iNonceCount);
 
             pszCNonce = osip_strdup(pCNonce);
             if (pszCNonce == NULL)
@@ -1204,81 +1204,280 @@ __eXosip_create_proxy_authorization_header(
     return OSIP_SUCCESS;
 }
 
+/*
+   Digest challenges of the dialogs and registrations.
+
+   The last challenge received for a Call-ID and a realm is kept: the
+   next requests with this Call-ID (refreshes of REGISTER and SUBSCRIBE,
+   requests inside a dialog) are sent with credentials computed from the
+   same nonce and an incremented nonce-count, instead of being challenged
+   again. The entries are hashed on the Call-ID, as far as it is kept
+   in pszCallId, in the nonce_buckets of eXosip_t.
+ */
+
+typedef struct eXosip_nonce eXosip_nonce_t;
+
+struct eXosip_nonce {
+    struct eXosip_http_auth http_auth;  /* must be first */
+    unsigned int            hash;
+    eXosip_nonce_t          *next;
+};
+
+#define EXOSIP_NONCE_MIN_BUCKETS 64
+#define EXOSIP_NONCE_CALLID_LEN  (sizeof(((struct eXosip_http_auth *) 0)->pszCallId) - 1)
+
+static unsigned int
+_eXosip_nonce_hash(
+    const char *call_id)
+{
+    unsigned int hash = 5381;
+    size_t       i;
+
+    for (i = 0; i < EXOSIP_NONCE_CALLID_LEN && *call_id != '\0'; i++, call_id++)
+    {
+        unsigned char c = (unsigned char) *call_id;
+
+        if (c >= 'A' && c <= 'Z')
+            c = c - 'A' + 'a';
+        hash = ((hash << 5) + hash) + c;
+    }
+    return hash;
+}
+
+static int
+_eXosip_nonce_match(
+    eXosip_nonce_t *nonce,
+    unsigned int   hash,
+    const char     *call_id)
+{
+    return nonce->hash == hash
+           && osip_strncasecmp(nonce->http_auth.pszCallId, call_id,
+                               EXOSIP_NONCE_CALLID_LEN) == 0;
+}
+
+static int
+_eXosip_nonce_grow(
+    void)
+{
+    eXosip_nonce_t **buckets;
+    unsigned int   nb_buckets = eXosip.nonce_nb_buckets * 2;
+    unsigned int   i;
+
+    if (nb_buckets < EXOSIP_NONCE_MIN_BUCKETS)
+        nb_buckets = EXOSIP_NONCE_MIN_BUCKETS;
+    buckets = (eXosip_nonce_t **) osip_malloc(nb_buckets * sizeof(eXosip_nonce_t *));
+    if (buckets == NULL)
+        return OSIP_NOMEM;
+    memset(buckets, 0, nb_buckets * sizeof(eXosip_nonce_t *));
+
+    for (i = 0; i < eXosip.nonce_nb_buckets; i++)
+    {
+        while (eXosip.nonce_buckets[i] != NULL)
+        {
+            eXosip_nonce_t *nonce = eXosip.nonce_buckets[i];
+
+            eXosip.nonce_buckets[i] = nonce->next;
+            nonce->next             = buckets[nonce->hash % nb_buckets];
+            buckets[nonce->hash % nb_buckets] = nonce;
+        }
+    }
+    osip_free(eXosip.nonce_buckets);
+    eXosip.nonce_buckets    = buckets;
+    eXosip.nonce_nb_buckets = nb_buckets;
+    return OSIP_SUCCESS;
+}
+
 int
 _eXosip_store_nonce(
     const char                *call_id,
     osip_proxy_authenticate_t *wa,
     int                       answer_code)
 {
+    eXosip_nonce_t          *nonce;
     struct eXosip_http_auth *http_auth;
-    int                     pos;
+    unsigned int            hash = _eXosip_nonce_hash(call_id);
 
     /* update entries with same call_id */
-    for (pos = 0; pos < MAX_EXOSIP_HTTP_AUTH; pos++)
+    if (eXosip.nonce_nb_buckets > 0)
     {
-        http_auth = &eXosip.http_auths[pos];
-        if (http_auth->pszCallId[0] == '\0')
-            continue;
-        if (osip_strcasecmp(http_auth->pszCallId, call_id) == 0
-            && ((http_auth->wa->realm == NULL && wa->realm == NULL)
-                || (http_auth->wa->realm != NULL
-                    && wa->realm != NULL
-                    && osip_strcasecmp(http_auth->wa->realm, wa->realm) == 0)))
+        for (nonce = eXosip.nonce_buckets[hash % eXosip.nonce_nb_buckets];
+             nonce != NULL; nonce = nonce->next)
         {
-            osip_proxy_authenticate_free(http_auth->wa);
-            http_auth->wa          = NULL;
-            osip_proxy_authenticate_clone(wa, &(http_auth->wa));
-            http_auth->iNonceCount = 1;
-            if (http_auth->wa == NULL)
-                memset(http_auth, 0, sizeof(struct eXosip_http_auth));
-            return OSIP_SUCCESS;
+            http_auth = &nonce->http_auth;
+            if (_eXosip_nonce_match(nonce, hash, call_id)
+                && ((http_auth->wa->realm == NULL && wa->realm == NULL)
+                    || (http_auth->wa->realm != NULL
+                        && wa->realm != NULL
+                        && osip_strcasecmp(http_auth->wa->realm, wa->realm) == 0)))
+            {
+                osip_proxy_authenticate_t *old = http_auth->wa;
+
+                http_auth->wa = NULL;
+                osip_proxy_authenticate_clone(wa, &(http_auth->wa));
+                if (http_auth->wa == NULL)
+                {
+                    /* keep the previous challenge */
+                    http_auth->wa = old;
+                    return OSIP_NOMEM;
+                }
+                osip_proxy_authenticate_free(old);
+                http_auth->iNonceCount = 1;
+                http_auth->answer_code = answer_code;
+                return OSIP_SUCCESS;
+            }
         }
     }
 
     /* not found */
-    for (pos = 0; pos < MAX_EXOSIP_HTTP_AUTH; pos++)
+    if (eXosip.nonce_count >= eXosip.nonce_nb_buckets * 2 && _eXosip_nonce_grow() != 0)
+        return OSIP_NOMEM;
+
+    nonce = (eXosip_nonce_t *) osip_malloc(sizeof(eXosip_nonce_t));
+    if (nonce == NULL)
+        return OSIP_NOMEM;
+    memset(nonce, 0, sizeof(eXosip_nonce_t));
+    http_auth = &nonce->http_auth;
+    snprintf(http_auth->pszCallId, sizeof(http_auth->pszCallId), "%s", call_id);
+    snprintf(http_auth->pszCNonce, sizeof(http_auth->pszCNonce),
+             "0a4f113b");
+    http_auth->iNonceCount = 1;
+    osip_proxy_authenticate_clone(wa, &(http_auth->wa));
+    http_auth->answer_code = answer_code;
+    if (http_auth->wa == NULL)
     {
-        http_auth = &eXosip.http_auths[pos];
-        if (http_auth->pszCallId[0] == '\0')
-        {
-            snprintf(http_auth->pszCallId, sizeof(http_auth->pszCallId), "%s", call_id);
-            snprintf(http_auth->pszCNonce, sizeof(http_auth->pszCNonce),
-                     "0a4f113b");
-            http_auth->iNonceCount = 1;
-            osip_proxy_authenticate_clone(wa, &(http_auth->wa));
-            http_auth->answer_code = answer_code;
-            if (http_auth->wa == NULL)
-                memset(http_auth, 0, sizeof(struct eXosip_http_auth));
-            return OSIP_SUCCESS;
-        }
+        osip_free(nonce);
+        return OSIP_NOMEM;
+    }
+
+    nonce->hash = hash;
+    nonce->next = eXosip.nonce_buckets[nonce->hash % eXosip.nonce_nb_buckets];
+    eXosip.nonce_buckets[nonce->hash % eXosip.nonce_nb_buckets] = nonce;
+    eXosip.nonce_count++;
+    return OSIP_SUCCESS;
+}
+
+struct eXosip_http_auth *
+_eXosip_find_nonce(
+    const char              *call_id,
+    struct eXosip_http_auth *previous)
+{
+    eXosip_nonce_t *nonce;
+    unsigned int   hash;
+
+    if (eXosip.nonce_nb_buckets == 0)
+        return NULL;
+
+    if (previous != NULL)
+    {
+        nonce = ((eXosip_nonce_t *) previous)->next;
+        hash  = ((eXosip_nonce_t *) previous)->hash;
+    }
+    else
+    {
+        hash  = _eXosip_nonce_hash(call_id);
+        nonce = eXosip.nonce_buckets[hash % eXosip.nonce_nb_buckets];
     }
 
-    OSIP_TRACE(osip_trace
-                   (__FILE__, __LINE__, OSIP_ERROR, NULL,
-                   "Compile with higher MAX_EXOSIP_HTTP_AUTH value (current=%i)\n",
-                   MAX_EXOSIP_HTTP_AUTH));
-    return OSIP_UNDEFINED_ERROR;
+    for (; nonce != NULL; nonce = nonce->next)
+    {
+        if (_eXosip_nonce_match(nonce, hash, call_id))
+            return &nonce->http_auth;
+    }
+    return NULL;
 }
 
 int
 _eXosip_delete_nonce(
     const char *call_id)
 {
-    struct eXosip_http_auth *http_auth;
-    int                     pos;
+    eXosip_nonce_t **prev;
+    unsigned int   hash;
+    int            found = 0;
 
-    /* update entries with same call_id */
-    for (pos = 0; pos < MAX_EXOSIP_HTTP_AUTH; pos++)
+    if (eXosip.nonce_nb_buckets == 0)
+        return OSIP_NOTFOUND;
+
+    /* remove the challenges of all realms */
+    hash = _eXosip_nonce_hash(call_id);
+    prev = &eXosip.nonce_buckets[hash % eXosip.nonce_nb_buckets];
+    while (*prev != NULL)
     {
-        http_auth = &eXosip.http_auths[pos];
-        if (http_auth->pszCallId[0] == '\0')
-            continue;
-        if (osip_strcasecmp(http_auth->pszCallId, call_id) == 0)
+        eXosip_nonce_t *nonce = *prev;
+
+        if (_eXosip_nonce_match(nonce, hash, call_id))
+        {
+            *prev = nonce->next;
+            osip_proxy_authenticate_free(nonce->http_auth.wa);
+            osip_free(nonce);
+            eXosip.nonce_count--;
+            found = 1;
+        }
+        else
+            prev = &nonce->next;
+    }
+    return found ? OSIP_SUCCESS : OSIP_NOTFOUND;
+}
+
+void
+_eXosip_nonce_free(
+    void)
+{
+    unsigned int i;
+
+    for (i = 0; i < eXosip.nonce_nb_buckets; i++)
+    {
+        while (eXosip.nonce_buckets[i] != NULL)
         {
-            osip_proxy_authenticate_free(http_auth->wa);
-            memset(http_auth, 0, sizeof(struct eXosip_http_auth));
-            return OSIP_SUCCESS;
+            eXosip_nonce_t *nonce = eXosip.nonce_buckets[i];
+
+            eXosip.nonce_buckets[i] = nonce->next;
+            osip_proxy_authenticate_free(nonce->http_auth.wa);
+            osip_free(nonce);
         }
     }
-    return OSIP_NOTFOUND;
-}
\ No newline at end of file
+    osip_free(eXosip.nonce_buckets);
+    eXosip.nonce_buckets    = NULL;
+    eXosip.nonce_nb_buckets = 0;
+    eXosip.nonce_count      = 0;
+}
+
+/*
+   H(A1) of an account for a realm. It does not depend on the nonce
+   with algorithm=MD5: it is computed once and kept in the account
+   until a challenge comes from another realm.
+ */
+const char *
+_eXosip_get_ha1(
+    jauthinfo_t *authinfo,
+    const char  *realm,
+    const char  *algorithm)
+{
+    char *pszRealm;
+
+    if (authinfo->ha1[0] != '\0')
+        return authinfo->ha1;
+    if (algorithm != NULL
+        && 0 != osip_strcasecmp("MD5", algorithm)
+        && 0 != osip_strcasecmp("\"MD5\"", algorithm))
+        return NULL;            /* AKA: computed from the nonce */
+
+    if (realm == NULL)
+        realm = "";
+    if (strlen(realm) >= sizeof(authinfo->cache_realm))
+        return NULL;
+    if (authinfo->cache_ha1[0] != '\0'
+        && strcmp(authinfo->cache_realm, realm) == 0)
+        return authinfo->cache_ha1;
+
+    if (realm[0] == '\0')
+        pszRealm = osip_strdup("");
+    else
+        pszRealm = osip_strdup_without_quote(realm);
+    if (pszRealm == NULL)
+        return NULL;
+    DigestCalcHA1("MD5", authinfo->userid, pszRealm, authinfo->passwd, NULL,
+                  NULL, authinfo->cache_ha1);
+    osip_free(pszRealm);
+    snprintf(authinfo->cache_realm, sizeof(authinfo->cache_realm), "%s", realm);
+    return authinfo->cache_ha1;
+}
@@ -30,18 +30,19 @@ eXosip_call_find(
     int           cid,
     eXosip_call_t **jc)
 {
+    eXosip_index_entry_t *entry;
+
     if (cid <= 0)
         return OSIP_BADPARAMETER;
 
-    for (*jc = eXosip.j_calls; *jc != NULL; *jc = (*jc)->next)
+    entry = _eXosip_index_find(EXOSIP_INDEX_CALL, cid);
+    if (entry == NULL || entry->jd != NULL)
     {
-        if ((*jc)->c_id == cid)
-        {
-            return OSIP_SUCCESS;
-        }
+        *jc = NULL;
+        return OSIP_NOTFOUND;
     }
-    *jc = NULL;
-    return OSIP_NOTFOUND;
+    *jc = (eXosip_call_t *) entry->owner;
+    return OSIP_SUCCESS;
 }
 
 void
@@ -113,6 +114,7 @@ eXosip_call_free(
              && jc->c_out_tr->orig_request->call_id->number != NULL)
         _eXosip_delete_nonce(jc->c_out_tr->orig_request->call_id->number);
 
+    _eXosip_index_remove(EXOSIP_INDEX_CALL, jc->c_id, jc);
     for (jd = jc->c_dialogs; jd != NULL; jd = jc->c_dialogs)
     {
         REMOVE_ELEMENT(jc->c_dialogs, jd);
@@ -190,9 +190,7 @@ cb_snd_message(osip_transaction_t * tr, osip_message_t * sip, char *host,
         }
     }
 
-    if (eXosip.cbsipCallback != NULL) {
-        eXosip.cbsipCallback(sip, 0);
-    }
+    _eXosip_cbsip_message(sip, 0);
 
     i = -1;
     if (osip_strcasecmp(via->protocol, "udp") == 0) {
@@ -994,6 +992,7 @@ static void cb_rcv2xx_4subscribe(osip_transaction_t * tr, osip_message_t * sip)
             tr);
         report_event(je, sip);
     }
+    _eXosip_refresh_update(&js->s_refresh);
 }
 #endif
 
@@ -1109,6 +1108,7 @@ static void cb_rcv2xx(int type, osip_transaction_t * tr, osip_message_t * sip)
                 }
             }
             pub->p_retry = 0;	/* reset value */
+            _eXosip_refresh_update(&pub->p_refresh);
         }
 
         je = eXosip_event_init_for_message(EXOSIP_MESSAGE_ANSWERED, tr);
@@ -1146,6 +1146,7 @@ static void cb_rcv2xx(int type, osip_transaction_t * tr, osip_message_t * sip)
                 je = eXosip_event_init_for_reg(EXOSIP_REGISTRATION_SUCCESS, jreg, tr);
                 report_event(je, sip);
                 jreg->r_retry = 0;	/* reset value */
+                _eXosip_refresh_update(&jreg->r_refresh);
             }
 
             return;
@@ -1297,6 +1298,8 @@ static void rcvregister_failure(osip_transaction_t * tr, osip_message_t * sip)
     if (jreg != NULL) {
         je = eXosip_event_init_for_reg(EXOSIP_REGISTRATION_FAILURE, jreg, tr);
         report_event(je, sip);
+        /* may have to retry with credentials now */
+        _eXosip_refresh_update(&jreg->r_refresh);
     }
 }
 
@@ -1443,6 +1446,8 @@ static void cb_rcv4xx(int type, osip_transaction_t * tr, osip_message_t * sip)
         je = eXosip_event_init_for_subscribe(EXOSIP_SUBSCRIPTION_REQUESTFAILURE,
             js, jd, tr);
         report_event(je, sip);
+        if (js != NULL)
+            _eXosip_refresh_update(&js->s_refresh);
     }
     else if (jc != NULL) {
         report_call_event(EXOSIP_CALL_MESSAGE_REQUESTFAILURE, jc, jd, tr);
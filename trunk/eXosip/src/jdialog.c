@@ -34,14 +34,16 @@ void eXosip_dialog_set_state(eXosip_dialog_t * jd, int state)
 
 int eXosip_call_dialog_find(int jid, eXosip_call_t ** jc, eXosip_dialog_t ** jd)
 {
+	eXosip_index_entry_t *entry;
+
 	if (jid <= 0)
 		return OSIP_BADPARAMETER;
 
-	for (*jc = eXosip.j_calls; *jc != NULL; *jc = (*jc)->next) {
-		for (*jd = (*jc)->c_dialogs; *jd != NULL; *jd = (*jd)->next) {
-			if ((*jd)->d_id == jid)
-				return OSIP_SUCCESS;
-		}
+	entry = _eXosip_index_find(EXOSIP_INDEX_CALL, jid);
+	if (entry != NULL && entry->jd != NULL) {
+		*jc = (eXosip_call_t *) entry->owner;
+		*jd = entry->jd;
+		return OSIP_SUCCESS;
 	}
 	*jd = NULL;
 	*jc = NULL;
@@ -53,13 +55,15 @@ int eXosip_call_dialog_find(int jid, eXosip_call_t ** jc, eXosip_dialog_t ** jd)
 int
 eXosip_notify_dialog_find(int nid, eXosip_notify_t ** jn, eXosip_dialog_t ** jd)
 {
+	eXosip_index_entry_t *entry;
+
 	if (nid <= 0)
 		return OSIP_BADPARAMETER;
-	for (*jn = eXosip.j_notifies; *jn != NULL; *jn = (*jn)->next) {
-		for (*jd = (*jn)->n_dialogs; *jd != NULL; *jd = (*jd)->next) {
-			if ((*jd)->d_id == nid)
-				return OSIP_SUCCESS;
-		}
+	entry = _eXosip_index_find(EXOSIP_INDEX_NOTIFY, nid);
+	if (entry != NULL && entry->jd != NULL) {
+		*jn = (eXosip_notify_t *) entry->owner;
+		*jd = entry->jd;
+		return OSIP_SUCCESS;
 	}
 	*jd = NULL;
 	*jn = NULL;
@@ -70,16 +74,16 @@ int
 eXosip_subscribe_dialog_find(int sid, eXosip_subscribe_t ** js,
 							 eXosip_dialog_t ** jd)
 {
+	eXosip_index_entry_t *entry;
+
 	if (sid <= 0)
 		return OSIP_BADPARAMETER;
-	for (*js = eXosip.j_subscribes; *js != NULL; *js = (*js)->next) {
-		*jd = NULL;
-		if ((*js)->s_id == sid)
-			return OSIP_SUCCESS;
-		for (*jd = (*js)->s_dialogs; *jd != NULL; *jd = (*jd)->next) {
-			if ((*jd)->d_id == sid)
-				return OSIP_SUCCESS;
-		}
+	/* sid is the id of the subscription or of one of its dialogs */
+	entry = _eXosip_index_find(EXOSIP_INDEX_SUBSCRIBE, sid);
+	if (entry != NULL) {
+		*js = (eXosip_subscribe_t *) entry->owner;
+		*jd = entry->jd;
+		return OSIP_SUCCESS;
 	}
 	*jd = NULL;
 	*js = NULL;
@@ -211,6 +215,13 @@ eXosip_dialog_init_as_uas(eXosip_dialog_t ** _jd, osip_message_t * _invite,
 
 void eXosip_dialog_free(eXosip_dialog_t * jd)
 {
+	if (jd->d_id > 0) {
+		/* d_id is unique among calls, subscriptions and notifies */
+		_eXosip_index_remove(EXOSIP_INDEX_CALL, jd->d_id, jd);
+		_eXosip_index_remove(EXOSIP_INDEX_SUBSCRIBE, jd->d_id, jd);
+		_eXosip_index_remove(EXOSIP_INDEX_NOTIFY, jd->d_id, jd);
+	}
+
 	while (!osip_list_eol(jd->d_inc_trs, 0)) {
 		osip_transaction_t *tr;
 
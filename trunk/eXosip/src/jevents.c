@@ -306,9 +306,89 @@ report_call_event(int evt, eXosip_call_t * jc,
 	report_event(je, NULL);
 }
 
+#ifdef OSIP_MT
+#if defined(WIN32) || defined(_WIN32_WCE)
+#define eXosip_event_xchg(ptr, val) InterlockedExchange((LONG volatile *) (ptr), (val))
+#elif defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+#define eXosip_event_xchg(ptr, val) __atomic_exchange_n((ptr), (val), __ATOMIC_SEQ_CST)
+#endif
+#endif
+
+int _eXosip_events_init(void)
+{
+	int i;
+
+	eXosip.j_events = (osip_mpsc_fifo_t *) osip_malloc(sizeof(osip_mpsc_fifo_t));
+	if (eXosip.j_events == NULL)
+		return OSIP_NOMEM;
+	i = osip_mpsc_fifo_init(eXosip.j_events);
+	if (i != 0) {
+		osip_free(eXosip.j_events);
+		eXosip.j_events = NULL;
+		return i;
+	}
+#ifdef OSIP_MT
+	eXosip.j_events_mutex = osip_mutex_init();
+	if (eXosip.j_events_mutex == NULL) {
+		osip_mpsc_fifo_free(eXosip.j_events);
+		eXosip.j_events = NULL;
+		return OSIP_NOMEM;
+	}
+	eXosip.j_events_wakeup = 0;
+#endif
+	return OSIP_SUCCESS;
+}
+
+/* the fifo has a single consumer: serialize the application threads */
+static int _eXosip_event_take(eXosip_event_t ** events, int max)
+{
+	int n = 0;
+
+	if (eXosip.j_events == NULL)
+		return 0;
+#ifdef OSIP_MT
+	osip_mutex_lock((struct osip_mutex *) eXosip.j_events_mutex);
+#endif
+	while (n < max) {
+		events[n] = (eXosip_event_t *) osip_mpsc_fifo_tryget(eXosip.j_events);
+		if (events[n] == NULL)
+			break;
+		n++;
+	}
+#ifdef OSIP_MT
+	osip_mutex_unlock((struct osip_mutex *) eXosip.j_events_mutex);
+#endif
+	return n;
+}
+
+void _eXosip_events_free(void)
+{
+	eXosip_event_t *je;
+
+	while (_eXosip_event_take(&je, 1) > 0)
+		eXosip_event_free(je);
+	osip_mpsc_fifo_free(eXosip.j_events);
+	eXosip.j_events = NULL;
+#ifdef OSIP_MT
+	if (eXosip.j_events_mutex != NULL)
+		osip_mutex_destroy((struct osip_mutex *) eXosip.j_events_mutex);
+	eXosip.j_events_mutex = NULL;
+#endif
+}
+
 int eXosip_event_add(eXosip_event_t * je)
 {
-	int i = osip_fifo_add(eXosip.j_events, (void *) je);
+	int i = osip_mpsc_fifo_add(eXosip.j_events, (void *) je);
+
+	if (i != 0)
+		return i;
+
+#ifdef eXosip_event_xchg
+	/* a burst of events needs a single wakeup: the consumer clears the
+	   flag before it looks at the fifo for the last time. */
+	if (eXosip_event_xchg(&eXosip.j_events_wakeup, 1) != 0)
+		return OSIP_SUCCESS;
+#endif
 
 #ifdef OSIP_MT
 #if !defined (_WIN32_WCE)
@@ -317,7 +397,7 @@ int eXosip_event_add(eXosip_event_t * je)
 #endif
 
 	__eXosip_wakeup_event();
-	return i;
+	return OSIP_SUCCESS;
 }
 
 #if 0
@@ -355,83 +435,88 @@ void __eXosip_clock_gettime(unsigned int clock_id, struct timespec *time)
 
 #ifndef OSIP_MT
 
-eXosip_event_t *eXosip_event_wait(int tv_s, int tv_ms)
+int eXosip_event_wait_batch(eXosip_event_t ** events, int max, int tv_s,
+							int tv_ms)
 {
-	eXosip_event_t *je = NULL;
-	je = (eXosip_event_t *) osip_fifo_tryget(eXosip.j_events);
-	if (je != NULL)
-		return je;
+	int n;
+
+	if (events == NULL || max <= 0)
+		return OSIP_BADPARAMETER;
+
+	n = _eXosip_event_take(events, max);
+	if (n > 0)
+		return n;
 
 	eXosip_lock();
 	eXosip_retransmit_lost200ok();
 	eXosip_unlock();
 
-	return NULL;
+	return 0;
 }
 
 #else
 
-eXosip_event_t *eXosip_event_wait(int tv_s, int tv_ms)
+/* wait for the event descriptor and clear it, return the select() result */
+static int _eXosip_event_wait_wakeup(int tv_s, int tv_ms)
 {
-	eXosip_event_t *je = NULL;
-
 	fd_set fdset;
 	struct timeval tv;
-	int max, i;
+	int fd, i;
 
+	fd = jpipe_get_read_descr(eXosip.j_socketctl_event);
 	FD_ZERO(&fdset);
 #if defined (WIN32) || defined (_WIN32_WCE)
-	FD_SET((unsigned int) jpipe_get_read_descr(eXosip.j_socketctl_event), &fdset);
+	FD_SET((unsigned int) fd, &fdset);
 #else
-	FD_SET(jpipe_get_read_descr(eXosip.j_socketctl_event), &fdset);
+	FD_SET(fd, &fdset);
 #endif
-	max = jpipe_get_read_descr(eXosip.j_socketctl_event);
-
-	je = (eXosip_event_t *) osip_fifo_tryget(eXosip.j_events);
-	if (je != NULL)
-		return je;
+	tv.tv_sec = tv_s;
+	tv.tv_usec = tv_ms * 1000;
 
-	tv.tv_sec = 0;
-	tv.tv_usec = 0;
-	i = select(max + 1, &fdset, NULL, NULL, &tv);
-	if (FD_ISSET(jpipe_get_read_descr(eXosip.j_socketctl_event), &fdset)) {
+	i = select(fd + 1, &fdset, NULL, NULL, &tv);
+	if (i > 0 && FD_ISSET(fd, &fdset)) {
 		char buf[500];
 		jpipe_read(eXosip.j_socketctl_event, buf, 499);
 	}
+	return i;
+}
+
+int eXosip_event_wait_batch(eXosip_event_t ** events, int max, int tv_s,
+							int tv_ms)
+{
+	int n;
+
+	if (events == NULL || max <= 0)
+		return OSIP_BADPARAMETER;
+
+	n = _eXosip_event_take(events, max);
+	if (n > 0)
+		return n;
+
+	/* clear the pending wakeup before looking again: an event added
+	   after this point either shows up now or signals once more. */
+	_eXosip_event_wait_wakeup(0, 0);
+#ifdef eXosip_event_xchg
+	eXosip_event_xchg(&eXosip.j_events_wakeup, 0);
+#endif
+	n = _eXosip_event_take(events, max);
+	if (n > 0)
+		return n;
 
 	eXosip_lock();
 	eXosip_retransmit_lost200ok();
 	eXosip_unlock();
 
-	FD_ZERO(&fdset);
-#if defined (WIN32) || defined (_WIN32_WCE)
-	FD_SET((unsigned int) jpipe_get_read_descr(eXosip.j_socketctl_event), &fdset);
-#else
-	FD_SET(jpipe_get_read_descr(eXosip.j_socketctl_event), &fdset);
-#endif
-	tv.tv_sec = tv_s;
-	tv.tv_usec = tv_ms * 1000;
-
 	if (tv_s == 0 && tv_ms == 0)
-		return NULL;
+		return 0;
 
-	i = select(max + 1, &fdset, NULL, NULL, &tv);
-	if (i <= 0)
-		return OSIP_SUCCESS;
+	if (_eXosip_event_wait_wakeup(tv_s, tv_ms) <= 0)
+		return 0;
 
 	if (eXosip.j_stop_ua)
-		return NULL;
-
-	if (FD_ISSET(jpipe_get_read_descr(eXosip.j_socketctl_event), &fdset)) {
-		char buf[500];
-		jpipe_read(eXosip.j_socketctl_event, buf, 499);
-	}
+		return 0;
 
-	je = (eXosip_event_t *) osip_fifo_tryget(eXosip.j_events);
-	if (je != NULL)
-		return je;
-
-	return je;
+	return _eXosip_event_take(events, max);
 }
 
 int eXosip_event_geteventsocket(void)
@@ -441,28 +526,21 @@ int eXosip_event_geteventsocket(void)
 
 eXosip_event_t *eXosip_event_get()
 {
-	eXosip_event_t *je;
-	fd_set fdset;
-	struct timeval tv;
-	int max, i;
+	eXosip_event_t *je = NULL;
 
-	FD_ZERO(&fdset);
-#if defined (WIN32) || defined (_WIN32_WCE)
-	FD_SET((unsigned int) jpipe_get_read_descr(eXosip.j_socketctl_event), &fdset);
-#else
-	FD_SET(jpipe_get_read_descr(eXosip.j_socketctl_event), &fdset);
+	while (eXosip_event_wait_batch(&je, 1, 1, 0) <= 0) {
+		if (eXosip.j_stop_ua)
+			return NULL;
+	}
+	return je;
+}
 #endif
-	max = jpipe_get_read_descr(eXosip.j_socketctl_event);
 
-	tv.tv_sec = 0;
-	tv.tv_usec = 0;
-	i = select(max + 1, &fdset, NULL, NULL, &tv);
-	if (FD_ISSET(jpipe_get_read_descr(eXosip.j_socketctl_event), &fdset)) {
-		char buf[500];
-		jpipe_read(eXosip.j_socketctl_event, buf, 499);
-	}
+eXosip_event_t *eXosip_event_wait(int tv_s, int tv_ms)
+{
+	eXosip_event_t *je = NULL;
 
-	je = (eXosip_event_t *) osip_fifo_get(eXosip.j_events);
+	if (eXosip_event_wait_batch(&je, 1, tv_s, tv_ms) <= 0)
+		return NULL;
 	return je;
 }
-#endif
\ No newline at end of file
@@ -0,0 +1,299 @@
+/*
+   eXosip - This is the eXtended osip library.
+   Copyright (C) 2002,2003,2004,2005,2006,2007  Aymeric MOIZARD  - jack@atosc.org
+
+   eXosip is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   eXosip is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef ENABLE_MPATROL
+    #include <mpatrol.h>
+#endif
+
+#include "eXosip2.h"
+
+extern eXosip_t eXosip;
+
+/*
+   Index of the calls, registrations, subscriptions, notifies and of
+   their dialogs.
+
+   Every object gets an entry when eXosip_update() (or eXosip_reg_init()
+   for registrations) gives it its id, and loses it when it is freed.
+   Entries are chained in two hash tables:
+     - by (type, id): used by eXosip_call_find(), eXosip_reg_find_id()
+       and the *_dialog_find() helpers.
+     - by Call-ID, for dialogs only: used to match incoming requests
+       with osip_dialog_match_as_uas() without walking every dialog.
+
+   The Call-ID is copied in the entry: the osip_dialog_t of a dialog may
+   be released before the eXosip_dialog_t itself. Only the part before
+   '@' is hashed, so that a request is looked up with call_id->number
+   without building the full Call-ID string.
+ */
+
+    #define EXOSIP_INDEX_MIN_SIZE 256
+
+static eXosip_index_entry_t **index_by_id;
+static eXosip_index_entry_t **index_by_call_id;
+static unsigned int         index_size;
+static unsigned int         index_count;
+
+static unsigned int
+_eXosip_index_hash_id(
+    int type,
+    int id)
+{
+    return ((unsigned int) id * 2654435761U) ^ (unsigned int) type;
+}
+
+static unsigned int
+_eXosip_index_hash_call_id(
+    const char *call_id)
+{
+    unsigned int hash = 5381;
+
+    while (*call_id != '\0' && *call_id != '@')
+    {
+        hash = ((hash << 5) + hash) + (unsigned char) *call_id;
+        call_id++;
+    }
+    return hash;
+}
+
+static int
+_eXosip_index_resize(
+    unsigned int size)
+{
+    eXosip_index_entry_t **by_id;
+    eXosip_index_entry_t **by_call_id;
+    unsigned int         pos;
+
+    by_id      = (eXosip_index_entry_t **) osip_malloc(size * sizeof(eXosip_index_entry_t *));
+    by_call_id = (eXosip_index_entry_t **) osip_malloc(size * sizeof(eXosip_index_entry_t *));
+    if (by_id == NULL || by_call_id == NULL)
+    {
+        osip_free(by_id);
+        osip_free(by_call_id);
+        return OSIP_NOMEM;
+    }
+    memset(by_id, 0, size * sizeof(eXosip_index_entry_t *));
+    memset(by_call_id, 0, size * sizeof(eXosip_index_entry_t *));
+
+    /* every entry is in the id table */
+    for (pos = 0; pos < index_size; pos++)
+    {
+        eXosip_index_entry_t *entry;
+        eXosip_index_entry_t *next;
+
+        for (entry = index_by_id[pos]; entry != NULL; entry = next)
+        {
+            unsigned int slot;
+
+            next           = entry->next_id;
+            slot           = _eXosip_index_hash_id(entry->type, entry->id) & (size - 1);
+            entry->next_id = by_id[slot];
+            by_id[slot]    = entry;
+
+            if (entry->call_id != NULL)
+            {
+                slot                = _eXosip_index_hash_call_id(entry->call_id) & (size - 1);
+                entry->next_call_id = by_call_id[slot];
+                by_call_id[slot]    = entry;
+            }
+        }
+    }
+
+    osip_free(index_by_id);
+    osip_free(index_by_call_id);
+    index_by_id      = by_id;
+    index_by_call_id = by_call_id;
+    index_size       = size;
+    return OSIP_SUCCESS;
+}
+
+int
+_eXosip_index_init(
+    void)
+{
+    _eXosip_index_free();
+    return _eXosip_index_resize(EXOSIP_INDEX_MIN_SIZE);
+}
+
+void
+_eXosip_index_free(
+    void)
+{
+    unsigned int pos;
+
+    for (pos = 0; pos < index_size; pos++)
+    {
+        eXosip_index_entry_t *entry;
+
+        for (entry = index_by_id[pos]; entry != NULL; entry = index_by_id[pos])
+        {
+            index_by_id[pos] = entry->next_id;
+            osip_free(entry->call_id);
+            osip_free(entry);
+        }
+    }
+    osip_free(index_by_id);
+    osip_free(index_by_call_id);
+    index_by_id      = NULL;
+    index_by_call_id = NULL;
+    index_size       = 0;
+    index_count      = 0;
+}
+
+static void
+_eXosip_index_unlink(
+    eXosip_index_entry_t *entry)
+{
+    eXosip_index_entry_t **prev;
+
+    prev = &index_by_id[_eXosip_index_hash_id(entry->type, entry->id) & (index_size - 1)];
+    while (*prev != entry)
+        prev = &(*prev)->next_id;
+    *prev = entry->next_id;
+
+    if (entry->call_id != NULL)
+    {
+        prev = &index_by_call_id[_eXosip_index_hash_call_id(entry->call_id) & (index_size - 1)];
+        while (*prev != entry)
+            prev = &(*prev)->next_call_id;
+        *prev = entry->next_call_id;
+    }
+
+    index_count--;
+    osip_free(entry->call_id);
+    osip_free(entry);
+}
+
+int
+_eXosip_index_add(
+    int             type,
+    int             id,
+    void            *owner,
+    eXosip_dialog_t *jd)
+{
+    eXosip_index_entry_t *entry;
+    unsigned int         slot;
+
+    if (id < 1 || owner == NULL)
+        return OSIP_BADPARAMETER;
+    if (index_size == 0)
+        return OSIP_WRONG_STATE;
+
+    /* ids are reused after 32767: the oldest object is no more indexed */
+    entry = _eXosip_index_find(type, id);
+    if (entry != NULL)
+        _eXosip_index_unlink(entry);
+
+    if (index_count >= index_size * 2)
+        _eXosip_index_resize(index_size * 2);  /* keep the old table on failure */
+
+    entry = (eXosip_index_entry_t *) osip_malloc(sizeof(eXosip_index_entry_t));
+    if (entry == NULL)
+        return OSIP_NOMEM;
+    memset(entry, 0, sizeof(eXosip_index_entry_t));
+    entry->type  = type;
+    entry->id    = id;
+    entry->owner = owner;
+    entry->jd    = jd;
+
+    if (jd != NULL && jd->d_dialog != NULL && jd->d_dialog->call_id != NULL)
+    {
+        entry->call_id = osip_strdup(jd->d_dialog->call_id);
+        if (entry->call_id == NULL)
+        {
+            osip_free(entry);
+            return OSIP_NOMEM;
+        }
+        slot                   = _eXosip_index_hash_call_id(entry->call_id) & (index_size - 1);
+        entry->next_call_id    = index_by_call_id[slot];
+        index_by_call_id[slot] = entry;
+    }
+
+    slot              = _eXosip_index_hash_id(type, id) & (index_size - 1);
+    entry->next_id    = index_by_id[slot];
+    index_by_id[slot] = entry;
+    index_count++;
+    return OSIP_SUCCESS;
+}
+
+void
+_eXosip_index_remove(
+    int  type,
+    int  id,
+    void *object)
+{
+    eXosip_index_entry_t *entry;
+
+    entry = _eXosip_index_find(type, id);
+    /* the id may already belong to a newer object */
+    if (entry == NULL || (entry->jd != NULL ? (void *) entry->jd : entry->owner) != object)
+        return;
+    _eXosip_index_unlink(entry);
+}
+
+eXosip_index_entry_t *
+_eXosip_index_find(
+    int type,
+    int id)
+{
+    eXosip_index_entry_t *entry;
+
+    if (index_size == 0 || id < 1)
+        return NULL;
+
+    for (entry = index_by_id[_eXosip_index_hash_id(type, id) & (index_size - 1)];
+         entry != NULL; entry = entry->next_id)
+    {
+        if (entry->id == id && entry->type == type)
+            return entry;
+    }
+    return NULL;
+}
+
+int
+_eXosip_index_match_as_uas(
+    int             type,
+    osip_message_t  *request,
+    void            **owner,
+    eXosip_dialog_t **jd)
+{
+    eXosip_index_entry_t *entry;
+    unsigned int         slot;
+
+    *owner = NULL;
+    *jd    = NULL;
+    if (index_size == 0 || request == NULL || request->call_id == NULL
+        || request->call_id->number == NULL)
+        return OSIP_BADPARAMETER;
+
+    slot = _eXosip_index_hash_call_id(request->call_id->number) & (index_size - 1);
+    for (entry = index_by_call_id[slot]; entry != NULL; entry = entry->next_call_id)
+    {
+        if (entry->type != type || entry->jd->d_dialog == NULL)
+            continue;
+        /* compares the Call-ID and the tags */
+        if (osip_dialog_match_as_uas(entry->jd->d_dialog, request) == 0)
+        {
+            *owner = entry->owner;
+            *jd    = entry->jd;
+            return OSIP_SUCCESS;
+        }
+    }
+    return OSIP_NOTFOUND;
+}
@@ -119,6 +119,7 @@ eXosip_notify_free(
              && jn->n_out_tr->orig_request->call_id->number != NULL)
         _eXosip_delete_nonce(jn->n_out_tr->orig_request->call_id->number);
 
+    _eXosip_index_remove(EXOSIP_INDEX_NOTIFY, jn->n_id, jn);
     for (jd = jn->n_dialogs; jd != NULL; jd = jn->n_dialogs)
     {
         REMOVE_ELEMENT(jn->n_dialogs, jd);
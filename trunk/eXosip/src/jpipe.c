@@ -28,6 +28,9 @@
     #if !defined(WIN32) && !defined(__arc__)
 
         #include <fcntl.h>
+        #ifdef HAVE_SYS_EVENTFD_H
+            #include <sys/eventfd.h>
+        #endif
 
 jpipe_t *
 jpipe()
@@ -37,6 +40,17 @@ jpipe()
     if (my_pipe == NULL)
         return NULL;
 
+        #ifdef HAVE_SYS_EVENTFD_H
+    /* an eventfd is a counter: wakeups written before the reader runs
+       coalesce and a single read clears them all. Both ends share it. */
+    my_pipe->pipes[0] = eventfd(0, EFD_NONBLOCK);
+    if (my_pipe->pipes[0] >= 0)
+    {
+        my_pipe->pipes[1] = my_pipe->pipes[0];
+        return my_pipe;
+    }
+        #endif
+
     if (0 != pipe(my_pipe->pipes))
     {
         osip_free(my_pipe);
@@ -61,7 +75,8 @@ jpipe_close(
     if (apipe == NULL)
         return OSIP_BADPARAMETER;
     close(apipe->pipes[0]);
-    close(apipe->pipes[1]);
+    if (apipe->pipes[1] != apipe->pipes[0])
+        close(apipe->pipes[1]);
     osip_free(apipe);
     return OSIP_SUCCESS;
 }
@@ -77,6 +92,14 @@ jpipe_write(
 {
     if (apipe == NULL)
         return OSIP_BADPARAMETER;
+        #ifdef HAVE_SYS_EVENTFD_H
+    if (apipe->pipes[0] == apipe->pipes[1])
+    {
+        if (eventfd_write(apipe->pipes[1], 1) != 0)
+            return -1;
+        return count;
+    }
+        #endif
     return write(apipe->pipes[1], buf, count);
 }
 
@@ -91,6 +114,16 @@ jpipe_read(
 {
     if (apipe == NULL)
         return OSIP_BADPARAMETER;
+        #ifdef HAVE_SYS_EVENTFD_H
+    if (apipe->pipes[0] == apipe->pipes[1])
+    {
+        eventfd_t value;
+
+        if (eventfd_read(apipe->pipes[0], &value) != 0)
+            return -1;
+        return count;
+    }
+        #endif
     return read(apipe->pipes[0], buf, count);
 }
 
@@ -54,6 +54,7 @@ _eXosip_pub_update(
                 if (sip_etag != NULL && sip_etag->hvalue != NULL)
                     snprintf(jpub->p_sip_etag, 64, "%s", sip_etag->hvalue);
             }
+            _eXosip_refresh_update(&jpub->p_refresh);
             *pub = jpub;
             return OSIP_SUCCESS;
         }
@@ -121,6 +122,8 @@ _eXosip_pub_init(
         return OSIP_NOMEM;
     memset(jpub, 0, sizeof(eXosip_pub_t));
     snprintf(jpub->p_aor, 256, "%s", aor);
+    jpub->p_refresh.type  = EXOSIP_REFRESH_PUBLISH;
+    jpub->p_refresh.owner = jpub;
 
     jpub->p_period = atoi(exp);
     jpub->p_id     = ++p_id;
@@ -133,6 +136,7 @@ void
 _eXosip_pub_free(
     eXosip_pub_t *pub)
 {
+    _eXosip_refresh_remove(&pub->p_refresh);
     if (pub->p_last_tr != NULL)
     {
         if (pub->p_last_tr != NULL && pub->p_last_tr->orig_request != NULL
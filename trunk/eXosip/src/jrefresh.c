@@ -0,0 +1,462 @@
+/*
+   eXosip - This is the eXtended osip library.
+   Copyright (C) 2002,2003,2004,2005,2006,2007  Aymeric MOIZARD  - jack@atosc.org
+
+   eXosip is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   eXosip is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef ENABLE_MPATROL
+    #include <mpatrol.h>
+#endif
+
+#include "eXosip2.h"
+
+
+extern eXosip_t eXosip;
+
+/*
+   Refresh scheduler.
+
+   Registrations, subscriptions and publications are kept in a heap
+   ordered by the next time eXosip_automatic_refresh() or
+   eXosip_automatic_action() may have something to do for them: send a
+   refresh, a new request after a failure or a retry with credentials.
+   Those functions only visit the entries that are due, and
+   eXosip_execute() does not wake up before the first deadline.
+
+   The deadline is computed again after each visit and each time the
+   registration, subscription or publication sends a request or
+   receives an answer (_eXosip_refresh_update()). It may be early,
+   never late: an entry visited too early is only rescheduled.
+
+   Refreshes are sent between 80% and 90% of the period, at a place
+   chosen randomly for each entry, so that registrations started
+   together do not come back together. EXOSIP_OPT_SET_MAX_REFRESH_RATE
+   limits the number of entries handled per second.
+ */
+
+    #define EXOSIP_REFRESH_RETRY_DELAY 120  /* after a failure */
+
+static struct eXosip_refresh **refresh_heap;   /* from index 1 */
+static int                   refresh_count;
+static int                   refresh_size;
+
+static struct eXosip_refresh **refresh_due;
+static int                   refresh_due_size;
+
+static time_t                refresh_second;
+static int                   refresh_nb_in_second;
+
+static void
+_eXosip_refresh_place(
+    struct eXosip_refresh *refresh,
+    int                   pos)
+{
+    refresh_heap[pos] = refresh;
+    refresh->pos      = pos;
+}
+
+static void
+_eXosip_refresh_sift_up(
+    int pos)
+{
+    struct eXosip_refresh *refresh = refresh_heap[pos];
+
+    while (pos > 1 && refresh_heap[pos / 2]->deadline > refresh->deadline)
+    {
+        _eXosip_refresh_place(refresh_heap[pos / 2], pos);
+        pos /= 2;
+    }
+    _eXosip_refresh_place(refresh, pos);
+}
+
+static void
+_eXosip_refresh_sift_down(
+    int pos)
+{
+    struct eXosip_refresh *refresh = refresh_heap[pos];
+
+    for (;;)
+    {
+        int child = pos * 2;
+
+        if (child > refresh_count)
+            break;
+        if (child < refresh_count
+            && refresh_heap[child + 1]->deadline < refresh_heap[child]->deadline)
+            child++;
+        if (refresh_heap[child]->deadline >= refresh->deadline)
+            break;
+        _eXosip_refresh_place(refresh_heap[child], pos);
+        pos = child;
+    }
+    _eXosip_refresh_place(refresh, pos);
+}
+
+static int
+_eXosip_refresh_schedule(
+    struct eXosip_refresh *refresh,
+    time_t                deadline)
+{
+    time_t previous = refresh->deadline;
+
+    refresh->deadline = deadline;
+    if (refresh->pos > 0)
+    {
+        if (deadline < previous)
+            _eXosip_refresh_sift_up(refresh->pos);
+        else
+            _eXosip_refresh_sift_down(refresh->pos);
+        return OSIP_SUCCESS;
+    }
+
+    if (refresh_count + 1 >= refresh_size)
+    {
+        struct eXosip_refresh **heap;
+        int                   size = refresh_size * 2;
+
+        if (size < 64)
+            size = 64;
+        heap = (struct eXosip_refresh **) osip_realloc(refresh_heap,
+                                                       size * sizeof(struct eXosip_refresh *));
+        if (heap == NULL)
+            return OSIP_NOMEM;
+        refresh_heap = heap;
+        refresh_size = size;
+    }
+    refresh_count++;
+    _eXosip_refresh_place(refresh, refresh_count);
+    _eXosip_refresh_sift_up(refresh_count);
+    return OSIP_SUCCESS;
+}
+
+void
+_eXosip_refresh_remove(
+    struct eXosip_refresh *refresh)
+{
+    int pos = refresh->pos;
+
+    if (pos <= 0)
+        return;
+    refresh->pos = 0;
+    if (pos == refresh_count)
+    {
+        refresh_count--;
+        return;
+    }
+
+    /* the last entry takes its place */
+    _eXosip_refresh_place(refresh_heap[refresh_count], pos);
+    refresh_count--;
+    if (pos > 1 && refresh_heap[pos / 2]->deadline > refresh_heap[pos]->deadline)
+        _eXosip_refresh_sift_up(pos);
+    else
+        _eXosip_refresh_sift_down(pos);
+}
+
+void
+_eXosip_refresh_free(
+    void)
+{
+    int pos;
+
+    /* the registrations, subscriptions and publications may be
+       released later: they must not look for their place anymore */
+    for (pos = 1; pos <= refresh_count; pos++)
+        refresh_heap[pos]->pos = 0;
+    osip_free(refresh_heap);
+    osip_free(refresh_due);
+    refresh_heap         = NULL;
+    refresh_count        = 0;
+    refresh_size         = 0;
+    refresh_due          = NULL;
+    refresh_due_size     = 0;
+    refresh_second       = 0;
+    refresh_nb_in_second = 0;
+}
+
+int
+_eXosip_refresh_delay(
+    struct eXosip_refresh *refresh,
+    int                   period)
+{
+    if (refresh->jitter == 0)
+        refresh->jitter = 1 + osip_build_random_number() % 1000;
+    return period - period / 10 - (period / 10) * (refresh->jitter - 1) / 1000;
+}
+
+static void
+_eXosip_refresh_min(
+    time_t *deadline,
+    time_t value)
+{
+    if (*deadline == 0 || value < *deadline)
+        *deadline = value;
+}
+
+/* the retry branches of eXosip_automatic_action() */
+static int
+_eXosip_refresh_retry_pending(
+    osip_transaction_t *tr,
+    int                retry,
+    time_t             now)
+{
+    osip_message_t *answer = tr->last_response;
+
+    if (retry >= 3 || answer == NULL || tr->orig_request == NULL)
+        return 0;
+    if (now - tr->birth_time >= EXOSIP_REFRESH_RETRY_DELAY)
+        return 0;
+    return answer->status_code == 401 || answer->status_code == 407
+           || answer->status_code == 423;
+}
+
+static time_t
+_eXosip_refresh_reg_deadline(
+    eXosip_reg_t *jr,
+    time_t       now)
+{
+    osip_transaction_t *tr       = jr->r_last_tr;
+    time_t             deadline = 0;
+
+    if (jr->r_id < 1 || tr == NULL)
+        return 0;
+
+    if (_eXosip_refresh_retry_pending(tr, jr->r_retry, now))
+        _eXosip_refresh_min(&deadline, tr->birth_time);
+    if (jr->r_reg_period != 0)
+    {
+        _eXosip_refresh_min(&deadline, tr->birth_time + 1
+                            + _eXosip_refresh_delay(&jr->r_refresh, EXOSIP_REFRESH_MAX_PERIOD));
+        _eXosip_refresh_min(&deadline, tr->birth_time + 1
+                            + _eXosip_refresh_delay(&jr->r_refresh, jr->r_reg_period));
+    #if TARGET_OS_IPHONE
+        _eXosip_refresh_min(&deadline, tr->birth_time + 1 + jr->r_reg_period - 630);
+    #endif
+        if (tr->last_response == NULL || !MSG_IS_STATUS_2XX(tr->last_response))
+            _eXosip_refresh_min(&deadline, tr->birth_time + 1 + EXOSIP_REFRESH_RETRY_DELAY);
+    }
+    return deadline;
+}
+
+    #ifndef MINISIZE
+
+static time_t
+_eXosip_refresh_subscribe_deadline(
+    eXosip_subscribe_t *js,
+    time_t             now)
+{
+    eXosip_dialog_t *jd;
+    time_t          deadline = 0;
+
+    if (js->s_id >= 1 && js->s_dialogs == NULL && js->s_out_tr != NULL
+        && _eXosip_refresh_retry_pending(js->s_out_tr, js->s_retry, now))
+        _eXosip_refresh_min(&deadline, js->s_out_tr->birth_time);
+
+    for (jd = js->s_dialogs; jd != NULL; jd = jd->next)
+    {
+        osip_transaction_t *tr;
+
+        if (jd->d_dialog == NULL || jd->d_id < 1)
+            continue;
+        tr = (osip_transaction_t *) osip_list_get(jd->d_out_trs, 0);
+        if (tr == NULL)
+            tr = js->s_out_tr;
+        if (tr == NULL)
+            continue;
+
+        if (_eXosip_refresh_retry_pending(tr, jd->d_retry, now))
+            _eXosip_refresh_min(&deadline, tr->birth_time);
+        if (js->s_reg_period != 0)
+            _eXosip_refresh_min(&deadline, tr->birth_time + 1
+                                + _eXosip_refresh_delay(&js->s_refresh, js->s_reg_period));
+    }
+    return deadline;
+}
+
+static time_t
+_eXosip_refresh_pub_deadline(
+    eXosip_pub_t *jpub,
+    time_t       now)
+{
+    osip_transaction_t *tr       = jpub->p_last_tr;
+    time_t             deadline = 0;
+
+    if (jpub->p_id < 1 || tr == NULL)
+        return 0;
+
+    if (_eXosip_refresh_retry_pending(tr, jpub->p_retry, now)
+        || (tr->last_response != NULL
+            && tr->orig_request != NULL
+            && now - tr->birth_time < EXOSIP_REFRESH_RETRY_DELAY
+            && tr->last_response->status_code == 412))
+        _eXosip_refresh_min(&deadline, tr->birth_time);
+    if (jpub->p_period != 0)
+    {
+        _eXosip_refresh_min(&deadline, tr->birth_time + 1
+                            + _eXosip_refresh_delay(&jpub->p_refresh, EXOSIP_REFRESH_MAX_PERIOD));
+        _eXosip_refresh_min(&deadline, tr->birth_time + 1
+                            + _eXosip_refresh_delay(&jpub->p_refresh, jpub->p_period));
+        if (tr->last_response == NULL || !MSG_IS_STATUS_2XX(tr->last_response))
+            _eXosip_refresh_min(&deadline, tr->birth_time + 1 + EXOSIP_REFRESH_RETRY_DELAY);
+    }
+    return deadline;
+}
+
+    #endif
+
+void
+_eXosip_refresh_update(
+    struct eXosip_refresh *refresh)
+{
+    time_t now      = time(NULL);
+    time_t deadline = 0;
+
+    if (refresh->owner == NULL)
+        return;
+
+    switch (refresh->type)
+    {
+    case EXOSIP_REFRESH_REG:
+        deadline = _eXosip_refresh_reg_deadline((eXosip_reg_t *) refresh->owner, now);
+        break;
+    #ifndef MINISIZE
+    case EXOSIP_REFRESH_SUBSCRIBE:
+        deadline = _eXosip_refresh_subscribe_deadline((eXosip_subscribe_t *) refresh->owner,
+                                                      now);
+        break;
+    case EXOSIP_REFRESH_PUBLISH:
+        deadline = _eXosip_refresh_pub_deadline((eXosip_pub_t *) refresh->owner, now);
+        break;
+    #endif
+    default:
+        break;
+    }
+
+    if (deadline == 0)
+        _eXosip_refresh_remove(refresh);
+    else if (_eXosip_refresh_schedule(refresh, deadline) != 0)
+    {
+        OSIP_TRACE(osip_trace
+                       (__FILE__, __LINE__, OSIP_ERROR, NULL,
+                       "eXosip: cannot schedule refresh\n"));
+    }
+}
+
+static int
+_eXosip_refresh_compare(
+    const void *a,
+    const void *b)
+{
+    const struct eXosip_refresh *ra = *(const struct eXosip_refresh **) a;
+    const struct eXosip_refresh *rb = *(const struct eXosip_refresh **) b;
+
+    if (ra->deadline < rb->deadline)
+        return -1;
+    return ra->deadline > rb->deadline;
+}
+
+static int
+_eXosip_refresh_add_due(
+    int                   nb,
+    struct eXosip_refresh *refresh)
+{
+    if (nb >= refresh_due_size)
+    {
+        struct eXosip_refresh **array;
+        int                   size = refresh_due_size * 2;
+
+        if (size < 64)
+            size = 64;
+        array = (struct eXosip_refresh **) osip_realloc(refresh_due,
+                                                        size * sizeof(struct eXosip_refresh *));
+        if (array == NULL)
+            return nb;
+        refresh_due      = array;
+        refresh_due_size = size;
+    }
+    refresh_due[nb] = refresh;
+    return nb + 1;
+}
+
+int
+_eXosip_refresh_due(
+    time_t                now,
+    struct eXosip_refresh ***due)
+{
+    int nb = 0;
+    int i;
+
+    *due = NULL;
+    if (refresh_count == 0 || refresh_heap[1]->deadline > now)
+        return 0;
+
+    /* a child is never due before its parent: walk down from the top
+       of the heap and stop at the first entries that are not due. */
+    nb = _eXosip_refresh_add_due(nb, refresh_heap[1]);
+    for (i = 0; i < nb; i++)
+    {
+        int child = refresh_due[i]->pos * 2;
+
+        if (child <= refresh_count && refresh_heap[child]->deadline <= now)
+            nb = _eXosip_refresh_add_due(nb, refresh_heap[child]);
+        if (child + 1 <= refresh_count && refresh_heap[child + 1]->deadline <= now)
+            nb = _eXosip_refresh_add_due(nb, refresh_heap[child + 1]);
+    }
+
+    qsort(refresh_due, nb, sizeof(struct eXosip_refresh *), _eXosip_refresh_compare);
+    *due = refresh_due;
+    return nb;
+}
+
+int
+_eXosip_refresh_allowed(
+    time_t now)
+{
+    if (eXosip.max_refresh_rate <= 0)
+        return 1;
+    if (now != refresh_second)
+    {
+        refresh_second       = now;
+        refresh_nb_in_second = 0;
+    }
+    return refresh_nb_in_second < eXosip.max_refresh_rate;
+}
+
+/* only the requests really sent are charged: a due entry may have
+   nothing to send (waiting for an answer, too many retries...) */
+void
+_eXosip_refresh_sent(
+    time_t now,
+    int    nb)
+{
+    if (eXosip.max_refresh_rate <= 0)
+        return;
+    if (now != refresh_second)
+    {
+        refresh_second       = now;
+        refresh_nb_in_second = 0;
+    }
+    refresh_nb_in_second += nb;
+}
+
+time_t
+_eXosip_refresh_next(
+    void)
+{
+    if (refresh_count == 0)
+        return 0;
+    return refresh_heap[1]->deadline;
+}
@@ -123,6 +123,9 @@ sizeof(firewall_ip),
         osip_strncpy((*jr)->r_line, key_line, sizeof((*jr)->r_line) - 1);
     }
 
+    (*jr)->r_refresh.type  = EXOSIP_REFRESH_REG;
+    (*jr)->r_refresh.owner = *jr;
+    _eXosip_index_add(EXOSIP_INDEX_REG, (*jr)->r_id, *jr, NULL);
     return OSIP_SUCCESS;
 }
 
@@ -130,6 +133,9 @@ void
 eXosip_reg_free(
     eXosip_reg_t *jreg)
 {
+    _eXosip_index_remove(EXOSIP_INDEX_REG, jreg->r_id, jreg);
+    _eXosip_refresh_remove(&jreg->r_refresh);
+
     osip_free(jreg->r_aor);
     osip_free(jreg->r_contact);
     osip_free(jreg->r_registrar);
@@ -192,19 +198,15 @@ eXosip_reg_find_id(
     eXosip_reg_t **reg,
     int          rid)
 {
-    eXosip_reg_t *jreg;
+    eXosip_index_entry_t *entry;
 
     *reg = NULL;
     if (rid <= 0)
         return OSIP_BADPARAMETER;
 
-    for (jreg = eXosip.j_reg; jreg != NULL; jreg = jreg->next)
-    {
-        if (jreg->r_id == rid)
-        {
-            *reg = jreg;
-            return OSIP_SUCCESS;
-        }
-    }
-    return OSIP_NOTFOUND;
+    entry = _eXosip_index_find(EXOSIP_INDEX_REG, rid);
+    if (entry == NULL)
+        return OSIP_NOTFOUND;
+    *reg = (eXosip_reg_t *) entry->owner;
+    return OSIP_SUCCESS;
 }
\ No newline at end of file
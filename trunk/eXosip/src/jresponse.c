@@ -448,7 +448,10 @@ _eXosip_insubscription_answer_1xx(
                                "eXosip: cannot create dialog!\n"));
             }
             else
+            {
                 ADD_ELEMENT(jn->n_dialogs, jd);
+                eXosip_update();
+            }
         }
     }
 
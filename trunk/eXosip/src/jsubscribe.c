@@ -90,6 +90,8 @@ eXosip_subscribe_init(
     if (*js == NULL)
         return OSIP_NOMEM;
     memset(*js, 0, sizeof(eXosip_subscribe_t));
+    (*js)->s_refresh.type  = EXOSIP_REFRESH_SUBSCRIBE;
+    (*js)->s_refresh.owner = *js;
     return OSIP_SUCCESS;
 }
 
@@ -110,6 +112,8 @@ eXosip_subscribe_free(
              && js->s_out_tr->orig_request->call_id->number != NULL)
         _eXosip_delete_nonce(js->s_out_tr->orig_request->call_id->number);
 
+    _eXosip_index_remove(EXOSIP_INDEX_SUBSCRIBE, js->s_id, js);
+    _eXosip_refresh_remove(&js->s_refresh);
     for (jd = js->s_dialogs; jd != NULL; jd = js->s_dialogs)
     {
         REMOVE_ELEMENT(js->s_dialogs, jd);
@@ -146,6 +150,7 @@ _eXosip_subscribe_set_refresh_interval(
             js->s_reg_period = val;
     }
 
+    _eXosip_refresh_update(&js->s_refresh);
     return OSIP_SUCCESS;
 }
 
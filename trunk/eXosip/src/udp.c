@@ -997,6 +997,7 @@ eXosip_process_newrequest(
     eXosip_notify_t    *jn;
 #endif
     eXosip_dialog_t    *jd;
+    void               *owner;
 
     if (MSG_IS_INVITE(evt->sip))
     {
@@ -1047,21 +1048,9 @@ eXosip_process_newrequest(
         return;
     }
 
-    jd = NULL;
     /* first, look for a Dialog in the map of element */
-    for (jc = eXosip.j_calls; jc != NULL; jc = jc->next)
-    {
-        for (jd = jc->c_dialogs; jd != NULL; jd = jd->next)
-        {
-            if (jd->d_dialog != NULL)
-            {
-                if (osip_dialog_match_as_uas(jd->d_dialog, evt->sip) == 0)
-                    break;
-            }
-        }
-        if (jd != NULL)
-            break;
-    }
+    _eXosip_index_match_as_uas(EXOSIP_INDEX_CALL, evt->sip, &owner, &jd);
+    jc = (eXosip_call_t *) owner;
 
     /* check CSeq */
     if (jd != NULL && transaction != NULL && evt->sip != NULL
@@ -1248,21 +1237,9 @@ eXosip_process_newrequest(
         return;
     }
 #ifndef MINISIZE
-    js = NULL;
     /* first, look for a Dialog in the map of element */
-    for (js = eXosip.j_subscribes; js != NULL; js = js->next)
-    {
-        for (jd = js->s_dialogs; jd != NULL; jd = jd->next)
-        {
-            if (jd->d_dialog != NULL)
-            {
-                if (osip_dialog_match_as_uas(jd->d_dialog, evt->sip) == 0)
-                    break;
-            }
-        }
-        if (jd != NULL)
-            break;
-    }
+    _eXosip_index_match_as_uas(EXOSIP_INDEX_SUBSCRIBE, evt->sip, &owner, &jd);
+    js = (eXosip_subscribe_t *) owner;
 
     if (js != NULL)
     {
@@ -1348,6 +1325,7 @@ eXosip_process_newrequest(
 
                 ADD_ELEMENT(js->s_dialogs, jd);
                 eXosip_update();
+                _eXosip_refresh_update(&js->s_refresh);
 
                 eXosip_process_notify_within_dialog(js, jd, transaction, evt);
                 return;
@@ -1358,21 +1336,9 @@ eXosip_process_newrequest(
         return;
     }
 
-    jn = NULL;
     /* first, look for a Dialog in the map of element */
-    for (jn = eXosip.j_notifies; jn != NULL; jn = jn->next)
-    {
-        for (jd = jn->n_dialogs; jd != NULL; jd = jd->next)
-        {
-            if (jd->d_dialog != NULL)
-            {
-                if (osip_dialog_match_as_uas(jd->d_dialog, evt->sip) == 0)
-                    break;
-            }
-        }
-        if (jd != NULL)
-            break;
-    }
+    _eXosip_index_match_as_uas(EXOSIP_INDEX_NOTIFY, evt->sip, &owner, &jd);
+    jn = (eXosip_notify_t *) owner;
 
     if (jn != NULL)
     {
@@ -1644,6 +1610,21 @@ _eXosip_handle_incoming_message(
     int    socket,
     char   *host,
     int    port)
+{
+#ifdef OSIP_MT
+    if (eXosip.j_workers != NULL)
+        return _eXosip_worker_dispatch(buf, length, socket, host, port);
+#endif
+    return _eXosip_process_incoming_message(buf, length, socket, host, port);
+}
+
+int
+_eXosip_process_incoming_message(
+    char   *buf,
+    size_t length,
+    int    socket,
+    char   *host,
+    int    port)
 {
     int          i;
     osip_event_t *se;
@@ -1680,10 +1661,7 @@ _eXosip_handle_incoming_message(
                        "MESSAGE REC. CALLID:%s\n", se->sip->call_id->number));
     }
 
-    if (eXosip.cbsipCallback != NULL)
-    {
-        eXosip.cbsipCallback(se->sip, 1);
-    }
+    _eXosip_cbsip_message(se->sip, 1);
 
     if (MSG_IS_REQUEST(se->sip))
     {
@@ -1771,6 +1749,16 @@ eXosip_read_message(
         int wakeup_socket = jpipe_get_read_descr(eXosip.j_socketctl);
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+        if (_eXtl_poll_enabled())
+        {
+            if (_eXtl_poll_wait(sec_max, usec_max) < 0)
+                return -2000;   /* error */
+            max_message_nb--;
+            continue;
+        }
+#endif
+
         FD_ZERO(&osip_fdset);
         FD_ZERO(&osip_wrset);
         eXtl_udp.tl_set_fdset(&osip_fdset, &osip_wrset, &max);
@@ -0,0 +1,811 @@
+/*
+ * SIP load generator -- benchmark for the osip/eXosip stack
+ *
+ * This program is Free Software, released under the GNU General
+ * Public License v2.0 http://www.gnu.org/licenses/gpl
+ *
+ * This program sends REGISTER, MESSAGE, INVITE/ACK/BYE or SUBSCRIBE
+ * transactions from an eXosip user agent client to an eXosip user
+ * agent server and reports the transaction rate, the latency of each
+ * transaction, the number of osip allocations per transaction and the
+ * memory high-water of both sides.
+ *
+ * By default the server is forked on the loopback interface:
+ *
+ *   sip_bench -s invite -n 20000 -c 100 -t tcp
+ *
+ * Both sides can also run on different hosts:
+ *
+ *   sip_bench -m uas -p 5070
+ *   sip_bench -m uac -r 192.168.1.2 -p 5070 -s register
+ *
+ * Both sides use eXosip, so the figures cover the parser, the
+ * transaction layer and the transport of the two user agents.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <osip2/osip_mt.h>
+#include <eXosip2/eXosip.h>
+
+#define _GNU_SOURCE
+#include <getopt.h>
+
+#define PROG_NAME       "sip_bench"
+#define PROG_VER        "1.0"
+#define UA_STRING       "SipBench v" PROG_VER
+
+#define BENCH_MAX_EVENTS    64
+#define BENCH_IDLE_TIMEOUT  5 /* seconds without any answer */
+
+/* osip allocations are counted by wrapping the osip allocators */
+#if !defined(MINISIZE) && defined(__GNUC__)
+    #define BENCH_COUNT_ALLOCS
+#endif
+
+enum bench_scenario
+{
+    BENCH_REGISTER,
+    BENCH_MESSAGE,
+    BENCH_INVITE,
+    BENCH_SUBSCRIBE
+};
+
+static const char *scenario_names[] = {
+    "register", "message", "invite", "subscribe"
+};
+
+enum bench_state
+{
+    SLOT_IDLE,
+    SLOT_REQUEST,  /* REGISTER, MESSAGE, INVITE or SUBSCRIBE sent */
+    SLOT_BYE       /* INVITE answered, BYE sent */
+};
+
+typedef struct bench_slot
+{
+    int            state;
+    int            rid; /* registration reused for each REGISTER */
+    struct timeval start;
+} bench_slot_t;
+
+typedef struct bench_stats
+{
+    unsigned int   *latencies; /* usec, one per transaction */
+    int            nb_latencies;
+    int            nb_transactions;
+    int            nb_messages;
+    int            nb_errors;
+    struct timeval start;
+    struct timeval end;
+} bench_stats_t;
+
+static volatile int stop_uas = 0;
+
+static void
+usage(
+    void)
+{
+    printf("Usage: " PROG_NAME " [options]\n"
+           "\n\t[options]\n"
+           "\t-m --mode\tuac|uas|both (default both: fork a server on loopback)\n"
+           "\t-s --scenario\tregister|message|invite|subscribe (default register)\n"
+           "\t-t --transport\tudp|tcp (default udp)\n"
+           "\t-n --number\tnumber of scenarios to run (default 10000)\n"
+           "\t-c --concurrency\tscenarios in progress at any time (default 50)\n"
+           "\t-r --remote\tserver address (default 127.0.0.1)\n"
+           "\t-p --port\tserver port (default 5070)\n"
+           "\t-l --localport\tclient port (default: server port + 1)\n"
+           "\t-d --debug\tenable osip traces\n"
+           "\t-h --help\n");
+}
+
+#ifdef BENCH_COUNT_ALLOCS
+
+/* each block is prefixed with its size so that free() can account for it */
+typedef union bench_alloc_header
+{
+    size_t size;
+    double align;
+} bench_alloc_header_t;
+
+static volatile long nb_allocs   = 0;
+static volatile long heap_bytes  = 0;
+static volatile long heap_peak   = 0;
+
+static void
+bench_account(
+    long delta)
+{
+    long now  = __sync_add_and_fetch(&heap_bytes, delta);
+    long peak = heap_peak;
+
+    while (now > peak && !__sync_bool_compare_and_swap(&heap_peak, peak, now))
+        peak = heap_peak;
+}
+
+static void *
+bench_malloc(
+    size_t size)
+{
+    bench_alloc_header_t *h = malloc(sizeof(bench_alloc_header_t) + size);
+
+    if (h == NULL)
+        return NULL;
+    h->size = size;
+    __sync_add_and_fetch(&nb_allocs, 1);
+    bench_account((long) size);
+    return h + 1;
+}
+
+static void
+bench_free(
+    void *ptr)
+{
+    bench_alloc_header_t *h;
+
+    if (ptr == NULL)
+        return;
+    h = (bench_alloc_header_t *) ptr - 1;
+    bench_account(-(long) h->size);
+    free(h);
+}
+
+static void *
+bench_realloc(
+    void   *ptr,
+    size_t size)
+{
+    bench_alloc_header_t *h;
+    size_t               old;
+
+    if (ptr == NULL)
+        return bench_malloc(size);
+    h   = (bench_alloc_header_t *) ptr - 1;
+    old = h->size;
+    h   = realloc(h, sizeof(bench_alloc_header_t) + size);
+    if (h == NULL)
+        return NULL;
+    h->size = size;
+    __sync_add_and_fetch(&nb_allocs, 1);
+    bench_account((long) size - (long) old);
+    return h + 1;
+}
+
+#endif
+
+static long
+elapsed_usec(
+    struct timeval *from,
+    struct timeval *to)
+{
+    return (to->tv_sec - from->tv_sec) * 1000000L + (to->tv_usec - from->tv_usec);
+}
+
+static long
+max_rss_kb(
+    void)
+{
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return usage.ru_maxrss;
+}
+
+static void
+print_memory(
+    const char *who,
+    long       nb_allocs_start,
+    int        nb_transactions)
+{
+#ifdef BENCH_COUNT_ALLOCS
+    long n = nb_allocs - nb_allocs_start;
+
+    printf("%s: %ld osip allocations", who, n);
+    if (nb_transactions > 0)
+        printf(" (%.1f per transaction)", (double) n / nb_transactions);
+    printf(", osip heap high-water %ld kB", heap_peak / 1024);
+#else
+    printf("%s: osip allocations not counted", who);
+#endif
+    printf(", max RSS %ld kB\n", max_rss_kb());
+}
+
+static int
+compare_latency(
+    const void *a,
+    const void *b)
+{
+    unsigned int la = *(const unsigned int *) a;
+    unsigned int lb = *(const unsigned int *) b;
+
+    return (la > lb) - (la < lb);
+}
+
+static double
+percentile(
+    bench_stats_t *stats,
+    int           pct)
+{
+    int i;
+
+    if (stats->nb_latencies == 0)
+        return 0;
+    i = (stats->nb_latencies * pct + 99) / 100 - 1;
+    if (i < 0)
+        i = 0;
+    return stats->latencies[i] / 1000.0;
+}
+
+static void
+add_latency(
+    bench_stats_t *stats,
+    bench_slot_t  *slot,
+    int           nb_messages)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    stats->latencies[stats->nb_latencies++] =
+        (unsigned int) elapsed_usec(&slot->start, &now);
+    stats->nb_transactions++;
+    stats->nb_messages += nb_messages;
+    slot->start = now;
+}
+
+static int
+listen_transport(
+    int transport,
+    int port)
+{
+    int i = eXosip_listen_addr(transport, NULL, port, AF_INET, 0);
+
+    if (i != 0)
+        fprintf(stderr, PROG_NAME ": cannot listen on port %i\n", port);
+    return i;
+}
+
+/*
+ * Server side
+ */
+
+static void
+uas_signal(
+    int sig)
+{
+    stop_uas = 1;
+}
+
+static void
+uas_answer(
+    eXosip_event_t *je,
+    int            *nb_requests)
+{
+    osip_message_t *answer = NULL;
+
+    switch (je->type)
+    {
+    case EXOSIP_MESSAGE_NEW:   /* REGISTER and MESSAGE */
+        if (eXosip_message_build_answer(je->tid, 200, &answer) == 0)
+            eXosip_message_send_answer(je->tid, 200, answer);
+        (*nb_requests)++;
+        break;
+    case EXOSIP_CALL_INVITE:
+        if (eXosip_call_build_answer(je->tid, 200, &answer) == 0)
+            eXosip_call_send_answer(je->tid, 200, answer);
+        (*nb_requests)++;
+        break;
+    case EXOSIP_CALL_ACK:
+        (*nb_requests)++;
+        break;
+    case EXOSIP_CALL_CLOSED:   /* BYE, already answered by eXosip */
+        (*nb_requests)++;
+        break;
+#ifndef MINISIZE
+    case EXOSIP_IN_SUBSCRIPTION_NEW:
+        if (eXosip_insubscription_build_answer(je->tid, 200, &answer) == 0)
+            eXosip_insubscription_send_answer(je->tid, 200, answer);
+        /* nothing is notified: drop the dialog right away */
+        eXosip_insubscription_remove(je->did);
+        (*nb_requests)++;
+        break;
+#endif
+    default:
+        break;
+    }
+}
+
+static int
+run_uas(
+    int transport,
+    int port,
+    int ready_fd)
+{
+    eXosip_event_t *events[BENCH_MAX_EVENTS];
+    int            nb_requests = 0;
+    long           allocs_start;
+    int            n, i;
+
+    if (eXosip_init() != 0)
+        return -1;
+    if (listen_transport(transport, port) != 0)
+    {
+        eXosip_quit();
+        return -1;
+    }
+    eXosip_set_user_agent(UA_STRING);
+
+    signal(SIGINT,  uas_signal);
+    signal(SIGTERM, uas_signal);
+
+    if (ready_fd >= 0)
+    {
+        write(ready_fd, "r", 1);
+        close(ready_fd);
+    }
+
+#ifdef BENCH_COUNT_ALLOCS
+    allocs_start = nb_allocs;
+#else
+    allocs_start = 0;
+#endif
+    while (!stop_uas)
+    {
+        n = eXosip_event_wait_batch(events, BENCH_MAX_EVENTS, 0, 100);
+#ifndef OSIP_MT
+        eXosip_execute();
+#endif
+        if (n <= 0)
+            continue;
+        eXosip_lock();
+        for (i = 0; i < n; i++)
+            uas_answer(events[i], &nb_requests);
+        eXosip_unlock();
+        for (i = 0; i < n; i++)
+            eXosip_event_free(events[i]);
+    }
+
+    printf("server: %i requests received\n", nb_requests);
+    print_memory("server", allocs_start, nb_requests);
+    fflush(stdout);
+    eXosip_quit();
+    return 0;
+}
+
+/*
+ * Client side
+ */
+
+/* the slot of a transaction is the number in the user part of From */
+static bench_slot_t *
+uac_find_slot(
+    bench_slot_t   *slots,
+    int            nb_slots,
+    eXosip_event_t *je)
+{
+    osip_message_t *req = je->request;
+    int            i;
+
+    if (req == NULL || req->from == NULL || req->from->url == NULL
+        || req->from->url->username == NULL
+        || strncmp(req->from->url->username, "bench", 5) != 0)
+        return NULL;
+    i = atoi(req->from->url->username + 5);
+    if (i < 0 || i >= nb_slots)
+        return NULL;
+    return &slots[i];
+}
+
+static int
+uac_start(
+    int          scenario,
+    bench_slot_t *slot,
+    int          index,
+    const char   *to,
+    const char   *route,
+    const char   *local)
+{
+    osip_message_t *request = NULL;
+    char           from[256];
+    int            i;
+
+    snprintf(from, sizeof(from), "sip:bench%i@%s", index, local);
+    gettimeofday(&slot->start, NULL);
+    slot->state = SLOT_REQUEST;
+
+    switch (scenario)
+    {
+    case BENCH_REGISTER:
+        if (slot->rid > 0)
+            return eXosip_register_send_register(slot->rid, NULL);
+        slot->rid = eXosip_register_build_initial_register(from, route, NULL,
+                                                           3600, &request);
+        if (slot->rid < 1)
+            return -1;
+        return eXosip_register_send_register(slot->rid, request);
+    case BENCH_MESSAGE:
+        i = eXosip_message_build_request(&request, "MESSAGE", to, from, route);
+        if (i != 0)
+            return i;
+        osip_message_set_content_type(request, "text/plain");
+        osip_message_set_body(request, "benchmark", 9);
+        return eXosip_message_send_request(request);
+    case BENCH_INVITE:
+        i = eXosip_call_build_initial_invite(&request, to, from, route,
+                                             "benchmark");
+        if (i != 0)
+            return i;
+        i = eXosip_call_send_initial_invite(request);
+        return i > 0 ? 0 : -1;
+#ifndef MINISIZE
+    case BENCH_SUBSCRIBE:
+        i = eXosip_subscribe_build_initial_request(&request, to, from, route,
+                                                   "presence", 600);
+        if (i != 0)
+            return i;
+        i = eXosip_subscribe_send_initial_request(request);
+        return i > 0 ? 0 : -1;
+#endif
+    }
+    return -1;
+}
+
+/* returns 1 when the scenario of the slot is complete */
+static int
+uac_process(
+    int            scenario,
+    bench_slot_t   *slot,
+    eXosip_event_t *je,
+    bench_stats_t  *stats)
+{
+    osip_message_t *ack = NULL;
+
+    switch (je->type)
+    {
+    case EXOSIP_REGISTRATION_SUCCESS:
+    case EXOSIP_MESSAGE_ANSWERED:
+    case EXOSIP_CALL_MESSAGE_ANSWERED:   /* BYE */
+        add_latency(stats, slot, 2);
+        return 1;
+#ifndef MINISIZE
+    case EXOSIP_SUBSCRIPTION_ANSWERED:
+        add_latency(stats, slot, 2);
+        eXosip_subscribe_remove(je->did);
+        return 1;
+#endif
+    case EXOSIP_CALL_ANSWERED:
+        if (slot->state != SLOT_REQUEST)
+            return 0;   /* retransmitted 200 */
+        add_latency(stats, slot, 3);
+        if (eXosip_call_build_ack(je->did, &ack) == 0)
+            eXosip_call_send_ack(je->did, ack);
+        slot->state = SLOT_BYE;
+        if (eXosip_call_terminate(je->cid, je->did) != 0)
+        {
+            stats->nb_errors++;
+            return 1;
+        }
+        return 0;
+    case EXOSIP_REGISTRATION_FAILURE:
+    case EXOSIP_MESSAGE_REQUESTFAILURE:
+    case EXOSIP_MESSAGE_SERVERFAILURE:
+    case EXOSIP_MESSAGE_GLOBALFAILURE:
+    case EXOSIP_CALL_NOANSWER:
+    case EXOSIP_CALL_REQUESTFAILURE:
+    case EXOSIP_CALL_SERVERFAILURE:
+    case EXOSIP_CALL_GLOBALFAILURE:
+    case EXOSIP_CALL_MESSAGE_REQUESTFAILURE:
+    case EXOSIP_CALL_MESSAGE_SERVERFAILURE:
+    case EXOSIP_CALL_MESSAGE_GLOBALFAILURE:
+    case EXOSIP_SUBSCRIPTION_NOANSWER:
+    case EXOSIP_SUBSCRIPTION_REQUESTFAILURE:
+    case EXOSIP_SUBSCRIPTION_SERVERFAILURE:
+    case EXOSIP_SUBSCRIPTION_GLOBALFAILURE:
+        stats->nb_errors++;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static void
+uac_report(
+    int           scenario,
+    int           transport,
+    int           concurrency,
+    bench_stats_t *stats,
+    long          allocs_start)
+{
+    double secs = elapsed_usec(&stats->start, &stats->end) / 1000000.0;
+
+    if (secs <= 0)
+        secs = 0.000001;
+    qsort(stats->latencies, stats->nb_latencies, sizeof(unsigned int),
+          compare_latency);
+
+    printf("scenario %s over %s, concurrency %i\n", scenario_names[scenario],
+           transport == IPPROTO_TCP ? "tcp" : "udp", concurrency);
+    printf("client: %i transactions, %i errors in %.3f s\n",
+           stats->nb_transactions, stats->nb_errors, secs);
+    printf("client: %.0f transactions/s, %.0f messages/s\n",
+           stats->nb_transactions / secs, stats->nb_messages / secs);
+    printf("client: latency ms min %.3f p50 %.3f p90 %.3f p99 %.3f max %.3f\n",
+           percentile(stats, 0), percentile(stats, 50), percentile(stats, 90),
+           percentile(stats, 99), percentile(stats, 100));
+    print_memory("client", allocs_start, stats->nb_transactions);
+    fflush(stdout);
+}
+
+static int
+run_uac(
+    int        scenario,
+    int        transport,
+    int        number,
+    int        concurrency,
+    const char *remote,
+    int        port,
+    int        local_port)
+{
+    eXosip_event_t *events[BENCH_MAX_EVENTS];
+    bench_slot_t   *slots;
+    bench_stats_t  stats;
+    char           to[256];
+    char           route[256];
+    char           local[64];
+    const char     *params = transport == IPPROTO_TCP ? ";transport=tcp" : "";
+    int            started  = 0;
+    int            finished = 0;
+    long           allocs_start;
+    struct timeval last_event;
+    struct timeval now;
+    int            n, i;
+
+    slots = (bench_slot_t *) calloc(concurrency, sizeof(bench_slot_t));
+    memset(&stats, 0, sizeof(stats));
+    /* an INVITE scenario is made of two transactions */
+    stats.latencies = (unsigned int *) calloc(2 * number, sizeof(unsigned int));
+    if (slots == NULL || stats.latencies == NULL)
+        return -1;
+
+    snprintf(to, sizeof(to), "sip:bench@%s:%i%s", remote, port, params);
+    snprintf(route, sizeof(route), "sip:%s:%i%s", remote, port, params);
+    snprintf(local, sizeof(local), "127.0.0.1:%i", local_port);
+
+    if (eXosip_init() != 0)
+        return -1;
+    if (listen_transport(transport, local_port) != 0)
+    {
+        eXosip_quit();
+        return -1;
+    }
+    eXosip_set_user_agent(UA_STRING);
+
+#ifdef BENCH_COUNT_ALLOCS
+    allocs_start = nb_allocs;
+#else
+    allocs_start = 0;
+#endif
+    gettimeofday(&stats.start, NULL);
+    last_event = stats.start;
+
+    eXosip_lock();
+    for (; started < concurrency && started < number; started++)
+    {
+        if (uac_start(scenario, &slots[started], started, to, route, local) != 0)
+        {
+            stats.nb_errors++;
+            finished++;
+        }
+    }
+    eXosip_unlock();
+
+    while (finished < number)
+    {
+        n = eXosip_event_wait_batch(events, BENCH_MAX_EVENTS, 0, 100);
+#ifndef OSIP_MT
+        eXosip_execute();
+#endif
+        gettimeofday(&now, NULL);
+        if (n <= 0)
+        {
+            if (elapsed_usec(&last_event, &now) > BENCH_IDLE_TIMEOUT * 1000000L)
+            {
+                fprintf(stderr, PROG_NAME ": no answer for %i s, %i scenarios lost\n",
+                        BENCH_IDLE_TIMEOUT, started - finished);
+                stats.nb_errors += started - finished;
+                break;
+            }
+            continue;
+        }
+        last_event = now;
+
+        eXosip_lock();
+        for (i = 0; i < n; i++)
+        {
+            bench_slot_t *slot = uac_find_slot(slots, concurrency, events[i]);
+
+            if (slot == NULL || slot->state == SLOT_IDLE)
+                continue;
+            if (!uac_process(scenario, slot, events[i], &stats))
+                continue;
+            slot->state = SLOT_IDLE;
+            finished++;
+            if (started < number)
+            {
+                if (uac_start(scenario, slot, (int) (slot - slots), to, route,
+                              local) != 0)
+                {
+                    stats.nb_errors++;
+                    finished++;
+                }
+                started++;
+            }
+        }
+        eXosip_automatic_action();
+        eXosip_unlock();
+        for (i = 0; i < n; i++)
+            eXosip_event_free(events[i]);
+    }
+    gettimeofday(&stats.end, NULL);
+
+    uac_report(scenario, transport, concurrency, &stats, allocs_start);
+
+    eXosip_quit();
+    free(stats.latencies);
+    free(slots);
+    return stats.nb_errors == 0 ? 0 : 1;
+}
+
+int
+main(
+    int  argc,
+    char *argv[])
+{
+    int        c, i;
+    const char *mode       = "both";
+    int        scenario    = BENCH_REGISTER;
+    int        transport   = IPPROTO_UDP;
+    int        number      = 10000;
+    int        concurrency = 50;
+    const char *remote     = "127.0.0.1";
+    int        port        = 5070;
+    int        local_port  = 0;
+    int        debug       = 0;
+    int        ready[2];
+    pid_t      uas         = 0;
+    int        ret;
+
+    for (;;)
+    {
+    #define short_options "m:s:t:n:c:r:p:l:dh"
+        int                  option_index   = 0;
+        static struct option long_options[] = {
+            {"mode",        required_argument, NULL, 'm'},
+            {"scenario",    required_argument, NULL, 's'},
+            {"transport",   required_argument, NULL, 't'},
+            {"number",      required_argument, NULL, 'n'},
+            {"concurrency", required_argument, NULL, 'c'},
+            {"remote",      required_argument, NULL, 'r'},
+            {"port",        required_argument, NULL, 'p'},
+            {"localport",   required_argument, NULL, 'l'},
+            {"debug",       no_argument,       NULL, 'd'},
+            {"help",        no_argument,       NULL, 'h'},
+            {NULL,          0,                 NULL, 0}
+        };
+
+        c = getopt_long(argc, argv, short_options, long_options, &option_index);
+        if (c == -1)
+            break;
+
+        switch (c)
+        {
+        case 'm':
+            mode = optarg;
+            break;
+        case 's':
+            for (i = 0; i < 4; i++)
+            {
+                if (strcmp(optarg, scenario_names[i]) == 0)
+                    break;
+            }
+            if (i == 4)
+            {
+                usage();
+                exit(1);
+            }
+            scenario = i;
+            break;
+        case 't':
+            transport = strcmp(optarg, "tcp") == 0 ? IPPROTO_TCP : IPPROTO_UDP;
+            break;
+        case 'n':
+            number      = atoi(optarg);
+            break;
+        case 'c':
+            concurrency = atoi(optarg);
+            break;
+        case 'r':
+            remote      = optarg;
+            break;
+        case 'p':
+            port        = atoi(optarg);
+            break;
+        case 'l':
+            local_port  = atoi(optarg);
+            break;
+        case 'd':
+            debug       = 1;
+            break;
+        case 'h':
+            usage();
+            exit(0);
+        default:
+            usage();
+            exit(1);
+        }
+    }
+
+    if (number < 1 || concurrency < 1
+        || (strcmp(mode, "uac") && strcmp(mode, "uas") && strcmp(mode, "both")))
+    {
+        usage();
+        exit(1);
+    }
+    if (local_port == 0)
+        local_port = port + 1;
+
+#ifdef BENCH_COUNT_ALLOCS
+    osip_set_allocators(bench_malloc, bench_realloc, bench_free);
+#endif
+    if (debug)
+        TRACE_INITIALIZE(6, NULL);
+
+    if (strcmp(mode, "uas") == 0)
+        return run_uas(transport, port, -1) == 0 ? 0 : 1;
+
+    if (strcmp(mode, "both") == 0)
+    {
+        char r;
+
+        if (pipe(ready) != 0)
+            exit(1);
+        uas = fork();
+        if (uas < 0)
+            exit(1);
+        if (uas == 0)
+        {
+            close(ready[0]);
+            exit(run_uas(transport, port, ready[1]) == 0 ? 0 : 1);
+        }
+        close(ready[1]);
+        if (read(ready[0], &r, 1) != 1)
+        {
+            fprintf(stderr, PROG_NAME ": server failed to start\n");
+            waitpid(uas, NULL, 0);
+            exit(1);
+        }
+        close(ready[0]);
+    }
+
+    ret = run_uac(scenario, transport, number, concurrency, remote, port,
+                  local_port);
+
+    if (uas > 0)
+    {
+        kill(uas, SIGTERM);
+        waitpid(uas, NULL, 0);
+    }
+    return ret;
+}
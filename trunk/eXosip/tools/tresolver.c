@@ -0,0 +1,339 @@
+/*
+ * Test of the eXosip resolver cache against a stub DNS server
+ *
+ * This program is Free Software, released under the GNU General
+ * Public License v2.0 http://www.gnu.org/licenses/gpl
+ *
+ * A stub DNS server is started on the loopback interface and given to
+ * eXosip with EXOSIP_OPT_SET_DNS_SERVER. It answers:
+ *
+ *   multi.test  A 192.0.2.1, A 192.0.2.2   TTL 3600
+ *   short.test  A 192.0.2.3                TTL 2
+ *   slow.test   A 192.0.2.4                TTL 3600, after 300ms
+ *   (other)     NXDOMAIN
+ *
+ * and counts the queries of each name, to check the TTL of the cached
+ * addresses, the negative caching and that a name being resolved is
+ * queried once. Returns 0 when all the checks pass.
+ *
+ * Without OSIP_MT, there is no resolver thread and the test is skipped.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+
+#include <eXosip2/eXosip.h>
+
+/* internal functions of the library (src/eXosip2.h) */
+int _eXosip_resolver_addr(const char *name, int family, int wait,
+                          char ip[][65], int max);
+int eXosip_get_addrinfo(struct addrinfo **addrinfo, const char *hostname,
+                        int service, int protocol);
+
+#define STUB_MAX_NAMES 8
+
+struct stub_name
+{
+    const char *name;
+    const char *ip[2];
+    int        ttl;
+    int        delay_ms;
+    int        queries;
+};
+
+static struct stub_name stub_names[STUB_MAX_NAMES] = {
+    { "multi.test", { "192.0.2.1", "192.0.2.2" }, 3600, 0, 0 },
+    { "short.test", { "192.0.2.3", NULL }, 2, 0, 0 },
+    { "slow.test", { "192.0.2.4", NULL }, 3600, 300, 0 },
+    { "missing.test", { NULL, NULL }, 0, 0, 0 },
+    { "other.test", { NULL, NULL }, 0, 0, 0 },
+    { NULL, { NULL, NULL }, 0, 0, 0 }
+};
+
+static pthread_mutex_t stub_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int             stub_socket = -1;
+static volatile int    stub_stop;
+static int             failures;
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            fprintf(stderr, "%s:%i: check failed: %s\n", __FILE__,      \
+                    __LINE__, #cond);                                   \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+static int
+stub_queries(
+    const char *name)
+{
+    int i;
+    int n = -1;
+
+    pthread_mutex_lock(&stub_mutex);
+    for (i = 0; stub_names[i].name != NULL; i++)
+    {
+        if (strcmp(stub_names[i].name, name) == 0)
+            n = stub_names[i].queries;
+    }
+    pthread_mutex_unlock(&stub_mutex);
+    return n;
+}
+
+/* answer one query: A records of the known names, NXDOMAIN otherwise */
+static int
+stub_answer(
+    unsigned char *buf,
+    int           len)
+{
+    struct stub_name *entry = NULL;
+    char             name[256];
+    int              pos    = 12;
+    int              nlen   = 0;
+    int              qtype;
+    int              ancount = 0;
+    int              i;
+
+    if (len < 12 + 5)
+        return -1;
+    while (pos < len && buf[pos] != 0)
+    {
+        int label = buf[pos];
+
+        if (pos + 1 + label >= len || nlen + label + 1 >= (int) sizeof(name))
+            return -1;
+        if (nlen > 0)
+            name[nlen++] = '.';
+        memcpy(name + nlen, buf + pos + 1, label);
+        nlen += label;
+        pos  += 1 + label;
+    }
+    name[nlen] = '\0';
+    pos++;
+    if (pos + 4 > len)
+        return -1;
+    qtype = (buf[pos] << 8) | buf[pos + 1];
+    pos  += 4;                  /* end of the question */
+
+    pthread_mutex_lock(&stub_mutex);
+    for (i = 0; stub_names[i].name != NULL; i++)
+    {
+        if (strcasecmp(stub_names[i].name, name) == 0)
+        {
+            entry = &stub_names[i];
+            entry->queries++;
+        }
+    }
+    pthread_mutex_unlock(&stub_mutex);
+
+    if (entry != NULL && entry->delay_ms > 0)
+        usleep(entry->delay_ms * 1000);
+
+    buf[2] = 0x81;              /* QR, RD */
+    buf[3] = 0x80;              /* RA */
+    if (entry == NULL || entry->ip[0] == NULL)
+        buf[3] |= 3;            /* NXDOMAIN */
+    else if (qtype == 1)
+    {
+        for (i = 0; i < 2 && entry->ip[i] != NULL; i++)
+        {
+            unsigned char *rr = buf + pos;
+
+            rr[0]  = 0xc0;      /* name of the question */
+            rr[1]  = 12;
+            rr[2]  = 0;
+            rr[3]  = 1;         /* A */
+            rr[4]  = 0;
+            rr[5]  = 1;         /* IN */
+            rr[6]  = (entry->ttl >> 24) & 0xff;
+            rr[7]  = (entry->ttl >> 16) & 0xff;
+            rr[8]  = (entry->ttl >> 8) & 0xff;
+            rr[9]  = entry->ttl & 0xff;
+            rr[10] = 0;
+            rr[11] = 4;
+            inet_pton(AF_INET, entry->ip[i], rr + 12);
+            pos   += 16;
+            ancount++;
+        }
+    }
+    buf[6]  = 0;
+    buf[7]  = ancount;
+    buf[8]  = 0;                /* no authority */
+    buf[9]  = 0;
+    buf[10] = 0;                /* no additional records */
+    buf[11] = 0;
+    return pos;
+}
+
+static void *
+stub_server(
+    void *arg)
+{
+    while (!stub_stop)
+    {
+        unsigned char      buf[512];
+        struct sockaddr_in from;
+        socklen_t          fromlen = sizeof(from);
+        struct timeval     tv;
+        fd_set             fds;
+        int                len;
+
+        FD_ZERO(&fds);
+        FD_SET(stub_socket, &fds);
+        tv.tv_sec  = 0;
+        tv.tv_usec = 100000;
+        if (select(stub_socket + 1, &fds, NULL, NULL, &tv) <= 0)
+            continue;
+        len = recvfrom(stub_socket, buf, 256, 0, (struct sockaddr *) &from,
+                       &fromlen);
+        if (len <= 0)
+            continue;
+        len = stub_answer(buf, len);
+        if (len > 0)
+            sendto(stub_socket, buf, len, 0, (struct sockaddr *) &from, fromlen);
+    }
+    return NULL;
+}
+
+static int
+stub_start(
+    pthread_t *thread)
+{
+    struct sockaddr_in addr;
+    socklen_t          addrlen = sizeof(addr);
+
+    stub_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (stub_socket < 0)
+        return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(stub_socket, (struct sockaddr *) &addr, sizeof(addr)) != 0
+        || getsockname(stub_socket, (struct sockaddr *) &addr, &addrlen) != 0
+        || pthread_create(thread, NULL, stub_server, NULL) != 0)
+    {
+        close(stub_socket);
+        return -1;
+    }
+    return ntohs(addr.sin_port);
+}
+
+/* resolve without waiting, as the transactions do, until the answer */
+static int
+resolve(
+    const char *name,
+    char       ip[][65])
+{
+    int n;
+    int i;
+
+    for (i = 0; i < 300; i++)
+    {
+        n = _eXosip_resolver_addr(name, AF_INET, 0, ip, 8);
+        if (n != 0)
+            return n;
+        usleep(10000);
+    }
+    return 0;
+}
+
+int
+main(
+    int  argc,
+    char *argv[])
+{
+    pthread_t       thread;
+    char            server[32];
+    char            ip[8][65];
+    struct addrinfo *addrinfo = NULL;
+    struct addrinfo *elem;
+    int             port;
+    int             n;
+
+#ifndef OSIP_MT
+    printf("tresolver: skipped (no resolver thread without OSIP_MT)\n");
+    return 0;
+#endif
+    if (eXosip_init() != 0)
+    {
+        fprintf(stderr, "eXosip_init failed\n");
+        return 1;
+    }
+    port = stub_start(&thread);
+    if (port < 0)
+    {
+        fprintf(stderr, "cannot start the stub DNS server\n");
+        eXosip_quit();
+        return 1;
+    }
+    snprintf(server, sizeof(server), "127.0.0.1:%i", port);
+    eXosip_set_option(EXOSIP_OPT_SET_DNS_SERVER, server);
+
+    /* all the addresses, kept for their TTL */
+    n = resolve("multi.test", ip);
+    CHECK(n == 2);
+    CHECK(n == 2 && strcmp(ip[0], "192.0.2.1") == 0 && strcmp(ip[1], "192.0.2.2") == 0);
+    CHECK(stub_queries("multi.test") == 1);
+
+    /* a name being resolved is queried once */
+    CHECK(_eXosip_resolver_addr("slow.test", AF_INET, 0, ip, 8) == 0);
+    CHECK(_eXosip_resolver_addr("slow.test", AF_INET, 0, ip, 8) == 0);
+    CHECK(resolve("slow.test", ip) == 1);
+    CHECK(stub_queries("slow.test") == 1);
+
+    /* TTL expiry */
+    CHECK(resolve("short.test", ip) == 1);
+    CHECK(_eXosip_resolver_addr("short.test", AF_INET, 0, ip, 8) == 1);
+    CHECK(stub_queries("short.test") == 1);
+    sleep(3);
+    CHECK(_eXosip_resolver_addr("short.test", AF_INET, 0, ip, 8) == 0);
+    CHECK(resolve("short.test", ip) == 1);
+    CHECK(stub_queries("short.test") == 2);
+    CHECK(_eXosip_resolver_addr("multi.test", AF_INET, 0, ip, 8) == 2);
+    CHECK(stub_queries("multi.test") == 1);
+
+    /* negative caching */
+    CHECK(resolve("missing.test", ip) < 0);
+    CHECK(_eXosip_resolver_addr("missing.test", AF_INET, 0, ip, 8) < 0);
+    CHECK(stub_queries("missing.test") == 1);
+
+    /* synchronous callers get all the cached addresses */
+    CHECK(eXosip_get_addrinfo(&addrinfo, "multi.test", 5060, IPPROTO_UDP) == 0);
+    for (n = 0, elem = addrinfo; elem != NULL; elem = elem->ai_next)
+        n++;
+    CHECK(n == 2);
+    if (addrinfo != NULL)
+        freeaddrinfo(addrinfo);
+    CHECK(stub_queries("multi.test") == 1);
+
+    /* clearing the option gives the system servers back */
+    eXosip_set_option(EXOSIP_OPT_SET_DNS_SERVER, NULL);
+    _eXosip_resolver_addr("other.test", AF_INET, 0, ip, 8);
+    usleep(500000);
+    CHECK(stub_queries("other.test") == 0);
+
+    eXosip_quit();
+    stub_stop = 1;
+    pthread_join(thread, NULL);
+    close(stub_socket);
+
+    if (failures > 0)
+    {
+        fprintf(stderr, "tresolver: %i check(s) failed\n", failures);
+        return 1;
+    }
+    printf("tresolver: ok\n");
+    return 0;
+}
@@ -32,6 +32,8 @@ static int media_parameters_changed(
 {
     if (call->params.in_conference != call->current_params.in_conference) return SAL_MEDIA_DESCRIPTION_CHANGED;
     if (call->up_bw != linphone_core_get_upload_bandwidth(call->core)) return SAL_MEDIA_DESCRIPTION_CHANGED;
+    /*the SAL hands the previous result back when a re-INVITE repeats the same offer*/
+    if (oldmd == newmd) return SAL_MEDIA_DESCRIPTION_UNCHANGED;
     return sal_media_description_equals(oldmd, newmd);
 }
 
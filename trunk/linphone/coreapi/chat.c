@@ -32,6 +32,112 @@
  * @{
  */
 
+/**
+ * Set the path of the sqlite database where chat messages and call logs are stored.
+ * Call logs found in the config file are moved into it.
+ * @param lc #LinphoneCore object
+ * @param path database file, or NULL to stop using one
+ */
+void linphone_core_set_chat_database_path(
+    LinphoneCore *lc, const char *path)
+{
+    linphone_core_message_storage_close(lc);
+    if (lc->chat_db_file)
+    {
+        ms_free(lc->chat_db_file);
+        lc->chat_db_file = NULL;
+    }
+    if (path)
+    {
+        lc->chat_db_file = ms_strdup(path);
+        linphone_core_message_storage_init(lc);
+    }
+}
+
+/*
+ * lc->chatrooms is indexed by the username of the peer, the only field
+ * linphone_chat_room_matches() compares, so that an incoming MESSAGE finds its
+ * room without walking the list. Rooms are kept in each bucket in list order,
+ * the first room created for a peer wins as before.
+ */
+#define CHAT_ROOM_INDEX_MIN_BUCKETS 32
+
+static unsigned int chat_room_peer_hash(
+    const char *username)
+{
+    unsigned int hash = 5381;
+    for (; *username != '\0'; username++)
+        hash = hash * 33 + (unsigned char)*username;
+    return hash;
+}
+
+static void chat_room_index_insert(
+    LinphoneChatRoomIndex *index, LinphoneChatRoom *cr)
+{
+    LinphoneChatRoom **tail = &index->buckets[cr->peer_hash % index->nb_buckets];
+    while (*tail != NULL)
+        tail = &(*tail)->hash_next;
+    cr->hash_next = NULL;
+    *tail         = cr;
+}
+
+static void linphone_core_index_chat_room(
+    LinphoneCore *lc, LinphoneChatRoom *cr)
+{
+    LinphoneChatRoomIndex *index    = &lc->chatroom_index;
+    const char            *username = linphone_address_get_username(cr->peer_url);
+    MSList                *elem;
+
+    if (username == NULL)
+        return; /* cannot match any address, see linphone_chat_room_matches() */
+    cr->peer_hash = chat_room_peer_hash(username);
+    cr->indexed   = TRUE;
+    index->count++;
+    if (index->nb_buckets == 0 || index->count > 2 * index->nb_buckets)
+    {
+        /* rebuild from the list so that buckets keep the list order */
+        if (index->buckets) ms_free(index->buckets);
+        index->nb_buckets = index->nb_buckets ? 2 * index->nb_buckets : CHAT_ROOM_INDEX_MIN_BUCKETS;
+        index->buckets    = ms_new0(LinphoneChatRoom *, index->nb_buckets);
+        for (elem = lc->chatrooms; elem != NULL; elem = ms_list_next(elem))
+        {
+            LinphoneChatRoom *it = (LinphoneChatRoom *)elem->data;
+            if (it->indexed)
+                chat_room_index_insert(index, it);
+        }
+    }
+    else chat_room_index_insert(index, cr);
+}
+
+static void linphone_core_unindex_chat_room(
+    LinphoneCore *lc, LinphoneChatRoom *cr)
+{
+    LinphoneChatRoomIndex *index = &lc->chatroom_index;
+    LinphoneChatRoom      **prev;
+
+    if (!cr->indexed)
+        return;
+    for (prev = &index->buckets[cr->peer_hash % index->nb_buckets]; *prev != NULL; prev = &(*prev)->hash_next)
+    {
+        if (*prev == cr)
+        {
+            *prev = cr->hash_next;
+            break;
+        }
+    }
+    cr->hash_next = NULL;
+    cr->indexed   = FALSE;
+    index->count--;
+}
+
+void linphone_core_free_chat_room_index(
+    LinphoneCore *lc)
+{
+    if (lc->chatroom_index.buckets)
+        ms_free(lc->chatroom_index.buckets);
+    memset(&lc->chatroom_index, 0, sizeof(LinphoneChatRoomIndex));
+}
+
 /**
  * Create a new chat room for messaging from a sip uri like sip:joe@sip.linphone.org
  * @param lc #LinphoneCore object
@@ -50,6 +156,7 @@ LinphoneChatRoom *linphone_core_create_chat_room(
         cr->peer      = linphone_address_as_string(parsed_url);
         cr->peer_url  = parsed_url;
         lc->chatrooms = ms_list_append(lc->chatrooms, (void *)cr);
+        linphone_core_index_chat_room(lc, cr);
         return cr;
     }
     return NULL;
@@ -63,6 +170,7 @@ void linphone_chat_room_destroy(
     LinphoneChatRoom *cr)
 {
     LinphoneCore *lc = cr->lc;
+    linphone_core_unindex_chat_room(lc, cr);
     lc->chatrooms = ms_list_remove(lc->chatrooms, (void *) cr);
     linphone_address_destroy(cr->peer_url);
     ms_free(cr->peer);
@@ -160,16 +268,19 @@ void linphone_chat_room_message_received(
 LinphoneChatRoom *linphone_core_get_chat_room(
     LinphoneCore *lc, const LinphoneAddress *addr)
 {
-    LinphoneChatRoom *cr = NULL;
-    MSList           *elem;
-    for (elem = lc->chatrooms; elem != NULL; elem = ms_list_next(elem))
+    LinphoneChatRoom *cr       = NULL;
+    const char       *username = linphone_address_get_username(addr);
+    unsigned int     hash;
+
+    if (username == NULL || lc->chatroom_index.nb_buckets == 0)
+        return NULL;
+    hash = chat_room_peer_hash(username);
+    for (cr = lc->chatroom_index.buckets[hash % lc->chatroom_index.nb_buckets]; cr != NULL; cr = cr->hash_next)
     {
-        cr = (LinphoneChatRoom *)elem->data;
-        if (linphone_chat_room_matches(cr, addr))
+        if (cr->peer_hash == hash && linphone_chat_room_matches(cr, addr))
         {
             break;
         }
-        cr = NULL;
     }
     return cr;
 }
@@ -179,20 +290,18 @@ void linphone_core_message_received(
 {
     LinphoneChatRoom      *cr = NULL;
     LinphoneAddress       *addr;
-    char                  *cleanfrom;
-    char                  *from;
     LinphoneChatMessage   *msg;
     const SalCustomHeader *ch;
 
-    addr      = linphone_address_new(sal_msg->from);
+    addr = linphone_address_new(sal_msg->from);
     linphone_address_clean(addr);
-    cr        = linphone_core_get_chat_room(lc, addr);
-    cleanfrom = linphone_address_as_string(addr);
-    from      = linphone_address_as_string_uri_only(addr);
+    cr   = linphone_core_get_chat_room(lc, addr);
     if (cr == NULL)
     {
         /* create a new chat room */
+        char *cleanfrom = linphone_address_as_string(addr);
         cr = linphone_core_create_chat_room(lc, cleanfrom);
+        ms_free(cleanfrom);
     }
     msg = linphone_chat_room_create_message(cr, sal_msg->text);
     linphone_chat_message_set_from(msg, cr->peer_url);
@@ -216,8 +325,6 @@ void linphone_core_message_received(
     linphone_address_destroy(addr);
     linphone_chat_message_store(msg);
     linphone_chat_room_message_received(cr, lc, msg);
-    ms_free(cleanfrom);
-    ms_free(from);
 }
 
 /**
@@ -499,6 +606,8 @@ LinphoneChatMessage *linphone_chat_message_clone(
     new_message->cb               = msg->cb;
     new_message->time             = msg->time;
     new_message->state            = msg->state;
+    new_message->storage_id       = msg->storage_id;
+    if (msg->pending_row) linphone_chat_message_storage_share(msg, new_message);
     if (msg->from) new_message->from = linphone_address_clone(msg->from);
     return new_message;
 }
@@ -509,6 +618,7 @@ LinphoneChatMessage *linphone_chat_message_clone(
 void linphone_chat_message_destroy(
     LinphoneChatMessage *msg)
 {
+    if (msg->pending_row) linphone_chat_message_storage_forget(msg);
     if (msg->message) ms_free(msg->message);
     if (msg->external_body_url) ms_free(msg->external_body_url);
     if (msg->from) linphone_address_destroy(msg->from);
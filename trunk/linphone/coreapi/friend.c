@@ -25,6 +25,7 @@
 #include "linphonecore.h"
 #include "private.h"
 #include "lpconfig.h"
+#include <ctype.h>
 #include "Ext\libMemLeakDetection.h"
 
 const char *linphone_online_status_to_string(
@@ -93,26 +94,217 @@ MSList *linphone_find_friend(
     return res;
 }
 
-LinphoneFriend *linphone_find_friend_by_inc_subscribe(
-    MSList *l, SalOp *op)
+/*
+ * lc->friends is indexed by address (username and domain, case insensitive)
+ * and by the incoming and outgoing subscription ops, so that presence
+ * requests and notifications do not walk the whole friend list.
+ */
+#define FRIEND_INDEX_MIN_BUCKETS 64
+
+static unsigned int friend_address_hash(
+    const LinphoneAddress *addr)
 {
-    MSList *elem;
-    for (elem = l; elem != NULL; elem = elem->next)
+    const char   *str;
+    unsigned int hash = 5381;
+    if ((str = linphone_address_get_username(addr)) != NULL)
     {
-        LinphoneFriend *lf = (LinphoneFriend *)elem->data;
-        if (lf->insub == op) return lf;
+        for (; *str != '\0'; str++)
+            hash = hash * 33 + (unsigned int)tolower((unsigned char)*str);
+    }
+    hash = hash * 33 + '@';
+    if ((str = linphone_address_get_domain(addr)) != NULL)
+    {
+        for (; *str != '\0'; str++)
+            hash = hash * 33 + (unsigned int)tolower((unsigned char)*str);
+    }
+    return hash;
+}
+
+static unsigned int friend_op_hash(
+    const SalOp *op)
+{
+    return (unsigned int)(((uintptr_t)op >> 4) * 2654435761U);
+}
+
+/* entries are appended so that a bucket keeps the insertion order */
+static void friend_bucket_append(
+    LinphoneFriendIndexEntry **bucket, LinphoneFriendIndexEntry *entry)
+{
+    while (*bucket != NULL)
+        bucket = &(*bucket)->next;
+    entry->next = NULL;
+    *bucket     = entry;
+}
+
+static void friend_index_resize(
+    LinphoneFriendIndex *index, int nb_buckets)
+{
+    LinphoneFriendIndexEntry **buckets = ms_new0(LinphoneFriendIndexEntry *, nb_buckets);
+    int                      i;
+    for (i = 0; i < index->nb_buckets; i++)
+    {
+        LinphoneFriendIndexEntry *entry = index->buckets[i];
+        while (entry != NULL)
+        {
+            LinphoneFriendIndexEntry *next = entry->next;
+            friend_bucket_append(&buckets[entry->hash % nb_buckets], entry);
+            entry = next;
+        }
+    }
+    if (index->buckets)
+        ms_free(index->buckets);
+    index->buckets    = buckets;
+    index->nb_buckets = nb_buckets;
+}
+
+static void friend_index_add(
+    LinphoneFriendIndex *index, unsigned int hash, LinphoneFriend *lf)
+{
+    LinphoneFriendIndexEntry *entry;
+    if (index->nb_buckets == 0)
+        friend_index_resize(index, FRIEND_INDEX_MIN_BUCKETS);
+    else if (index->count >= 2 * index->nb_buckets)
+        friend_index_resize(index, 2 * index->nb_buckets);
+    entry       = ms_new0(LinphoneFriendIndexEntry, 1);
+    entry->hash = hash;
+    entry->lf   = lf;
+    friend_bucket_append(&index->buckets[hash % index->nb_buckets], entry);
+    index->count++;
+}
+
+static void friend_index_remove(
+    LinphoneFriendIndex *index, unsigned int hash, LinphoneFriend *lf)
+{
+    LinphoneFriendIndexEntry **prev;
+    if (index->nb_buckets == 0)
+        return;
+    for (prev = &index->buckets[hash % index->nb_buckets]; *prev != NULL; prev = &(*prev)->next)
+    {
+        LinphoneFriendIndexEntry *entry = *prev;
+        if (entry->lf == lf && entry->hash == hash)
+        {
+            *prev = entry->next;
+            ms_free(entry);
+            index->count--;
+            return;
+        }
+    }
+}
+
+static LinphoneFriendIndexEntry *friend_index_bucket(
+    const LinphoneFriendIndex *index, unsigned int hash)
+{
+    if (index->nb_buckets == 0)
+        return NULL;
+    return index->buckets[hash % index->nb_buckets];
+}
+
+static void friend_index_free(
+    LinphoneFriendIndex *index)
+{
+    int i;
+    for (i = 0; i < index->nb_buckets; i++)
+    {
+        LinphoneFriendIndexEntry *entry = index->buckets[i];
+        while (entry != NULL)
+        {
+            LinphoneFriendIndexEntry *next = entry->next;
+            ms_free(entry);
+            entry = next;
+        }
+    }
+    if (index->buckets)
+        ms_free(index->buckets);
+    memset(index, 0, sizeof(LinphoneFriendIndex));
+}
+
+static void linphone_core_index_friend(
+    LinphoneCore *lc, LinphoneFriend *lf)
+{
+    lf->indexed_in = lc;
+    friend_index_add(&lc->friends_by_address, friend_address_hash(lf->uri), lf);
+    if (lf->insub)
+        friend_index_add(&lc->friends_by_insub, friend_op_hash(lf->insub), lf);
+    if (lf->outsub)
+        friend_index_add(&lc->friends_by_outsub, friend_op_hash(lf->outsub), lf);
+}
+
+static void linphone_core_unindex_friend(
+    LinphoneCore *lc, LinphoneFriend *lf)
+{
+    friend_index_remove(&lc->friends_by_address, friend_address_hash(lf->uri), lf);
+    if (lf->insub)
+        friend_index_remove(&lc->friends_by_insub, friend_op_hash(lf->insub), lf);
+    if (lf->outsub)
+        friend_index_remove(&lc->friends_by_outsub, friend_op_hash(lf->outsub), lf);
+    lf->indexed_in = NULL;
+}
+
+void linphone_core_free_friend_indexes(
+    LinphoneCore *lc)
+{
+    friend_index_free(&lc->friends_by_address);
+    friend_index_free(&lc->friends_by_insub);
+    friend_index_free(&lc->friends_by_outsub);
+}
+
+void linphone_friend_set_insub(
+    LinphoneFriend *lf, SalOp *op)
+{
+    LinphoneCore *lc = lf->indexed_in;
+    if (lc != NULL && lf->insub != NULL)
+        friend_index_remove(&lc->friends_by_insub, friend_op_hash(lf->insub), lf);
+    lf->insub = op;
+    if (lc != NULL && op != NULL)
+        friend_index_add(&lc->friends_by_insub, friend_op_hash(op), lf);
+}
+
+void linphone_friend_set_outsub(
+    LinphoneFriend *lf, SalOp *op)
+{
+    LinphoneCore *lc = lf->indexed_in;
+    if (lc != NULL && lf->outsub != NULL)
+        friend_index_remove(&lc->friends_by_outsub, friend_op_hash(lf->outsub), lf);
+    lf->outsub = op;
+    if (lc != NULL && op != NULL)
+        friend_index_add(&lc->friends_by_outsub, friend_op_hash(op), lf);
+}
+
+LinphoneFriend *linphone_core_find_friend(
+    const LinphoneCore *lc, const LinphoneAddress *addr)
+{
+    unsigned int             hash = friend_address_hash(addr);
+    LinphoneFriendIndexEntry *entry;
+    for (entry = friend_index_bucket(&lc->friends_by_address, hash); entry != NULL; entry = entry->next)
+    {
+        if (entry->hash == hash && linphone_address_weak_equal(entry->lf->uri, addr))
+            return entry->lf;
     }
     return NULL;
 }
 
-LinphoneFriend *linphone_find_friend_by_out_subscribe(
-    MSList *l, SalOp *op)
+LinphoneFriend *linphone_core_find_friend_by_inc_subscribe(
+    const LinphoneCore *lc, SalOp *op)
 {
-    MSList *elem;
-    for (elem = l; elem != NULL; elem = elem->next)
+    unsigned int             hash = friend_op_hash(op);
+    LinphoneFriendIndexEntry *entry;
+    for (entry = friend_index_bucket(&lc->friends_by_insub, hash); entry != NULL; entry = entry->next)
     {
-        LinphoneFriend *lf = (LinphoneFriend *)elem->data;
-        if (lf->outsub == op) return lf;
+        if (entry->lf->insub == op)
+            return entry->lf;
+    }
+    return NULL;
+}
+
+LinphoneFriend *linphone_core_find_friend_by_out_subscribe(
+    const LinphoneCore *lc, SalOp *op)
+{
+    unsigned int             hash = friend_op_hash(op);
+    LinphoneFriendIndexEntry *entry;
+    for (entry = friend_index_bucket(&lc->friends_by_outsub, hash); entry != NULL; entry = entry->next)
+    {
+        if (entry->lf->outsub == op)
+            return entry->lf;
     }
     return NULL;
 }
@@ -154,9 +346,9 @@ void __linphone_friend_do_subscribe(
     else
     {
         sal_op_release(fr->outsub);
-        fr->outsub = NULL;
+        linphone_friend_set_outsub(fr, NULL);
     }
-    fr->outsub = sal_op_new(fr->lc->sal);
+    linphone_friend_set_outsub(fr, sal_op_new(fr->lc->sal));
     sal_op_set_route(fr->outsub, route);
     sal_op_set_contact(fr->outsub, fixed_contact);
     sal_subscribe_presence(fr->outsub, from, friend);
@@ -248,8 +440,12 @@ int linphone_friend_set_addr(
 {
     LinphoneAddress *fr = linphone_address_clone(addr);
     linphone_address_clean(fr);
+    if (lf->indexed_in != NULL)
+        friend_index_remove(&lf->indexed_in->friends_by_address, friend_address_hash(lf->uri), lf);
     if (lf->uri != NULL) linphone_address_destroy(lf->uri);
     lf->uri = fr;
+    if (lf->indexed_in != NULL)
+        friend_index_add(&lf->indexed_in->friends_by_address, friend_address_hash(lf->uri), lf);
     return 0;
 }
 
@@ -360,6 +556,8 @@ void linphone_friend_close_subscriptions(
 void linphone_friend_destroy(
     LinphoneFriend *lf)
 {
+    if (lf->indexed_in != NULL)
+        linphone_core_unindex_friend(lf->indexed_in, lf);
     if (lf->insub)
     {
         sal_op_release(lf->insub);
@@ -405,18 +603,16 @@ BuddyInfo *linphone_friend_get_info(
     return lf->info;
 }
 
-void linphone_friend_apply(
+static bool_t linphone_friend_commit(
     LinphoneFriend *fr, LinphoneCore *lc)
 {
     if (fr->uri == NULL)
     {
         ms_warning("No sip url defined.");
-        return;
+        return FALSE;
     }
     fr->lc = lc;
 
-    linphone_core_write_friends_config(lc);
-
     if (fr->inc_subscribe_pending)
     {
         switch (fr->pol)
@@ -444,6 +640,14 @@ void linphone_friend_apply(
     ms_message("linphone_friend_apply() done.");
     lc->bl_refresh = TRUE;
     fr->commit     = FALSE;
+    return TRUE;
+}
+
+void linphone_friend_apply(
+    LinphoneFriend *fr, LinphoneCore *lc)
+{
+    if (linphone_friend_commit(fr, lc))
+        linphone_core_write_friends_config(lc);
 }
 
 void linphone_friend_edit(
@@ -462,7 +666,7 @@ void linphone_core_add_friend(
 {
     ms_return_if_fail(lf->lc == NULL);
     ms_return_if_fail(lf->uri != NULL);
-    if (ms_list_find(lc->friends, lf) != NULL)
+    if (lf->indexed_in != NULL)
     {
         char                  *tmp  = NULL;
         const LinphoneAddress *addr = linphone_friend_get_address(lf);
@@ -472,6 +676,7 @@ void linphone_core_add_friend(
         return;
     }
     lc->friends = ms_list_append(lc->friends, lf);
+    linphone_core_index_friend(lc, lf);
     if (linphone_core_ready(lc)) linphone_friend_apply(lf, lc);
     else lf->commit = TRUE;
     return;
@@ -483,22 +688,54 @@ void linphone_core_remove_friend(
     MSList *el = ms_list_find(lc->friends, (void *)fl);
     if (el != NULL)
     {
+        if (el == lc->initial_subscribes_next)
+            lc->initial_subscribes_next = el->next;
         linphone_friend_destroy((LinphoneFriend *)el->data);
         lc->friends = ms_list_remove_link(lc->friends, el);
         linphone_core_write_friends_config(lc);
     }
 }
 
-void linphone_core_send_initial_subscribes(
+/*
+ * Applies the friends loaded from config, sending their SUBSCRIBEs at most
+ * [sip] initial_subscribes_rate per second (0 means no limit) so that a large
+ * friend list does not flood the proxy at startup.
+ * Returns TRUE once all of them have been applied; when the rate is reached,
+ * the next call resumes from lc->initial_subscribes_next.
+ */
+bool_t linphone_core_send_initial_subscribes(
     LinphoneCore *lc)
 {
     const MSList *elem;
-    for (elem = lc->friends; elem != NULL; elem = elem->next)
+    int          rate    = lp_config_get_int(lc->config, "sip", "initial_subscribes_rate", 0);
+    time_t       curtime = time(NULL);
+
+    if (lc->initial_subscribes_time != curtime)
+    {
+        lc->initial_subscribes_time  = curtime;
+        lc->initial_subscribes_count = 0;
+    }
+    else if (rate > 0 && lc->initial_subscribes_count >= rate)
+        return FALSE;
+    elem = lc->initial_subscribes_paused ? lc->initial_subscribes_next : lc->friends;
+    for (; elem != NULL; elem = elem->next)
     {
         LinphoneFriend *f = (LinphoneFriend *)elem->data;
-        if (f->commit)
-            linphone_friend_apply(f, lc);
+        if (!f->commit) continue;
+        if (rate > 0 && lc->initial_subscribes_count >= rate)
+        {
+            lc->initial_subscribes_next   = (MSList *)elem;
+            lc->initial_subscribes_paused = TRUE;
+            return FALSE;
+        }
+        if (f->subscribe && !f->subscribe_active)
+            lc->initial_subscribes_count++;
+        linphone_friend_commit(f, lc);
     }
+    lc->initial_subscribes_next   = NULL;
+    lc->initial_subscribes_paused = FALSE;
+    linphone_core_write_friends_config(lc);
+    return TRUE;
 }
 
 void linphone_friend_set_ref_key(
@@ -532,11 +769,12 @@ static bool_t username_match(
 LinphoneFriend *linphone_core_get_friend_by_address(
     const LinphoneCore *lc, const char *uri)
 {
-    LinphoneAddress *puri = linphone_address_new(uri);
-    const MSList    *elem;
-    const char      *username;
-    const char      *domain;
-    LinphoneFriend  *lf = NULL;
+    LinphoneAddress          *puri = linphone_address_new(uri);
+    LinphoneFriendIndexEntry *entry;
+    unsigned int             hash;
+    const char               *username;
+    const char               *domain;
+    LinphoneFriend           *lf = NULL;
 
     if (puri == NULL)
     {
@@ -549,17 +787,17 @@ LinphoneFriend *linphone_core_get_friend_by_address(
         linphone_address_destroy(puri);
         return NULL;
     }
-    for (elem = lc->friends; elem != NULL; elem = ms_list_next(elem))
+    hash = friend_address_hash(puri);
+    for (entry = friend_index_bucket(&lc->friends_by_address, hash); entry != NULL; entry = entry->next)
     {
-        lf = (LinphoneFriend *)elem->data;
-        const char *it_username = linphone_address_get_username(lf->uri);
-        const char *it_host     = linphone_address_get_domain(lf->uri);
-        ;
-        if (strcasecmp(domain, it_host) == 0 && username_match(username, it_username))
+        const char *it_username = linphone_address_get_username(entry->lf->uri);
+        const char *it_host     = linphone_address_get_domain(entry->lf->uri);
+        if (entry->hash == hash && it_host != NULL && strcasecmp(domain, it_host) == 0 &&
+            username_match(username, it_username))
         {
+            lf = entry->lf;
             break;
         }
-        lf = NULL;
     }
     linphone_address_destroy(puri);
     return lf;
@@ -331,149 +331,149 @@ void linphone_call_make_local_media_description(
     if (old_md) sal_media_description_unref(old_md);
 }
 
-static int find_port_offset(
-    LinphoneCore *lc, SalStreamType type)
+static uint64_t get_cur_time_ms(void)
 {
-    int    offset;
-    MSList *elem;
-    int    tried_port;
-    int    existing_port;
-    bool_t already_used = FALSE;
-    for (offset = 0; offset < 100; offset += 2)
-    {
-        switch (type)
-        {
-        default:
-        case SalAudio:
-            tried_port = linphone_core_get_audio_port(lc) + offset;
-            break;
-        case SalVideo:
-            tried_port = linphone_core_get_video_port(lc) + offset;
-            break;
-        }
-        already_used = FALSE;
-        for (elem = lc->calls; elem != NULL; elem = elem->next)
-        {
-            LinphoneCall *call = (LinphoneCall *)elem->data;
-            switch (type)
-            {
-            default:
-            case SalAudio:
-                existing_port = call->audio_port;
-                break;
-            case SalVideo:
-                existing_port = call->video_port;
-                break;
-            }
-            if (existing_port == tried_port)
-            {
-                already_used = TRUE;
-                break;
-            }
-        }
-        if (!already_used) break;
-    }
-    if (offset == 100)
+    MSTimeSpec ts;
+    ms_get_cur_time(&ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int get_audio_stream_pool_size(
+    LinphoneCore *lc)
+{
+    return lp_config_get_int(lc->config, "rtp", "audio_stream_pool_size", 0);
+}
+
+/*
+ * Keeps [rtp] audio_stream_pool_size AudioStreams created and bound in advance,
+ * so that new calls do not pay for the RtpSession, socket and echo canceller
+ * creation. One stream is built per iteration to avoid stalling the main loop.
+ */
+bool_t linphone_core_audio_stream_pool_needs_fill(
+    LinphoneCore *lc)
+{
+    return lc->audio_stream_pool_retry != time(NULL)
+           && ms_list_size(lc->audio_stream_pool) < get_audio_stream_pool_size(lc);
+}
+
+void linphone_core_fill_audio_stream_pool(
+    LinphoneCore *lc)
+{
+    int port;
+    if (!linphone_core_audio_stream_pool_needs_fill(lc))
+        return;
+    port = linphone_core_reserve_rtp_port(lc, SalAudio);
+    if (port == -1)
     {
-        ms_error("Could not find any free port !");
-        return -1;
+        /* range exhausted, try again next second */
+        lc->audio_stream_pool_retry = time(NULL);
+        return;
     }
-    return offset;
+    lc->audio_stream_pool = ms_list_append(lc->audio_stream_pool,
+                                           audio_stream_new(port, port + 1, linphone_core_ipv6_enabled(lc)));
 }
 
-static int select_random_port(
-    LinphoneCore *lc, SalStreamType type)
+/* destroys the idle streams, needed when the port range or the address family changes */
+void linphone_core_flush_audio_stream_pool(
+    LinphoneCore *lc)
 {
     MSList *elem;
-    int    nb_tries;
-    int    tried_port = 0;
-    int    existing_port = 0;
-    int    min_port = 0, max_port = 0;
-    bool_t already_used = FALSE;
-
-    switch (type)
+    for (elem = lc->audio_stream_pool; elem != NULL; elem = elem->next)
     {
-    default:
-    case SalAudio:
-        linphone_core_get_audio_port_range(lc, &min_port, &max_port);
-        break;
-    case SalVideo:
-        linphone_core_get_video_port_range(lc, &min_port, &max_port);
-        break;
+        AudioStream *stream = (AudioStream *)elem->data;
+        linphone_core_release_rtp_port(lc, SalAudio, rtp_session_get_local_port(stream->ms.session));
+        audio_stream_stop(stream);
     }
-    tried_port = (rand() % (max_port - min_port) + min_port) & ~0x1;
-    if (tried_port < min_port) tried_port = min_port + 2;
-    for (nb_tries = 0; nb_tries < 100; nb_tries++)
+    lc->audio_stream_pool = ms_list_free(lc->audio_stream_pool);
+    for (elem = lc->calls; elem != NULL; elem = elem->next)
     {
-        for (elem = lc->calls; elem != NULL; elem = elem->next)
+        LinphoneCall *call = (LinphoneCall *)elem->data;
+        /* the call keeps its port, the next init builds a fresh stream on it */
+        if (call->idle_audiostream != NULL)
         {
-            LinphoneCall *call = (LinphoneCall *)elem->data;
-            switch (type)
-            {
-            default:
-            case SalAudio:
-                existing_port = call->audio_port;
-                break;
-            case SalVideo:
-                existing_port = call->video_port;
-                break;
-            }
-            if (existing_port == tried_port)
-            {
-                already_used = TRUE;
-                break;
-            }
+            audio_stream_stop(call->idle_audiostream);
+            call->idle_audiostream = NULL;
         }
-        if (!already_used) break;
     }
-    if (nb_tries == 100)
+}
+
+static AudioStream *linphone_core_take_idle_audio_stream(
+    LinphoneCore *lc)
+{
+    AudioStream *stream;
+    if (lc->audio_stream_pool == NULL)
+        return NULL;
+    stream                = (AudioStream *)lc->audio_stream_pool->data;
+    lc->audio_stream_pool = ms_list_remove_link(lc->audio_stream_pool, lc->audio_stream_pool);
+    return stream;
+}
+
+/* a stream can be handed to another call as long as no graph or transport was attached to it */
+static bool_t linphone_call_audio_stream_reusable(
+    LinphoneCall *call)
+{
+    AudioStream *stream = call->audiostream;
+    return stream->ms.start_time == 0 && stream->ms.ticker == NULL && stream->dummy == NULL
+           && stream->ms.ice_check_list == NULL && call->core->rtptf == NULL;
+}
+
+/* puts back what linphone_call_init_audio_stream() and audio_stream_new() configure */
+static void reset_idle_audio_stream(
+    AudioStream *stream)
+{
+    rtp_session_reset(stream->ms.session);
+    ortp_ev_queue_flush(stream->ms.evq);
+    stream->el_type    = ELInactive;
+    stream->features   = AUDIO_STREAM_FEATURE_ALL;
+    stream->play_dtmfs = TRUE;
+    stream->use_gc     = FALSE;
+    stream->use_agc    = FALSE;
+    stream->use_ng     = FALSE;
+}
+
+static void linphone_call_release_media_resources(
+    LinphoneCall *call)
+{
+    if (call->idle_audiostream != NULL)
     {
-        ms_error("Could not find any free port!");
-        return -1;
+        LinphoneCore *lc = call->core;
+        if (ms_list_size(lc->audio_stream_pool) < get_audio_stream_pool_size(lc))
+        {
+            /* the stream goes back to the pool together with its port */
+            lc->audio_stream_pool = ms_list_append(lc->audio_stream_pool, call->idle_audiostream);
+            call->audio_port      = 0;
+        }
+        else audio_stream_stop(call->idle_audiostream);
+        call->idle_audiostream = NULL;
     }
-    return tried_port;
+    if (call->audio_port > 0)
+        linphone_core_release_rtp_port(call->core, SalAudio, call->audio_port);
+    if (call->video_port > 0)
+        linphone_core_release_rtp_port(call->core, SalVideo, call->video_port);
+    call->audio_port = 0;
+    call->video_port = 0;
 }
 
 static void linphone_call_init_common(
     LinphoneCall *call, LinphoneAddress *from, LinphoneAddress *to)
 {
-    int port_offset;
-    int min_port, max_port;
     call->magic            = linphone_call_magic;
     call->refcnt           = 1;
     call->state            = LinphoneCallIdle;
     call->transfer_state   = LinphoneCallIdle;
     call->start_time       = time(NULL);
     call->media_start_time = 0;
+    call->setup_start_ms   = get_cur_time_ms();
+    call->media_setup_time = -1;
     call->log              = linphone_call_log_new(call, from, to);
     call->owns_call_log    = TRUE;
     linphone_core_notify_all_friends(call->core, LinphoneStatusOnThePhone);
-    linphone_core_get_audio_port_range(call->core, &min_port, &max_port);
-    if (min_port == max_port)
-    {
-        /* Used fixed RTP audio port. */
-        port_offset      = find_port_offset(call->core, SalAudio);
-        if (port_offset == -1) return;
-        call->audio_port = linphone_core_get_audio_port(call->core) + port_offset;
-    }
-    else
-    {
-        /* Select random RTP audio port in the specified range. */
-        call->audio_port = select_random_port(call->core, SalAudio);
-    }
-    linphone_core_get_video_port_range(call->core, &min_port, &max_port);
-    if (min_port == max_port)
-    {
-        /* Used fixed RTP video port. */
-        port_offset      = find_port_offset(call->core, SalVideo);
-        if (port_offset == -1) return;
-        call->video_port = linphone_core_get_video_port(call->core) + port_offset;
-    }
+    call->idle_audiostream = linphone_core_take_idle_audio_stream(call->core);
+    if (call->idle_audiostream != NULL)
+        call->audio_port = rtp_session_get_local_port(call->idle_audiostream->ms.session);
     else
-    {
-        /* Select random RTP video port in the specified range. */
-        call->video_port = select_random_port(call->core, SalVideo);
-    }
+        call->audio_port = linphone_core_reserve_rtp_port(call->core, SalAudio);
+    call->video_port       = linphone_core_reserve_rtp_port(call->core, SalVideo);
     linphone_call_init_stats(&call->stats[LINPHONE_CALL_STATS_AUDIO], LINPHONE_CALL_STATS_AUDIO);
     linphone_call_init_stats(&call->stats[LINPHONE_CALL_STATS_VIDEO], LINPHONE_CALL_STATS_VIDEO);
 }
@@ -803,6 +803,7 @@ void linphone_call_set_state(
                 sal_op_release(call->op);
                 call->op = NULL;
             }
+            linphone_call_release_media_resources(call);
             linphone_call_unref(call);
         }
     }
@@ -817,6 +818,7 @@ void linphone_call_destroy(
     linphone_call_delete_upnp_session(obj);
 #endif //BUILD_UPNP
     linphone_call_delete_ice_session(obj);
+    linphone_call_release_media_resources(obj);
     if (obj->op != NULL)
     {
         sal_op_release(obj->op);
@@ -1088,6 +1090,16 @@ int linphone_call_get_duration(
     return time(NULL) - call->media_start_time;
 }
 
+/**
+ * Returns the time in milliseconds between the creation of the call (INVITE sent
+ * or received) and the start of its media streams, or -1 if media did not start yet.
+ **/
+int linphone_call_get_media_setup_time(
+    const LinphoneCall *call)
+{
+    return call->media_setup_time;
+}
+
 /**
  * Returns the call object this call is replacing, if any.
  * Call replacement can occur during call transfers.
@@ -1393,7 +1405,13 @@ void linphone_call_init_audio_stream(
     int          dscp;
 
     if (call->audiostream != NULL) return;
-    call->audiostream = audiostream = audio_stream_new(call->audio_port, call->audio_port + 1, linphone_core_ipv6_enabled(lc));
+    if (call->idle_audiostream != NULL)
+    {
+        audiostream            = call->idle_audiostream;
+        call->idle_audiostream = NULL;
+    }
+    else audiostream = audio_stream_new(call->audio_port, call->audio_port + 1, linphone_core_ipv6_enabled(lc));
+    call->audiostream = audiostream;
     dscp              = linphone_core_get_audio_dscp(lc);
     if (dscp != -1)
         audio_stream_set_dscp(audiostream, dscp);
@@ -2063,6 +2081,11 @@ void linphone_call_start_media_streams(
     {
         ice_session_start_connectivity_checks(call->ice_session);
     }
+    if (call->media_setup_time < 0)
+    {
+        call->media_setup_time = (int)(get_cur_time_ms() - call->setup_start_ms);
+        ms_message("Call %p: media started %i ms after the call was created", call, call->media_setup_time);
+    }
 
     goto end;
 end:
@@ -2236,7 +2259,13 @@ void linphone_call_stop_audio_stream(
         {
             linphone_call_remove_from_conf(call);
         }
-        audio_stream_stop(call->audiostream);
+        if (call->idle_audiostream == NULL && linphone_call_audio_stream_reusable(call))
+        {
+            /* never started: keep it bound for a later init or for the next call */
+            reset_idle_audio_stream(call->audiostream);
+            call->idle_audiostream = call->audiostream;
+        }
+        else audio_stream_stop(call->audiostream);
         call->audiostream = NULL;
     }
 }
@@ -2656,153 +2685,342 @@ static void handle_ice_events(
     }
 }
 
-void linphone_call_background_tasks(
+/*
+ * Part of the background tasks that only touches the call's own streams and
+ * statistics: RTCP and ICE processing, quality indicators, bandwidth and
+ * RTP timeout. It may run in a call worker thread while the main thread waits.
+ */
+static void linphone_call_stream_tasks(
     LinphoneCall *call, bool_t one_second_elapsed)
 {
-    if (call != NULL)
-    {
-        LinphoneCore *lc = call->core;
-        int          disconnect_timeout = linphone_core_get_nortp_timeout(call->core);
-        bool_t       disconnected = FALSE;
+    int disconnect_timeout = linphone_core_get_nortp_timeout(call->core);
 
-        if (call->state == LinphoneCallStreamsRunning && one_second_elapsed)
+    if (call->state == LinphoneCallStreamsRunning && one_second_elapsed)
+    {
+        RtpSession *as = NULL, *vs = NULL;
+        float      audio_load = 0, video_load = 0;
+        if (call->audiostream != NULL)
         {
-            RtpSession *as = NULL, *vs = NULL;
-            float      audio_load = 0, video_load = 0;
-            if (call->audiostream != NULL)
-            {
-                as = call->audiostream->ms.session;
-                if (call->audiostream->ms.ticker)
-                    audio_load = ms_ticker_get_average_load(call->audiostream->ms.ticker);
-            }
-            if (call->videostream != NULL)
-            {
-                if (call->videostream->ms.ticker)
-                    video_load = ms_ticker_get_average_load(call->videostream->ms.ticker);
-                vs = call->videostream->ms.session;
-            }
-            report_bandwidth(call, as, vs);
-            ms_message("Thread processing load: audio=%f\tvideo=%f", audio_load, video_load);
+            as = call->audiostream->ms.session;
+            if (call->audiostream->ms.ticker)
+                audio_load = ms_ticker_get_average_load(call->audiostream->ms.ticker);
+        }
+        if (call->videostream != NULL)
+        {
+            if (call->videostream->ms.ticker)
+                video_load = ms_ticker_get_average_load(call->videostream->ms.ticker);
+            vs = call->videostream->ms.session;
         }
+        report_bandwidth(call, as, vs);
+        ms_message("Thread processing load: audio=%f\tvideo=%f", audio_load, video_load);
+    }
+
+#ifdef VIDEO_ENABLED
+    if (call->videostream != NULL)
+    {
+        /* Ensure there is no dangling ICE check list. */
+        if (call->ice_session == NULL) call->videostream->ms.ice_check_list = NULL;
+
+        // Beware that the application queue should not depend on treatments fron the
+        // mediastreamer queue.
+        video_stream_iterate(call->videostream);
+    }
+#endif
+    if (call->audiostream != NULL)
+    {
+        /* Ensure there is no dangling ICE check list. */
+        if (call->ice_session == NULL) call->audiostream->ms.ice_check_list = NULL;
+
+        // Beware that the application queue should not depend on treatments fron the
+        // mediastreamer queue.
+        audio_stream_iterate(call->audiostream);
+    }
+    if (call->state == LinphoneCallStreamsRunning && one_second_elapsed && call->audiostream != NULL && disconnect_timeout > 0)
+    {
+        if (!audio_stream_alive(call->audiostream, disconnect_timeout))
+            call->media_timed_out = TRUE;
+    }
+}
+
+/* main thread part: application events, callbacks and call state changes */
+void linphone_call_process_stream_events(
+    LinphoneCall *call)
+{
+    LinphoneCore *lc = call->core;
 
 #ifdef BUILD_UPNP
-        linphone_upnp_call_process(call);
+    linphone_upnp_call_process(call);
 #endif //BUILD_UPNP
 
 #ifdef VIDEO_ENABLED
-        if (call->videostream != NULL)
-        {
-            OrtpEvent *ev;
-
-            /* Ensure there is no dangling ICE check list. */
-            if (call->ice_session == NULL) call->videostream->ms.ice_check_list = NULL;
-
-            // Beware that the application queue should not depend on treatments fron the
-            // mediastreamer queue.
-            video_stream_iterate(call->videostream);
+    if (call->videostream != NULL)
+    {
+        OrtpEvent *ev;
 
-            while (call->videostream_app_evq && (NULL != (ev = ortp_ev_queue_get(call->videostream_app_evq))))
+        while (call->videostream_app_evq && (NULL != (ev = ortp_ev_queue_get(call->videostream_app_evq))))
+        {
+            OrtpEventType evt = ortp_event_get_type(ev);
+            OrtpEventData *evd = ortp_event_get_data(ev);
+            ms_warning("ortp_ev_queue_get: evt: %d", evt);
+            if (evt == ORTP_EVENT_ZRTP_ENCRYPTION_CHANGED)
             {
-                OrtpEventType evt = ortp_event_get_type(ev);
-                OrtpEventData *evd = ortp_event_get_data(ev);
-                ms_warning("ortp_ev_queue_get: evt: %d", evt);
-                if (evt == ORTP_EVENT_ZRTP_ENCRYPTION_CHANGED)
-                {
-                    linphone_call_videostream_encryption_changed(call, evd->info.zrtp_stream_encrypted);
-                }
-                else if (evt == ORTP_EVENT_RTCP_PACKET_RECEIVED)
-                {
-                    call->stats[LINPHONE_CALL_STATS_VIDEO].round_trip_delay = rtp_session_get_round_trip_propagation(call->videostream->ms.session);
-                    if (call->stats[LINPHONE_CALL_STATS_VIDEO].received_rtcp != NULL)
-                        freemsg(call->stats[LINPHONE_CALL_STATS_VIDEO].received_rtcp);
-                    call->stats[LINPHONE_CALL_STATS_VIDEO].received_rtcp = evd->packet;
-                    evd->packet = NULL;
-                    update_local_stats(&call->stats[LINPHONE_CALL_STATS_VIDEO], (MediaStream *)call->videostream);
-                    if (lc->vtable.call_stats_updated)
-                        lc->vtable.call_stats_updated(lc, call, &call->stats[LINPHONE_CALL_STATS_VIDEO]);
-                }
-                else if (evt == ORTP_EVENT_RTCP_PACKET_EMITTED)
-                {
-                    memcpy(&call->stats[LINPHONE_CALL_STATS_VIDEO].jitter_stats, rtp_session_get_jitter_stats(call->videostream->ms.session), sizeof(jitter_stats_t));
-                    if (call->stats[LINPHONE_CALL_STATS_VIDEO].sent_rtcp != NULL)
-                        freemsg(call->stats[LINPHONE_CALL_STATS_VIDEO].sent_rtcp);
-                    call->stats[LINPHONE_CALL_STATS_VIDEO].sent_rtcp = evd->packet;
-                    evd->packet = NULL;
-                    update_local_stats(&call->stats[LINPHONE_CALL_STATS_VIDEO], (MediaStream *)call->videostream);
-                    if (lc->vtable.call_stats_updated)
-                        lc->vtable.call_stats_updated(lc, call, &call->stats[LINPHONE_CALL_STATS_VIDEO]);
-                }
-                else if ((evt == ORTP_EVENT_ICE_SESSION_PROCESSING_FINISHED) || (evt == ORTP_EVENT_ICE_GATHERING_FINISHED)
-                    || (evt == ORTP_EVENT_ICE_LOSING_PAIRS_COMPLETED) || (evt == ORTP_EVENT_ICE_RESTART_NEEDED))
-                {
-                    handle_ice_events(call, ev);
-                }
-                ortp_event_destroy(ev);
+                linphone_call_videostream_encryption_changed(call, evd->info.zrtp_stream_encrypted);
+            }
+            else if (evt == ORTP_EVENT_RTCP_PACKET_RECEIVED)
+            {
+                call->stats[LINPHONE_CALL_STATS_VIDEO].round_trip_delay = rtp_session_get_round_trip_propagation(call->videostream->ms.session);
+                if (call->stats[LINPHONE_CALL_STATS_VIDEO].received_rtcp != NULL)
+                    freemsg(call->stats[LINPHONE_CALL_STATS_VIDEO].received_rtcp);
+                call->stats[LINPHONE_CALL_STATS_VIDEO].received_rtcp = evd->packet;
+                evd->packet = NULL;
+                update_local_stats(&call->stats[LINPHONE_CALL_STATS_VIDEO], (MediaStream *)call->videostream);
+                if (lc->vtable.call_stats_updated)
+                    lc->vtable.call_stats_updated(lc, call, &call->stats[LINPHONE_CALL_STATS_VIDEO]);
+            }
+            else if (evt == ORTP_EVENT_RTCP_PACKET_EMITTED)
+            {
+                memcpy(&call->stats[LINPHONE_CALL_STATS_VIDEO].jitter_stats, rtp_session_get_jitter_stats(call->videostream->ms.session), sizeof(jitter_stats_t));
+                if (call->stats[LINPHONE_CALL_STATS_VIDEO].sent_rtcp != NULL)
+                    freemsg(call->stats[LINPHONE_CALL_STATS_VIDEO].sent_rtcp);
+                call->stats[LINPHONE_CALL_STATS_VIDEO].sent_rtcp = evd->packet;
+                evd->packet = NULL;
+                update_local_stats(&call->stats[LINPHONE_CALL_STATS_VIDEO], (MediaStream *)call->videostream);
+                if (lc->vtable.call_stats_updated)
+                    lc->vtable.call_stats_updated(lc, call, &call->stats[LINPHONE_CALL_STATS_VIDEO]);
             }
+            else if ((evt == ORTP_EVENT_ICE_SESSION_PROCESSING_FINISHED) || (evt == ORTP_EVENT_ICE_GATHERING_FINISHED)
+                || (evt == ORTP_EVENT_ICE_LOSING_PAIRS_COMPLETED) || (evt == ORTP_EVENT_ICE_RESTART_NEEDED))
+            {
+                handle_ice_events(call, ev);
+            }
+            ortp_event_destroy(ev);
         }
+    }
 #endif
-        if (call->audiostream != NULL)
+    if (call->audiostream != NULL)
+    {
+        OrtpEvent *ev;
+
+        while (call->audiostream_app_evq && (NULL != (ev = ortp_ev_queue_get(call->audiostream_app_evq))))
         {
-            OrtpEvent *ev;
+            OrtpEventType evt = ortp_event_get_type(ev);
+            OrtpEventData *evd = ortp_event_get_data(ev);
+            if (evt == ORTP_EVENT_ZRTP_ENCRYPTION_CHANGED)
+            {
+                linphone_call_audiostream_encryption_changed(call, evd->info.zrtp_stream_encrypted);
+            }
+            else if (evt == ORTP_EVENT_ZRTP_SAS_READY)
+            {
+                linphone_call_audiostream_auth_token_ready(call, evd->info.zrtp_sas.sas, evd->info.zrtp_sas.verified);
+            }
+            else if (evt == ORTP_EVENT_RTCP_PACKET_RECEIVED)
+            {
+                call->stats[LINPHONE_CALL_STATS_AUDIO].round_trip_delay = rtp_session_get_round_trip_propagation(call->audiostream->ms.session);
+                if (call->stats[LINPHONE_CALL_STATS_AUDIO].received_rtcp != NULL)
+                    freemsg(call->stats[LINPHONE_CALL_STATS_AUDIO].received_rtcp);
+                call->stats[LINPHONE_CALL_STATS_AUDIO].received_rtcp = evd->packet;
+                evd->packet = NULL;
+                update_local_stats(&call->stats[LINPHONE_CALL_STATS_AUDIO], (MediaStream *)call->audiostream);
+                if (lc->vtable.call_stats_updated)
+                    lc->vtable.call_stats_updated(lc, call, &call->stats[LINPHONE_CALL_STATS_AUDIO]);
+            }
+            else if (evt == ORTP_EVENT_RTCP_PACKET_EMITTED)
+            {
+                memcpy(&call->stats[LINPHONE_CALL_STATS_AUDIO].jitter_stats, rtp_session_get_jitter_stats(call->audiostream->ms.session), sizeof(jitter_stats_t));
+                if (call->stats[LINPHONE_CALL_STATS_AUDIO].sent_rtcp != NULL)
+                    freemsg(call->stats[LINPHONE_CALL_STATS_AUDIO].sent_rtcp);
+                call->stats[LINPHONE_CALL_STATS_AUDIO].sent_rtcp = evd->packet;
+                evd->packet = NULL;
+                update_local_stats(&call->stats[LINPHONE_CALL_STATS_AUDIO], (MediaStream *)call->audiostream);
+                if (lc->vtable.call_stats_updated)
+                    lc->vtable.call_stats_updated(lc, call, &call->stats[LINPHONE_CALL_STATS_AUDIO]);
+            }
+            else if ((evt == ORTP_EVENT_ICE_SESSION_PROCESSING_FINISHED) || (evt == ORTP_EVENT_ICE_GATHERING_FINISHED)
+                || (evt == ORTP_EVENT_ICE_LOSING_PAIRS_COMPLETED) || (evt == ORTP_EVENT_ICE_RESTART_NEEDED))
+            {
+                handle_ice_events(call, ev);
+            }
+            else if (evt == ORTP_EVENT_TELEPHONE_EVENT)
+            {
+                linphone_core_dtmf_received(lc, evd->info.telephone_event);
+            }
+            ortp_event_destroy(ev);
+        }
+    }
+    if (call->media_timed_out)
+    {
+        call->media_timed_out = FALSE;
+        linphone_core_disconnected(call->core, call);
+    }
+}
 
-            /* Ensure there is no dangling ICE check list. */
-            if (call->ice_session == NULL) call->audiostream->ms.ice_check_list = NULL;
+void linphone_call_background_tasks(
+    LinphoneCall *call, bool_t one_second_elapsed)
+{
+    if (call != NULL)
+    {
+        linphone_call_stream_tasks(call, one_second_elapsed);
+        linphone_call_process_stream_events(call);
+    }
+}
 
-            // Beware that the application queue should not depend on treatments fron the
-            // mediastreamer queue.
-            audio_stream_iterate(call->audiostream);
+/*
+ * Call workers.
+ * With [misc] call_worker_threads set, linphone_core_iterate() hands the stream
+ * part of the background tasks of all calls to a pool of threads and waits for
+ * it before processing the events, callbacks and state changes of each call in
+ * the main thread as usual. Nothing else runs while the workers do, so the call
+ * objects need no locking.
+ */
+struct _LinphoneCallWorkers
+{
+    ms_thread_t  *threads;
+    int          nb_threads;
+    ms_mutex_t   lock;
+    ms_cond_t    work_cond;
+    ms_cond_t    done_cond;
+    LinphoneCall **jobs;
+    int          jobs_size;
+    int          nb_jobs;
+    int          next_job;
+    int          pending;
+    bool_t       one_second_elapsed;
+    bool_t       stop;
+    bool_t       pad[2];
+};
+
+/* runs the remaining jobs, returns when the queue is empty */
+static void linphone_call_workers_run_jobs(
+    LinphoneCallWorkers *workers)
+{
+    ms_mutex_lock(&workers->lock);
+    while (workers->next_job < workers->nb_jobs)
+    {
+        LinphoneCall *call = workers->jobs[workers->next_job++];
+        ms_mutex_unlock(&workers->lock);
+        linphone_call_stream_tasks(call, workers->one_second_elapsed);
+        ms_mutex_lock(&workers->lock);
+        if (--workers->pending == 0)
+            ms_cond_signal(&workers->done_cond);
+    }
+    ms_mutex_unlock(&workers->lock);
+}
+
+static void *linphone_call_worker_thread(
+    void *data)
+{
+    LinphoneCallWorkers *workers = (LinphoneCallWorkers *)data;
+    ms_mutex_lock(&workers->lock);
+    while (!workers->stop)
+    {
+        if (workers->next_job >= workers->nb_jobs)
+        {
+            ms_cond_wait(&workers->work_cond, &workers->lock);
+            continue;
+        }
+        ms_mutex_unlock(&workers->lock);
+        linphone_call_workers_run_jobs(workers);
+        ms_mutex_lock(&workers->lock);
+    }
+    ms_mutex_unlock(&workers->lock);
+    return NULL;
+}
 
-            while (call->audiostream_app_evq && (NULL != (ev = ortp_ev_queue_get(call->audiostream_app_evq))))
-            {
-                OrtpEventType evt = ortp_event_get_type(ev);
-                OrtpEventData *evd = ortp_event_get_data(ev);
-                if (evt == ORTP_EVENT_ZRTP_ENCRYPTION_CHANGED)
-                {
-                    linphone_call_audiostream_encryption_changed(call, evd->info.zrtp_stream_encrypted);
-                }
-                else if (evt == ORTP_EVENT_ZRTP_SAS_READY)
-                {
-                    linphone_call_audiostream_auth_token_ready(call, evd->info.zrtp_sas.sas, evd->info.zrtp_sas.verified);
-                }
-                else if (evt == ORTP_EVENT_RTCP_PACKET_RECEIVED)
-                {
-                    call->stats[LINPHONE_CALL_STATS_AUDIO].round_trip_delay = rtp_session_get_round_trip_propagation(call->audiostream->ms.session);
-                    if (call->stats[LINPHONE_CALL_STATS_AUDIO].received_rtcp != NULL)
-                        freemsg(call->stats[LINPHONE_CALL_STATS_AUDIO].received_rtcp);
-                    call->stats[LINPHONE_CALL_STATS_AUDIO].received_rtcp = evd->packet;
-                    evd->packet = NULL;
-                    update_local_stats(&call->stats[LINPHONE_CALL_STATS_AUDIO], (MediaStream *)call->audiostream);
-                    if (lc->vtable.call_stats_updated)
-                        lc->vtable.call_stats_updated(lc, call, &call->stats[LINPHONE_CALL_STATS_AUDIO]);
-                }
-                else if (evt == ORTP_EVENT_RTCP_PACKET_EMITTED)
-                {
-                    memcpy(&call->stats[LINPHONE_CALL_STATS_AUDIO].jitter_stats, rtp_session_get_jitter_stats(call->audiostream->ms.session), sizeof(jitter_stats_t));
-                    if (call->stats[LINPHONE_CALL_STATS_AUDIO].sent_rtcp != NULL)
-                        freemsg(call->stats[LINPHONE_CALL_STATS_AUDIO].sent_rtcp);
-                    call->stats[LINPHONE_CALL_STATS_AUDIO].sent_rtcp = evd->packet;
-                    evd->packet = NULL;
-                    update_local_stats(&call->stats[LINPHONE_CALL_STATS_AUDIO], (MediaStream *)call->audiostream);
-                    if (lc->vtable.call_stats_updated)
-                        lc->vtable.call_stats_updated(lc, call, &call->stats[LINPHONE_CALL_STATS_AUDIO]);
-                }
-                else if ((evt == ORTP_EVENT_ICE_SESSION_PROCESSING_FINISHED) || (evt == ORTP_EVENT_ICE_GATHERING_FINISHED)
-                    || (evt == ORTP_EVENT_ICE_LOSING_PAIRS_COMPLETED) || (evt == ORTP_EVENT_ICE_RESTART_NEEDED))
-                {
-                    handle_ice_events(call, ev);
-                }
-                else if (evt == ORTP_EVENT_TELEPHONE_EVENT)
-                {
-                    linphone_core_dtmf_received(lc, evd->info.telephone_event);
-                }
-                ortp_event_destroy(ev);
-            }
+static LinphoneCallWorkers *linphone_call_workers_new(
+    int nb_threads)
+{
+    LinphoneCallWorkers *workers = ms_new0(LinphoneCallWorkers, 1);
+    int                 i;
+    ms_mutex_init(&workers->lock, NULL);
+    ms_cond_init(&workers->work_cond, NULL);
+    ms_cond_init(&workers->done_cond, NULL);
+    workers->threads = ms_new0(ms_thread_t, nb_threads);
+    for (i = 0; i < nb_threads; i++)
+    {
+        if (ms_thread_create(&workers->threads[i], NULL, linphone_call_worker_thread, workers) != 0)
+        {
+            ms_error("Could not start call worker thread %i", i);
+            break;
         }
-        if (call->state == LinphoneCallStreamsRunning && one_second_elapsed && call->audiostream != NULL && disconnect_timeout > 0)
-            disconnected = !audio_stream_alive(call->audiostream, disconnect_timeout);
-        if (disconnected)
-            linphone_core_disconnected(call->core, call);
+        workers->nb_threads++;
+    }
+    ms_message("%i call worker threads started", workers->nb_threads);
+    return workers;
+}
+
+void linphone_core_stop_call_workers(
+    LinphoneCore *lc)
+{
+    LinphoneCallWorkers *workers = lc->call_workers;
+    int                 i;
+    if (workers == NULL)
+        return;
+    ms_mutex_lock(&workers->lock);
+    workers->stop = TRUE;
+    ms_cond_broadcast(&workers->work_cond);
+    ms_mutex_unlock(&workers->lock);
+    for (i = 0; i < workers->nb_threads; i++)
+        ms_thread_join(workers->threads[i], NULL);
+    ms_mutex_destroy(&workers->lock);
+    ms_cond_destroy(&workers->work_cond);
+    ms_cond_destroy(&workers->done_cond);
+    ms_free(workers->threads);
+    if (workers->jobs)
+        ms_free(workers->jobs);
+    ms_free(workers);
+    lc->call_workers = NULL;
+}
+
+/**
+ * Runs the stream tasks of all calls in the call workers.
+ * Returns FALSE if they are not enabled or not worth it, in which case
+ * linphone_call_background_tasks() must be used for each call instead of
+ * linphone_call_process_stream_events().
+ */
+bool_t linphone_core_run_call_workers(
+    LinphoneCore *lc, bool_t one_second_elapsed)
+{
+    LinphoneCallWorkers *workers;
+    int                 nb_calls = ms_list_size(lc->calls);
+    MSList              *elem;
+
+    if (nb_calls < 2)
+        return FALSE;
+    if (lc->call_workers == NULL)
+    {
+        int nb_threads = lp_config_get_int(lc->config, "misc", "call_worker_threads", 0);
+        if (nb_threads <= 0)
+            return FALSE;
+        lc->call_workers = linphone_call_workers_new(nb_threads);
     }
+    workers = lc->call_workers;
+    if (workers->nb_threads == 0)
+        return FALSE;
+
+    ms_mutex_lock(&workers->lock);
+    if (workers->jobs_size < nb_calls)
+    {
+        workers->jobs_size = nb_calls * 2;
+        workers->jobs      = ms_realloc(workers->jobs, workers->jobs_size * sizeof(LinphoneCall *));
+    }
+    workers->nb_jobs = 0;
+    for (elem = lc->calls; elem != NULL; elem = elem->next)
+        workers->jobs[workers->nb_jobs++] = (LinphoneCall *)elem->data;
+    workers->next_job           = 0;
+    workers->pending            = workers->nb_jobs;
+    workers->one_second_elapsed = one_second_elapsed;
+    ms_cond_broadcast(&workers->work_cond);
+    ms_mutex_unlock(&workers->lock);
+
+    /* the main thread takes its share instead of sleeping */
+    linphone_call_workers_run_jobs(workers);
+
+    ms_mutex_lock(&workers->lock);
+    while (workers->pending > 0)
+        ms_cond_wait(&workers->done_cond, &workers->lock);
+    workers->nb_jobs = 0;
+    ms_mutex_unlock(&workers->lock);
+    return TRUE;
 }
 
 void linphone_call_log_completed(
@@ -2823,6 +3041,7 @@ void linphone_call_log_completed(
             lc->vtable.display_status(lc, info);
         ms_free(info);
     }
+    linphone_core_call_log_store(lc, call->log);
     lc->call_logs = ms_list_prepend(lc->call_logs, (void *)call->log);
     if (ms_list_size(lc->call_logs) > lc->max_call_logs)
     {
@@ -80,7 +80,7 @@ static size_t my_strftime(
     return strftime(s, max, fmt, tm);
 }
 
-static void set_call_log_date(
+void set_call_log_date(
     LinphoneCallLog *cl, time_t start_time)
 {
     struct tm loctime;
@@ -99,6 +99,7 @@ LinphoneCallLog *linphone_call_log_new(
     LinphoneCall *call, LinphoneAddress *from, LinphoneAddress *to)
 {
     LinphoneCallLog *cl = ms_new0(LinphoneCallLog, 1);
+    cl->lc              = call->core;
     cl->dir             = call->dir;
     cl->start_date_time = call->start_time;
     set_call_log_date(cl, cl->start_date_time);
@@ -119,12 +120,17 @@ void call_logs_write_to_config_file(
     LpConfig *cfg = lc->config;
 
     if (linphone_core_get_global_state(lc) == LinphoneGlobalStartup) return;
+    if (linphone_core_call_log_storage_enabled(lc)) return;
 
+    /*
+     * Sections are updated in place rather than cleaned and rewritten: values
+     * that did not change do not mark the config as modified, and unchanged
+     * sections are not serialized again at the next sync.
+     */
     for (i = 0, elem = lc->call_logs; elem != NULL; elem = elem->next, ++i)
     {
         LinphoneCallLog *cl = (LinphoneCallLog *)elem->data;
         snprintf(logsection, sizeof(logsection), "call_log_%i", i);
-        lp_config_clean_section(cfg, logsection);
         lp_config_set_int(cfg, logsection, "dir",    cl->dir);
         lp_config_set_int(cfg, logsection, "status", cl->status);
         tmp = linphone_address_as_string(cl->from);
@@ -134,10 +140,17 @@ void call_logs_write_to_config_file(
         lp_config_set_string(cfg, logsection, "to", tmp);
         ms_free(tmp);
         if (cl->start_date_time)
+        {
             lp_config_set_int64(cfg, logsection, "start_date_time", (int64_t)cl->start_date_time);
-        else lp_config_set_string(cfg, logsection, "start_date", cl->start_date);
+            lp_config_set_string(cfg, logsection, "start_date", NULL);
+        }
+        else
+        {
+            lp_config_set_string(cfg, logsection, "start_date", cl->start_date);
+            lp_config_set_string(cfg, logsection, "start_date_time", NULL);
+        }
         lp_config_set_int(cfg, logsection, "duration", cl->duration);
-        if (cl->refkey) lp_config_set_string(cfg, logsection, "refkey", cl->refkey);
+        lp_config_set_string(cfg, logsection, "refkey", cl->refkey);
         lp_config_set_float(cfg, logsection, "quality", cl->quality);
         lp_config_set_int(cfg, logsection, "video_enabled", cl->video_enabled);
         lp_config_set_string(cfg, logsection, "call_id", cl->call_id);
@@ -175,6 +188,7 @@ static void call_logs_read_from_config_file(
         if (lp_config_has_section(cfg, logsection))
         {
             LinphoneCallLog *cl = ms_new0(LinphoneCallLog, 1);
+            cl->lc     = lc;
             cl->dir    = lp_config_get_int(cfg, logsection, "dir", 0);
             cl->status = lp_config_get_int(cfg, logsection, "status", 0);
             tmp        = lp_config_get_string(cfg, logsection, "from", NULL);
@@ -315,6 +329,7 @@ void linphone_call_log_set_ref_key(
         cl->refkey = NULL;
     }
     if (refkey) cl->refkey = ms_strdup(refkey);
+    if (cl->lc != NULL) linphone_core_call_log_store_ref_key(cl->lc, cl);
 }
 
 /**
@@ -1122,6 +1137,7 @@ static void ui_config_read(
         linphone_core_add_friend(lc, lf);
     }
     call_logs_read_from_config_file(lc);
+    lc->call_logs_loaded = TRUE;
 }
 
 /*
@@ -1898,6 +1914,7 @@ void linphone_core_set_rtp_no_xmit_on_audio_mute(
 void linphone_core_set_audio_port(
     LinphoneCore *lc, int port)
 {
+    linphone_core_flush_audio_stream_pool(lc);
     lc->rtp_conf.audio_rtp_min_port = lc->rtp_conf.audio_rtp_max_port = port;
 }
 
@@ -1908,6 +1925,7 @@ void linphone_core_set_audio_port(
 void linphone_core_set_audio_port_range(
     LinphoneCore *lc, int min_port, int max_port)
 {
+    linphone_core_flush_audio_stream_pool(lc);
     lc->rtp_conf.audio_rtp_min_port = min_port;
     lc->rtp_conf.audio_rtp_max_port = max_port;
 }
@@ -2198,6 +2216,7 @@ void linphone_core_enable_ipv6(
     if (lc->sip_conf.ipv6_enabled != val)
     {
         lc->sip_conf.ipv6_enabled = val;
+        linphone_core_flush_audio_stream_pool(lc);
         if (lc->sal)
         {
             /* we need to restart eXosip */
@@ -2355,6 +2374,8 @@ static void linphone_core_do_plugin_tasks(
  * - performs registration to proxies
  * - authentication retries
  * The application MUST call this function periodically, in its main loop.
+ * Instead of a fixed timer, the loop can wait with linphone_core_wait_for_work()
+ * before each call.
  * Be careful that this function must be called from the same thread as
  * other liblinphone methods. If it is not the case make sure all liblinphone calls are
  * serialized with a mutex.
@@ -2367,6 +2388,7 @@ void linphone_core_iterate(
     time_t       curtime            = time(NULL);
     int          elapsed;
     bool_t       one_second_elapsed = FALSE;
+    bool_t       stream_tasks_done;
 
     if (curtime - lc->prevtime >= 1)
     {
@@ -2397,17 +2419,20 @@ void linphone_core_iterate(
     proxy_update(lc);
 
     //we have to iterate for each call
-    calls = lc->calls;
+    stream_tasks_done = linphone_core_run_call_workers(lc, one_second_elapsed);
+    calls             = lc->calls;
     while (calls != NULL)
     {
         call    = (LinphoneCall *)calls->data;
-        ms_message("calls(%X)call(%X)", calls, call);
         elapsed = curtime - call->start_time;
         /* get immediately a reference to next one in case the one
            we are going to examine is destroy and removed during
            linphone_core_start_invite() */
         calls   = calls->next;
-        linphone_call_background_tasks(call, one_second_elapsed);
+        if (stream_tasks_done)
+            linphone_call_process_stream_events(call);
+        else
+            linphone_call_background_tasks(call, one_second_elapsed);
         if (call->state == LinphoneCallOutgoingInit && (elapsed >= lc->sip_conf.delayed_timeout))
         {
             /*start the call even if the OPTIONS reply did not arrive*/
@@ -2429,7 +2454,8 @@ void linphone_core_iterate(
         }
         if (call->state == LinphoneCallIncomingReceived)
         {
-            ms_message("incoming call ringing for %i seconds", elapsed);
+            if (one_second_elapsed)
+                ms_message("incoming call ringing for %i seconds", elapsed);
             if (elapsed > lc->sip_conf.inc_timeout)
             {
                 LinphoneReason decline_reason;
@@ -2467,19 +2493,75 @@ void linphone_core_iterate(
     if (lc->initial_subscribes_sent == FALSE && lc->netup_time != 0 &&
         (curtime - lc->netup_time) > 3)
     {
-        linphone_core_send_initial_subscribes(lc);
-        lc->initial_subscribes_sent = TRUE;
+        lc->initial_subscribes_sent = linphone_core_send_initial_subscribes(lc);
     }
 
+    linphone_core_message_storage_flush(lc);
+    linphone_core_fill_audio_stream_pool(lc);
+
     if (one_second_elapsed)
     {
         if (lp_config_needs_commit(lc->config))
         {
-            lp_config_sync(lc->config);
+            lp_config_sync_async(lc->config);
         }
     }
 }
 
+/* media streams, ring and preview players and hooks post their events without waking us */
+static bool_t linphone_core_needs_polling(
+    LinphoneCore *lc)
+{
+    return lc->calls != NULL || lc->ringstream != NULL || lc->previewstream != NULL
+           || lc->ecc != NULL || lc->hooks != NULL || lc->bl_reqs != NULL || lc->bl_refresh
+           || linphone_core_video_preview_enabled(lc);
+}
+
+/**
+ * Returns the delay in milliseconds after which linphone_core_iterate() has
+ * work to do even if no SIP event arrives.
+ *
+ * @ingroup initializing
+ * Timers of calls, registrations and configuration have a one second granularity,
+ * so an idle core only needs to be iterated once per second. While calls or other
+ * media are running, the delay is [misc] media_iterate_interval (20 ms by default).
+ **/
+int linphone_core_get_next_timeout(
+    LinphoneCore *lc)
+{
+    if (lc->preview_finished || linphone_core_audio_stream_pool_needs_fill(lc))
+        return 0;
+    if (linphone_core_needs_polling(lc))
+        return lp_config_get_int(lc->config, "misc", "media_iterate_interval", 20);
+    return 1000;
+}
+
+/**
+ * Blocks until linphone_core_iterate() has work to do.
+ *
+ * @ingroup initializing
+ * Returns as soon as a SIP event is received, or when the delay given by
+ * linphone_core_get_next_timeout() expires, but never waits more than
+ * max_wait_ms (-1 for no limit). The main loop then becomes:
+ * @code
+ * while (running) {
+ *     linphone_core_wait_for_work(lc, -1);
+ *     linphone_core_iterate(lc);
+ * }
+ * @endcode
+ * Returns TRUE if a SIP event is waiting, FALSE if the delay expired.
+ **/
+bool_t linphone_core_wait_for_work(
+    LinphoneCore *lc, int max_wait_ms)
+{
+    int timeout = linphone_core_get_next_timeout(lc);
+    if (max_wait_ms >= 0 && max_wait_ms < timeout)
+        timeout = max_wait_ms;
+    if (timeout == 0)
+        return FALSE;
+    return sal_wait_for_event(lc->sal, timeout) ? TRUE : FALSE;
+}
+
 /**
  * Interpret a call destination as supplied by the user, and returns a fully qualified
  * LinphoneAddress.
@@ -5015,17 +5097,153 @@ LinphoneFirewallPolicy linphone_core_get_firewall_policy(
     return lc->net_conf.firewall_policy;
 }
 
+static int call_log_compare_storage_id(
+    const void *a, const void *b)
+{
+    return ((const LinphoneCallLog *)a)->storage_id != ((const LinphoneCallLog *)b)->storage_id;
+}
+
+static LinphoneCallLog *call_log_copy(
+    const LinphoneCallLog *cl)
+{
+    LinphoneCallLog *copy = ms_new0(LinphoneCallLog, 1);
+    *copy              = *cl;
+    copy->from         = cl->from ? linphone_address_clone(cl->from) : NULL;
+    copy->to           = cl->to ? linphone_address_clone(cl->to) : NULL;
+    copy->refkey       = cl->refkey ? ms_strdup(cl->refkey) : NULL;
+    copy->call_id      = cl->call_id ? ms_strdup(cl->call_id) : NULL;
+    copy->user_pointer = NULL;
+    return copy;
+}
+
+static bool_t call_log_has_peer(
+    const LinphoneCallLog *cl, const char *peer)
+{
+    const LinphoneAddress *remote = (cl->dir == LinphoneCallIncoming) ? cl->from : cl->to;
+    char                  *tmp;
+    bool_t                ret;
+    if (remote == NULL) return FALSE;
+    tmp = linphone_address_as_string_uri_only(remote);
+    ret = (strcmp(tmp, peer) == 0);
+    ms_free(tmp);
+    return ret;
+}
+
+static MSList *call_history_page(
+    LinphoneCore *lc, const char *peer, bool_t missed_only, int offset, int count)
+{
+    const MSList *elem;
+    MSList       *ret = NULL;
+
+    if (linphone_core_call_log_storage_enabled(lc))
+        return linphone_core_call_log_storage_query(lc, peer, missed_only, offset, count);
+    /*without the sqlite storage the whole history is in memory*/
+    for (elem = lc->call_logs; elem != NULL && count > 0; elem = elem->next)
+    {
+        LinphoneCallLog *cl = (LinphoneCallLog *)elem->data;
+        if (missed_only && cl->status != LinphoneCallMissed) continue;
+        if (peer != NULL && !call_log_has_peer(cl, peer)) continue;
+        if (offset > 0)
+        {
+            offset--;
+            continue;
+        }
+        ret = ms_list_append(ret, call_log_copy(cl));
+        count--;
+    }
+    return ret;
+}
+
 /**
  * Get the list of call logs (past calls).
  *
+ * When call logs are stored in the sqlite database set with
+ * linphone_core_set_chat_database_path(), the list is read from it the first time
+ * it is asked for. linphone_core_get_call_history() is cheaper to browse large histories.
+ *
  * @ingroup call_logs
  **/
 const MSList *linphone_core_get_call_logs(
     LinphoneCore *lc)
 {
+    if (!lc->call_logs_loaded && linphone_core_call_log_storage_enabled(lc))
+    {
+        MSList *stored = linphone_core_call_log_storage_query(lc, NULL, FALSE, 0, lc->max_call_logs);
+        MSList *elem;
+        /*logs of the calls ended since the storage was opened may already be known by the application, keep these objects*/
+        for (elem = stored; elem != NULL; elem = elem->next)
+        {
+            MSList *known = ms_list_find_custom(lc->call_logs, call_log_compare_storage_id, elem->data);
+            if (known != NULL)
+            {
+                linphone_call_log_destroy((LinphoneCallLog *)elem->data);
+                elem->data    = known->data;
+                lc->call_logs = ms_list_remove_link(lc->call_logs, known);
+            }
+        }
+        ms_list_for_each(lc->call_logs, (void (*)(void *))linphone_call_log_destroy);
+        ms_list_free(lc->call_logs);
+        lc->call_logs = stored;
+    }
+    lc->call_logs_loaded = TRUE;
     return lc->call_logs;
 }
 
+/**
+ * Returns the number of call logs in the history.
+ *
+ * @ingroup call_logs
+ **/
+int linphone_core_get_call_history_size(
+    LinphoneCore *lc)
+{
+    if (linphone_core_call_log_storage_enabled(lc))
+        return linphone_core_call_log_storage_count(lc);
+    return ms_list_size(lc->call_logs);
+}
+
+/**
+ * Get a page of the call history, most recent call first.
+ *
+ * The returned list and the LinphoneCallLog it contains belong to the caller, free
+ * them with linphone_call_log_destroy() and ms_list_free().
+ * @param lc the linphone core object
+ * @param offset number of most recent calls to skip
+ * @param count maximum number of call logs to return
+ *
+ * @ingroup call_logs
+ **/
+MSList *linphone_core_get_call_history(
+    LinphoneCore *lc, int offset, int count)
+{
+    return call_history_page(lc, NULL, FALSE, offset, count);
+}
+
+/**
+ * Same as linphone_core_get_call_history(), restricted to the calls with @a addr.
+ *
+ * @ingroup call_logs
+ **/
+MSList *linphone_core_get_call_history_for_address(
+    LinphoneCore *lc, const LinphoneAddress *addr, int offset, int count)
+{
+    char   *peer = linphone_address_as_string_uri_only(addr);
+    MSList *ret  = call_history_page(lc, peer, FALSE, offset, count);
+    ms_free(peer);
+    return ret;
+}
+
+/**
+ * Same as linphone_core_get_call_history(), restricted to the missed calls.
+ *
+ * @ingroup call_logs
+ **/
+MSList *linphone_core_get_missed_call_history(
+    LinphoneCore *lc, int offset, int count)
+{
+    return call_history_page(lc, NULL, TRUE, offset, count);
+}
+
 /**
  * Erase the call log.
  *
@@ -5034,9 +5252,11 @@ const MSList *linphone_core_get_call_logs(
 void linphone_core_clear_call_logs(
     LinphoneCore *lc)
 {
-    lc->missed_calls = 0;
+    lc->missed_calls     = 0;
     ms_list_for_each(lc->call_logs, (void (*)(void *))linphone_call_log_destroy);
-    lc->call_logs    = ms_list_free(lc->call_logs);
+    lc->call_logs        = ms_list_free(lc->call_logs);
+    lc->call_logs_loaded = TRUE;
+    linphone_core_call_log_storage_clear(lc);
     call_logs_write_to_config_file(lc);
 }
 
@@ -5062,13 +5282,22 @@ void linphone_core_reset_missed_calls_count(
 /**
  * Remove a specific call log from call history list.
  * This function destroys the call log object. It must not be accessed anymore by the application after calling this function.
+ * A call log returned by linphone_core_get_call_history() can be passed too, the
+ * matching element of the list returned by linphone_core_get_call_logs() is then destroyed as well.
  * @param lc the linphone core object
  * @param a LinphoneCallLog object.
  **/
 void linphone_core_remove_call_log(
     LinphoneCore *lc, LinphoneCallLog *cl)
 {
-    lc->call_logs = ms_list_remove(lc->call_logs, cl);
+    MSList *elem = ms_list_find(lc->call_logs, cl);
+    if (elem == NULL && cl->storage_id != 0)
+    {
+        elem = ms_list_find_custom(lc->call_logs, call_log_compare_storage_id, cl);
+        if (elem != NULL) linphone_call_log_destroy((LinphoneCallLog *)elem->data);
+    }
+    if (elem != NULL) lc->call_logs = ms_list_remove_link(lc->call_logs, elem);
+    linphone_core_call_log_unstore(lc, cl);
     call_logs_write_to_config_file(lc);
     linphone_call_log_destroy(cl);
 }
@@ -6147,6 +6376,9 @@ void ui_config_uninit(
         ms_list_free(lc->friends);
         lc->friends = NULL;
     }
+    lc->initial_subscribes_next   = NULL;
+    lc->initial_subscribes_paused = FALSE;
+    linphone_core_free_friend_indexes(lc);
 }
 
 /**
@@ -6201,6 +6433,9 @@ static void linphone_core_uninit(
     /* save all config */
     net_config_uninit(lc);
     rtp_config_uninit(lc);
+    linphone_core_flush_audio_stream_pool(lc);
+    linphone_core_uninit_port_pools(lc);
+    linphone_core_stop_call_workers(lc);
     if (lc->ringstream) ring_stop(lc->ringstream);
     sound_config_uninit(lc);
     video_config_uninit(lc);
@@ -6234,6 +6469,8 @@ static void linphone_core_uninit(
 
     linphone_core_free_payload_types(lc);
     linphone_core_message_storage_close(lc);
+    if (lc->chat_db_file) ms_free(lc->chat_db_file);
+    linphone_core_free_chat_room_index(lc);
     ortp_exit();
     linphone_core_set_state(lc, LinphoneGlobalOff, "Off");
 #ifdef TUNNEL_ENABLED
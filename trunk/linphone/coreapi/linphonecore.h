@@ -395,6 +395,7 @@ const char *linphone_call_get_refer_to(const LinphoneCall *call);
 bool_t linphone_call_has_transfer_pending(const LinphoneCall *call);
 LinphoneCall *linphone_call_get_replaced_call(LinphoneCall *call);
 int linphone_call_get_duration(const LinphoneCall *call);
+int linphone_call_get_media_setup_time(const LinphoneCall *call);
 const LinphoneCallParams *linphone_call_get_current_params(LinphoneCall *call);
 const LinphoneCallParams *linphone_call_get_remote_params(LinphoneCall *call);
 void linphone_call_enable_camera(LinphoneCall *lc, bool_t enabled);
@@ -931,6 +932,10 @@ LinphoneCore *linphone_core_new_with_config(const LinphoneCoreVTable *vtable, st
 /* function to be periodically called in a main loop */
 /* For ICE to work properly it should be called every 20ms */
 void linphone_core_iterate(LinphoneCore *lc);
+
+int linphone_core_get_next_timeout(LinphoneCore *lc);
+
+bool_t linphone_core_wait_for_work(LinphoneCore *lc, int max_wait_ms);
 #if 0 /*not implemented yet*/
 /**
  * @ingroup initializing
@@ -1308,6 +1313,10 @@ void linphone_core_set_rtp_no_xmit_on_audio_mute(LinphoneCore *lc, bool_t val);
 
 /* returns a list of LinphoneCallLog */
 const MSList *linphone_core_get_call_logs(LinphoneCore *lc);
+int linphone_core_get_call_history_size(LinphoneCore *lc);
+MSList *linphone_core_get_call_history(LinphoneCore *lc, int offset, int count);
+MSList *linphone_core_get_call_history_for_address(LinphoneCore *lc, const LinphoneAddress *addr, int offset, int count);
+MSList *linphone_core_get_missed_call_history(LinphoneCore *lc, int offset, int count);
 void linphone_core_clear_call_logs(LinphoneCore *lc);
 int linphone_core_get_missed_calls_count(LinphoneCore *lc);
 void linphone_core_reset_missed_calls_count(LinphoneCore *lc);
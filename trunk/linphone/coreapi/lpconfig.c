@@ -36,39 +36,237 @@
     #include <sys/types.h>
     #include <sys/stat.h>
 #endif /*_WIN32_WCE*/
+#if !defined(WIN32)
+    #include <unistd.h>
+#elif !defined(_WIN32_WCE)
+    #include <io.h>
+#endif
 
 #define lp_new0(type, n) (type *)calloc(sizeof(type), n)
 
 #include "lpconfig.h"
 #include "Ext\libMemLeakDetection.h"
 
+/*
+ * Sections and items are kept in MSLists so that the file is written back in
+ * the order it was read, and are also indexed by name in small chained hash
+ * tables so that lookups do not have to walk the lists. Item keys are
+ * interned in a pool owned by the LpConfig: the same few keys are repeated in
+ * many sections (call logs, proxies, friends...).
+ */
+
+#define LP_HASH_MIN_SIZE 8
+
+typedef struct _LpHashNode {
+    struct _LpHashNode *next;   // next node in the same bucket
+    const char         *key;
+    unsigned int       hash;
+} LpHashNode;
+
+typedef struct _LpHashTable {
+    LpHashNode   **buckets;
+    unsigned int size;          // number of buckets, a power of two
+    unsigned int count;         // number of nodes
+} LpHashTable;
+
+typedef struct _LpKey {
+    LpHashNode node;            // entry in the key pool
+    char       str[1];          // the interned string
+} LpKey;
+
+/* parsed values cached in an item, reset whenever the value changes */
+#define LP_ITEM_HAS_INT     (1 << 0)
+#define LP_ITEM_HAS_INT64   (1 << 1)
+#define LP_ITEM_HAS_FLOAT   (1 << 2)
+#define LP_ITEM_BAD_FLOAT   (1 << 3)
+
 typedef struct _LpItem {
-    char *key;      // item's name
-    char *value;    // item's value
+    LpHashNode node;            // entry in the section index, must be first
+    const char *key;            // item's name, interned in the config key pool
+    char       *value;          // item's value
+    int        cached;          // LP_ITEM_* flags
+    int        int_value;
+    int64_t    int64_value;
+    float      float_value;
 } LpItem;
 
 typedef struct _LpSection {
-    char   *name;   // section name
-    MSList *items;  // items in the section
+    LpHashNode  node;           // entry in the config index, must be first
+    char        *name;          // section name
+    MSList      *items;         // items in the section
+    LpHashTable index;          // items by key
+    char        *text;          // serialized section, NULL when it changed
+    size_t      text_len;
 } LpSection;
 
+typedef struct _LpBuffer {
+    char   *data;
+    size_t len;
+    size_t size;
+} LpBuffer;
+
 struct _LpConfig {
-    FILE   *file;       // config file handle
-    char   *filename;   // config file name1
-    MSList *sections;   // sections that have been loaded in to memory
-    int    modified;
-    int    readonly;
+    FILE        *file;          // config file handle
+    char        *filename;      // config file name1
+    MSList      *sections;      // sections that have been loaded in to memory
+    LpHashTable index;          // sections by name
+    LpHashTable keys;           // pool of interned item keys
+    int         modified;
+    int         readonly;
+    /* background writer, started by the first lp_config_sync_async() */
+    ms_thread_t writer;
+    ms_mutex_t  lock;           // protects the fields below, and readonly once running
+    ms_cond_t   cond;
+    int         writer_running;
+    int         writing;        // the writer is busy with a snapshot
+    int         stop;
+    char        *pending;       // latest snapshot not written yet
+    size_t      pending_len;
 };
 
+static unsigned int lp_hash(
+    const char *str)
+{
+    /* FNV-1a */
+    unsigned int h = 2166136261U;
+    for (; *str != '\0'; str++)
+    {
+        h ^= (unsigned char)*str;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+static LpHashNode *lp_hash_table_find(
+    const LpHashTable *table, const char *key, unsigned int hash)
+{
+    LpHashNode *node;
+    if (table->size == 0)
+        return NULL;
+    for (node = table->buckets[hash & (table->size - 1)]; node != NULL; node = node->next)
+    {
+        if (node->hash == hash && strcmp(node->key, key) == 0)
+            return node;
+    }
+    return NULL;
+}
+
+static void lp_hash_table_resize(
+    LpHashTable *table, unsigned int size)
+{
+    LpHashNode   **buckets = lp_new0(LpHashNode *, size);
+    LpHashNode   *node, *next;
+    unsigned int i;
+
+    if (buckets == NULL)
+        return;     // keep the current buckets, only the chains get longer
+    for (i = 0; i < table->size; i++)
+    {
+        for (node = table->buckets[i]; node != NULL; node = next)
+        {
+            next                             = node->next;
+            node->next                       = buckets[node->hash & (size - 1)];
+            buckets[node->hash & (size - 1)] = node;
+        }
+    }
+    free(table->buckets);
+    table->buckets = buckets;
+    table->size    = size;
+}
+
+static void lp_hash_table_add(
+    LpHashTable *table, LpHashNode *node)
+{
+    unsigned int b;
+    if (table->count >= table->size)
+        lp_hash_table_resize(table, table->size ? table->size * 2 : LP_HASH_MIN_SIZE);
+    if (table->size == 0)
+        return;
+    b                  = node->hash & (table->size - 1);
+    node->next         = table->buckets[b];
+    table->buckets[b]  = node;
+    table->count++;
+}
+
+static void lp_hash_table_remove(
+    LpHashTable *table, LpHashNode *node)
+{
+    LpHashNode **prev;
+    if (table->size == 0)
+        return;
+    for (prev = &table->buckets[node->hash & (table->size - 1)]; *prev != NULL; prev = &(*prev)->next)
+    {
+        if (*prev == node)
+        {
+            *prev = node->next;
+            table->count--;
+            return;
+        }
+    }
+}
+
+static void lp_hash_table_free(
+    LpHashTable *table)
+{
+    free(table->buckets);
+    table->buckets = NULL;
+    table->size    = 0;
+    table->count   = 0;
+}
+
+// return the pooled copy of @key, which lives as long as @lpconfig
+static const char *lp_config_intern_key(
+    LpConfig *lpconfig, const char *key)
+{
+    unsigned int hash = lp_hash(key);
+    LpKey        *k   = (LpKey *)lp_hash_table_find(&lpconfig->keys, key, hash);
+    if (k == NULL)
+    {
+        size_t len = strlen(key);
+        k = (LpKey *)malloc(sizeof(LpKey) + len);
+        if (k == NULL)
+            return NULL;
+        memcpy(k->str, key, len + 1);
+        k->node.key  = k->str;
+        k->node.hash = hash;
+        lp_hash_table_add(&lpconfig->keys, &k->node);
+    }
+    return k->str;
+}
+
+static void lp_config_free_keys(
+    LpConfig *lpconfig)
+{
+    LpHashNode   *node, *next;
+    unsigned int i;
+    for (i = 0; i < lpconfig->keys.size; i++)
+    {
+        for (node = lpconfig->keys.buckets[i]; node != NULL; node = next)
+        {
+            next = node->next;
+            free(node);
+        }
+    }
+    lp_hash_table_free(&lpconfig->keys);
+}
+
 // create a new item
 LpItem *lp_item_new(
-    const char *key, const char *value)
+    LpConfig *lpconfig, const char *key, const char *value)
 {
     LpItem *item = lp_new0(LpItem, 1);
     if (item != NULL)
     {
-        item->key   = ortp_strdup(key);
-        item->value = ortp_strdup(value);
+        item->key       = lp_config_intern_key(lpconfig, key);
+        item->value     = ortp_strdup(value);
+        item->node.key  = item->key;
+        item->node.hash = lp_hash(key);
+        if (item->key == NULL)
+        {
+            lp_free(item->value);
+            free(item);
+            return NULL;
+        }
     }
     return item;
 }
@@ -80,7 +278,9 @@ LpSection *lp_section_new(
     LpSection *sec = lp_new0(LpSection, 1);
     if (sec != NULL)
     {
-        sec->name = ortp_strdup(name);
+        sec->name      = ortp_strdup(name);
+        sec->node.key  = sec->name;
+        sec->node.hash = lp_hash(name);
     }
     return sec;
 }
@@ -92,12 +292,32 @@ void lp_item_destroy(
     LpItem *item = (LpItem *)pitem;
     if (item != NULL)
     {
-        lp_free(item->key);
         lp_free(item->value);
         free(item);
     }
 }
 
+// set value @value of item @item
+void lp_item_set_value(
+    LpItem *item, const char *value)
+{
+    if (item != NULL && value != NULL)
+    {
+        lp_free(item->value);   // free original value
+        item->value  = ortp_strdup(value);
+        item->cached = 0;
+    }
+}
+
+// forget the serialized text of section @sec after a change
+static void lp_section_touch(
+    LpSection *sec)
+{
+    free(sec->text);
+    sec->text     = NULL;
+    sec->text_len = 0;
+}
+
 // destroy a section
 void lp_section_destroy(
     LpSection *sec)
@@ -105,8 +325,10 @@ void lp_section_destroy(
     if (sec != NULL)
     {
         lp_free(sec->name);
+        free(sec->text);
         ms_list_for_each(sec->items, lp_item_destroy);
         ms_list_free(sec->items);
+        lp_hash_table_free(&sec->index);
         free(sec);
     }
 }
@@ -118,6 +340,8 @@ void lp_section_add_item(
     if (item == NULL || sec == NULL)
         return;
     sec->items = ms_list_append(sec->items, (void *)item);
+    lp_hash_table_add(&sec->index, &item->node);
+    lp_section_touch(sec);
 }
 
 // add a section @section in config @lpconfig
@@ -127,6 +351,7 @@ void lp_config_add_section(
     if (section == NULL || lpconfig == NULL)
         return;
     lpconfig->sections = ms_list_append(lpconfig->sections, (void *)section);
+    lp_hash_table_add(&lpconfig->index, &section->node);
 }
 
 // remove and destroy a section @section in config @lpconfig
@@ -136,6 +361,7 @@ void lp_config_remove_section(
     if (section == NULL || lpconfig == NULL)
         return;
     lpconfig->sections = ms_list_remove(lpconfig->sections, (void *)section);
+    lp_hash_table_remove(&lpconfig->index, &section->node);
     lp_section_destroy(section);
 }
 
@@ -154,44 +380,24 @@ static bool_t is_first_char(
 LpSection *lp_config_find_section(
     const LpConfig *lpconfig, const char *name)
 {
-    LpSection *sec;
-    MSList    *elem;
-
     if (name == NULL || lpconfig == NULL)
         return NULL;
-    /*printf("Looking for section %s\n",name);*/
-    for (elem = lpconfig->sections; elem != NULL; elem = ms_list_next(elem))
-    {
-        sec = (LpSection *)elem->data;
-        if (strcmp(sec->name, name) == 0)
-        {
-            /*printf("Section %s found\n",name);*/
-            return sec;
-        }
-    }
-    return NULL;
+    return (LpSection *)lp_hash_table_find(&lpconfig->index, name, lp_hash(name));
 }
 
 // find item with item name @name in section @sec in memory
 LpItem *lp_section_find_item(
     const LpSection *sec, const char *name)
 {
-    MSList *elem;
-    LpItem *item;
-
     if (name == NULL || sec == NULL)
         return NULL;
-    /*printf("Looking for item %s\n",name);*/
-    for (elem = sec->items; elem != NULL; elem = ms_list_next(elem))
-    {
-        item = (LpItem *)elem->data;
-        if (strcmp(item->key, name) == 0)
-        {
-            /*printf("Item %s found\n",name);*/
-            return item;
-        }
-    }
-    return NULL;
+    return (LpItem *)lp_hash_table_find(&sec->index, name, lp_hash(name));
+}
+
+static LpItem *lp_config_find_item(
+    const LpConfig *lpconfig, const char *section, const char *key)
+{
+    return lp_section_find_item(lp_config_find_section(lpconfig, section), key);
 }
 
 // parse file @file into config @lpconfig
@@ -270,12 +476,12 @@ void lp_config_parse(
                             LpItem *item = lp_section_find_item(cur, key);
                             if (item == NULL)
                             {
-                                lp_section_add_item(cur, lp_item_new(key, pos1));   // pos1 is the item value
+                                lp_section_add_item(cur, lp_item_new(lpconfig, key, pos1));   // pos1 is the item value
                             }
-                            else
+                            else if (strcmp(item->value, pos1) != 0)
                             {
-                                lp_free(item->value);
-                                item->value = strdup(pos1);
+                                lp_item_set_value(item, pos1);
+                                lp_section_touch(cur);
                             }
                             /*ms_message("Found %s=%s",key,pos1);*/
                         }
@@ -350,25 +556,19 @@ int lp_config_read_file(
     return -1;
 }
 
-// set value @value of item @item
-void lp_item_set_value(
-    LpItem *item, const char *value)
-{
-    if (item != NULL && value != NULL)
-    {
-        lp_free(item->value);   // free original value
-        item->value = ortp_strdup(value);
-    }
-}
+static void lp_config_stop_writer(LpConfig *lpconfig);
 
 void lp_config_destroy(
     LpConfig *lpconfig)
 {
     if (lpconfig != NULL)
     {
+        lp_config_stop_writer(lpconfig);
         lp_free(lpconfig->filename);
         ms_list_for_each(lpconfig->sections, (void (*)(void *))lp_section_destroy);
         ms_list_free(lpconfig->sections);
+        lp_hash_table_free(&lpconfig->index);
+        lp_config_free_keys(lpconfig);
         free(lpconfig);
     }
 }
@@ -379,21 +579,17 @@ void lp_section_remove_item(
     if (sec != NULL && item != NULL)
     {
         sec->items = ms_list_remove(sec->items, (void *)item);
+        lp_hash_table_remove(&sec->index, &item->node);
         lp_item_destroy(item);
+        lp_section_touch(sec);
     }
 }
 
 const char *lp_config_get_string(
     const LpConfig *lpconfig, const char *section, const char *key, const char *default_string)
 {
-    LpSection *sec;
-    LpItem    *item;
-    sec = lp_config_find_section(lpconfig, section);
-    if (sec != NULL)
-    {
-        item = lp_section_find_item(sec, key);
-        if (item != NULL) return item->value;
-    }
+    LpItem *item = lp_config_find_item(lpconfig, section, key);
+    if (item != NULL) return item->value;
     return default_string;
 }
 
@@ -425,16 +621,21 @@ bool_t lp_config_get_range(
 int lp_config_get_int(
     const LpConfig *lpconfig, const char *section, const char *key, int default_value)
 {
-    const char *str = lp_config_get_string(lpconfig, section, key, NULL);
-    if (str != NULL)
+    LpItem *item = lp_config_find_item(lpconfig, section, key);
+    if (item != NULL)
     {
-        int ret = 0;
-        if (strstr(str, "0x") == str)
+        if (!(item->cached & LP_ITEM_HAS_INT))
         {
-            sscanf(str, "%x", &ret);
+            int ret = 0;
+            if (strstr(item->value, "0x") == item->value)
+            {
+                sscanf(item->value, "%x", &ret);
+            }
+            else ret = atoi(item->value);
+            item->int_value = ret;
+            item->cached   |= LP_ITEM_HAS_INT;
         }
-        else ret = atoi(str);
-        return ret;
+        return item->int_value;
     }
     else return default_value;
 }
@@ -442,14 +643,19 @@ int lp_config_get_int(
 int64_t lp_config_get_int64(
     const LpConfig *lpconfig, const char *section, const char *key, int64_t default_value)
 {
-    const char *str = lp_config_get_string(lpconfig, section, key, NULL);
-    if (str != NULL)
+    LpItem *item = lp_config_find_item(lpconfig, section, key);
+    if (item != NULL)
     {
+        if (!(item->cached & LP_ITEM_HAS_INT64))
+        {
 #ifdef WIN32
-        return (int64_t)_atoi64(str);
+            item->int64_value = (int64_t)_atoi64(item->value);
 #else
-        return atoll(str);
+            item->int64_value = atoll(item->value);
 #endif
+            item->cached     |= LP_ITEM_HAS_INT64;
+        }
+        return item->int64_value;
     }
     else return default_value;
 }
@@ -457,11 +663,17 @@ int64_t lp_config_get_int64(
 float lp_config_get_float(
     const LpConfig *lpconfig, const char *section, const char *key, float default_value)
 {
-    const char *str = lp_config_get_string(lpconfig, section, key, NULL);
-    float      ret  = default_value;
-    if (str == NULL) return default_value;
-    sscanf(str, "%f", &ret);
-    return ret;
+    LpItem *item = lp_config_find_item(lpconfig, section, key);
+    if (item == NULL) return default_value;
+    if (!(item->cached & (LP_ITEM_HAS_FLOAT | LP_ITEM_BAD_FLOAT)))
+    {
+        /*an unparsable value means the default one, whatever it is*/
+        if (sscanf(item->value, "%f", &item->float_value) == 1)
+            item->cached |= LP_ITEM_HAS_FLOAT;
+        else item->cached |= LP_ITEM_BAD_FLOAT;
+    }
+    if (item->cached & LP_ITEM_BAD_FLOAT) return default_value;
+    return item->float_value;
 }
 
 void lp_config_set_string(
@@ -474,22 +686,26 @@ void lp_config_set_string(
         item = lp_section_find_item(sec, key);
         if (item != NULL)
         {
-            if (value != NULL)
+            if (value == NULL)
+                lp_section_remove_item(sec, item);
+            else if (strcmp(item->value, value) != 0)
+            {
                 lp_item_set_value(item, value);
-            else lp_section_remove_item(sec, item);
-        }
-        else
-        {
-            if (value != NULL)
-                lp_section_add_item(sec, lp_item_new(key, value));
+                lp_section_touch(sec);
+            }
+            else return;    /*unchanged, nothing to write*/
         }
+        else if (value != NULL)
+            lp_section_add_item(sec, lp_item_new(lpconfig, key, value));
+        else return;
     }
     else if (value != NULL)
     {
         sec = lp_section_new(section);
         lp_config_add_section(lpconfig, sec);
-        lp_section_add_item(sec, lp_item_new(key, value));
+        lp_section_add_item(sec, lp_item_new(lpconfig, key, value));
     }
+    else return;
     lpconfig->modified++;
 }
 
@@ -533,39 +749,268 @@ void lp_config_set_float(
     lp_config_set_string(lpconfig, section, key, tmp);
 }
 
-void lp_item_write(
-    LpItem *item, FILE *file)
+static int lp_buffer_append(
+    LpBuffer *buf, const char *str, size_t len)
+{
+    if (buf->len + len + 1 > buf->size)
+    {
+        size_t size = buf->size ? buf->size : 4096;
+        char   *data;
+        while (buf->len + len + 1 > size)
+            size *= 2;
+        data = (char *)realloc(buf->data, size);
+        if (data == NULL)
+            return -1;
+        buf->data = data;
+        buf->size = size;
+    }
+    memcpy(buf->data + buf->len, str, len);
+    buf->len            += len;
+    buf->data[buf->len]  = '\0';
+    return 0;
+}
+
+// serialize section @sec, unless its text from a previous sync is still valid
+static int lp_section_serialize(
+    LpSection *sec)
+{
+    LpBuffer buf = {NULL, 0, 0};
+    MSList   *elem;
+    int      err = 0;
+
+    if (sec->text != NULL)
+        return 0;
+    err |= lp_buffer_append(&buf, "[", 1);
+    err |= lp_buffer_append(&buf, sec->name, strlen(sec->name));
+    err |= lp_buffer_append(&buf, "]\n", 2);
+    for (elem = sec->items; elem != NULL; elem = ms_list_next(elem))
+    {
+        LpItem *item = (LpItem *)elem->data;
+        err |= lp_buffer_append(&buf, item->key, strlen(item->key));
+        err |= lp_buffer_append(&buf, "=", 1);
+        err |= lp_buffer_append(&buf, item->value, strlen(item->value));
+        err |= lp_buffer_append(&buf, "\n", 1);
+    }
+    err |= lp_buffer_append(&buf, "\n", 1);
+    if (err != 0)
+    {
+        free(buf.data);
+        return -1;
+    }
+    sec->text     = buf.data;
+    sec->text_len = buf.len;
+    return 0;
+}
+
+// build the whole file content in @buf, only dirty sections are serialized again
+static int lp_config_serialize(
+    LpConfig *lpconfig, LpBuffer *buf)
 {
-    fprintf(file, "%s=%s\n", item->key, item->value);
+    MSList *elem;
+    for (elem = lpconfig->sections; elem != NULL; elem = ms_list_next(elem))
+    {
+        LpSection *sec = (LpSection *)elem->data;
+        if (lp_section_serialize(sec) != 0 || lp_buffer_append(buf, sec->text, sec->text_len) != 0)
+        {
+            free(buf->data);
+            buf->data = NULL;
+            return -1;
+        }
+    }
+    if (buf->data == NULL)
+        return lp_buffer_append(buf, "", 0);
+    return 0;
 }
 
-void lp_section_write(
-    LpSection *sec, FILE *file)
+static int lp_rename(
+    const char *from, const char *to)
 {
-    fprintf(file, "[%s]\n", sec->name);
-    ms_list_for_each2(sec->items, (void (*)(void *, void *))lp_item_write, (void *)file);
-    fprintf(file, "\n");
+#if defined(WIN32) && !defined(_WIN32_WCE)
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) ? 0 : -1;
+#else
+#if defined(_WIN32_WCE)
+    remove(to);
+#endif
+    return rename(from, to);
+#endif
 }
 
-int lp_config_sync(
-    LpConfig *lpconfig)
+static int lp_write_data(
+    FILE *file, const char *data, size_t len)
+{
+    int err = 0;
+    if (fwrite(data, 1, len, file) != len) err = -1;
+    if (fflush(file) != 0) err = -1;
+#if !defined(WIN32)
+    if (fsync(fileno(file)) != 0) err = -1;
+#elif !defined(_WIN32_WCE)
+    if (_commit(_fileno(file)) != 0) err = -1;
+#endif
+    if (fclose(file) != 0) err = -1;
+    return err;
+}
+
+#define LP_WRITE_READONLY -2
+
+/*
+ * Write @data to a temporary file next to @filename and rename it over the
+ * latter, so that a crash leaves either the old or the new content. Falls back
+ * to rewriting the file in place when the directory is not writable.
+ * Runs in the writer thread too.
+ */
+static int lp_config_write(
+    const char *filename, const char *data, size_t len)
 {
+    char *tmpname = ortp_strdup_printf("%s.tmp", filename);
     FILE *file;
-    if (lpconfig->filename == NULL) return -1;
-    if (lpconfig->readonly) return 0;
+    int  err      = -1;
+
 #ifndef WIN32
     /* don't create group/world-accessible files */
     (void) umask(S_IRWXG | S_IRWXO);
 #endif
-    file = fopen(lpconfig->filename, "w");
-    if (file == NULL)
+    file = fopen(tmpname, "w");
+    if (file != NULL)
     {
-        ms_warning("Could not write %s ! Maybe it is read-only. Configuration will not be saved.", lpconfig->filename);
-        lpconfig->readonly = 1;
-        return -1;
+        err = lp_write_data(file, data, len);
+        if (err == 0)
+            err = lp_rename(tmpname, filename);
+        if (err != 0)
+        {
+            ms_warning("Could not write %s, configuration not saved.", tmpname);
+            remove(tmpname);
+        }
+    }
+    else if ((file = fopen(filename, "w")) != NULL)
+    {
+        err = lp_write_data(file, data, len);
+    }
+    else
+    {
+        ms_warning("Could not write %s ! Maybe it is read-only. Configuration will not be saved.", filename);
+        err = LP_WRITE_READONLY;
+    }
+    ms_free(tmpname);
+    return err;
+}
+
+static void *lp_config_writer(
+    void *data)
+{
+    LpConfig *lpconfig = (LpConfig *)data;
+    char     *snapshot;
+    size_t   len;
+
+    ms_mutex_lock(&lpconfig->lock);
+    for (;;)
+    {
+        while (lpconfig->pending == NULL && !lpconfig->stop)
+            ms_cond_wait(&lpconfig->cond, &lpconfig->lock);
+        if (lpconfig->pending == NULL)
+            break;  /*stopped and nothing left to write*/
+        snapshot             = lpconfig->pending;
+        len                  = lpconfig->pending_len;
+        lpconfig->pending    = NULL;
+        lpconfig->writing    = 1;
+        if (!lpconfig->readonly)
+        {
+            int err;
+            ms_mutex_unlock(&lpconfig->lock);
+            err = lp_config_write(lpconfig->filename, snapshot, len);
+            ms_mutex_lock(&lpconfig->lock);
+            if (err == LP_WRITE_READONLY) lpconfig->readonly = 1;
+        }
+        free(snapshot);
+        lpconfig->writing = 0;
+        ms_cond_broadcast(&lpconfig->cond);
+    }
+    ms_mutex_unlock(&lpconfig->lock);
+    return NULL;
+}
+
+static void lp_config_stop_writer(
+    LpConfig *lpconfig)
+{
+    if (!lpconfig->writer_running)
+        return;
+    ms_mutex_lock(&lpconfig->lock);
+    lpconfig->stop = 1;
+    ms_cond_broadcast(&lpconfig->cond);
+    ms_mutex_unlock(&lpconfig->lock);
+    ms_thread_join(lpconfig->writer, NULL);
+    ms_mutex_destroy(&lpconfig->lock);
+    ms_cond_destroy(&lpconfig->cond);
+    lpconfig->writer_running = 0;
+}
+
+int lp_config_sync(
+    LpConfig *lpconfig)
+{
+    LpBuffer buf = {NULL, 0, 0};
+    int      err = 0;
+
+    if (lpconfig->filename == NULL) return -1;
+    if (lp_config_serialize(lpconfig, &buf) != 0) return -1;
+    if (lpconfig->writer_running)
+    {
+        /*this snapshot supersedes any pending one, and must land after the current write*/
+        ms_mutex_lock(&lpconfig->lock);
+        free(lpconfig->pending);
+        lpconfig->pending = NULL;
+        while (lpconfig->writing)
+            ms_cond_wait(&lpconfig->cond, &lpconfig->lock);
+        if (!lpconfig->readonly)
+            err = lp_config_write(lpconfig->filename, buf.data, buf.len);
+        if (err == LP_WRITE_READONLY) lpconfig->readonly = 1;
+        ms_mutex_unlock(&lpconfig->lock);
+    }
+    else if (!lpconfig->readonly)
+    {
+        err = lp_config_write(lpconfig->filename, buf.data, buf.len);
+        if (err == LP_WRITE_READONLY) lpconfig->readonly = 1;
+    }
+    free(buf.data);
+    if (err != 0) return -1;
+    lpconfig->modified = 0;
+    return 0;
+}
+
+int lp_config_sync_async(
+    LpConfig *lpconfig)
+{
+    LpBuffer buf = {NULL, 0, 0};
+
+    if (lpconfig->filename == NULL) return -1;
+    if (!lpconfig->writer_running)
+    {
+        if (lpconfig->readonly) return 0;
+        ms_mutex_init(&lpconfig->lock, NULL);
+        ms_cond_init(&lpconfig->cond, NULL);
+        lpconfig->stop = 0;
+        if (ms_thread_create(&lpconfig->writer, NULL, lp_config_writer, lpconfig) != 0)
+        {
+            ms_warning("Could not start the config writer thread, syncing %s synchronously.", lpconfig->filename);
+            ms_mutex_destroy(&lpconfig->lock);
+            ms_cond_destroy(&lpconfig->cond);
+            return lp_config_sync(lpconfig);
+        }
+        lpconfig->writer_running = 1;
+    }
+    if (lp_config_serialize(lpconfig, &buf) != 0) return -1;
+    ms_mutex_lock(&lpconfig->lock);
+    if (lpconfig->readonly)
+    {
+        ms_mutex_unlock(&lpconfig->lock);
+        free(buf.data);
+        lpconfig->modified = 0;
+        return 0;
     }
-    ms_list_for_each2(lpconfig->sections, (void (*)(void *, void *))lp_section_write, (void *)file);
-    fclose(file);
+    /*bursts of changes made while the writer is busy collapse into one write*/
+    free(lpconfig->pending);
+    lpconfig->pending     = buf.data;
+    lpconfig->pending_len = buf.len;
+    ms_cond_broadcast(&lpconfig->cond);
+    ms_mutex_unlock(&lpconfig->lock);
     lpconfig->modified = 0;
     return 0;
 }
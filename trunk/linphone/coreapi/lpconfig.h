@@ -171,10 +171,24 @@ void lp_config_set_int64(LpConfig *lpconfig,const char *section, const char *key
 void lp_config_set_float(LpConfig *lpconfig,const char *section, const char *key, float value);	
 /**
  * Writes the config file to disk.
+ *
+ * The content goes to a temporary file first, which is then renamed over the
+ * config file, so that a crash never leaves a truncated file behind.
+ * Waits for a write started by lp_config_sync_async() to complete.
  * 
  * @ingroup misc
 **/
 int lp_config_sync(LpConfig *lpconfig);
+/**
+ * Same as lp_config_sync() but the file is written by a background thread.
+ *
+ * Only the sections modified since the previous sync are serialized again
+ * before returning. A snapshot still waiting for the writer is replaced by the
+ * newer one. lp_config_destroy() waits for pending writes.
+ *
+ * @ingroup misc
+**/
+int lp_config_sync_async(LpConfig *lpconfig);
 /**
  * Returns 1 if a given section is present in the configuration.
  *
@@ -19,6 +19,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "private.h"
 #include "linphonecore.h"
+#include "lpconfig.h"
 #include "Ext\libMemLeakDetection.h"
 
 #ifdef WIN32
@@ -40,25 +41,30 @@ static const char *days[]={"Sun","Mon","Tue","Wed","Thu","Fri","Sat"};
 static const char *months[]={"Jan","Feb","Mar","Apr","May","Jun","Jul","Aug","Sep","Oct","Nov","Dec"};
 
 
-static void create_chat_message(char **argv, void *data){
-	LinphoneChatRoom *cr = (LinphoneChatRoom *)data;
-	LinphoneChatMessage* new_message = linphone_chat_room_create_message(cr,argv[4]);
+#define MESSAGE_COLUMNS "id,localContact,remoteContact,direction,message,time,read,status"
+
+/*how long a connection waits for the other one to release the database, in ms*/
+#define MESSAGE_STORAGE_BUSY_TIMEOUT 5000
+
+static LinphoneChatMessage *create_chat_message(LinphoneChatRoom *cr, sqlite3_stmt *stmt){
+	LinphoneChatMessage* new_message = linphone_chat_room_create_message(cr,(const char*)sqlite3_column_text(stmt,4));
+	const char *date=(const char*)sqlite3_column_text(stmt,5);
 	LinphoneAddress *from;
 	struct tm ret={0};
 	char tmp1[80]={0};
 	char tmp2[80]={0};
 	
-	if(atoi(argv[3])==LinphoneChatMessageIncoming){
-		from=linphone_address_new(argv[2]);
+	if(sqlite3_column_int(stmt,3)==LinphoneChatMessageIncoming){
+		from=linphone_address_new((const char*)sqlite3_column_text(stmt,2));
 	} else {
-		from=linphone_address_new(argv[1]);
+		from=linphone_address_new((const char*)sqlite3_column_text(stmt,1));
 	}
 	linphone_chat_message_set_from(new_message,from);
 	linphone_address_destroy(from);
 
-	if(argv[5]!=NULL){
+	if(date!=NULL){
 		int i,j;
-		sscanf(argv[5],"%3c %3c%d%d:%d:%d %d",tmp1,tmp2,&ret.tm_mday,
+		sscanf(date,"%3c %3c%d%d:%d:%d %d",tmp1,tmp2,&ret.tm_mday,
 	             &ret.tm_hour,&ret.tm_min,&ret.tm_sec,&ret.tm_year);
 		ret.tm_year-=1900;
 		for(i=0;i<7;i++) { 
@@ -69,24 +75,11 @@ static void create_chat_message(char **argv, void *data){
 		}
 		ret.tm_isdst=-1;
 	}
-	new_message->time=argv[5]!=NULL ? mktime(&ret) : time(NULL);
-	new_message->state=atoi(argv[7]);
-	cr->messages_hist=ms_list_prepend(cr->messages_hist,new_message);
-}
-
-static int callback(void *data, int argc, char **argv, char **colName){
-    create_chat_message(argv,data);
-    return 0;
-}
-
-void linphone_sql_request_message(sqlite3 *db,const char *stmt,LinphoneChatRoom *cr){
-	char* errmsg=NULL;
-	int ret;
-	ret=sqlite3_exec(db,stmt,callback,cr,&errmsg);
-	if(ret != SQLITE_OK) {
-		ms_error("Error in creation: %s.\n", errmsg);
-		sqlite3_free(errmsg);
-	}
+	new_message->time=date!=NULL ? mktime(&ret) : time(NULL);
+	new_message->is_read=sqlite3_column_int(stmt,6);
+	new_message->state=sqlite3_column_int(stmt,7);
+	new_message->storage_id=sqlite3_column_int(stmt,0);
+	return new_message;
 }
 
 void linphone_sql_request(sqlite3* db,const char *stmt){
@@ -99,91 +92,278 @@ void linphone_sql_request(sqlite3* db,const char *stmt){
 	}
 }
 
+static sqlite3_stmt *linphone_sql_prepare(sqlite3 *db, const char *stmt){
+	sqlite3_stmt *ret=NULL;
+	if (sqlite3_prepare_v2(db,stmt,-1,&ret,NULL)!=SQLITE_OK){
+		ms_error("linphone_sql_prepare: cannot prepare [%s]: %s",stmt,sqlite3_errmsg(db));
+		return NULL;
+	}
+	return ret;
+}
+
+/*run a statement returning no row, and make it ready for the next use*/
+static int linphone_sql_step(sqlite3 *db, sqlite3_stmt *stmt){
+	int ret=sqlite3_step(stmt);
+	if (ret!=SQLITE_DONE)
+		ms_error("linphone_sql_step: %s",sqlite3_errmsg(db));
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+	return ret;
+}
+
+/*
+ * Stored messages and their state changes are queued for a writer thread that
+ * inserts them on its own connection to the database (WAL), so that sending or
+ * receiving a message never waits for sqlite. Everything queued while the
+ * writer was busy goes into one transaction. Queries on the history wait for
+ * the queue to be written first so that they always see it. The storage ids
+ * are given back to the messages on the core thread, by
+ * linphone_core_message_storage_flush().
+ */
+static void linphone_message_storage_write_row(LinphoneChatMessageStorage *st, LinphoneChatMessageRow *row){
+	sqlite3_stmt *stmt;
+
+	if (row->update){
+		int id=row->inserted ? row->inserted->storage_id : row->storage_id;
+		if (id==0) return;
+		stmt=st->set_state;
+		sqlite3_bind_int(stmt,1,row->state);
+		sqlite3_bind_int(stmt,2,id);
+		linphone_sql_step(st->writer_db,stmt);
+		return;
+	}
+	stmt=st->insert;
+	sqlite3_bind_text(stmt,1,row->local_contact,-1,SQLITE_STATIC);
+	sqlite3_bind_text(stmt,2,row->peer,-1,SQLITE_STATIC);
+	sqlite3_bind_int(stmt,3,row->dir);
+	sqlite3_bind_text(stmt,4,row->text,-1,SQLITE_STATIC);
+	sqlite3_bind_text(stmt,5,row->date,-1,SQLITE_STATIC);
+	sqlite3_bind_int(stmt,6,row->read);
+	sqlite3_bind_int(stmt,7,row->state);
+	if (linphone_sql_step(st->writer_db,stmt)==SQLITE_DONE)
+		row->storage_id=(int)sqlite3_last_insert_rowid(st->writer_db);
+}
+
+static void *linphone_message_storage_writer(void *data){
+	LinphoneChatMessageStorage *st=(LinphoneChatMessageStorage*)data;
+	LinphoneChatMessageRow *rows,*row,*next;
+
+	ms_mutex_lock(&st->lock);
+	for(;;){
+		while (st->queue==NULL && !st->stop)
+			ms_cond_wait(&st->cond,&st->lock);
+		if (st->queue==NULL) break;
+		rows=st->queue;
+		st->queue=st->queue_tail=NULL;
+		st->writing=TRUE;
+		ms_mutex_unlock(&st->lock);
+
+		linphone_sql_request(st->writer_db,"BEGIN;");
+		for (row=rows;row!=NULL;row=row->next)
+			linphone_message_storage_write_row(st,row);
+		linphone_sql_request(st->writer_db,"COMMIT;");
+
+		ms_mutex_lock(&st->lock);
+		for (row=rows;row!=NULL;row=next){
+			next=row->next;
+			row->next=st->done;
+			st->done=row;
+		}
+		st->writing=FALSE;
+		ms_cond_broadcast(&st->cond);
+	}
+	ms_mutex_unlock(&st->lock);
+	return NULL;
+}
+
+static void linphone_message_storage_row_unref(LinphoneChatMessageRow *row){
+	if (--row->refs>0) return;
+	if (row->inserted) linphone_message_storage_row_unref(row->inserted);
+	ms_free(row);
+}
+
+/*core thread: the row is written, hand its storage id to the messages sharing it*/
+static void linphone_message_storage_row_done(LinphoneChatMessageRow *row){
+	MSList *elem;
+	for (elem=row->msgs;elem!=NULL;elem=elem->next){
+		LinphoneChatMessage *msg=(LinphoneChatMessage*)elem->data;
+		msg->storage_id=row->storage_id;
+		msg->pending_row=NULL;
+	}
+	row->msgs=ms_list_free(row->msgs);
+	if (row->local_contact) ms_free(row->local_contact);
+	if (row->peer) ms_free(row->peer);
+	if (row->text) ms_free(row->text);
+	row->local_contact=row->peer=row->text=NULL;
+	linphone_message_storage_row_unref(row);
+}
+
+static void linphone_message_storage_reap(LinphoneChatMessageStorage *st){
+	LinphoneChatMessageRow *rows,*next;
+
+	if (!st->writer_running) return;
+	ms_mutex_lock(&st->lock);
+	rows=st->done;
+	st->done=NULL;
+	ms_mutex_unlock(&st->lock);
+	for (;rows!=NULL;rows=next){
+		next=rows->next;
+		linphone_message_storage_row_done(rows);
+	}
+}
+
+static void linphone_message_storage_queue(LinphoneChatMessageStorage *st, LinphoneChatMessageRow *row){
+	row->refs++;
+	if (!st->writer_running){
+		/*no writer thread: write it now*/
+		linphone_message_storage_write_row(st,row);
+		linphone_message_storage_row_done(row);
+		return;
+	}
+	row->next=NULL;
+	ms_mutex_lock(&st->lock);
+	if (st->queue_tail) st->queue_tail->next=row;
+	else st->queue=row;
+	st->queue_tail=row;
+	ms_cond_signal(&st->cond);
+	ms_mutex_unlock(&st->lock);
+}
+
+/*waits until the writer has written everything queued so far*/
+static void linphone_message_storage_write_pending(LinphoneCore *lc){
+	LinphoneChatMessageStorage *st=&lc->message_storage;
+
+	if (!st->writer_running) return;
+	ms_mutex_lock(&st->lock);
+	while (st->queue!=NULL || st->writing)
+		ms_cond_wait(&st->cond,&st->lock);
+	ms_mutex_unlock(&st->lock);
+	linphone_message_storage_reap(st);
+}
+
+void linphone_core_message_storage_flush(LinphoneCore *lc){
+	if (lc->db==NULL) return;
+	linphone_message_storage_reap(&lc->message_storage);
+}
+
 void linphone_chat_message_store(LinphoneChatMessage *msg){
 	LinphoneCore *lc=linphone_chat_room_get_lc(msg->chat_room);
-	if (lc->db){
-		char *peer=linphone_address_as_string_uri_only(linphone_chat_room_get_peer_address(msg->chat_room));
-		char *local_contact=linphone_address_as_string_uri_only(linphone_chat_message_get_local_address(msg));
-		char datebuf[26];
-		char *buf=sqlite3_mprintf("insert into history values(NULL,%Q,%Q,%i,%Q,%Q,%i,%i);",
-						local_contact,peer,msg->dir,msg->message,my_ctime_r(&msg->time,datebuf),msg->is_read,msg->state);
-		linphone_sql_request(lc->db,buf);
-		sqlite3_free(buf);
-		ms_free(local_contact);
-		ms_free(peer);
-	}
+	LinphoneChatMessageStorage *st=&lc->message_storage;
+	LinphoneChatMessageRow *row;
+
+	if (lc->db==NULL || st->insert==NULL) return;
+	row=ms_new0(LinphoneChatMessageRow,1);
+	row->msgs=ms_list_append(NULL,msg);
+	row->local_contact=linphone_address_as_string_uri_only(linphone_chat_message_get_local_address(msg));
+	row->peer=linphone_address_as_string_uri_only(linphone_chat_room_get_peer_address(msg->chat_room));
+	row->text=msg->message ? ms_strdup(msg->message) : NULL;
+	my_ctime_r(&msg->time,row->date);
+	row->dir=msg->dir;
+	row->read=msg->is_read;
+	row->state=msg->state;
+	msg->pending_row=row;
+	linphone_message_storage_queue(st,row);
+}
+
+/*a clone resolves to the same row as the original message*/
+void linphone_chat_message_storage_share(const LinphoneChatMessage *msg, LinphoneChatMessage *clone){
+	LinphoneChatMessageRow *row=msg->pending_row;
+	if (row==NULL) return;
+	row->msgs=ms_list_append(row->msgs,clone);
+	clone->pending_row=row;
+}
+
+/*the message is being destroyed before its row was written*/
+void linphone_chat_message_storage_forget(LinphoneChatMessage *msg){
+	LinphoneChatMessageRow *row=msg->pending_row;
+	if (row)
+		row->msgs=ms_list_remove(row->msgs,msg);
+	msg->pending_row=NULL;
 }
 
 void linphone_chat_message_store_state(LinphoneChatMessage *msg){
 	LinphoneCore *lc=msg->chat_room->lc;
-	if (lc->db){
-		char time_str[26];
-		char *buf=sqlite3_mprintf("update history set status=%i where message = %Q and time = %Q;",
-			msg->state,msg->message,my_ctime_r(&msg->time,time_str));
-		linphone_sql_request(lc->db,buf);
-		sqlite3_free(buf);
+	LinphoneChatMessageStorage *st=&lc->message_storage;
+	LinphoneChatMessageRow *row;
+
+	if (lc->db==NULL || st->set_state==NULL) return;
+	if (msg->pending_row==NULL && msg->storage_id==0) return;
+	row=ms_new0(LinphoneChatMessageRow,1);
+	row->update=TRUE;
+	row->state=msg->state;
+	row->storage_id=msg->storage_id;
+	if (msg->pending_row){
+		/*the writer knows the id once it has inserted the row, which is queued before*/
+		row->inserted=msg->pending_row;
+		row->inserted->refs++;
 	}
+	linphone_message_storage_queue(st,row);
 }
 
 void linphone_chat_room_mark_as_read(LinphoneChatRoom *cr){
 	LinphoneCore *lc=linphone_chat_room_get_lc(cr);
-	int read=1;
+	sqlite3_stmt *stmt=lc->message_storage.mark_read;
+	char *peer;
 	
-	if (lc->db==NULL) return ;
+	if (lc->db==NULL || stmt==NULL) return ;
 
-	char *peer=linphone_address_as_string_uri_only(linphone_chat_room_get_peer_address(cr));
-	char *buf=sqlite3_mprintf("update history set read=%i where remoteContact = %Q;",
-	               read,peer);
-	linphone_sql_request(lc->db,buf);
-	sqlite3_free(buf);
+	linphone_message_storage_write_pending(lc);
+	peer=linphone_address_as_string_uri_only(linphone_chat_room_get_peer_address(cr));
+	sqlite3_bind_text(stmt,1,peer,-1,SQLITE_STATIC);
+	linphone_sql_step(lc->db,stmt);
 	ms_free(peer);
 }
 
 int linphone_chat_room_get_unread_messages_count(LinphoneChatRoom *cr){
 	LinphoneCore *lc=linphone_chat_room_get_lc(cr);
+	sqlite3_stmt *stmt=lc->message_storage.unread_count;
 	int numrows=0;
+	char *peer;
 	
-	if (lc->db==NULL) return 0;
+	if (lc->db==NULL || stmt==NULL) return 0;
 	
-	char *peer=linphone_address_as_string_uri_only(linphone_chat_room_get_peer_address(cr));
-	char *buf=sqlite3_mprintf("select count(*) from history where remoteContact = %Q and read = 0;",peer);
-	sqlite3_stmt *selectStatement;
-	int returnValue = sqlite3_prepare_v2(lc->db,buf,-1,&selectStatement,NULL);
-	if (returnValue == SQLITE_OK){
-		if(sqlite3_step(selectStatement) == SQLITE_ROW){
-			numrows= sqlite3_column_int(selectStatement, 0);
-		}
+	linphone_message_storage_write_pending(lc);
+	peer=linphone_address_as_string_uri_only(linphone_chat_room_get_peer_address(cr));
+	sqlite3_bind_text(stmt,1,peer,-1,SQLITE_STATIC);
+	if(sqlite3_step(stmt) == SQLITE_ROW){
+		numrows= sqlite3_column_int(stmt, 0);
 	}
-	sqlite3_finalize(selectStatement);
-	sqlite3_free(buf);
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
 	ms_free(peer);
 	return numrows;
 }
 
 void linphone_chat_room_delete_history(LinphoneChatRoom *cr){
 	LinphoneCore *lc=cr->lc;
+	sqlite3_stmt *stmt=lc->message_storage.delete_history;
+	char *peer;
 	
-	if (lc->db==NULL) return ;
+	if (lc->db==NULL || stmt==NULL) return ;
 	
-	char *peer=linphone_address_as_string_uri_only(linphone_chat_room_get_peer_address(cr));
-	char *buf=sqlite3_mprintf("delete from history where remoteContact = %Q;",peer);
-	linphone_sql_request(lc->db,buf);
-	sqlite3_free(buf);
+	linphone_message_storage_write_pending(lc);
+	peer=linphone_address_as_string_uri_only(linphone_chat_room_get_peer_address(cr));
+	sqlite3_bind_text(stmt,1,peer,-1,SQLITE_STATIC);
+	linphone_sql_step(lc->db,stmt);
 	ms_free(peer);
 }
 
 MSList *linphone_chat_room_get_history(LinphoneChatRoom *cr,int nb_message){
 	LinphoneCore *lc=linphone_chat_room_get_lc(cr);
-	MSList *ret;
+	sqlite3_stmt *stmt=lc->message_storage.history;
+	MSList *ret=NULL;
+	char *peer;
 	
-	if (lc->db==NULL) return NULL;
-	char *peer=linphone_address_as_string_uri_only(linphone_chat_room_get_peer_address(cr));
-	cr->messages_hist = NULL;
-	char *buf=sqlite3_mprintf("select * from history where remoteContact = %Q order by id DESC limit %i ;",peer,nb_message);
-	linphone_sql_request_message(lc->db,buf,cr);
-	sqlite3_free(buf);
-	ret=cr->messages_hist;
-	cr->messages_hist=NULL;
+	if (lc->db==NULL || stmt==NULL) return NULL;
+	linphone_message_storage_write_pending(lc);
+	peer=linphone_address_as_string_uri_only(linphone_chat_room_get_peer_address(cr));
+	sqlite3_bind_text(stmt,1,peer,-1,SQLITE_STATIC);
+	sqlite3_bind_int(stmt,2,nb_message);
+	/*rows come newest first, the list is oldest first*/
+	while (sqlite3_step(stmt)==SQLITE_ROW)
+		ret=ms_list_prepend(ret,create_chat_message(cr,stmt));
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
 	ms_free(peer);
 	return ret;
 }
@@ -192,6 +372,209 @@ void linphone_close_storage(sqlite3* db){
 	sqlite3_close(db);
 }
 
+/*
+ * Call logs are stored in the call_history table. The statements are prepared
+ * once when the database is opened and only rebound afterwards.
+ */
+
+#define CALL_LOG_COLUMNS "id,direction,status,caller,callee,startTime,duration,quality,videoEnabled,refKey,callId"
+
+/*the page is selected newest first, then returned oldest first so that it can be prepended into a list*/
+#define CALL_LOG_PAGE(where) "select * from (select " CALL_LOG_COLUMNS " from call_history " where \
+	" order by startTime DESC, id DESC limit ? offset ?) order by startTime, id;"
+
+static void linphone_create_call_log_table(sqlite3* db){
+	linphone_sql_request(db,"CREATE TABLE if not exists call_history (id INTEGER PRIMARY KEY AUTOINCREMENT, caller TEXT NOT NULL, callee TEXT NOT NULL, peer TEXT NOT NULL, direction INTEGER, status INTEGER, startTime INTEGER NOT NULL, duration INTEGER, quality REAL, videoEnabled INTEGER, refKey TEXT, callId TEXT);");
+	linphone_sql_request(db,"CREATE INDEX if not exists call_history_peer on call_history (peer, startTime);");
+	linphone_sql_request(db,"CREATE INDEX if not exists call_history_time on call_history (startTime);");
+	linphone_sql_request(db,"CREATE INDEX if not exists call_history_status on call_history (status, startTime);");
+}
+
+static char *call_log_address(const LinphoneAddress *addr, bool_t uri_only){
+	if (addr==NULL) return ms_strdup("");
+	return uri_only ? linphone_address_as_string_uri_only(addr) : linphone_address_as_string(addr);
+}
+
+static LinphoneCallLog *call_log_from_row(LinphoneCore *lc, sqlite3_stmt *stmt){
+	LinphoneCallLog *cl=ms_new0(LinphoneCallLog,1);
+	const char *tmp;
+
+	cl->lc=lc;
+	cl->storage_id=sqlite3_column_int(stmt,0);
+	cl->dir=sqlite3_column_int(stmt,1);
+	cl->status=sqlite3_column_int(stmt,2);
+	tmp=(const char*)sqlite3_column_text(stmt,3);
+	if (tmp && tmp[0]) cl->from=linphone_address_new(tmp);
+	tmp=(const char*)sqlite3_column_text(stmt,4);
+	if (tmp && tmp[0]) cl->to=linphone_address_new(tmp);
+	cl->start_date_time=(time_t)sqlite3_column_int64(stmt,5);
+	if (cl->start_date_time) set_call_log_date(cl,cl->start_date_time);
+	cl->duration=sqlite3_column_int(stmt,6);
+	cl->quality=(float)sqlite3_column_double(stmt,7);
+	cl->video_enabled=sqlite3_column_int(stmt,8);
+	tmp=(const char*)sqlite3_column_text(stmt,9);
+	if (tmp) cl->refkey=ms_strdup(tmp);
+	tmp=(const char*)sqlite3_column_text(stmt,10);
+	if (tmp) cl->call_id=ms_strdup(tmp);
+	return cl;
+}
+
+static void call_log_insert(LinphoneCore *lc, LinphoneCallLog *cl){
+	sqlite3_stmt *stmt=lc->call_log_storage.insert;
+	char *caller=call_log_address(cl->from,FALSE);
+	char *callee=call_log_address(cl->to,FALSE);
+	char *peer=call_log_address(cl->dir==LinphoneCallIncoming ? cl->from : cl->to,TRUE);
+
+	sqlite3_bind_text(stmt,1,caller,-1,SQLITE_STATIC);
+	sqlite3_bind_text(stmt,2,callee,-1,SQLITE_STATIC);
+	sqlite3_bind_text(stmt,3,peer,-1,SQLITE_STATIC);
+	sqlite3_bind_int(stmt,4,cl->dir);
+	sqlite3_bind_int(stmt,5,cl->status);
+	sqlite3_bind_int64(stmt,6,(sqlite3_int64)cl->start_date_time);
+	sqlite3_bind_int(stmt,7,cl->duration);
+	sqlite3_bind_double(stmt,8,cl->quality);
+	sqlite3_bind_int(stmt,9,cl->video_enabled);
+	sqlite3_bind_text(stmt,10,cl->refkey,-1,SQLITE_STATIC);
+	sqlite3_bind_text(stmt,11,cl->call_id,-1,SQLITE_STATIC);
+	if (linphone_sql_step(lc->db,stmt)==SQLITE_DONE)
+		cl->storage_id=(int)sqlite3_last_insert_rowid(lc->db);
+	ms_free(caller);
+	ms_free(callee);
+	ms_free(peer);
+}
+
+/*keep the history_max_size most recent call logs*/
+static void call_log_trim(LinphoneCore *lc){
+	sqlite3_stmt *stmt=lc->call_log_storage.trim;
+	sqlite3_bind_int(stmt,1,lc->max_call_logs);
+	linphone_sql_step(lc->db,stmt);
+}
+
+static void linphone_core_call_log_storage_close(LinphoneCore *lc){
+	LinphoneCallLogStorage *st=&lc->call_log_storage;
+	/*sqlite3_finalize() accepts NULL*/
+	sqlite3_finalize(st->insert);
+	sqlite3_finalize(st->remove);
+	sqlite3_finalize(st->clear);
+	sqlite3_finalize(st->trim);
+	sqlite3_finalize(st->set_ref_key);
+	sqlite3_finalize(st->count);
+	sqlite3_finalize(st->page);
+	sqlite3_finalize(st->peer_page);
+	sqlite3_finalize(st->status_page);
+	memset(st,0,sizeof(*st));
+	/*whatever was not read yet stays in the database*/
+	lc->call_logs_loaded=TRUE;
+}
+
+static void linphone_core_call_log_storage_init(LinphoneCore *lc){
+	LinphoneCallLogStorage *st=&lc->call_log_storage;
+	char logsection[32];
+	MSList *elem;
+	int i;
+
+	linphone_create_call_log_table(lc->db);
+	st->insert=linphone_sql_prepare(lc->db,"insert into call_history (caller,callee,peer,direction,status,startTime,duration,quality,videoEnabled,refKey,callId) values (?,?,?,?,?,?,?,?,?,?,?);");
+	st->remove=linphone_sql_prepare(lc->db,"delete from call_history where id = ?;");
+	st->clear=linphone_sql_prepare(lc->db,"delete from call_history;");
+	st->trim=linphone_sql_prepare(lc->db,"delete from call_history where id in (select id from call_history order by startTime DESC, id DESC limit -1 offset ?);");
+	st->set_ref_key=linphone_sql_prepare(lc->db,"update call_history set refKey = ? where id = ?;");
+	st->count=linphone_sql_prepare(lc->db,"select count(*) from call_history;");
+	st->page=linphone_sql_prepare(lc->db,CALL_LOG_PAGE(""));
+	st->peer_page=linphone_sql_prepare(lc->db,CALL_LOG_PAGE("where peer = ?"));
+	st->status_page=linphone_sql_prepare(lc->db,CALL_LOG_PAGE("where status = ?"));
+	if (!st->insert || !st->remove || !st->clear || !st->trim || !st->set_ref_key || !st->count
+		|| !st->page || !st->peer_page || !st->status_page){
+		ms_error("Call logs will not be stored in %s.",lc->chat_db_file);
+		linphone_core_call_log_storage_close(lc);
+		return;
+	}
+	if (lc->call_logs==NULL || !lp_config_has_section(lc->config,"call_log_0")){
+		/*read the list from the database when first asked for*/
+		lc->call_logs_loaded=FALSE;
+		return;
+	}
+	/*call logs read from the config file at startup: move them into the database, oldest first*/
+	for (elem=lc->call_logs;elem->next!=NULL;elem=elem->next);
+	linphone_sql_request(lc->db,"BEGIN;");
+	for (;elem!=NULL;elem=elem->prev){
+		LinphoneCallLog *cl=(LinphoneCallLog*)elem->data;
+		if (cl->storage_id==0) call_log_insert(lc,cl);
+	}
+	call_log_trim(lc);
+	linphone_sql_request(lc->db,"COMMIT;");
+	for (i=0;;++i){
+		snprintf(logsection,sizeof(logsection),"call_log_%i",i);
+		if (!lp_config_has_section(lc->config,logsection)) break;
+		lp_config_clean_section(lc->config,logsection);
+	}
+	ms_message("%i call logs moved from the config file to %s.",i,lc->chat_db_file);
+}
+
+bool_t linphone_core_call_log_storage_enabled(LinphoneCore *lc){
+	return lc->db!=NULL && lc->call_log_storage.insert!=NULL;
+}
+
+void linphone_core_call_log_store(LinphoneCore *lc, LinphoneCallLog *cl){
+	if (!linphone_core_call_log_storage_enabled(lc)) return;
+	call_log_insert(lc,cl);
+	call_log_trim(lc);
+}
+
+void linphone_core_call_log_store_ref_key(LinphoneCore *lc, LinphoneCallLog *cl){
+	sqlite3_stmt *stmt=lc->call_log_storage.set_ref_key;
+	if (!linphone_core_call_log_storage_enabled(lc) || cl->storage_id==0) return;
+	sqlite3_bind_text(stmt,1,cl->refkey,-1,SQLITE_STATIC);
+	sqlite3_bind_int(stmt,2,cl->storage_id);
+	linphone_sql_step(lc->db,stmt);
+}
+
+void linphone_core_call_log_unstore(LinphoneCore *lc, LinphoneCallLog *cl){
+	sqlite3_stmt *stmt=lc->call_log_storage.remove;
+	if (!linphone_core_call_log_storage_enabled(lc) || cl->storage_id==0) return;
+	sqlite3_bind_int(stmt,1,cl->storage_id);
+	linphone_sql_step(lc->db,stmt);
+	cl->storage_id=0;
+}
+
+void linphone_core_call_log_storage_clear(LinphoneCore *lc){
+	if (!linphone_core_call_log_storage_enabled(lc)) return;
+	linphone_sql_step(lc->db,lc->call_log_storage.clear);
+}
+
+int linphone_core_call_log_storage_count(LinphoneCore *lc){
+	sqlite3_stmt *stmt=lc->call_log_storage.count;
+	int ret=0;
+	if (!linphone_core_call_log_storage_enabled(lc)) return 0;
+	if (sqlite3_step(stmt)==SQLITE_ROW)
+		ret=sqlite3_column_int(stmt,0);
+	sqlite3_reset(stmt);
+	return ret;
+}
+
+MSList *linphone_core_call_log_storage_query(LinphoneCore *lc, const char *peer, bool_t missed_only, int offset, int count){
+	LinphoneCallLogStorage *st=&lc->call_log_storage;
+	sqlite3_stmt *stmt;
+	MSList *ret=NULL;
+	int i=1;
+
+	if (!linphone_core_call_log_storage_enabled(lc)) return NULL;
+	if (peer!=NULL){
+		stmt=st->peer_page;
+		sqlite3_bind_text(stmt,i++,peer,-1,SQLITE_STATIC);
+	}else if (missed_only){
+		stmt=st->status_page;
+		sqlite3_bind_int(stmt,i++,LinphoneCallMissed);
+	}else stmt=st->page;
+	sqlite3_bind_int(stmt,i++,count);
+	sqlite3_bind_int(stmt,i++,offset);
+	while (sqlite3_step(stmt)==SQLITE_ROW)
+		ret=ms_list_prepend(ret,call_log_from_row(lc,stmt));
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+	return ret;
+}
+
 void linphone_create_table(sqlite3* db){
 	char* errmsg=NULL;
 	int ret;
@@ -201,6 +584,60 @@ void linphone_create_table(sqlite3* db){
 		ms_error("Error in creation: %s.\n", errmsg);
 		sqlite3_free(errmsg);
 	}
+	linphone_sql_request(db,"CREATE INDEX if not exists history_remote on history (remoteContact, id);");
+	linphone_sql_request(db,"CREATE INDEX if not exists history_unread on history (remoteContact, read);");
+}
+
+static void linphone_message_storage_prepare(LinphoneCore *lc){
+	LinphoneChatMessageStorage *st=&lc->message_storage;
+	st->insert=linphone_sql_prepare(st->writer_db,"insert into history values(NULL,?,?,?,?,?,?,?);");
+	st->set_state=linphone_sql_prepare(st->writer_db,"update history set status=? where id = ?;");
+	st->mark_read=linphone_sql_prepare(lc->db,"update history set read=1 where remoteContact = ? and read = 0;");
+	st->unread_count=linphone_sql_prepare(lc->db,"select count(*) from history where remoteContact = ? and read = 0;");
+	st->delete_history=linphone_sql_prepare(lc->db,"delete from history where remoteContact = ?;");
+	st->history=linphone_sql_prepare(lc->db,"select " MESSAGE_COLUMNS " from history where remoteContact = ? order by id DESC limit ?;");
+}
+
+static void linphone_message_storage_start_writer(LinphoneCore *lc){
+	LinphoneChatMessageStorage *st=&lc->message_storage;
+
+	ms_mutex_init(&st->lock,NULL);
+	ms_cond_init(&st->cond,NULL);
+	if (ms_thread_create(&st->writer,NULL,linphone_message_storage_writer,st)!=0){
+		ms_warning("Could not start the message storage writer thread, messages are written synchronously.");
+		ms_mutex_destroy(&st->lock);
+		ms_cond_destroy(&st->cond);
+		return;
+	}
+	st->writer_running=TRUE;
+}
+
+/*writes what is still queued and joins the writer*/
+static void linphone_message_storage_stop_writer(LinphoneCore *lc){
+	LinphoneChatMessageStorage *st=&lc->message_storage;
+
+	if (!st->writer_running) return;
+	ms_mutex_lock(&st->lock);
+	st->stop=TRUE;
+	ms_cond_broadcast(&st->cond);
+	ms_mutex_unlock(&st->lock);
+	ms_thread_join(st->writer,NULL);
+	linphone_message_storage_reap(st);
+	ms_mutex_destroy(&st->lock);
+	ms_cond_destroy(&st->cond);
+	st->writer_running=FALSE;
+}
+
+static void linphone_message_storage_finalize(LinphoneCore *lc){
+	LinphoneChatMessageStorage *st=&lc->message_storage;
+	sqlite3_finalize(st->insert);
+	sqlite3_finalize(st->set_state);
+	sqlite3_finalize(st->mark_read);
+	sqlite3_finalize(st->unread_count);
+	sqlite3_finalize(st->delete_history);
+	sqlite3_finalize(st->history);
+	sqlite3_close(st->writer_db);
+	memset(st,0,sizeof(*st));
 }
 
 void linphone_core_message_storage_init(LinphoneCore *lc){
@@ -212,13 +649,35 @@ void linphone_core_message_storage_init(LinphoneCore *lc){
 		errmsg=sqlite3_errmsg(db);
 		ms_error("Error in the opening: %s.\n", errmsg);
 		sqlite3_close(db);
+		return;
 	}
+	/*readers do not block the writer, and commits do not wait for a checkpoint*/
+	linphone_sql_request(db,"PRAGMA journal_mode=WAL;");
+	linphone_sql_request(db,"PRAGMA synchronous=NORMAL;");
+	sqlite3_busy_timeout(db,MESSAGE_STORAGE_BUSY_TIMEOUT);
 	linphone_create_table(db);
+	/*the writer thread has its own connection: the history can be read while it writes*/
+	ret=sqlite3_open(lc->chat_db_file,&lc->message_storage.writer_db);
+	if(ret != SQLITE_OK) {
+		ms_error("Error in the opening of the writer connection: %s.\n", sqlite3_errmsg(lc->message_storage.writer_db));
+		sqlite3_close(lc->message_storage.writer_db);
+		lc->message_storage.writer_db=NULL;
+		sqlite3_close(db);
+		return;
+	}
+	linphone_sql_request(lc->message_storage.writer_db,"PRAGMA synchronous=NORMAL;");
+	sqlite3_busy_timeout(lc->message_storage.writer_db,MESSAGE_STORAGE_BUSY_TIMEOUT);
 	lc->db=db;
+	linphone_message_storage_prepare(lc);
+	linphone_message_storage_start_writer(lc);
+	linphone_core_call_log_storage_init(lc);
 }
 
 void linphone_core_message_storage_close(LinphoneCore *lc){
 	if (lc->db){
+		linphone_message_storage_stop_writer(lc);
+		linphone_message_storage_finalize(lc);
+		linphone_core_call_log_storage_close(lc);
 		sqlite3_close(lc->db);
 		lc->db=NULL;
 	}
@@ -248,8 +707,41 @@ void linphone_core_message_storage_init(LinphoneCore *lc){
 void linphone_core_message_storage_close(LinphoneCore *lc){
 }
 
+void linphone_core_message_storage_flush(LinphoneCore *lc){
+}
+
+void linphone_chat_message_storage_forget(LinphoneChatMessage *msg){
+}
+
+void linphone_chat_message_storage_share(const LinphoneChatMessage *msg, LinphoneChatMessage *clone){
+}
+
 int linphone_chat_room_get_unread_messages_count(LinphoneChatRoom *cr){
 	return 0;
 }
 
+bool_t linphone_core_call_log_storage_enabled(LinphoneCore *lc){
+	return FALSE;
+}
+
+void linphone_core_call_log_store(LinphoneCore *lc, LinphoneCallLog *cl){
+}
+
+void linphone_core_call_log_store_ref_key(LinphoneCore *lc, LinphoneCallLog *cl){
+}
+
+void linphone_core_call_log_unstore(LinphoneCore *lc, LinphoneCallLog *cl){
+}
+
+void linphone_core_call_log_storage_clear(LinphoneCore *lc){
+}
+
+int linphone_core_call_log_storage_count(LinphoneCore *lc){
+	return 0;
+}
+
+MSList *linphone_core_call_log_storage_query(LinphoneCore *lc, const char *peer, bool_t missed_only, int offset, int count){
+	return NULL;
+}
+
 #endif
@@ -1379,6 +1379,241 @@ int linphone_core_get_local_ip_for(
     return 0;
 }
 
+/*
+ * RTP port pools.
+ * Each pool keeps one bit per RTP/RTCP pair of the configured audio or video
+ * port range, so that allocating a pair does not need to walk lc->calls.
+ * A fixed port is handled as the range [port, port+98] scanned from its start,
+ * like linphone always did; a real range is scanned from a random pair.
+ */
+#define PORT_POOL_FIXED_PAIRS  50
+#define PORT_POOL_MAX_PROBES   100
+#define PORT_POOL_WORD_BITS    (8 * (int)sizeof(unsigned int))
+
+static LinphonePortPool *linphone_core_get_port_pool(
+    LinphoneCore *lc, SalStreamType type)
+{
+    return (type == SalVideo) ? &lc->video_port_pool : &lc->audio_port_pool;
+}
+
+static int port_pool_index(
+    const LinphonePortPool *pool, int port)
+{
+    if (pool->bitmap == NULL || port < pool->base || port >= pool->base + 2 * pool->nb_pairs)
+        return -1;
+    return (port - pool->base) / 2;
+}
+
+static bool_t port_pool_is_reserved(
+    const LinphonePortPool *pool, int port)
+{
+    int index = port_pool_index(pool, port);
+    if (index < 0)
+        return FALSE;
+    return (pool->bitmap[index / PORT_POOL_WORD_BITS] & (1U << (index % PORT_POOL_WORD_BITS))) != 0;
+}
+
+static void port_pool_set(
+    LinphonePortPool *pool, int index, bool_t reserved)
+{
+    unsigned int mask = 1U << (index % PORT_POOL_WORD_BITS);
+    if (reserved)
+        pool->bitmap[index / PORT_POOL_WORD_BITS] |= mask;
+    else
+        pool->bitmap[index / PORT_POOL_WORD_BITS] &= ~mask;
+}
+
+/* returns the first free pair at or after index, wrapping around, or -1 */
+static int port_pool_find_free(
+    const LinphonePortPool *pool, int index)
+{
+    int scanned = 0;
+    while (scanned < pool->nb_pairs)
+    {
+        int word = index / PORT_POOL_WORD_BITS;
+        int bit  = index % PORT_POOL_WORD_BITS;
+        if (bit == 0 && pool->bitmap[word] == ~0U)
+        {
+            /* skip a fully reserved word at once */
+            scanned += PORT_POOL_WORD_BITS;
+            index   += PORT_POOL_WORD_BITS;
+        }
+        else
+        {
+            if ((pool->bitmap[word] & (1U << bit)) == 0)
+                return index;
+            scanned++;
+            index++;
+        }
+        if (index >= pool->nb_pairs)
+            index = 0;
+    }
+    return -1;
+}
+
+void linphone_core_uninit_port_pools(
+    LinphoneCore *lc)
+{
+    if (lc->audio_port_pool.bitmap)
+        ms_free(lc->audio_port_pool.bitmap);
+    if (lc->video_port_pool.bitmap)
+        ms_free(lc->video_port_pool.bitmap);
+    memset(&lc->audio_port_pool, 0, sizeof(LinphonePortPool));
+    memset(&lc->video_port_pool, 0, sizeof(LinphonePortPool));
+}
+
+/* (re)builds the pool when the configured range changed since last allocation */
+static int port_pool_update(
+    LinphoneCore *lc, SalStreamType type)
+{
+    LinphonePortPool *pool = linphone_core_get_port_pool(lc, type);
+    int              min_port, max_port;
+    int              nb_words;
+    MSList           *elem;
+
+    if (type == SalVideo)
+        linphone_core_get_video_port_range(lc, &min_port, &max_port);
+    else
+        linphone_core_get_audio_port_range(lc, &min_port, &max_port);
+
+    if (pool->bitmap != NULL && pool->min_port == min_port && pool->max_port == max_port)
+        return 0;
+
+    if (pool->bitmap)
+        ms_free(pool->bitmap);
+    memset(pool, 0, sizeof(LinphonePortPool));
+    pool->min_port = min_port;
+    pool->max_port = max_port;
+    if (min_port == max_port)
+    {
+        pool->base     = min_port;
+        pool->nb_pairs = PORT_POOL_FIXED_PAIRS;
+        pool->fixed    = TRUE;
+    }
+    else
+    {
+        /* RTP ports are even, the following odd port is for RTCP */
+        pool->base     = (min_port + 1) & ~0x1;
+        pool->nb_pairs = (max_port - pool->base + 1) / 2;
+    }
+    if (pool->nb_pairs <= 0 || pool->base <= 0)
+    {
+        ms_error("Invalid %s RTP port range [%i-%i]", type == SalVideo ? "video" : "audio", min_port, max_port);
+        pool->nb_pairs = 0;
+        return -1;
+    }
+    nb_words     = (pool->nb_pairs + PORT_POOL_WORD_BITS - 1) / PORT_POOL_WORD_BITS;
+    pool->bitmap = ms_new0(unsigned int, nb_words);
+    /* ports of the calls still running remain reserved */
+    for (elem = lc->calls; elem != NULL; elem = elem->next)
+    {
+        LinphoneCall *call  = (LinphoneCall *)elem->data;
+        int          index  = port_pool_index(pool, type == SalVideo ? call->video_port : call->audio_port);
+        if (index >= 0)
+            port_pool_set(pool, index, TRUE);
+    }
+    if (type == SalAudio)
+    {
+        for (elem = lc->audio_stream_pool; elem != NULL; elem = elem->next)
+        {
+            AudioStream *stream = (AudioStream *)elem->data;
+            int         index   = port_pool_index(pool, rtp_session_get_local_port(stream->ms.session));
+            if (index >= 0)
+                port_pool_set(pool, index, TRUE);
+        }
+    }
+    return 0;
+}
+
+/* checks that no socket outside linphone is bound to the RTP or RTCP port */
+static bool_t port_is_bindable(
+    int port, bool_t ipv6)
+{
+    int i;
+    for (i = 0; i < 2; i++)
+    {
+        struct addrinfo hints;
+        struct addrinfo *res = NULL;
+        ortp_socket_t   sock;
+        char            service[16];
+        int             err;
+
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family   = ipv6 ? PF_INET6 : PF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        hints.ai_flags    = AI_PASSIVE | AI_NUMERICHOST;
+        snprintf(service, sizeof(service), "%i", port + i);
+        if (getaddrinfo(ipv6 ? "::" : "0.0.0.0", service, &hints, &res) != 0 || res == NULL)
+            return TRUE;    /* cannot tell, let the stream find out */
+        sock = socket(res->ai_family, SOCK_DGRAM, 0);
+        if (sock < 0)
+        {
+            freeaddrinfo(res);
+            return TRUE;
+        }
+        err = bind(sock, res->ai_addr, res->ai_addrlen);
+        close_socket(sock);
+        freeaddrinfo(res);
+        if (err != 0)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * Reserves a RTP/RTCP port pair for a new audio or video stream.
+ * Returns the RTP port, or -1 if the configured range is exhausted.
+ */
+int linphone_core_reserve_rtp_port(
+    LinphoneCore *lc, SalStreamType type)
+{
+    LinphonePortPool *pool  = linphone_core_get_port_pool(lc, type);
+    LinphonePortPool *other = linphone_core_get_port_pool(lc, type == SalVideo ? SalAudio : SalVideo);
+    bool_t           probe  = lp_config_get_int(lc->config, "rtp", "probe_ports", 1);
+    bool_t           ipv6   = linphone_core_ipv6_enabled(lc);
+    int              skipped[PORT_POOL_MAX_PROBES];
+    int              nb_skipped = 0;
+    int              port       = -1;
+    int              index;
+
+    if (port_pool_update(lc, type) != 0)
+        return -1;
+    index = port_pool_find_free(pool, pool->fixed ? 0 : rand() % pool->nb_pairs);
+    while (index >= 0)
+    {
+        int tried_port = pool->base + 2 * index;
+        /* reserve it right away so that the next lookup moves past it */
+        port_pool_set(pool, index, TRUE);
+        if (!port_pool_is_reserved(other, tried_port) && !port_pool_is_reserved(other, tried_port + 1)
+            && (!probe || port_is_bindable(tried_port, ipv6)))
+        {
+            port = tried_port;
+            break;
+        }
+        skipped[nb_skipped++] = index;
+        if (nb_skipped == PORT_POOL_MAX_PROBES)
+            break;
+        index = port_pool_find_free(pool, index);
+    }
+    /* pairs held by the other stream type or by a foreign socket may be free next time */
+    while (nb_skipped > 0)
+        port_pool_set(pool, skipped[--nb_skipped], FALSE);
+    if (port == -1)
+        ms_error("Could not find any free %s port !", type == SalVideo ? "video" : "audio");
+    return port;
+}
+
+void linphone_core_release_rtp_port(
+    LinphoneCore *lc, SalStreamType type, int port)
+{
+    LinphonePortPool *pool = linphone_core_get_port_pool(lc, type);
+    int              index = port_pool_index(pool, port);
+    /* a port outside the pool was reserved before the range changed */
+    if (index >= 0)
+        port_pool_set(pool, index, FALSE);
+}
+
+
 #ifndef WIN32
     #include <resolv.h>
 
@@ -28,7 +28,7 @@ void linphone_core_add_subscriber(
 {
     LinphoneFriend *fl = linphone_friend_new_with_addr(subscriber);
     if (fl == NULL) return;
-    fl->insub                 = op;
+    linphone_friend_set_insub(fl, op);
     linphone_friend_set_inc_subscribe_policy(fl, LinphoneSPAccept);
     fl->inc_subscribe_pending = TRUE;
     lc->subscribers           = ms_list_append(lc->subscribers, (void *)fl);
@@ -89,9 +89,9 @@ void linphone_subscription_new(
         }
     }
     /* check if we answer to this subscription */
-    if (linphone_find_friend(lc->friends, uri, &lf) != NULL)
+    if ((lf = linphone_core_find_friend(lc, uri)) != NULL)
     {
-        lf->insub                 = op;
+        linphone_friend_set_insub(lf, op);
         lf->inc_subscribe_pending = TRUE;
         sal_subscribe_accept(op);
         linphone_friend_done(lf);   /*this will do all necessary actions */
@@ -161,7 +161,7 @@ void linphone_notify_recv(
         estatus = LinphoneStatusMoved;
         break;
     }
-    lf = linphone_find_friend_by_out_subscribe(lc->friends, op);
+    lf = linphone_core_find_friend_by_out_subscribe(lc, op);
     if (lf != NULL)
     {
         friend               = lf->uri;
@@ -181,7 +181,7 @@ void linphone_notify_recv(
         sal_op_release(op);
         if (lf)
         {
-            lf->outsub           = NULL;
+            linphone_friend_set_outsub(lf, NULL);
             lf->subscribe_active = FALSE;
         }
     }
@@ -191,11 +191,11 @@ void linphone_subscription_closed(
     LinphoneCore *lc, SalOp *op)
 {
     LinphoneFriend *lf;
-    lf = linphone_find_friend_by_inc_subscribe(lc->friends, op);
+    lf = linphone_core_find_friend_by_inc_subscribe(lc, op);
     sal_op_release(op);
     if (lf != NULL)
     {
-        lf->insub = NULL;
+        linphone_friend_set_insub(lf, NULL);
     }
     else
     {
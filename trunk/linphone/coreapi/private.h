@@ -47,6 +47,56 @@ extern "C" {
 
 #ifdef MSG_STORAGE_ENABLED
     #include "sqlite3.h"
+
+/* a write queued for the message storage writer thread: a stored message, or a state change */
+typedef struct _LinphoneChatMessageRow {
+    struct _LinphoneChatMessageRow *next;         /* in the writer queue */
+    struct _LinphoneChatMessageRow *inserted;     /* state change of a message whose row is still queued */
+    MSList                         *msgs;         /* messages receiving the storage_id once written (core thread) */
+    int                            refs;          /* while queued, and per state change pointing here (core thread) */
+    int                            storage_id;    /* set by the writer for a stored message, row to update for a state change */
+    bool_t                         update;        /* state change rather than a new row */
+    char                           *local_contact;
+    char                           *peer;
+    char                           *text;
+    char                           date[26];
+    int                            dir;
+    int                            read;
+    int                            state;
+} LinphoneChatMessageRow;
+
+/* the chat message storage: history queries use lc->db, writes go through the writer thread and its own connection */
+typedef struct _LinphoneChatMessageStorage {
+    sqlite3                *writer_db;
+    sqlite3_stmt           *insert;        /* on writer_db */
+    sqlite3_stmt           *set_state;     /* on writer_db */
+    sqlite3_stmt           *mark_read;
+    sqlite3_stmt           *unread_count;
+    sqlite3_stmt           *delete_history;
+    sqlite3_stmt           *history;
+    ms_thread_t            writer;
+    ms_mutex_t             lock;           /* protects the fields below */
+    ms_cond_t              cond;
+    LinphoneChatMessageRow *queue;         /* waiting for the writer, oldest first */
+    LinphoneChatMessageRow *queue_tail;
+    LinphoneChatMessageRow *done;          /* written, waiting for linphone_core_message_storage_flush() */
+    bool_t                 writing;        /* the writer is busy with rows taken from the queue */
+    bool_t                 stop;
+    bool_t                 writer_running;
+} LinphoneChatMessageStorage;
+
+/* statements of the call log storage, prepared once when the database is opened */
+typedef struct _LinphoneCallLogStorage {
+    sqlite3_stmt *insert;
+    sqlite3_stmt *remove;
+    sqlite3_stmt *clear;
+    sqlite3_stmt *trim;
+    sqlite3_stmt *set_ref_key;
+    sqlite3_stmt *count;
+    sqlite3_stmt *page;
+    sqlite3_stmt *peer_page;
+    sqlite3_stmt *status_page;
+} LinphoneCallLogStorage;
 #endif
 
 #include "mediastreamer2/mseventqueue.h"
@@ -114,6 +164,7 @@ struct _LinphoneCallLog {
     time_t               start_date_time; /**Start date of the call in seconds as expressed in a time_t */
     char                 *call_id;        /**unique id of a call*/
     bool_t               video_enabled;
+    int                  storage_id;      /**row of the call log in the sqlite storage, 0 if not stored*/
 };
 
 typedef struct _CallCallbackObj
@@ -143,6 +194,8 @@ struct _LinphoneChatMessage {
     SalCustomHeader                  *custom_headers;
     LinphoneChatMessageState         state;
     bool_t                           is_read;
+    int                              storage_id;   /* row in the sqlite history, 0 if not stored */
+    struct _LinphoneChatMessageRow   *pending_row; /* row queued for the storage writer, shared with the clones; NULL once written */
 };
 
 typedef struct StunCandidate {
@@ -166,6 +219,8 @@ struct _LinphoneCall
     char                    localip[LINPHONE_IPADDR_SIZE]; /* our best guess for local ipaddress for this call */
     time_t                  start_time;                    /*time at which the call was initiated*/
     time_t                  media_start_time;              /*time at which it was accepted, media streams established*/
+    uint64_t                setup_start_ms;                /*when the call object was created, in ms*/
+    int                     media_setup_time;              /*ms from call creation to the first media start, -1 until then*/
     LinphoneCallState       state;
     LinphoneCallState       transfer_state;                /*idle if no transfer*/
     LinphoneReason          reason;
@@ -176,6 +231,7 @@ struct _LinphoneCall
     int                     video_port;
     StunCandidate           ac, vc;       /*audio video ip/port discovered by STUN*/
     struct _AudioStream     *audiostream; /**/
+    struct _AudioStream     *idle_audiostream; /*built and bound on audio_port but never started, reused by the next init*/
     struct _VideoStream     *videostream;
     MSAudioEndpoint         *endpoint;    /*used for conferencing*/
     char                    *refer_to;
@@ -216,6 +272,9 @@ struct _LinphoneCall
     bool_t                  ping_replied;
     bool_t                  record_active;
     bool_t                  paused_by_app;
+
+    bool_t                  media_timed_out; /*no RTP for nortp_timeout, set by the stream tasks*/
+    bool_t                  pad[3];
 };
 
 LinphoneCall *linphone_call_new_outgoing(struct _LinphoneCore *lc, LinphoneAddress *from, LinphoneAddress *to, const LinphoneCallParams *params);
@@ -225,6 +284,7 @@ void linphone_call_destroy(struct _LinphoneCall *obj);
 
 /* private: */
 LinphoneCallLog *linphone_call_log_new(LinphoneCall *call, LinphoneAddress *local, LinphoneAddress *remote);
+void set_call_log_date(LinphoneCallLog *cl, time_t start_time);
 void linphone_call_log_completed(LinphoneCall *call);
 void linphone_call_log_destroy(LinphoneCallLog *cl);
 void linphone_call_set_transfer_state(LinphoneCall *call, LinphoneCallState state);
@@ -241,8 +301,10 @@ void linphone_proxy_config_set_state(LinphoneProxyConfig *cfg, LinphoneRegistrat
 int linphone_online_status_to_eXosip(LinphoneOnlineStatus os);
 void linphone_friend_close_subscriptions(LinphoneFriend *lf);
 void linphone_friend_notify(LinphoneFriend *lf, LinphoneOnlineStatus os);
-LinphoneFriend *linphone_find_friend_by_inc_subscribe(MSList *l, SalOp *op);
-LinphoneFriend *linphone_find_friend_by_out_subscribe(MSList *l, SalOp *op);
+LinphoneFriend *linphone_core_find_friend_by_inc_subscribe(const LinphoneCore *lc, SalOp *op);
+LinphoneFriend *linphone_core_find_friend_by_out_subscribe(const LinphoneCore *lc, SalOp *op);
+void linphone_friend_set_insub(LinphoneFriend *lf, SalOp *op);
+void linphone_friend_set_outsub(LinphoneFriend *lf, SalOp *op);
 
 int parse_hostname_to_addr(const char *server, struct sockaddr_storage *ss, socklen_t *socklen);
 int set_lock_file();
@@ -302,6 +364,8 @@ void linphone_subscription_answered(LinphoneCore *lc, SalOp *op);
 void linphone_subscription_closed(LinphoneCore *lc, SalOp *op);
 
 MSList *linphone_find_friend(MSList *fl, const LinphoneAddress *fri, LinphoneFriend **lf);
+LinphoneFriend *linphone_core_find_friend(const LinphoneCore *lc, const LinphoneAddress *addr);
+void linphone_core_free_friend_indexes(LinphoneCore *lc);
 
 void linphone_core_update_allocated_audio_bandwidth(LinphoneCore *lc);
 void linphone_core_update_allocated_audio_bandwidth_in_call(LinphoneCall *call, const PayloadType *pt);
@@ -314,7 +378,7 @@ void linphone_core_update_local_media_description_from_ice(SalMediaDescription *
 void linphone_core_update_ice_from_remote_media_description(LinphoneCall *call, const SalMediaDescription *md);
 bool_t linphone_core_media_description_contains_video_stream(const SalMediaDescription *md);
 
-void linphone_core_send_initial_subscribes(LinphoneCore *lc);
+bool_t linphone_core_send_initial_subscribes(LinphoneCore *lc);
 void linphone_core_write_friends_config(LinphoneCore *lc);
 void linphone_friend_write_to_config_file(struct _LpConfig *config, LinphoneFriend *lf, int index);
 LinphoneFriend *linphone_friend_new_from_config_file(struct _LinphoneCore *lc, int index);
@@ -324,6 +388,12 @@ void linphone_proxy_config_get_contact(LinphoneProxyConfig *cfg, const char **ip
 LinphoneProxyConfig *linphone_core_lookup_known_proxy(LinphoneCore *lc, const LinphoneAddress *uri);
 const char *linphone_core_find_best_identity(LinphoneCore *lc, const LinphoneAddress *to, const char **route);
 int linphone_core_get_local_ip_for(int type, const char *dest, char *result);
+int linphone_core_reserve_rtp_port(LinphoneCore *lc, SalStreamType type);
+void linphone_core_release_rtp_port(LinphoneCore *lc, SalStreamType type, int port);
+void linphone_core_uninit_port_pools(LinphoneCore *lc);
+void linphone_core_fill_audio_stream_pool(LinphoneCore *lc);
+void linphone_core_flush_audio_stream_pool(LinphoneCore *lc);
+bool_t linphone_core_audio_stream_pool_needs_fill(LinphoneCore *lc);
 
 LinphoneProxyConfig *linphone_proxy_config_new_from_config_file(struct _LpConfig *config, int index);
 void linphone_proxy_config_write_to_config_file(struct _LpConfig *config, LinphoneProxyConfig *obj, int index);
@@ -416,13 +486,23 @@ struct _LinphoneAuthInfo
 };
 
 struct _LinphoneChatRoom {
-    struct _LinphoneCore *lc;
-    char                 *peer;
-    LinphoneAddress      *peer_url;
-    void                 *user_data;
-    MSList               *messages_hist;
+    struct _LinphoneCore     *lc;
+    char                     *peer;
+    LinphoneAddress          *peer_url;
+    void                     *user_data;
+    MSList                   *messages_hist;
+    struct _LinphoneChatRoom *hash_next; /* next room of the same lc->chatroom_index bucket */
+    unsigned int             peer_hash;
+    bool_t                   indexed;
 };
 
+typedef struct _LinphoneChatRoomIndex
+{
+    LinphoneChatRoom **buckets;
+    int              nb_buckets;
+    int              count;
+} LinphoneChatRoomIndex;
+
 struct _LinphoneFriend {
     LinphoneAddress         *uri;
     SalOp                   *insub;
@@ -436,6 +516,7 @@ struct _LinphoneFriend {
     bool_t                  subscribe_active;
     bool_t                  inc_subscribe_pending;
     bool_t                  commit;
+    struct _LinphoneCore    *indexed_in; /* core whose friend indexes hold this friend */
 };
 
 typedef struct sip_config
@@ -477,6 +558,31 @@ typedef struct rtp_config
     bool_t pad;
 } rtp_config_t;
 
+typedef struct _LinphonePortPool
+{
+    int          min_port;  /* configured range the bitmap was built for */
+    int          max_port;
+    int          base;      /* RTP port of the first pair */
+    int          nb_pairs;
+    unsigned int *bitmap;   /* one bit per reserved RTP/RTCP pair */
+    bool_t       fixed;     /* a single port was configured, scan from it */
+    bool_t       pad[3];
+} LinphonePortPool;
+
+typedef struct _LinphoneFriendIndexEntry
+{
+    struct _LinphoneFriendIndexEntry *next;
+    unsigned int                     hash;
+    LinphoneFriend                   *lf;
+} LinphoneFriendIndexEntry;
+
+typedef struct _LinphoneFriendIndex
+{
+    LinphoneFriendIndexEntry **buckets;
+    int                      nb_buckets;
+    int                      count;
+} LinphoneFriendIndex;
+
 typedef struct net_config
 {
     char   *nat_address;           /* may be IP or host name */
@@ -557,6 +663,8 @@ struct _LinphoneConference {
 
 typedef struct _LinphoneConference LinphoneConference;
 
+typedef struct _LinphoneCallWorkers LinphoneCallWorkers;
+
 struct _LinphoneCore
 {
     LinphoneCoreVTable            vtable;
@@ -567,6 +675,11 @@ struct _LinphoneCore
     net_config_t                  net_conf;
     sip_config_t                  sip_conf;
     rtp_config_t                  rtp_conf;
+    LinphonePortPool              audio_port_pool;
+    LinphonePortPool              video_port_pool;
+    MSList                        *audio_stream_pool; /* idle AudioStreams bound on reserved ports, taken by new calls */
+    time_t                        audio_stream_pool_retry;
+    LinphoneCallWorkers           *call_workers; /* threads running the stream tasks of calls, see linphone_core_run_call_workers() */
     sound_config_t                sound_conf;
     video_config_t                video_conf;
     codecs_config_t               codecs_conf;
@@ -576,6 +689,12 @@ struct _LinphoneCore
     int                           dyn_pt;
     LinphoneProxyConfig           *default_proxy;
     MSList                        *friends;
+    LinphoneFriendIndex           friends_by_address; /* lc->friends keyed by username and domain */
+    LinphoneFriendIndex           friends_by_insub;   /* lc->friends keyed by incoming subscription op */
+    LinphoneFriendIndex           friends_by_outsub;  /* lc->friends keyed by outgoing subscription op */
+    time_t                        initial_subscribes_time;  /* second in which initial_subscribes_count were sent */
+    int                           initial_subscribes_count;
+    MSList                        *initial_subscribes_next; /* friend to resume from when initial_subscribes_paused */
     MSList                        *auth_info;
     struct _RingStream            *ringstream;
     time_t                        dmfs_playing_start_time;
@@ -585,7 +704,9 @@ struct _LinphoneCore
     MSList                        *queued_calls; /* used by the autoreplier */
     MSList                        *call_logs;
     MSList                        *chatrooms;
+    LinphoneChatRoomIndex         chatroom_index; /* lc->chatrooms keyed by peer username, see linphone_core_get_chat_room() */
     int                           max_call_logs;
+    bool_t                        call_logs_loaded; /* FALSE while call_logs only holds the logs of calls ended since the sqlite storage was opened */
     int                           missed_calls;
     VideoPreview                  *previewstream;
     struct _MSEventQueue          *msevq;
@@ -613,6 +734,7 @@ struct _LinphoneCore
     bool_t                        use_files;
     bool_t                        apply_nat_settings;
     bool_t                        initial_subscribes_sent;
+    bool_t                        initial_subscribes_paused;
     bool_t                        bl_refresh;
 
     bool_t                        preview_finished;
@@ -633,6 +755,8 @@ struct _LinphoneCore
     char                          *chat_db_file;
 #ifdef MSG_STORAGE_ENABLED
     sqlite3                       *db;
+    LinphoneChatMessageStorage    message_storage;
+    LinphoneCallLogStorage        call_log_storage;
 #endif
 #ifdef BUILD_UPNP
     UpnpContext                   *upnp;
@@ -684,6 +808,9 @@ LinphoneEcCalibratorStatus ec_calibrator_get_status(EcCalibrator *ecc);
 void ec_calibrator_destroy(EcCalibrator *ecc);
 
 void linphone_call_background_tasks(LinphoneCall *call, bool_t one_second_elapsed);
+void linphone_call_process_stream_events(LinphoneCall *call);
+bool_t linphone_core_run_call_workers(LinphoneCore *lc, bool_t one_second_elapsed);
+void linphone_core_stop_call_workers(LinphoneCore *lc);
 void linphone_core_preempt_sound_resources(LinphoneCore *lc);
 int _linphone_core_pause_call(LinphoneCore *lc, LinphoneCall *call);
 
@@ -726,6 +853,18 @@ void linphone_chat_message_store(LinphoneChatMessage *msg);
 void linphone_chat_message_store_state(LinphoneChatMessage *msg);
 void linphone_core_message_storage_init(LinphoneCore *lc);
 void linphone_core_message_storage_close(LinphoneCore *lc);
+void linphone_core_message_storage_flush(LinphoneCore *lc);
+void linphone_chat_message_storage_forget(LinphoneChatMessage *msg);
+void linphone_chat_message_storage_share(const LinphoneChatMessage *msg, LinphoneChatMessage *clone);
+void linphone_core_free_chat_room_index(LinphoneCore *lc);
+
+bool_t linphone_core_call_log_storage_enabled(LinphoneCore *lc);
+void linphone_core_call_log_store(LinphoneCore *lc, LinphoneCallLog *cl);
+void linphone_core_call_log_store_ref_key(LinphoneCore *lc, LinphoneCallLog *cl);
+void linphone_core_call_log_unstore(LinphoneCore *lc, LinphoneCallLog *cl);
+void linphone_core_call_log_storage_clear(LinphoneCore *lc);
+int linphone_core_call_log_storage_count(LinphoneCore *lc);
+MSList *linphone_core_call_log_storage_query(LinphoneCore *lc, const char *peer, bool_t missed_only, int offset, int count);
 
 typedef enum _LinphoneToneID {
     LinphoneToneBusy,
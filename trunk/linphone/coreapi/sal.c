@@ -284,6 +284,128 @@ int sal_media_description_equals(
     return result;
 }
 
+/*
+ * 64 bit FNV-1a hash of everything that can influence an offer/answer
+ * negotiation, used to recognize a description that did not change.
+ * The o= line session id and version are left out: linphone increments its
+ * own version each time it rebuilds the local description.
+ */
+#define SAL_FINGERPRINT_INIT  0xcbf29ce484222325ULL
+#define SAL_FINGERPRINT_PRIME 0x100000001b3ULL
+
+static uint64_t fingerprint_bytes(
+    uint64_t h, const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    size_t              i;
+    for (i = 0; i < len; i++)
+    {
+        h ^= p[i];
+        h *= SAL_FINGERPRINT_PRIME;
+    }
+    return h;
+}
+
+static uint64_t fingerprint_string(
+    uint64_t h, const char *str)
+{
+    /*include the terminating zero so that consecutive strings cannot be confused*/
+    if (str == NULL) str = "";
+    return fingerprint_bytes(h, str, strlen(str) + 1);
+}
+
+static uint64_t fingerprint_int(
+    uint64_t h, int value)
+{
+    return fingerprint_bytes(h, &value, sizeof(value));
+}
+
+static uint64_t fingerprint_stream(
+    uint64_t h, const SalStreamDescription *sd)
+{
+    const MSList *elem;
+    int          i;
+
+    h = fingerprint_int(h, sd->proto);
+    h = fingerprint_int(h, sd->type);
+    h = fingerprint_string(h, sd->typeother);
+    h = fingerprint_string(h, sd->rtp_addr);
+    h = fingerprint_string(h, sd->rtcp_addr);
+    h = fingerprint_int(h, sd->rtp_port);
+    h = fingerprint_int(h, sd->rtcp_port);
+    for (elem = sd->payloads; elem != NULL; elem = elem->next)
+    {
+        const PayloadType *pt = (const PayloadType *)elem->data;
+        h = fingerprint_int(h, payload_type_get_number(pt));
+        h = fingerprint_int(h, pt->type);
+        h = fingerprint_string(h, pt->mime_type);
+        h = fingerprint_int(h, pt->clock_rate);
+        h = fingerprint_int(h, pt->channels);
+        h = fingerprint_int(h, pt->normal_bitrate);
+        h = fingerprint_int(h, pt->flags);
+        h = fingerprint_string(h, pt->recv_fmtp);
+        h = fingerprint_string(h, pt->send_fmtp);
+    }
+    h = fingerprint_int(h, ms_list_size(sd->payloads));
+    h = fingerprint_int(h, sd->bandwidth);
+    h = fingerprint_int(h, sd->ptime);
+    h = fingerprint_int(h, sd->dir);
+    for (i = 0; i < SAL_CRYPTO_ALGO_MAX; i++)
+    {
+        h = fingerprint_int(h, sd->crypto[i].tag);
+        h = fingerprint_int(h, sd->crypto[i].algo);
+        h = fingerprint_string(h, sd->crypto[i].master_key);
+    }
+    h = fingerprint_int(h, sd->crypto_local_tag);
+    h = fingerprint_int(h, sd->max_rate);
+    for (i = 0; i < SAL_MEDIA_DESCRIPTION_MAX_ICE_CANDIDATES; i++)
+    {
+        const SalIceCandidate *candidate = &sd->ice_candidates[i];
+        h = fingerprint_string(h, candidate->addr);
+        h = fingerprint_string(h, candidate->raddr);
+        h = fingerprint_string(h, candidate->foundation);
+        h = fingerprint_string(h, candidate->type);
+        h = fingerprint_int(h, candidate->componentID);
+        h = fingerprint_int(h, candidate->priority);
+        h = fingerprint_int(h, candidate->port);
+        h = fingerprint_int(h, candidate->rport);
+    }
+    for (i = 0; i < SAL_MEDIA_DESCRIPTION_MAX_ICE_REMOTE_CANDIDATES; i++)
+    {
+        h = fingerprint_string(h, sd->ice_remote_candidates[i].addr);
+        h = fingerprint_int(h, sd->ice_remote_candidates[i].port);
+    }
+    h = fingerprint_string(h, sd->ice_ufrag);
+    h = fingerprint_string(h, sd->ice_pwd);
+    h = fingerprint_int(h, sd->ice_mismatch);
+    h = fingerprint_int(h, sd->ice_completed);
+    return h;
+}
+
+uint64_t sal_media_description_fingerprint(
+    const SalMediaDescription *md)
+{
+    uint64_t h = SAL_FINGERPRINT_INIT;
+    int      i;
+
+    if (md == NULL)
+        return 0;
+    h = fingerprint_string(h, md->addr);
+    h = fingerprint_string(h, md->username);
+    h = fingerprint_int(h, md->n_active_streams);
+    h = fingerprint_int(h, md->n_total_streams);
+    h = fingerprint_int(h, md->bandwidth);
+    for (i = 0; i < md->n_total_streams; ++i)
+    {
+        h = fingerprint_stream(h, &md->streams[i]);
+    }
+    h = fingerprint_string(h, md->ice_ufrag);
+    h = fingerprint_string(h, md->ice_pwd);
+    h = fingerprint_int(h, md->ice_lite);
+    h = fingerprint_int(h, md->ice_completed);
+    return h;
+}
+
 static void assign_string(
     char **str, const char *arg)
 {
@@ -214,6 +214,8 @@ SalOp *sal_op_new(
     op->sdp_offering            = TRUE;
     op->pending_auth            = NULL;
     op->sdp_answer              = NULL;
+    op->last_result             = NULL;
+    op->last_answer             = NULL;
     op->reinvite                = FALSE;
     op->call_id                 = NULL;
     op->replaces                = NULL;
@@ -235,7 +237,11 @@ void sal_op_release(
     SalOp *op)
 {
     if (op->sdp_answer)
-        sdp_message_free(op->sdp_answer);
+        ms_free(op->sdp_answer);
+    if (op->last_result)
+        sal_media_description_unref(op->last_result);
+    if (op->last_answer)
+        ms_free(op->last_answer);
     if (op->pending_auth)
         eXosip_event_free(op->pending_auth);
     if (op->rid != -1)
@@ -667,31 +673,85 @@ static int extract_received_rport(
 }
 
 static void set_sdp(
-    osip_message_t *sip, sdp_message_t *msg)
+    osip_message_t *sip, const char *sdp)
 {
     int  sdplen;
     char clen[10];
-    char *sdp = NULL;
-    sdp_message_to_str(msg, &sdp);
     sdplen = strlen(sdp);
     snprintf(clen, sizeof(clen), "%i", sdplen);
     osip_message_set_body(sip, sdp, sdplen);
     osip_message_set_content_type(sip, "application/sdp");
     osip_message_set_content_length(sip, clen);
-    osip_free(sdp);
 }
 
 static void set_sdp_from_desc(
     osip_message_t *sip, const SalMediaDescription *desc)
 {
-    sdp_message_t *msg = media_description_to_sdp(desc);
-    if (msg == NULL)
+    char *sdp = media_description_to_sdp(desc);
+    if (sdp == NULL)
     {
         ms_error("Fail to print sdp message !");
         return;
     }
-    set_sdp(sip, msg);
-    sdp_message_free(msg);
+    set_sdp(sip, sdp);
+    ms_free(sdp);
+}
+
+/* parse the SDP body of msg, if any, straight into a new media description */
+static SalMediaDescription *get_remote_media(
+    osip_message_t *msg)
+{
+    osip_content_type_t *ctt;
+    osip_body_t         *body;
+    int                 pos = 0;
+
+    if (msg == NULL)
+        return NULL;
+    ctt = osip_message_get_content_type(msg);
+    if (ctt == NULL || ctt->type == NULL || ctt->subtype == NULL)
+        return NULL;
+    if (osip_strcasecmp(ctt->type, "multipart") != 0
+        && (osip_strcasecmp(ctt->type, "application") != 0 || osip_strcasecmp(ctt->subtype, "sdp") != 0))
+        return NULL;
+    while ((body = (osip_body_t *)osip_list_get(&msg->bodies, pos++)) != NULL)
+    {
+        SalMediaDescription *md = sal_media_description_new();
+        if (sdp_to_media_description(body->body, md) == 0)
+            return md;
+        sal_media_description_unref(md);
+    }
+    return NULL;
+}
+
+static uint64_t offer_answer_fingerprint(
+    SalOp *h)
+{
+    uint64_t fingerprint = sal_media_description_fingerprint(h->base.local_media);
+    fingerprint = fingerprint * 0x100000001b3ULL ^ sal_media_description_fingerprint(h->base.remote_media);
+    /*only the remote o= line: our local session_ver is bumped for every accepted update, even when nothing changed*/
+    if (h->base.remote_media)
+    {
+        fingerprint = fingerprint * 0x100000001b3ULL ^ h->base.remote_media->session_id;
+        fingerprint = fingerprint * 0x100000001b3ULL ^ h->base.remote_media->session_ver;
+    }
+    return fingerprint * 0x100000001b3ULL ^ h->base.root->one_matching_codec;
+}
+
+/*our own offer starts a new negotiation: the previous answer, and the o= version it carries, must not be sent again*/
+static void forget_last_answer(
+    SalOp *h)
+{
+    if (h->last_result)
+    {
+        sal_media_description_unref(h->last_result);
+        h->last_result = NULL;
+    }
+    if (h->last_answer)
+    {
+        ms_free(h->last_answer);
+        h->last_answer = NULL;
+    }
+    h->last_fingerprint = 0;
 }
 
 static void sdp_process(
@@ -701,19 +761,32 @@ static void sdp_process(
     if (h->result)
     {
         sal_media_description_unref(h->result);
+        h->result = NULL;
     }
-    h->result = sal_media_description_new();
     if (h->sdp_offering)
     {
+        forget_last_answer(h);
+        h->result = sal_media_description_new();
         offer_answer_initiate_outgoing(h->base.local_media, h->base.remote_media, h->result);
     }
     else
     {
-        int i;
+        int      i;
+        uint64_t fingerprint = offer_answer_fingerprint(h);
         if (h->sdp_answer)
         {
-            sdp_message_free(h->sdp_answer);
+            ms_free(h->sdp_answer);
+        }
+        if (h->last_result && fingerprint == h->last_fingerprint)
+        {
+            /*session refresh or re-INVITE repeating the previous offer: answer the same way*/
+            ms_message("Remote offer and local capabilities unchanged, reusing previous answer.");
+            sal_media_description_ref(h->last_result);
+            h->result     = h->last_result;
+            h->sdp_answer = ms_strdup(h->last_answer);
+            return;
         }
+        h->result = sal_media_description_new();
         offer_answer_initiate_incoming(h->base.local_media, h->base.remote_media, h->result, h->base.root->one_matching_codec);
         h->sdp_answer        = media_description_to_sdp(h->result);
         /*once we have generated the SDP answer, we modify the result description for processing by the upper layer.
@@ -734,6 +807,14 @@ static void sdp_process(
                 h->result->streams[i].crypto[0] = h->base.remote_media->streams[i].crypto[0];
             }
         }
+        if (h->last_result)
+            sal_media_description_unref(h->last_result);
+        if (h->last_answer)
+            ms_free(h->last_answer);
+        sal_media_description_ref(h->result);
+        h->last_result      = h->result;
+        h->last_answer      = ms_strdup(h->sdp_answer);
+        h->last_fingerprint = fingerprint;
     }
 }
 
@@ -758,7 +839,7 @@ int sal_call_set_local_media_description(
         /*reset the sdp answer so that it is computed again*/
         if (h->sdp_answer)
         {
-            sdp_message_free(h->sdp_answer);
+            ms_free(h->sdp_answer);
             h->sdp_answer = NULL;
         }
     }
@@ -849,7 +930,7 @@ int sal_call_notify_ringing(
             if (h->sdp_answer)
             {
                 set_sdp(msg, h->sdp_answer);
-                sdp_message_free(h->sdp_answer);
+                ms_free(h->sdp_answer);
                 h->sdp_answer = NULL;
             }
             eXosip_call_send_answer(h->tid, 183, msg);
@@ -901,7 +982,7 @@ int sal_call_accept(
             if (h->sdp_answer)
             {
                 set_sdp(msg, h->sdp_answer);
-                sdp_message_free(h->sdp_answer);
+                ms_free(h->sdp_answer);
                 h->sdp_answer = NULL;
             }
         }
@@ -1328,13 +1409,13 @@ static SalOp *find_op(
 static void inc_new_call(
     Sal *sal, eXosip_event_t *ev)
 {
-    SalOp            *op = sal_op_new(sal);
-    osip_from_t      *from, *to;
-    osip_call_info_t *call_info;
-    char             *tmp    = NULL;
-    sdp_message_t    *sdp    = eXosip_get_sdp_info(ev->request);
+    SalOp               *op = sal_op_new(sal);
+    osip_from_t         *from, *to;
+    osip_call_info_t    *call_info;
+    char                *tmp    = NULL;
+    SalMediaDescription *md     = get_remote_media(ev->request);
 
-    osip_call_id_t   *callid = osip_message_get_call_id(ev->request);
+    osip_call_id_t      *callid = osip_message_get_call_id(ev->request);
 
     osip_call_id_to_str(callid, &tmp);
     op->base.call_id = ms_strdup(tmp);
@@ -1346,12 +1427,10 @@ static void inc_new_call(
     set_replaces(op, ev->request);
     sal_op_set_custom_header(op, sal_exosip_get_custom_headers(ev->request));
 
-    if (sdp)
+    if (md)
     {
         op->sdp_offering      = FALSE;
-        op->base.remote_media = sal_media_description_new();
-        sdp_to_media_description(sdp, op->base.remote_media);
-        sdp_message_free(sdp);
+        op->base.remote_media = md;
     }
     else op->sdp_offering = TRUE;
 
@@ -1386,8 +1465,8 @@ static void inc_new_call(
 static void handle_reinvite(
     Sal *sal,  eXosip_event_t *ev)
 {
-    SalOp         *op = find_op(sal, ev);
-    sdp_message_t *sdp;
+    SalOp               *op = find_op(sal, ev);
+    SalMediaDescription *md;
 
     if (op == NULL)
     {
@@ -1396,7 +1475,7 @@ static void handle_reinvite(
     }
     op->reinvite = TRUE;
     op->tid      = ev->tid;
-    sdp          = eXosip_get_sdp_info(ev->request);
+    md           = get_remote_media(ev->request);
     if (op->base.remote_media)
     {
         sal_media_description_unref(op->base.remote_media);
@@ -1407,12 +1486,10 @@ static void handle_reinvite(
         sal_media_description_unref(op->result);
         op->result = NULL;
     }
-    if (sdp)
+    if (md)
     {
         op->sdp_offering      = FALSE;
-        op->base.remote_media = sal_media_description_new();
-        sdp_to_media_description(sdp, op->base.remote_media);
-        sdp_message_free(sdp);
+        op->base.remote_media = md;
     }
     else
     {
@@ -1424,8 +1501,8 @@ static void handle_reinvite(
 static void handle_ack(
     Sal *sal,  eXosip_event_t *ev)
 {
-    SalOp         *op = find_op(sal, ev);
-    sdp_message_t *sdp;
+    SalOp               *op = find_op(sal, ev);
+    SalMediaDescription *md;
 
     if (op == NULL)
     {
@@ -1440,15 +1517,13 @@ static void handle_ack(
 
     if (op->sdp_offering)
     {
-        sdp = eXosip_get_sdp_info(ev->ack);
-        if (sdp)
+        md = get_remote_media(ev->ack);
+        if (md)
         {
             if (op->base.remote_media)
                 sal_media_description_unref(op->base.remote_media);
-            op->base.remote_media = sal_media_description_new();
-            sdp_to_media_description(sdp, op->base.remote_media);
+            op->base.remote_media = md;
             sdp_process(op);
-            sdp_message_free(sdp);
         }
     }
     if (op->reinvite)
@@ -1515,17 +1590,15 @@ static int call_proceeding(
 static void call_ringing(
     Sal *sal, eXosip_event_t *ev)
 {
-    sdp_message_t *sdp;
-    SalOp         *op = find_op(sal, ev);
+    SalMediaDescription *md;
+    SalOp               *op = find_op(sal, ev);
     if (call_proceeding(sal, ev) == -1) return;
 
     set_remote_ua(op, ev->response);
-    sdp = eXosip_get_sdp_info(ev->response);
-    if (sdp)
+    md = get_remote_media(ev->response);
+    if (md)
     {
-        op->base.remote_media = sal_media_description_new();
-        sdp_to_media_description(sdp, op->base.remote_media);
-        sdp_message_free(sdp);
+        op->base.remote_media = md;
         if (op->base.local_media) sdp_process(op);
     }
     sal->callbacks.call_ringing(op);
@@ -1534,10 +1607,10 @@ static void call_ringing(
 static void call_accepted(
     Sal *sal, eXosip_event_t *ev)
 {
-    sdp_message_t  *sdp;
-    osip_message_t *msg = NULL;
-    SalOp          *op  = find_op(sal, ev);
-    const char     *contact;
+    SalMediaDescription *md;
+    osip_message_t      *msg = NULL;
+    SalOp               *op  = find_op(sal, ev);
+    const char          *contact;
 
     if (op == NULL || op->terminated == TRUE)
     {
@@ -1552,12 +1625,10 @@ static void call_accepted(
     set_remote_ua(op, ev->response);
     set_remote_contact(op, ev->response);
 
-    sdp = eXosip_get_sdp_info(ev->response);
-    if (sdp)
+    md = get_remote_media(ev->response);
+    if (md)
     {
-        op->base.remote_media = sal_media_description_new();
-        sdp_to_media_description(sdp, op->base.remote_media);
-        sdp_message_free(sdp);
+        op->base.remote_media = md;
         if (op->base.local_media) sdp_process(op);
     }
     eXosip_call_build_ack(ev->did, &msg);
@@ -1578,7 +1649,7 @@ static void call_accepted(
     if (op->sdp_answer)
     {
         set_sdp(msg, op->sdp_answer);
-        sdp_message_free(op->sdp_answer);
+        ms_free(op->sdp_answer);
         op->sdp_answer = NULL;
     }
     eXosip_call_send_ack(ev->did, msg);
@@ -2780,11 +2851,16 @@ static bool_t process_event(
 int sal_iterate(
     Sal *sal)
 {
-    eXosip_event_t *ev;
-    while ((ev = eXosip_event_wait(0, 0)) != NULL)
+    eXosip_event_t *evs[16];
+    int            nb, i;
+
+    while ((nb = eXosip_event_wait_batch(evs, 16, 0, 0)) > 0)
     {
-        if (process_event(sal, ev))
-            eXosip_event_free(ev);
+        for (i = 0; i < nb; i++)
+        {
+            if (process_event(sal, evs[i]))
+                eXosip_event_free(evs[i]);
+        }
     }
 #ifdef HAVE_EXOSIP_TRYLOCK
     if (eXosip_trylock() == 0)
@@ -2804,6 +2880,26 @@ int sal_iterate(
     return 0;
 }
 
+int sal_wait_for_event(
+    Sal *sal, int timeout_ms)
+{
+    fd_set         fdset;
+    struct timeval tv;
+    int            fd = eXosip_event_geteventsocket();
+
+    /* sal_iterate() leaves the event pipe empty once the fifo is drained,
+       so anything readable here is a new event: leave it for sal_iterate(). */
+    FD_ZERO(&fdset);
+#ifdef WIN32
+    FD_SET((unsigned int)fd, &fdset);
+#else
+    FD_SET(fd, &fdset);
+#endif
+    tv.tv_sec  = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    return select(fd + 1, &fdset, NULL, NULL, timeout_ms < 0 ? NULL : &tv) > 0;
+}
+
 static void register_set_contact(
     osip_message_t *msg, const char *contact)
 {
@@ -3274,6 +3370,7 @@ int sal_call_update(
     if (h->base.local_media)
     {
         h->sdp_offering = TRUE;
+        forget_last_answer(h);
         set_sdp_from_desc(reinvite, h->base.local_media);
     }
     else h->sdp_offering = FALSE;
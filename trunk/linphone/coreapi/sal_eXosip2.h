@@ -23,8 +23,8 @@
 #include "sip_sal.h"
 #include <eXosip2/eXosip.h>
 
-sdp_message_t *media_description_to_sdp(const SalMediaDescription *sal);
-int sdp_to_media_description(sdp_message_t *sdp, SalMediaDescription *desc);
+char *media_description_to_sdp(const SalMediaDescription *sal);
+int sdp_to_media_description(const char *sdp, SalMediaDescription *desc);
 
 struct Sal {
     SalCallbacks callbacks;
@@ -63,7 +63,10 @@ struct SalOp {
     int                 nid;
     int                 expires;
     SalMediaDescription *result;
-    sdp_message_t       *sdp_answer;
+    char                *sdp_answer;
+    SalMediaDescription *last_result; /*last incoming negotiation, reused while offer and capabilities are unchanged*/
+    char                *last_answer;
+    uint64_t            last_fingerprint;
     eXosip_event_t      *pending_auth;
     osip_call_id_t      *call_id; /*used for out of calls transaction in order
                                      to retrieve the operation when receiving a response*/
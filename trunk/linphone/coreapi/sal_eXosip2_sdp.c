@@ -22,6 +22,8 @@
 #include "ortp/ortp_srtp.h"
 #include "sip_sal.h"
 #include <eXosip2/eXosip.h>
+#include <stdarg.h>
+#include <ctype.h>
 #include "Ext\libMemLeakDetection.h"
 
 #define keywordcmp(key, b) strcmp(key, b)
@@ -54,154 +56,77 @@ static void add_relay_info(
 
 #endif
 
-static char *int_2char(
-    int a)
-{
-    char *p = osip_malloc(16);
-    snprintf(p, 16, "%i", a);
-    return p;
-}
+/*
+ * SDP printer.
+ * The SDP text is generated straight from the SalMediaDescription into a
+ * growable buffer, following the line ordering of sdp_message_to_str(), so
+ * that no intermediate sdp_message_t tree has to be built for each offer
+ * and answer.
+ */
 
-/* return the value of attr "field" for payload pt at line pos (field=rtpmap,fmtp...)*/
-static const char *sdp_message_a_attr_value_get_with_pt(
-    sdp_message_t *sdp, int pos, int pt, const char *field)
+#define SDP_BUFFER_MAX_LINE 65536
+
+typedef struct _SdpBuffer
 {
-    int             i, tmppt = 0, scanned = 0;
-    char            *tmp;
-    sdp_attribute_t *attr;
-    for (i = 0; (attr = sdp_message_attribute_get(sdp, pos, i)) != NULL; i++)
-    {
-        if (keywordcmp(field, attr->a_att_field) == 0 && attr->a_att_value != NULL)
-        {
-            int nb = sscanf(attr->a_att_value, "%i %n", &tmppt, &scanned);
-            /* the return value may depend on how %n is interpreted by the libc: see manpage*/
-            if (nb == 1 || nb == 2)
-            {
-                if (pt == tmppt)
-                {
-                    tmp = attr->a_att_value + scanned;
-                    if (strlen(tmp) > 0)
-                        return tmp;
-                }
-            }
-            else ms_warning("sdp has a strange a= line (%s) nb=%i", attr->a_att_value, nb);
-        }
-    }
-    return NULL;
-}
+    char   *data;
+    size_t len;
+    size_t size;
+} SdpBuffer;
 
-#ifdef FOR_LATER
-/* return the value of attr "field" */
-static const char *sdp_message_a_attr_value_get(
-    sdp_message_t *sdp, int pos, const char *field)
+static void sdp_buffer_reserve(
+    SdpBuffer *buf, size_t len)
 {
-    int             i;
-    sdp_attribute_t *attr;
-    for (i = 0; (attr = sdp_message_attribute_get(sdp, pos, i)) != NULL; i++)
-    {
-        if (keywordcmp(field, attr->a_att_field) == 0 && attr->a_att_value != NULL)
-        {
-            return attr->a_att_value;
-        }
-    }
-    return NULL;
+    if (buf->len + len + 1 <= buf->size)
+        return;
+    while (buf->len + len + 1 > buf->size)
+        buf->size *= 2;
+    buf->data = ms_realloc(buf->data, buf->size);
 }
 
-#endif
-
-static int _sdp_message_get_a_ptime(
-    sdp_message_t *sdp, int mline)
+static void sdp_buffer_append(
+    SdpBuffer *buf, const char *str)
 {
-    int             i, ret;
-    sdp_attribute_t *attr;
-    for (i = 0; (attr = sdp_message_attribute_get(sdp, mline, i)) != NULL; i++)
-    {
-        if (keywordcmp("ptime", attr->a_att_field) == 0)
-        {
-            int nb = sscanf(attr->a_att_value, "%i", &ret);
-            /* the return value may depend on how %n is interpreted by the libc: see manpage*/
-            if (nb == 1)
-            {
-                return ret;
-            }
-            else ms_warning("sdp has a strange a=ptime line (%s) ", attr->a_att_value);
-        }
-    }
-    return 0;
+    size_t len = strlen(str);
+    sdp_buffer_reserve(buf, len);
+    memcpy(buf->data + buf->len, str, len + 1);
+    buf->len += len;
 }
 
-static int _sdp_message_get_mline_dir(
-    sdp_message_t *sdp, int mline)
+static void sdp_buffer_printf(
+    SdpBuffer *buf, const char *fmt, ...)
 {
-    int             i;
-    sdp_attribute_t *attr;
-    for (i = 0; (attr = sdp_message_attribute_get(sdp, mline, i)) != NULL; i++)
+    va_list args;
+    size_t  avail;
+    int     nb;
+
+    for (;;)
     {
-        if (keywordcmp("sendrecv", attr->a_att_field) == 0)
-        {
-            return SalStreamSendRecv;
-        }
-        else if (keywordcmp("sendonly", attr->a_att_field) == 0)
-        {
-            return SalStreamSendOnly;
-        }
-        else if (keywordcmp("recvonly", attr->a_att_field) == 0)
+        avail = buf->size - buf->len;
+        va_start(args, fmt);
+        nb    = vsnprintf(buf->data + buf->len, avail, fmt, args);
+        va_end(args);
+        if (nb >= 0 && (size_t)nb < avail)
         {
-            return SalStreamRecvOnly;
+            buf->len += nb;
+            return;
         }
-        else if (keywordcmp("inactive", attr->a_att_field) == 0)
+        /* _vsnprintf() returns -1 instead of the needed size when the output is truncated */
+        if (nb < 0 && avail > SDP_BUFFER_MAX_LINE)
         {
-            return SalStreamInactive;
+            buf->data[buf->len] = '\0';
+            return;
         }
+        sdp_buffer_reserve(buf, nb >= 0 ? (size_t)nb : avail * 2);
     }
-    return SalStreamSendRecv;
 }
 
-static sdp_message_t *create_generic_sdp(
-    const SalMediaDescription *desc)
+static void sdp_buffer_attribute(
+    SdpBuffer *buf, const char *field, const char *value)
 {
-    sdp_message_t *local;
-    int           inet6;
-    char          sessid[16];
-    char          sessver[16];
-    const char    *rtp_addr = desc->addr;
-
-    snprintf(sessid,  16, "%i", desc->session_id);
-    snprintf(sessver, 16, "%i", desc->session_ver);
-    sdp_message_init(&local);
-    if (strchr(desc->addr, ':') != NULL)
-    {
-        inet6 = 1;
-    }
-    else inet6 = 0;
-    sdp_message_v_version_set(local, osip_strdup("0"));
-    sdp_message_o_origin_set(local, osip_strdup(desc->username),
-                             osip_strdup(sessid), osip_strdup(sessver),
-                             osip_strdup("IN"), inet6 ? osip_strdup("IP6") : osip_strdup("IP4"),
-                             osip_strdup(desc->addr));
-    sdp_message_s_name_set(local, osip_strdup("Talk"));
-    /* Do not set the c= line to 0.0.0.0 if there is an ICE session. */
-    if ((desc->ice_ufrag[0] != '\0') || !sal_media_description_has_dir(desc, SalStreamSendOnly))
-    {
-        sdp_message_c_connection_add(local, -1,
-                                     osip_strdup("IN"), inet6 ? osip_strdup("IP6") : osip_strdup("IP4"),
-                                     osip_strdup(rtp_addr), NULL, NULL);
-    }
+    if (value != NULL)
+        sdp_buffer_printf(buf, "a=%s:%s\r\n", field, value);
     else
-    {
-        sdp_message_c_connection_add(local, -1,
-                                     osip_strdup("IN"), inet6 ? osip_strdup("IP6") : osip_strdup("IP4"),
-                                     inet6 ? osip_strdup("::0") : osip_strdup("0.0.0.0"), NULL, NULL);
-    }
-    sdp_message_t_time_descr_add(local, osip_strdup("0"), osip_strdup("0"));
-    if (desc->bandwidth > 0)
-        sdp_message_b_bandwidth_add(local, -1, osip_strdup("AS"),
-                                    int_2char(desc->bandwidth));
-    if (desc->ice_completed == TRUE) sdp_message_a_attribute_add(local, -1, osip_strdup("nortpproxy"), osip_strdup("yes"));
-    if (desc->ice_pwd[0] != '\0') sdp_message_a_attribute_add(local, -1, osip_strdup("ice-pwd"), osip_strdup(desc->ice_pwd));
-    if (desc->ice_ufrag[0] != '\0') sdp_message_a_attribute_add(local, -1, osip_strdup("ice-ufrag"), osip_strdup(desc->ice_ufrag));
-
-    return local;
+        sdp_buffer_printf(buf, "a=%s\r\n", field);
 }
 
 static bool_t is_known_rtpmap(
@@ -219,92 +144,64 @@ static bool_t is_known_rtpmap(
 }
 
 static void add_payload(
-    sdp_message_t *msg, int line, const PayloadType *pt, bool_t strip_well_known_rtpmaps)
+    SdpBuffer *buf, const PayloadType *pt, bool_t strip_well_known_rtpmaps)
 {
-    char attr[256];
-    sdp_message_m_payload_add(msg, line, int_2char(payload_type_get_number(pt)));
-
     if (!strip_well_known_rtpmaps || !is_known_rtpmap(pt))
     {
         if (pt->channels > 1)
-        snprintf(attr, sizeof(attr), "%i %s/%i/%i", payload_type_get_number(pt),
-                 pt->mime_type, pt->clock_rate, pt->channels);
-    else
-        snprintf(attr, sizeof(attr), "%i %s/%i", payload_type_get_number(pt),
-                 pt->mime_type, pt->clock_rate);
-    sdp_message_a_attribute_add(msg, line,
-                                osip_strdup("rtpmap"), osip_strdup(attr));
+            sdp_buffer_printf(buf, "a=rtpmap:%i %s/%i/%i\r\n", payload_type_get_number(pt),
+                              pt->mime_type, pt->clock_rate, pt->channels);
+        else
+            sdp_buffer_printf(buf, "a=rtpmap:%i %s/%i\r\n", payload_type_get_number(pt),
+                              pt->mime_type, pt->clock_rate);
     }
 
     if (pt->recv_fmtp != NULL)
     {
-        snprintf(attr, sizeof(attr), "%i %s", payload_type_get_number(pt), pt->recv_fmtp);
-        sdp_message_a_attribute_add(msg, line, osip_strdup("fmtp"),
-                                    osip_strdup(attr));
+        sdp_buffer_printf(buf, "a=fmtp:%i %s\r\n", payload_type_get_number(pt), pt->recv_fmtp);
     }
 }
 
 static void add_ice_candidates(
-    sdp_message_t *msg, int lineno, const SalStreamDescription *desc)
+    SdpBuffer *buf, const SalStreamDescription *desc)
 {
-    char                  buffer[1024];
     const SalIceCandidate *candidate;
-    int                   nb;
     int                   i;
 
     for (i = 0; i < SAL_MEDIA_DESCRIPTION_MAX_ICE_CANDIDATES; i++)
     {
         candidate = &desc->ice_candidates[i];
         if ((candidate->addr[0] == '\0') || (candidate->port == 0)) break;
-        nb        = snprintf(buffer, sizeof(buffer), "%s %u UDP %u %s %d typ %s",
-                             candidate->foundation, candidate->componentID, candidate->priority, candidate->addr, candidate->port, candidate->type);
-        if (nb < 0)
-        {
-            ms_error("Cannot add ICE candidate attribute!");
-            return;
-        }
+        sdp_buffer_printf(buf, "a=candidate:%s %u UDP %u %s %d typ %s",
+                          candidate->foundation, candidate->componentID, candidate->priority, candidate->addr, candidate->port, candidate->type);
         if (candidate->raddr[0] != '\0')
-        {
-            nb = snprintf(buffer + nb, sizeof(buffer) - nb, " raddr %s rport %d", candidate->raddr, candidate->rport);
-            if (nb < 0)
-            {
-                ms_error("Cannot add ICE candidate attribute!");
-                return;
-            }
-        }
-        sdp_message_a_attribute_add(msg, lineno, osip_strdup("candidate"), osip_strdup(buffer));
+            sdp_buffer_printf(buf, " raddr %s rport %d", candidate->raddr, candidate->rport);
+        sdp_buffer_append(buf, "\r\n");
     }
 }
 
 static void add_ice_remote_candidates(
-    sdp_message_t *msg, int lineno, const SalStreamDescription *desc)
+    SdpBuffer *buf, const SalStreamDescription *desc)
 {
-    char                        buffer[1024];
-    char                        *ptr   = buffer;
     const SalIceRemoteCandidate *candidate;
-    int                         offset = 0;
+    bool_t                      first = TRUE;
     int                         i;
 
-    buffer[0] = '\0';
     for (i = 0; i < SAL_MEDIA_DESCRIPTION_MAX_ICE_REMOTE_CANDIDATES; i++)
     {
         candidate = &desc->ice_remote_candidates[i];
         if ((candidate->addr[0] != '\0') && (candidate->port != 0))
         {
-            offset = snprintf(ptr, buffer + sizeof(buffer) - ptr, "%s%d %s %d", (i > 0) ? " " : "", i + 1, candidate->addr, candidate->port);
-            if (offset < 0)
-            {
-                ms_error("Cannot add ICE remote-candidates attribute!");
-                return;
-            }
-            ptr += offset;
+            if (first) sdp_buffer_append(buf, "a=remote-candidates:");
+            sdp_buffer_printf(buf, "%s%d %s %d", (i > 0) ? " " : "", i + 1, candidate->addr, candidate->port);
+            first = FALSE;
         }
     }
-    if (buffer[0] != '\0') sdp_message_a_attribute_add(msg, lineno, osip_strdup("remote-candidates"), osip_strdup(buffer));
+    if (!first) sdp_buffer_append(buf, "\r\n");
 }
 
 static void add_line(
-    sdp_message_t *msg, int lineno, const SalStreamDescription *desc)
+    SdpBuffer *buf, const char *session_addr, const SalStreamDescription *desc)
 {
     const char   *mt = NULL;
     const MSList *elem;
@@ -333,31 +230,48 @@ static void add_line(
     rtp_port  = desc->rtp_port;
     rtcp_port = desc->rtcp_port;
 
+    sdp_buffer_printf(buf, "m=%s %i %s", mt, rtp_port,
+                      desc->proto == SalProtoRtpSavp ? "RTP/SAVP" : "RTP/AVP");
+    if (desc->payloads)
+    {
+        for (elem = desc->payloads; elem != NULL; elem = elem->next)
+        {
+            sdp_buffer_printf(buf, " %i", payload_type_get_number((PayloadType *)elem->data));
+        }
+    }
+    else
+    {
+        /* to comply with SDP we cannot have an empty payload type number list */
+        /* as it happens only when mline is declined with a zero port, it does not matter to put whatever codec*/
+        sdp_buffer_append(buf, " 0");
+    }
+    sdp_buffer_append(buf, "\r\n");
+
+    /*only add a c= line within the stream description if address are differents*/
+    if (rtp_addr[0] != '\0' && strcmp(rtp_addr, session_addr) != 0)
+    {
+        sdp_buffer_printf(buf, "c=IN %s %s\r\n", strchr(rtp_addr, ':') != NULL ? "IP6" : "IP4", rtp_addr);
+    }
+
+    if (desc->bandwidth > 0)
+        sdp_buffer_printf(buf, "b=AS:%i\r\n", desc->bandwidth);
+
     if (desc->proto == SalProtoRtpSavp)
     {
         int i;
 
-        sdp_message_m_media_add(msg, osip_strdup(mt),
-                                int_2char(rtp_port), NULL,
-                                osip_strdup("RTP/SAVP"));
-
         /* add crypto lines */
         for (i = 0; i < SAL_CRYPTO_ALGO_MAX; i++)
         {
-            char buffer[1024];
             switch (desc->crypto[i].algo)
             {
             case AES_128_SHA1_80:
-                snprintf(buffer, 1024, "%d %s inline:%s",
-                         desc->crypto[i].tag, "AES_CM_128_HMAC_SHA1_80", desc->crypto[i].master_key);
-                sdp_message_a_attribute_add(msg, lineno, osip_strdup("crypto"),
-                                            osip_strdup(buffer));
+                sdp_buffer_printf(buf, "a=crypto:%d %s inline:%s\r\n",
+                                  desc->crypto[i].tag, "AES_CM_128_HMAC_SHA1_80", desc->crypto[i].master_key);
                 break;
             case AES_128_SHA1_32:
-                snprintf(buffer, 1024, "%d %s inline:%s",
-                         desc->crypto[i].tag, "AES_CM_128_HMAC_SHA1_32", desc->crypto[i].master_key);
-                sdp_message_a_attribute_add(msg, lineno, osip_strdup("crypto"),
-                                            osip_strdup(buffer));
+                sdp_buffer_printf(buf, "a=crypto:%d %s inline:%s\r\n",
+                                  desc->crypto[i].tag, "AES_CM_128_HMAC_SHA1_32", desc->crypto[i].master_key);
                 break;
             case AES_128_NO_AUTH:
                 ms_warning("Unsupported crypto suite: AES_128_NO_AUTH");
@@ -370,46 +284,13 @@ static void add_line(
             }
         }
     }
-    else
-    {
-    sdp_message_m_media_add(msg, osip_strdup(mt),
-                            int_2char(rtp_port), NULL,
-                            osip_strdup("RTP/AVP"));
-    }
-
-    /*only add a c= line within the stream description if address are differents*/
-    if (rtp_addr[0] != '\0' && strcmp(rtp_addr, sdp_message_c_addr_get(msg, -1, 0)) != 0)
-    {
-        bool_t inet6;
-        if (strchr(rtp_addr, ':') != NULL)
-        {
-            inet6 = TRUE;
-        }
-        else inet6 = FALSE;
-        sdp_message_c_connection_add(msg, lineno,
-                                     osip_strdup("IN"), inet6 ? osip_strdup("IP6") : osip_strdup("IP4"),
-                                     osip_strdup(rtp_addr), NULL, NULL);
-    }
 
-    if (desc->bandwidth > 0)
-        sdp_message_b_bandwidth_add(msg, lineno, osip_strdup("AS"),
-                                    int_2char(desc->bandwidth));
     if (desc->ptime > 0)
-        sdp_message_a_attribute_add(msg, lineno, osip_strdup("ptime"),
-                                    int_2char(desc->ptime));
+        sdp_buffer_printf(buf, "a=ptime:%i\r\n", desc->ptime);
     strip_well_known_rtpmaps = ms_list_size(desc->payloads) > 5;
-    if (desc->payloads)
+    for (elem = desc->payloads; elem != NULL; elem = elem->next)
     {
-        for (elem = desc->payloads; elem != NULL; elem = elem->next)
-        {
-            add_payload(msg, lineno, (PayloadType *)elem->data, strip_well_known_rtpmaps);
-        }
-    }
-    else
-    {
-        /* to comply with SDP we cannot have an empty payload type number list */
-        /* as it happens only when mline is declined with a zero port, it does not matter to put whatever codec*/
-        sdp_message_m_payload_add(msg, lineno, int_2char(0));
+        add_payload(buf, (PayloadType *)elem->data, strip_well_known_rtpmaps);
     }
     switch (desc->dir)
     {
@@ -427,54 +308,132 @@ static void add_line(
         dir = "inactive";
         break;
     }
-    if (dir) sdp_message_a_attribute_add(msg, lineno, osip_strdup(dir), NULL);
+    if (dir) sdp_buffer_attribute(buf, dir, NULL);
     if (rtp_port != 0)
     {
         different_rtp_and_rtcp_addr = (rtcp_addr[0] != '\0') && (strcmp(rtp_addr, rtcp_addr) != 0);
         if ((rtcp_port != (rtp_port + 1)) || (different_rtp_and_rtcp_addr == TRUE))
         {
             if (different_rtp_and_rtcp_addr == TRUE)
-            {
-                char buffer[1024];
-                snprintf(buffer, sizeof(buffer), "%u IN IP4 %s", rtcp_port, rtcp_addr);
-                sdp_message_a_attribute_add(msg, lineno, osip_strdup("rtcp"), osip_strdup(buffer));
-            }
+                sdp_buffer_printf(buf, "a=rtcp:%u IN IP4 %s\r\n", rtcp_port, rtcp_addr);
             else
-            {
-                sdp_message_a_attribute_add(msg, lineno, osip_strdup("rtcp"), int_2char(rtcp_port));
-            }
+                sdp_buffer_printf(buf, "a=rtcp:%i\r\n", rtcp_port);
         }
     }
     if (desc->ice_completed == TRUE)
     {
-        sdp_message_a_attribute_add(msg, lineno, osip_strdup("nortpproxy"), osip_strdup("yes"));
+        sdp_buffer_attribute(buf, "nortpproxy", "yes");
     }
     if (desc->ice_mismatch == TRUE)
     {
-        sdp_message_a_attribute_add(msg, lineno, osip_strdup("ice-mismatch"), NULL);
+        sdp_buffer_attribute(buf, "ice-mismatch", NULL);
     }
     else
     {
         if (desc->rtp_port != 0)
         {
-            if (desc->ice_pwd[0] != '\0') sdp_message_a_attribute_add(msg, lineno, osip_strdup("ice-pwd"), osip_strdup(desc->ice_pwd));
-            if (desc->ice_ufrag[0] != '\0') sdp_message_a_attribute_add(msg, lineno, osip_strdup("ice-ufrag"), osip_strdup(desc->ice_ufrag));
-            add_ice_candidates(msg, lineno, desc);
-            add_ice_remote_candidates(msg, lineno, desc);
+            if (desc->ice_pwd[0] != '\0') sdp_buffer_attribute(buf, "ice-pwd", desc->ice_pwd);
+            if (desc->ice_ufrag[0] != '\0') sdp_buffer_attribute(buf, "ice-ufrag", desc->ice_ufrag);
+            add_ice_candidates(buf, desc);
+            add_ice_remote_candidates(buf, desc);
         }
     }
 }
 
-sdp_message_t *media_description_to_sdp(
+/* Returns the SDP text for desc, to be freed with ms_free(). */
+char *media_description_to_sdp(
     const SalMediaDescription *desc)
 {
-    int           i;
-    sdp_message_t *msg = create_generic_sdp(desc);
+    SdpBuffer  buf;
+    int        i;
+    bool_t     inet6        = (strchr(desc->addr, ':') != NULL);
+    const char *session_addr = desc->addr;
+
+    buf.size    = 1024;
+    buf.len     = 0;
+    buf.data    = ms_malloc(buf.size);
+    buf.data[0] = '\0';
+
+    sdp_buffer_printf(&buf, "v=0\r\no=%s %i %i IN %s %s\r\ns=Talk\r\n",
+                      desc->username, desc->session_id, desc->session_ver,
+                      inet6 ? "IP6" : "IP4", desc->addr);
+    /* Do not set the c= line to 0.0.0.0 if there is an ICE session. */
+    if ((desc->ice_ufrag[0] == '\0') && sal_media_description_has_dir(desc, SalStreamSendOnly))
+    {
+        session_addr = inet6 ? "::0" : "0.0.0.0";
+    }
+    sdp_buffer_printf(&buf, "c=IN %s %s\r\n", inet6 ? "IP6" : "IP4", session_addr);
+    if (desc->bandwidth > 0)
+        sdp_buffer_printf(&buf, "b=AS:%i\r\n", desc->bandwidth);
+    sdp_buffer_append(&buf, "t=0 0\r\n");
+    if (desc->ice_completed == TRUE) sdp_buffer_attribute(&buf, "nortpproxy", "yes");
+    if (desc->ice_pwd[0] != '\0') sdp_buffer_attribute(&buf, "ice-pwd", desc->ice_pwd);
+    if (desc->ice_ufrag[0] != '\0') sdp_buffer_attribute(&buf, "ice-ufrag", desc->ice_ufrag);
+
     for (i = 0; i < desc->n_total_streams; ++i)
     {
-        add_line(msg, i, &desc->streams[i]);
+        add_line(&buf, session_addr, &desc->streams[i]);
     }
-    return msg;
+    return buf.data;
+}
+
+/*
+ * SDP parser.
+ * The body is copied once and split in place; every line is visited a single
+ * time and dispatched on its type and attribute name. Attributes which refer
+ * to payload numbers (rtpmap, fmtp) are indexed by number while the media
+ * section is read, and the payload list is resolved when the section ends.
+ */
+
+#define SDP_MAX_INDEXED_PAYLOADS 128
+
+typedef struct _SdpMediaIndex
+{
+    SalStreamDescription *stream;
+    char                 *formats;    /* payload numbers of the m= line */
+    const char           *rtcp;       /* value of the last a=rtcp line */
+    const char           *rtpmap[SDP_MAX_INDEXED_PAYLOADS];
+    const char           *fmtp[SDP_MAX_INDEXED_PAYLOADS];
+    int                  nb_ice_candidates;
+    int                  nb_crypto;
+    bool_t               has_dir;
+    bool_t               has_ptime;
+    bool_t               has_c;
+} SdpMediaIndex;
+
+static char *sdp_next_token(
+    char **str)
+{
+    char *tok = *str;
+    char *end;
+
+    while (*tok == ' ')
+        tok++;
+    if (*tok == '\0')
+        return NULL;
+    end = strchr(tok, ' ');
+    if (end != NULL)
+    {
+        *end = '\0';
+        *str = end + 1;
+    }
+    else *str = tok + strlen(tok);
+    return tok;
+}
+
+/* index a "<payload number> <value>" attribute, keeping the first occurence per number */
+static void sdp_index_payload_attribute(
+    const char **table, const char *value)
+{
+    int tmppt = 0, scanned = 0;
+    int nb    = sscanf(value, "%i %n", &tmppt, &scanned);
+    /* the return value may depend on how %n is interpreted by the libc: see manpage*/
+    if (nb == 1 || nb == 2)
+    {
+        if (tmppt >= 0 && tmppt < SDP_MAX_INDEXED_PAYLOADS && table[tmppt] == NULL && value[scanned] != '\0')
+            table[tmppt] = value + scanned;
+    }
+    else ms_warning("sdp has a strange a= line (%s) nb=%i", value, nb);
 }
 
 static int payload_type_fill_from_rtpmap(
@@ -519,234 +478,458 @@ static int payload_type_fill_from_rtpmap(
     return 0;
 }
 
-int sdp_to_media_description(
-    sdp_message_t *msg, SalMediaDescription *desc)
+static void sdp_parse_crypto(
+    SdpMediaIndex *idx, const char *value)
 {
-    int             i, j;
-    const char      *mtype, *proto, *rtp_port, *rtp_addr, *number;
-    const char      *sess;
-    sdp_bandwidth_t *sbw = NULL;
-    sdp_attribute_t *attr;
-    int             nb_ice_candidates;
+    SalStreamDescription *stream = idx->stream;
+    char                 tmp[256], tmp2[256];
+    int                  nb;
+
+    if (idx->nb_crypto >= SAL_CRYPTO_ALGO_MAX)
+        return;
+    nb = sscanf(value, "%d %255s inline:%255s",
+                &stream->crypto[idx->nb_crypto].tag,
+                tmp,
+                tmp2);
+    if (nb != 3)
+    {
+        ms_warning("sdp has a strange a= line (%s) nb=%i", value, nb);
+        return;
+    }
+    if (strcmp(tmp, "AES_CM_128_HMAC_SHA1_80") == 0)
+        stream->crypto[idx->nb_crypto].algo = AES_128_SHA1_80;
+    else if (strcmp(tmp, "AES_CM_128_HMAC_SHA1_32") == 0)
+        stream->crypto[idx->nb_crypto].algo = AES_128_SHA1_32;
+    else
+    {
+        ms_warning("Failed to parse crypto-algo: '%s'", tmp);
+        stream->crypto[idx->nb_crypto].algo = 0;
+    }
+    if (stream->crypto[idx->nb_crypto].algo)
+    {
+        strncpy(stream->crypto[idx->nb_crypto].master_key, tmp2, 41);
+        stream->crypto[idx->nb_crypto].master_key[40] = '\0';
+        ms_message("Found valid crypto line (tag:%d algo:'%s' key:'%s'",
+                   stream->crypto[idx->nb_crypto].tag,
+                   tmp,
+                   stream->crypto[idx->nb_crypto].master_key);
+        idx->nb_crypto++;
+    }
+}
 
-    /* Get session information. */
-    sess     = sdp_message_o_sess_id_get(msg);
-    if (sess) desc->session_id = strtoul(sess, NULL, 10);
-    sess     = sdp_message_o_sess_version_get(msg);
-    if (sess) desc->session_ver = strtoul(sess, NULL, 10);
+static void sdp_parse_remote_candidates(
+    SalStreamDescription *stream, const char *value)
+{
+    SalIceRemoteCandidate candidate;
+    unsigned int          componentID;
+    int                   offset;
+    const char            *ptr = value;
 
-    rtp_addr = sdp_message_c_addr_get(msg, -1, 0);
-    if (rtp_addr)
-        strncpy(desc->addr, rtp_addr, sizeof(desc->addr));
-    for (j = 0; (sbw = sdp_message_bandwidth_get(msg, -1, j)) != NULL; ++j)
+    while (3 == sscanf(ptr, "%u %63s %u%n", &componentID, candidate.addr, &candidate.port, &offset))
     {
-        if (strcasecmp(sbw->b_bwtype, "AS") == 0) desc->bandwidth = atoi(sbw->b_bandwidth);
+        if ((componentID > 0) && (componentID <= SAL_MEDIA_DESCRIPTION_MAX_ICE_REMOTE_CANDIDATES))
+        {
+            SalIceRemoteCandidate *remote_candidate = &stream->ice_remote_candidates[componentID - 1];
+            strncpy(remote_candidate->addr, candidate.addr, sizeof(remote_candidate->addr));
+            remote_candidate->port = candidate.port;
+        }
+        ptr += offset;
+        if (*ptr == ' ') ptr += 1;
     }
+}
 
-    /* Get ICE remote ufrag and remote pwd, and ice_lite flag */
-    for (i = 0; (i < SAL_MEDIA_DESCRIPTION_MAX_MESSAGE_ATTRIBUTES) && ((attr = sdp_message_attribute_get(msg, -1, i)) != NULL); i++)
+static void sdp_parse_media_attribute(
+    SdpMediaIndex *idx, const char *field, const char *value)
+{
+    SalStreamDescription *stream = idx->stream;
+
+    if (keywordcmp("rtpmap", field) == 0)
+    {
+        if (value != NULL) sdp_index_payload_attribute(idx->rtpmap, value);
+    }
+    else if (keywordcmp("fmtp", field) == 0)
     {
-        if ((keywordcmp("ice-ufrag", attr->a_att_field) == 0) && (attr->a_att_value != NULL))
+        if (value != NULL) sdp_index_payload_attribute(idx->fmtp, value);
+    }
+    else if (keywordcmp("ptime", field) == 0)
+    {
+        if (!idx->has_ptime)
         {
-            strncpy(desc->ice_ufrag, attr->a_att_value, sizeof(desc->ice_ufrag));
+            if (value != NULL && sscanf(value, "%i", &stream->ptime) == 1)
+                idx->has_ptime = TRUE;
+            else ms_warning("sdp has a strange a=ptime line (%s) ", value ? value : "");
         }
-        else if ((keywordcmp("ice-pwd", attr->a_att_field) == 0) && (attr->a_att_value != NULL))
+    }
+    else if (keywordcmp("sendrecv", field) == 0 || keywordcmp("sendonly", field) == 0
+             || keywordcmp("recvonly", field) == 0 || keywordcmp("inactive", field) == 0)
+    {
+        if (!idx->has_dir)
         {
-            strncpy(desc->ice_pwd, attr->a_att_value, sizeof(desc->ice_pwd));
+            if (field[0] == 'i')
+                stream->dir = SalStreamInactive;
+            else if (field[0] == 'r')
+                stream->dir = SalStreamRecvOnly;
+            else if (field[4] == 'o')
+                stream->dir = SalStreamSendOnly;
+            else
+                stream->dir = SalStreamSendRecv;
+            idx->has_dir = TRUE;
         }
-        else if (keywordcmp("ice-lite", attr->a_att_field) == 0)
+    }
+    else if (keywordcmp("rtcp", field) == 0)
+    {
+        if (value != NULL) idx->rtcp = value;
+    }
+    else if (keywordcmp("crypto", field) == 0)
+    {
+        if (value != NULL && stream->proto == SalProtoRtpSavp) sdp_parse_crypto(idx, value);
+    }
+    else if (keywordcmp("candidate", field) == 0)
+    {
+        if (value != NULL && idx->nb_ice_candidates < SAL_MEDIA_DESCRIPTION_MAX_ICE_CANDIDATES)
         {
-            desc->ice_lite = TRUE;
+            SalIceCandidate *candidate = &stream->ice_candidates[idx->nb_ice_candidates];
+            int             nb         = sscanf(value, "%31s %u UDP %u %63s %d typ %5s raddr %63s rport %d",
+                                                candidate->foundation, &candidate->componentID, &candidate->priority, candidate->addr, &candidate->port,
+                                                candidate->type, candidate->raddr, &candidate->rport);
+            if ((nb == 6) || (nb == 8)) idx->nb_ice_candidates++;
+            else memset(candidate, 0, sizeof(*candidate));
         }
     }
+    else if (keywordcmp("remote-candidates", field) == 0)
+    {
+        if (value != NULL) sdp_parse_remote_candidates(stream, value);
+    }
+    else if (keywordcmp("ice-ufrag", field) == 0)
+    {
+        if (value != NULL) strncpy(stream->ice_ufrag, value, sizeof(stream->ice_ufrag));
+    }
+    else if (keywordcmp("ice-pwd", field) == 0)
+    {
+        if (value != NULL) strncpy(stream->ice_pwd, value, sizeof(stream->ice_pwd));
+    }
+    else if (keywordcmp("ice-mismatch", field) == 0)
+    {
+        stream->ice_mismatch = TRUE;
+    }
+}
 
-    desc->n_active_streams = 0;
+/* resolve the payload list and the RTCP address of a media section once all its lines are read */
+static void sdp_media_end(
+    SdpMediaIndex *idx)
+{
+    SalStreamDescription *stream = idx->stream;
+    char                 *formats = idx->formats;
+    char                 *number;
 
-    /* for each m= line */
-    for (i = 0; !sdp_message_endof_media(msg, i) && i < SAL_MEDIA_DESCRIPTION_MAX_STREAMS; i++)
+    if (stream == NULL)
+        return;
+    while ((number = sdp_next_token(&formats)) != NULL)
     {
-        SalStreamDescription *stream = &desc->streams[i];
-        nb_ice_candidates = 0;
-
-        memset(stream, 0, sizeof(*stream));
-        mtype             = sdp_message_m_media_get(msg, i);
-        proto             = sdp_message_m_proto_get(msg, i);
-        rtp_port          = sdp_message_m_port_get(msg, i);
-        stream->proto     = SalProtoUnknown;
-        if (proto)
+        int         ptn = atoi(number);
+        const char  *rtpmap = NULL, *fmtp = NULL;
+        PayloadType *pt  = payload_type_new();
+        payload_type_set_number(pt, ptn);
+        if (ptn >= 0 && ptn < SDP_MAX_INDEXED_PAYLOADS)
         {
-            if (strcasecmp(proto, "RTP/AVP") == 0)
-                stream->proto = SalProtoRtpAvp;
-            else if (strcasecmp(proto, "RTP/SAVP") == 0)
-            {
-                stream->proto = SalProtoRtpSavp;
-            }
+            rtpmap = idx->rtpmap[ptn];
+            fmtp   = idx->fmtp[ptn];
         }
-        rtp_addr = sdp_message_c_addr_get(msg, i, 0);
-        if (rtp_addr != NULL)
-            strncpy(stream->rtp_addr, rtp_addr, sizeof(stream->rtp_addr));
-        if (rtp_port)
-            stream->rtp_port = atoi(rtp_port);
-        if (stream->rtp_port > 0)
-            desc->n_active_streams++;
-
-        stream->ptime = _sdp_message_get_a_ptime(msg, i);
-        if (strcasecmp("audio", mtype) == 0)
+        if (payload_type_fill_from_rtpmap(pt, rtpmap) == 0)
         {
-            stream->type = SalAudio;
+            payload_type_set_send_fmtp(pt, fmtp);
+            stream->payloads = ms_list_append(stream->payloads, pt);
+            ms_message("Found payload %s/%i fmtp=%s", pt->mime_type, pt->clock_rate,
+                       pt->send_fmtp ? pt->send_fmtp : "");
         }
-        else if (strcasecmp("video", mtype) == 0)
+        else payload_type_destroy(pt);
+    }
+
+    stream->rtcp_port = stream->rtp_port + 1;
+    snprintf(stream->rtcp_addr, sizeof(stream->rtcp_addr), "%s", stream->rtp_addr);
+    if (idx->rtcp != NULL)
+    {
+        char tmp[256];
+        int  nb = sscanf(idx->rtcp, "%d IN IP4 %255s", &stream->rtcp_port, tmp);
+        if (nb == 1)
         {
-            stream->type = SalVideo;
+            /* SDP rtcp attribute only contains the port */
         }
-        else
+        else if (nb == 2)
         {
-            stream->type = SalOther;
-            strncpy(stream->typeother, mtype, sizeof(stream->typeother) - 1);
+            strncpy(stream->rtcp_addr, tmp, sizeof(stream->rtcp_addr));
         }
-        for (j = 0; (sbw = sdp_message_bandwidth_get(msg, i, j)) != NULL; ++j)
+        else
         {
-            if (strcasecmp(sbw->b_bwtype, "AS") == 0) stream->bandwidth = atoi(sbw->b_bandwidth);
+            ms_warning("sdp has a strange a= line (%s) nb=%i", idx->rtcp, nb);
         }
-        stream->dir = _sdp_message_get_mline_dir(msg, i);
-        /* for each payload type */
-        for (j = 0; ((number = sdp_message_m_payload_get(msg, i, j)) != NULL); j++)
+    }
+    if (stream->proto == SalProtoRtpSavp)
+        ms_message("Found: %d valid crypto lines", idx->nb_crypto);
+}
+
+/* check the "<port>[/<number of ports>]" field of a m= line */
+static bool_t sdp_is_port(
+    const char *port)
+{
+    char *end;
+    long value;
+
+    if (!isdigit((unsigned char)port[0]))
+        return FALSE;
+    value = strtol(port, &end, 10);
+    if (value > 65535)
+        return FALSE;
+    if (*end == '/')
+    {
+        port = end + 1;
+        if (!isdigit((unsigned char)port[0]))
+            return FALSE;
+        strtol(port, &end, 10);
+    }
+    return *end == '\0';
+}
+
+/* returns -1 if the m= line has no media, port or proto field */
+static int sdp_media_begin(
+    SdpMediaIndex *idx, SalStreamDescription *stream, char *value)
+{
+    const char *mtype, *port, *proto;
+
+    memset(idx, 0, sizeof(*idx));
+    memset(stream, 0, sizeof(*stream));
+
+    mtype         = sdp_next_token(&value);
+    port          = sdp_next_token(&value);
+    proto         = sdp_next_token(&value);
+    if (mtype == NULL || port == NULL || proto == NULL || !sdp_is_port(port))
+        return -1;
+    idx->stream   = stream;
+    idx->formats  = value;
+    stream->proto = SalProtoUnknown;
+    stream->dir   = SalStreamSendRecv;
+    if (strcasecmp(proto, "RTP/AVP") == 0)
+        stream->proto = SalProtoRtpAvp;
+    else if (strcasecmp(proto, "RTP/SAVP") == 0)
+        stream->proto = SalProtoRtpSavp;
+    stream->rtp_port = atoi(port);
+    if (strcasecmp("audio", mtype) == 0)
+    {
+        stream->type = SalAudio;
+    }
+    else if (strcasecmp("video", mtype) == 0)
+    {
+        stream->type = SalVideo;
+    }
+    else
+    {
+        stream->type = SalOther;
+        strncpy(stream->typeother, mtype, sizeof(stream->typeother) - 1);
+    }
+    return 0;
+}
+
+/* copy the address of a "c=<nettype> <addrtype> <addr>[/ttl[/n]]" line */
+static void sdp_parse_connection(
+    char *value, char *addr, size_t size)
+{
+    char *c_addr;
+
+    sdp_next_token(&value);
+    sdp_next_token(&value);
+    c_addr = sdp_next_token(&value);
+    if (c_addr == NULL)
+        return;
+    value = strchr(c_addr, '/');
+    if (value != NULL)
+        *value = '\0';
+    strncpy(addr, c_addr, size);
+}
+
+/* return the value of a "b=AS:<value>" line, or -1 */
+static int sdp_parse_as_bandwidth(
+    const char *value)
+{
+    if (strncasecmp(value, "AS:", 3) == 0)
+        return atoi(value + 3);
+    return -1;
+}
+
+/* Fills desc from the SDP text. Returns 0 on success, -1 if sdp does not look like an SDP body:
+   the o=, s= and t= lines are required, and every m= line needs valid media, port and proto fields. */
+int sdp_to_media_description(
+    const char *sdp, SalMediaDescription *desc)
+{
+    SdpMediaIndex idx;
+    char          *copy, *line, *next;
+    int           nb_streams = 0;
+    int           nb_attributes = 0;
+    bool_t        has_origin = FALSE;
+    bool_t        has_name   = FALSE;
+    bool_t        has_time   = FALSE;
+    bool_t        in_media   = FALSE;
+    bool_t        bad_media  = FALSE;
+
+    if (sdp == NULL)
+        return -1;
+    while (*sdp == '\r' || *sdp == '\n')
+        sdp++;
+    if (sdp[0] != 'v' || sdp[1] != '=')
+        return -1;
+
+    copy                   = ms_strdup(sdp);
+    memset(&idx, 0, sizeof(idx));
+    desc->n_active_streams = 0;
+
+    for (line = copy; line != NULL; line = next)
+    {
+        char   type;
+        char   *value;
+        size_t len;
+
+        next = strchr(line, '\n');
+        if (next != NULL)
+            *next++ = '\0';
+        len = strlen(line);
+        if (len > 0 && line[len - 1] == '\r')
+            line[--len] = '\0';
+        if (len < 2 || line[1] != '=')
+            continue;
+        type  = line[0];
+        value = line + 2;
+
+        if (type == 'm')
         {
-            const char  *rtpmap, *fmtp;
-            int         ptn = atoi(number);
-            PayloadType *pt = payload_type_new();
-            payload_type_set_number(pt, ptn);
-            /* get the rtpmap associated to this codec, if any */
-            rtpmap = sdp_message_a_attr_value_get_with_pt(msg, i, ptn, "rtpmap");
-            if (payload_type_fill_from_rtpmap(pt, rtpmap) == 0)
+            sdp_media_end(&idx);
+            in_media = TRUE;
+            if (nb_streams >= SAL_MEDIA_DESCRIPTION_MAX_STREAMS)
             {
-                /* get the fmtp, if any */
-                fmtp             = sdp_message_a_attr_value_get_with_pt(msg, i, ptn, "fmtp");
-                payload_type_set_send_fmtp(pt, fmtp);
-                stream->payloads = ms_list_append(stream->payloads, pt);
-                ms_message("Found payload %s/%i fmtp=%s", pt->mime_type, pt->clock_rate,
-                           pt->send_fmtp ? pt->send_fmtp : "");
+                /* ignore the remaining media sections */
+                idx.stream = NULL;
+                break;
+            }
+            if (sdp_media_begin(&idx, &desc->streams[nb_streams], value) != 0)
+            {
+                bad_media = TRUE;
+                break;
             }
+            if (desc->streams[nb_streams].rtp_port > 0)
+                desc->n_active_streams++;
+            nb_streams++;
+            continue;
         }
 
-        /* Get media specific RTCP attribute */
-        stream->rtcp_port = stream->rtp_port + 1;
-        snprintf(stream->rtcp_addr, sizeof(stream->rtcp_addr), "%s", stream->rtp_addr);
-        for (j = 0; ((attr = sdp_message_attribute_get(msg, i, j)) != NULL); j++)
+        if (!in_media)
         {
-            if ((keywordcmp("rtcp", attr->a_att_field) == 0) && (attr->a_att_value != NULL))
+            switch (type)
             {
-                char tmp[256];
-                int  nb = sscanf(attr->a_att_value, "%d IN IP4 %s", &stream->rtcp_port, tmp);
-                if (nb == 1)
+            case 'o':
+            {
+                const char *sess;
+                sdp_next_token(&value);
+                sess       = sdp_next_token(&value);
+                if (sess) desc->session_id = strtoul(sess, NULL, 10);
+                sess       = sdp_next_token(&value);
+                if (sess) desc->session_ver = strtoul(sess, NULL, 10);
+                has_origin = TRUE;
+                break;
+            }
+            case 's':
+                has_name = TRUE;
+                break;
+            case 't':
+                has_time = TRUE;
+                break;
+            case 'c':
+                sdp_parse_connection(value, desc->addr, sizeof(desc->addr));
+                break;
+            case 'b':
+            {
+                int bw = sdp_parse_as_bandwidth(value);
+                if (bw >= 0) desc->bandwidth = bw;
+                break;
+            }
+            case 'a':
+            {
+                /* Get ICE remote ufrag and remote pwd, and ice_lite flag */
+                char *field = value;
+                char *colon = strchr(value, ':');
+                if (nb_attributes++ >= SAL_MEDIA_DESCRIPTION_MAX_MESSAGE_ATTRIBUTES)
+                    break;
+                value = NULL;
+                if (colon != NULL)
                 {
-                    /* SDP rtcp attribute only contains the port */
+                    *colon = '\0';
+                    value  = colon + 1;
                 }
-                else if (nb == 2)
+                if ((keywordcmp("ice-ufrag", field) == 0) && (value != NULL))
                 {
-                    strncpy(stream->rtcp_addr, tmp, sizeof(stream->rtcp_addr));
+                    strncpy(desc->ice_ufrag, value, sizeof(desc->ice_ufrag));
                 }
-                else
+                else if ((keywordcmp("ice-pwd", field) == 0) && (value != NULL))
                 {
-                    ms_warning("sdp has a strange a= line (%s) nb=%i", attr->a_att_value, nb);
+                    strncpy(desc->ice_pwd, value, sizeof(desc->ice_pwd));
                 }
-            }
-        }
-
-        /* read crypto lines if any */
-        if (stream->proto == SalProtoRtpSavp)
-        {
-            int k, valid_count = 0;
-
-            memset(&stream->crypto, 0, sizeof(stream->crypto));
-            for (k = 0; valid_count < SAL_CRYPTO_ALGO_MAX && (attr = sdp_message_attribute_get(msg, i, k)) != NULL; k++)
-            {
-                char tmp[256], tmp2[256];
-                if (keywordcmp("crypto", attr->a_att_field) == 0 && attr->a_att_value != NULL)
+                else if (keywordcmp("ice-lite", field) == 0)
                 {
-                    int nb = sscanf(attr->a_att_value, "%d %255s inline:%255s",
-                                    &stream->crypto[valid_count].tag,
-                                    tmp,
-                                    tmp2);
-                    ms_message("Found valid crypto line (tag:%d algo:'%s' key:'%s'",
-                               stream->crypto[valid_count].tag,
-                               tmp,
-                               tmp2);
-                    if (nb == 3)
-                       {
-                        if (strcmp(tmp, "AES_CM_128_HMAC_SHA1_80") == 0)
-                            stream->crypto[valid_count].algo = AES_128_SHA1_80;
-                        else if (strcmp(tmp, "AES_CM_128_HMAC_SHA1_32") == 0)
-                            stream->crypto[valid_count].algo = AES_128_SHA1_32;
-                        else
-                        {
-                            ms_warning("Failed to parse crypto-algo: '%s'", tmp);
-                            stream->crypto[valid_count].algo = 0;
-                        }
-                        if (stream->crypto[valid_count].algo)
-                        {
-                            strncpy(stream->crypto[valid_count].master_key, tmp2, 41);
-                            stream->crypto[valid_count].master_key[40] = '\0';
-                            ms_message("Found valid crypto line (tag:%d algo:'%s' key:'%s'",
-                                       stream->crypto[valid_count].tag,
-                                       tmp,
-                                       stream->crypto[valid_count].master_key);
-                            valid_count++;
-                        }
-                       }
-                       else
-                       {
-                        ms_warning("sdp has a strange a= line (%s) nb=%i", attr->a_att_value, nb);
-                    }
+                    desc->ice_lite = TRUE;
                 }
+                break;
             }
-            ms_message("Found: %d valid crypto lines", valid_count);
+            default:
+                break;
+            }
+            continue;
         }
 
-        /* Get ICE candidate attributes if any */
-        for (j = 0; (attr = sdp_message_attribute_get(msg, i, j)) != NULL; j++)
+        switch (type)
         {
-            if ((keywordcmp("candidate", attr->a_att_field) == 0) && (attr->a_att_value != NULL))
-            {
-                SalIceCandidate *candidate = &stream->ice_candidates[nb_ice_candidates];
-                int             nb         = sscanf(attr->a_att_value, "%s %u UDP %u %s %d typ %s raddr %s rport %d",
-                                                    candidate->foundation, &candidate->componentID, &candidate->priority, candidate->addr, &candidate->port,
-                                                    candidate->type, candidate->raddr, &candidate->rport);
-                if ((nb == 6) || (nb == 8)) nb_ice_candidates++;
-                else memset(candidate, 0, sizeof(*candidate));
-            }
-            else if ((keywordcmp("remote-candidates", attr->a_att_field) == 0) && (attr->a_att_value != NULL))
-            {
-                SalIceRemoteCandidate candidate;
-                unsigned int          componentID;
-                int                   offset;
-                char                  *ptr = attr->a_att_value;
-                while (3 == sscanf(ptr, "%u %s %u%n", &componentID, candidate.addr, &candidate.port, &offset))
-                {
-                    if ((componentID > 0) && (componentID <= SAL_MEDIA_DESCRIPTION_MAX_ICE_REMOTE_CANDIDATES))
-                    {
-                        SalIceRemoteCandidate *remote_candidate = &stream->ice_remote_candidates[componentID - 1];
-                        strncpy(remote_candidate->addr, candidate.addr, sizeof(remote_candidate->addr));
-                        remote_candidate->port = candidate.port;
-                    }
-                    ptr += offset;
-                    if (ptr[offset] == ' ') ptr += 1;
-                }
-            }
-            else if ((keywordcmp("ice-ufrag", attr->a_att_field) == 0) && (attr->a_att_value != NULL))
+        case 'c':
+            if (!idx.has_c)
             {
-                strncpy(stream->ice_ufrag, attr->a_att_value, sizeof(stream->ice_ufrag));
+                sdp_parse_connection(value, idx.stream->rtp_addr, sizeof(idx.stream->rtp_addr));
+                idx.has_c = TRUE;
             }
-            else if ((keywordcmp("ice-pwd", attr->a_att_field) == 0) && (attr->a_att_value != NULL))
-            {
-                strncpy(stream->ice_pwd, attr->a_att_value, sizeof(stream->ice_pwd));
-            }
-            else if (keywordcmp("ice-mismatch", attr->a_att_field) == 0)
+            break;
+        case 'b':
+        {
+            int bw = sdp_parse_as_bandwidth(value);
+            if (bw >= 0) idx.stream->bandwidth = bw;
+            break;
+        }
+        case 'a':
+        {
+            char *colon = strchr(value, ':');
+            if (colon != NULL)
             {
-                stream->ice_mismatch = TRUE;
+                *colon = '\0';
+                sdp_parse_media_attribute(&idx, value, colon + 1);
             }
+            else sdp_parse_media_attribute(&idx, value, NULL);
+            break;
+        }
+        default:
+            break;
         }
     }
-    desc->n_total_streams = i;
+    sdp_media_end(&idx);
+    ms_free(copy);
+
+    desc->n_total_streams = nb_streams;
+    if (!has_origin)
+    {
+        ms_warning("sdp has no o= line, ignored.");
+        return -1;
+    }
+    if (!has_name || !has_time)
+    {
+        ms_warning("sdp has no s= or t= line, ignored.");
+        return -1;
+    }
+    if (bad_media)
+    {
+        ms_warning("sdp has a bad m= line, ignored.");
+        return -1;
+    }
     return 0;
-}
\ No newline at end of file
+}
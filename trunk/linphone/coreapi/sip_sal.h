@@ -204,6 +204,8 @@ void sal_media_description_ref(SalMediaDescription *md);
 void sal_media_description_unref(SalMediaDescription *md);
 bool_t sal_media_description_empty(const SalMediaDescription *md);
 int sal_media_description_equals(const SalMediaDescription *md1, const SalMediaDescription *md2);
+/*hash of the whole description, equal fingerprints mean the offer/answer result is the same*/
+uint64_t sal_media_description_fingerprint(const SalMediaDescription *md);
 bool_t sal_media_description_has_dir(const SalMediaDescription *md, SalStreamDir dir);
 SalStreamDescription *sal_media_description_find_stream(SalMediaDescription *md,
                                                         SalMediaProto proto, SalStreamType type);
@@ -366,6 +368,8 @@ void sal_verify_server_certificates(Sal *ctx, bool_t verify);
 void sal_verify_server_cn(Sal *ctx, bool_t verify);
 
 int sal_iterate(Sal *sal);
+/*waits at most timeout_ms (-1 for ever) for a SIP event to process with sal_iterate(), returns 1 if one arrived*/
+int sal_wait_for_event(Sal *sal, int timeout_ms);
 MSList *sal_get_pending_auths(Sal *sal);
 
 /*create an operation */
@@ -346,12 +346,16 @@ typedef struct osip_transaction osip_transaction_t;
 
 /**
  * Structure for transaction handling
+ * NOTE: transactionff is an osip_mpsc_fifo_t, and no longer an
+ * osip_fifo_t. This breaks the API and the ABI of earlier versions
+ * (libtool version 7:0:0). Use osip_transaction_add_event() to give
+ * an event to a transaction.
  * @struct osip_transaction
  */
 struct osip_transaction {
     void              *your_instance; /**< User Defined Pointer. */
     int               transactionid;  /**< Internal Transaction Identifier. */
-    osip_fifo_t       *transactionff; /**< events must be added in this fifo */
+    osip_mpsc_fifo_t  *transactionff; /**< events must be added in this fifo */
 
     osip_via_t        *topvia;        /**< CALL-LEG definition (Top Via) */
     osip_from_t       *from;          /**< CALL-LEG definition (From)    */
@@ -115,6 +115,72 @@ void *osip_fifo_get(osip_fifo_t *ff);
  */
 void *osip_fifo_tryget(osip_fifo_t *ff);
 
+#ifndef DOXYGEN
+
+typedef struct osip_mpsc_node osip_mpsc_node_t;
+
+struct osip_mpsc_node {
+    osip_mpsc_node_t *volatile next;
+    void                       *element;
+};
+
+#endif
+
+/**
+ * Structure for referencing a lock-free fifo.
+ * @var osip_mpsc_fifo_t
+ */
+typedef struct osip_mpsc_fifo osip_mpsc_fifo_t;
+
+/**
+ * Structure for referencing a lock-free fifo.
+ * Any number of threads may add elements concurrently, but only one
+ * thread at a time may get them (multiple producers, single consumer).
+ * Adding an element is a single atomic exchange: there is no mutex
+ * and no semaphore, and the fifo has no maximum size.
+ * @struct osip_mpsc_fifo
+ */
+struct osip_mpsc_fifo {
+    osip_mpsc_node_t *volatile head;  /**@internal last added node (producers) */
+    osip_mpsc_node_t           *tail; /**@internal dummy node before the next element (consumer) */
+#ifdef OSIP_MT
+    struct osip_mutex          *qislocked; /**@internal only without atomic operations */
+#endif
+};
+
+/**
+ * Initialise a osip_mpsc_fifo_t element.
+ * NOTE: as for osip_fifo_init(), this element MUST be previously
+ * allocated with osip_malloc(): it is released by osip_mpsc_fifo_free().
+ * @param ff The element to initialise.
+ */
+int osip_mpsc_fifo_init(osip_mpsc_fifo_t *ff);
+/**
+ * Free a lock-free fifo element.
+ * The elements still in the fifo are not released.
+ * @param ff The element to work on.
+ */
+void osip_mpsc_fifo_free(osip_mpsc_fifo_t *ff);
+/**
+ * Add an element in a lock-free fifo. (any thread)
+ * @param ff The element to work on.
+ * @param element The pointer on the element to add.
+ */
+int osip_mpsc_fifo_add(osip_mpsc_fifo_t *ff, void *element);
+/**
+ * Try to get an element from a lock-free fifo, but do not block if
+ * there is no element. (consumer thread only)
+ * @param ff The element to work on.
+ */
+void *osip_mpsc_fifo_tryget(osip_mpsc_fifo_t *ff);
+/**
+ * Check if a lock-free fifo is empty without locking it. (consumer
+ * thread only: the node it reads is freed by osip_mpsc_fifo_tryget())
+ * An element being added by another thread may not be visible yet.
+ * @param ff The element to work on.
+ */
+int osip_mpsc_fifo_is_empty(osip_mpsc_fifo_t *ff);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -166,6 +166,19 @@ int osip_message_to_str(osip_message_t *sip, char **dest,
  */
 int osip_message_to_str_sipfrag(osip_message_t *sip, char **dest,
                                 size_t *message_length);
+/**
+ * Get the string representation of a osip_message_t element without
+ * copying it. The message is only rebuilt when it has been modified
+ * since the last call (see osip_message_force_update()), so this is
+ * the cheapest way to send retransmissions.
+ * The returned buffer belongs to the element: it remains valid until the
+ * element is rebuilt or released and MUST NOT be freed by the caller.
+ * @param sip The element to work on.
+ * @param dest pointer on the internal buffer returned.
+ * @param message_length The length of the returned buffer.
+ */
+int osip_message_to_str_cached(osip_message_t *sip, const char **dest,
+                               size_t *message_length);
 /**
  * Clone a osip_message_t element.
  * @param sip The element to clone.
@@ -1454,7 +1454,7 @@ osip_ict_execute(
         more_event  = 1;
         do
         {
-            se = (osip_event_t *) osip_fifo_tryget(transaction->transactionff);
+            se = (osip_event_t *) osip_mpsc_fifo_tryget(transaction->transactionff);
             if (se == NULL)     /* no more event for this transaction */
                 more_event = 0;
             else
@@ -1518,7 +1518,7 @@ osip_ist_execute(
         more_event  = 1;
         do
         {
-            se = (osip_event_t *) osip_fifo_tryget(transaction->transactionff);
+            se = (osip_event_t *) osip_mpsc_fifo_tryget(transaction->transactionff);
             if (se == NULL)     /* no more event for this transaction */
                 more_event = 0;
             else
@@ -1582,7 +1582,7 @@ osip_nict_execute(
         more_event  = 1;
         do
         {
-            se = (osip_event_t *) osip_fifo_tryget(transaction->transactionff);
+            se = (osip_event_t *) osip_mpsc_fifo_tryget(transaction->transactionff);
             if (se == NULL)     /* no more event for this transaction */
                 more_event = 0;
             else
@@ -1646,7 +1646,7 @@ osip_nist_execute(
         more_event  = 1;
         do
         {
-            se = (osip_event_t *) osip_fifo_tryget(transaction->transactionff);
+            se = (osip_event_t *) osip_mpsc_fifo_tryget(transaction->transactionff);
             if (se == NULL)     /* no more event for this transaction */
                 more_event = 0;
             else
@@ -1681,7 +1681,7 @@ osip_timers_gettimeout(
                                                    &iterator);
     while (osip_list_iterator_has_elem(iterator))
     {
-        if (1 <= osip_fifo_size(tr->transactionff))
+        if (!osip_mpsc_fifo_is_empty(tr->transactionff))
         {
             OSIP_TRACE(osip_trace
                            (__FILE__, __LINE__, OSIP_INFO4, NULL,
@@ -1866,7 +1866,7 @@ osip_timers_ict_execute(
     {
         osip_event_t *evt;
 
-        if (1 <= osip_fifo_size(tr->transactionff))
+        if (!osip_mpsc_fifo_is_empty(tr->transactionff))
         {
             OSIP_TRACE(osip_trace
                            (__FILE__, __LINE__, OSIP_INFO4, NULL,
@@ -1877,20 +1877,20 @@ osip_timers_ict_execute(
             evt = __osip_ict_need_timer_b_event(tr->ict_context, tr->state,
                                                 tr->transactionid);
             if (evt != NULL)
-                osip_fifo_add(tr->transactionff, evt);
+                osip_mpsc_fifo_add(tr->transactionff, evt);
             else
             {
                 evt = __osip_ict_need_timer_a_event(tr->ict_context, tr->state,
                                                     tr->transactionid);
                 if (evt != NULL)
-                    osip_fifo_add(tr->transactionff, evt);
+                    osip_mpsc_fifo_add(tr->transactionff, evt);
                 else
                 {
                     evt =
                         __osip_ict_need_timer_d_event(tr->ict_context, tr->state,
                                                       tr->transactionid);
                     if (evt != NULL)
-                        osip_fifo_add(tr->transactionff, evt);
+                        osip_mpsc_fifo_add(tr->transactionff, evt);
                 }
             }
         }
@@ -1921,19 +1921,19 @@ osip_timers_ist_execute(
         evt = __osip_ist_need_timer_i_event(tr->ist_context, tr->state,
                                             tr->transactionid);
         if (evt != NULL)
-            osip_fifo_add(tr->transactionff, evt);
+            osip_mpsc_fifo_add(tr->transactionff, evt);
         else
         {
             evt = __osip_ist_need_timer_h_event(tr->ist_context, tr->state,
                                                 tr->transactionid);
             if (evt != NULL)
-                osip_fifo_add(tr->transactionff, evt);
+                osip_mpsc_fifo_add(tr->transactionff, evt);
             else
             {
                 evt = __osip_ist_need_timer_g_event(tr->ist_context, tr->state,
                                                     tr->transactionid);
                 if (evt != NULL)
-                    osip_fifo_add(tr->transactionff, evt);
+                    osip_mpsc_fifo_add(tr->transactionff, evt);
             }
         }
         tr = (osip_transaction_t *) osip_list_get_next(&iterator);
@@ -1963,20 +1963,20 @@ osip_timers_nict_execute(
         evt = __osip_nict_need_timer_k_event(tr->nict_context, tr->state,
                                              tr->transactionid);
         if (evt != NULL)
-            osip_fifo_add(tr->transactionff, evt);
+            osip_mpsc_fifo_add(tr->transactionff, evt);
         else
         {
             evt = __osip_nict_need_timer_f_event(tr->nict_context, tr->state,
                                                  tr->transactionid);
             if (evt != NULL)
-                osip_fifo_add(tr->transactionff, evt);
+                osip_mpsc_fifo_add(tr->transactionff, evt);
             else
             {
                 evt =
                     __osip_nict_need_timer_e_event(tr->nict_context, tr->state,
                                                    tr->transactionid);
                 if (evt != NULL)
-                    osip_fifo_add(tr->transactionff, evt);
+                    osip_mpsc_fifo_add(tr->transactionff, evt);
             }
         }
         tr = (osip_transaction_t *) osip_list_get_next(&iterator);
@@ -2006,7 +2006,7 @@ osip_timers_nist_execute(
         evt = __osip_nist_need_timer_j_event(tr->nist_context, tr->state,
                                              tr->transactionid);
         if (evt != NULL)
-            osip_fifo_add(tr->transactionff, evt);
+            osip_mpsc_fifo_add(tr->transactionff, evt);
         tr = (osip_transaction_t *) osip_list_get_next(&iterator);
     }
 #ifdef OSIP_MT
@@ -218,14 +218,22 @@ osip_transaction_init(
     (*transaction)->config        = osip;
 
     (*transaction)->transactionff =
-        (osip_fifo_t *) osip_malloc(sizeof(osip_fifo_t));
+        (osip_mpsc_fifo_t *) osip_malloc(sizeof(osip_mpsc_fifo_t));
     if ((*transaction)->transactionff == NULL)
     {
         osip_transaction_free(*transaction);
         *transaction = NULL;
         return OSIP_NOMEM;
     }
-    osip_fifo_init((*transaction)->transactionff);
+    i = osip_mpsc_fifo_init((*transaction)->transactionff);
+    if (i != 0)
+    {
+        osip_free((*transaction)->transactionff);
+        (*transaction)->transactionff = NULL;
+        osip_transaction_free(*transaction);
+        *transaction = NULL;
+        return i;
+    }
 
     (*transaction)->ctx_type     = ctx_type;
     (*transaction)->ict_context  = NULL;
@@ -357,14 +365,14 @@ osip_transaction_free2(
     /* empty the fifo */
     if (transaction->transactionff != NULL)
     {
-    evt = osip_fifo_tryget(transaction->transactionff);
+    evt = osip_mpsc_fifo_tryget(transaction->transactionff);
     while (evt != NULL)
     {
         osip_message_free(evt->sip);
         osip_free(evt);
-        evt = osip_fifo_tryget(transaction->transactionff);
+        evt = osip_mpsc_fifo_tryget(transaction->transactionff);
     }
-    osip_fifo_free(transaction->transactionff);
+    osip_mpsc_fifo_free(transaction->transactionff);
     }
 
     osip_message_free(transaction->orig_request);
@@ -391,8 +399,7 @@ osip_transaction_add_event(
     if (transaction == NULL)
         return OSIP_BADPARAMETER;
     evt->transactionid = transaction->transactionid;
-    osip_fifo_add(transaction->transactionff, evt);
-    return OSIP_SUCCESS;
+    return osip_mpsc_fifo_add(transaction->transactionff, evt);
 }
 
 int
@@ -230,4 +230,148 @@ osip_fifo_free(
     osip_sem_destroy(ff->qisempty);
 #endif
     osip_free(ff);
+}
+
+/*
+   Lock-free fifo: D. Vyukov's non intrusive MPSC queue.
+   "head" is the last node added, "tail" is a dummy node whose
+   successor holds the next element to get. A producer publishes its
+   node with one atomic exchange on "head" followed by a store on the
+   "next" field of the previous node; the consumer only reads "next".
+   Between those two steps, the new element is not visible yet.
+ */
+#ifdef OSIP_MT
+    #if defined(WIN32) || defined(_WIN32_WCE)
+        #define osip_mpsc_xchg(ptr, val)   InterlockedExchangePointer((PVOID volatile *) (ptr), (val))
+        #define osip_mpsc_load(ptr)        (*(ptr))
+        #define osip_mpsc_store(ptr, val)  (*(ptr) = (val))
+    #elif defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+        #define osip_mpsc_xchg(ptr, val)   __atomic_exchange_n((ptr), (val), __ATOMIC_ACQ_REL)
+        #define osip_mpsc_load(ptr)        __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+        #define osip_mpsc_store(ptr, val)  __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+    #else
+        #define OSIP_MPSC_USE_MUTEX
+    #endif
+#endif
+
+#if !defined(OSIP_MT) || defined(OSIP_MPSC_USE_MUTEX)
+    #define osip_mpsc_load(ptr)        (*(ptr))
+    #define osip_mpsc_store(ptr, val)  (*(ptr) = (val))
+#endif
+
+int
+osip_mpsc_fifo_init(
+    osip_mpsc_fifo_t *ff)
+{
+    osip_mpsc_node_t *stub;
+
+    if (ff == NULL)
+        return OSIP_BADPARAMETER;
+    stub          = (osip_mpsc_node_t *) osip_malloc(sizeof(osip_mpsc_node_t));
+    if (stub == NULL)
+        return OSIP_NOMEM;
+    stub->next    = NULL;
+    stub->element = NULL;
+    ff->head      = stub;
+    ff->tail      = stub;
+#ifdef OSIP_MT
+    ff->qislocked = NULL;
+#ifdef OSIP_MPSC_USE_MUTEX
+    ff->qislocked = osip_mutex_init();
+    if (ff->qislocked == NULL)
+    {
+        osip_free(stub);
+        return OSIP_NOMEM;
+    }
+#endif
+#endif
+    return OSIP_SUCCESS;
+}
+
+int
+osip_mpsc_fifo_add(
+    osip_mpsc_fifo_t *ff,
+    void             *el)
+{
+    osip_mpsc_node_t *node;
+    osip_mpsc_node_t *prev;
+
+    node          = (osip_mpsc_node_t *) osip_malloc(sizeof(osip_mpsc_node_t));
+    if (node == NULL)
+        return OSIP_NOMEM;
+    node->next    = NULL;
+    node->element = el;
+
+#if defined(OSIP_MT) && !defined(OSIP_MPSC_USE_MUTEX)
+    prev          = (osip_mpsc_node_t *) osip_mpsc_xchg(&ff->head, node);
+    osip_mpsc_store(&prev->next, node);
+#else
+#ifdef OSIP_MT
+    osip_mutex_lock(ff->qislocked);
+#endif
+    prev          = ff->head;
+    ff->head      = node;
+    prev->next    = node;
+#ifdef OSIP_MT
+    osip_mutex_unlock(ff->qislocked);
+#endif
+#endif
+    return OSIP_SUCCESS;
+}
+
+void *
+osip_mpsc_fifo_tryget(
+    osip_mpsc_fifo_t *ff)
+{
+    osip_mpsc_node_t *tail = ff->tail;
+    osip_mpsc_node_t *next;
+    void             *el;
+
+#ifdef OSIP_MPSC_USE_MUTEX
+    osip_mutex_lock(ff->qislocked);
+#endif
+    next = osip_mpsc_load(&tail->next);
+#ifdef OSIP_MPSC_USE_MUTEX
+    osip_mutex_unlock(ff->qislocked);
+#endif
+    if (next == NULL)
+        return NULL;
+
+    /* "next" becomes the new dummy node */
+    el            = next->element;
+    next->element = NULL;
+    ff->tail      = next;
+    osip_free(tail);
+    return el;
+}
+
+int
+osip_mpsc_fifo_is_empty(
+    osip_mpsc_fifo_t *ff)
+{
+    if (ff == NULL)
+        return 1;
+    return osip_mpsc_load(&ff->tail->next) == NULL;
+}
+
+void
+osip_mpsc_fifo_free(
+    osip_mpsc_fifo_t *ff)
+{
+    osip_mpsc_node_t *node;
+
+    if (ff == NULL)
+        return;
+    node = ff->tail;
+    while (node != NULL)
+    {
+        osip_mpsc_node_t *next = node->next;
+
+        osip_free(node);
+        node = next;
+    }
+#ifdef OSIP_MPSC_USE_MUTEX
+    osip_mutex_destroy(ff->qislocked);
+#endif
+    osip_free(ff);
 }
\ No newline at end of file
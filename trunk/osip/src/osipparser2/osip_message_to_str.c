@@ -27,28 +27,6 @@
 
 extern const char *osip_protocol_version;
 
-static int strcat_simple_header(char **_string, size_t *malloc_size,
-                                char **_message, void *ptr_header,
-                                char *header_name, size_t size_of_header,
-                                int (*xxx_to_str)(void *, char **), char **next);
-static int strcat_headers_one_per_line(char **_string, size_t *malloc_size,
-                                       char **_message,
-                                       osip_list_t *headers, char *header,
-                                       size_t size_of_header,
-                                       int (*xxx_to_str)(void *, char **),
-                                       char **next);
-#if 0
-static int strcat_headers_all_on_one_line(char        **_string,
-                                          size_t      *malloc_size,
-                                          char        **_message,
-                                          osip_list_t *headers,
-                                          char        *header,
-                                          size_t      size_of_header,
-                                          int (       *xxx_to_str)(void *,
-                                                                   char **),
-                                          char        **next);
-#endif
-
 static int
 __osip_message_startline_to_strreq(
     osip_message_t *sip,
@@ -183,243 +161,6 @@ osip_message_get_uri(
     return sip->req_uri;
 }
 
-static int
-strcat_simple_header(
-    char   **_string,
-    size_t *malloc_size,
-    char   **_message,
-    void   *ptr_header,
-    char   *header_name,
-    size_t size_of_header,
-    int (  *xxx_to_str)(void *,
-                        char **),
-    char   **next)
-{
-    char *string;
-    char *message;
-    char *tmp;
-    int  i;
-
-    string  = *_string;
-    message = *_message;
-
-    if (ptr_header != NULL)
-    {
-        if (*malloc_size < message - string + 100 + size_of_header)
-        /* take some memory avoid to osip_realloc too much often */
-        {                       /* should not happen often */
-            size_t size = message - string;
-
-            *malloc_size = message - string + size_of_header + 100;
-            string       = osip_realloc(string, *malloc_size);
-            if (string == NULL)
-            {
-                *_string  = NULL;
-                *_message = NULL;
-                return OSIP_NOMEM;
-            }
-            message = string + size;
-        }
-        message = osip_strn_append(message, header_name, size_of_header);
-
-        i       = xxx_to_str(ptr_header, &tmp);
-        if (i != 0)
-        {
-            *_string  = string;
-            *_message = message;
-            *next     = NULL;
-            return i;
-        }
-        if (*malloc_size < message - string + strlen(tmp) + 100)
-        {
-            size_t size = message - string;
-
-            *malloc_size = message - string + strlen(tmp) + 100;
-            string       = osip_realloc(string, *malloc_size);
-            if (string == NULL)
-            {
-                *_string  = NULL;
-                *_message = NULL;
-                return OSIP_NOMEM;
-            }
-            message = string + size;
-        }
-
-        message = osip_str_append(message, tmp);
-        osip_free(tmp);
-        message = osip_strn_append(message, CRLF, 2);
-    }
-    *_string  = string;
-    *_message = message;
-    *next     = message;
-    return OSIP_SUCCESS;
-}
-
-static int
-strcat_headers_one_per_line(
-    char **_string,
-    size_t *malloc_size,
-    char **_message,
-    osip_list_t *headers,
-    char *header,
-    size_t size_of_header,
-    int (*xxx_to_str)(void *, char **),
-    char **next)
-{
-    char *string;
-    char *message;
-    char *tmp;
-    int  pos = 0;
-    int  i;
-
-    string  = *_string;
-    message = *_message;
-
-    while (!osip_list_eol(headers, pos))
-    {
-        void *elt;
-
-        elt = (void *) osip_list_get(headers, pos);
-
-        if (*malloc_size < message - string + 100 + size_of_header)
-        /* take some memory avoid to osip_realloc too much often */
-        {                       /* should not happen often */
-            size_t size = message - string;
-
-            *malloc_size = message - string + size_of_header + 100;
-            string       = osip_realloc(string, *malloc_size);
-            if (string == NULL)
-            {
-                *_string  = NULL;
-                *_message = NULL;
-                return OSIP_NOMEM;
-            }
-            message = string + size;
-        }
-        osip_strncpy(message, header, size_of_header);
-        i = xxx_to_str(elt, &tmp);
-        if (i != 0)
-        {
-            *_string  = string;
-            *_message = message;
-            *next     = NULL;
-            return i;
-        }
-        message = message + strlen(message);
-
-        if (*malloc_size < message - string + strlen(tmp) + 100)
-        {
-            size_t size = message - string;
-
-            *malloc_size = message - string + strlen(tmp) + 100;
-            string       = osip_realloc(string, *malloc_size);
-            if (string == NULL)
-            {
-                *_string  = NULL;
-                *_message = NULL;
-                return OSIP_NOMEM;
-            }
-            message = string + size;
-        }
-        message = osip_str_append(message, tmp);
-        osip_free(tmp);
-        message = osip_strn_append(message, CRLF, 2);
-        pos++;
-    }
-    *_string  = string;
-    *_message = message;
-    *next     = message;
-    return OSIP_SUCCESS;
-}
-
-#if 0
-static int
-strcat_headers_all_on_one_line(
-    char **_string,
-    size_t *malloc_size,
-    char **_message,
-    osip_list_t *headers,
-    char *header,
-    size_t size_of_header,
-    int (*xxx_to_str)(void *, char **),
-    char **next)
-{
-    char *string;
-    char *message;
-    char *tmp;
-    int  pos = 0;
-    int  i;
-
-    string  = *_string;
-    message = *_message;
-
-    pos     = 0;
-    while (!osip_list_eol(headers, pos))
-    {
-        if (*malloc_size < message - string + 100 + size_of_header)
-        /* take some memory avoid to osip_realloc too much often */
-        {                       /* should not happen often */
-            size_t size = message - string;
-
-            *malloc_size = message - string + size_of_header + 100;
-            string       = osip_realloc(string, *malloc_size);
-            if (string == NULL)
-            {
-                *_string  = NULL;
-                *_message = NULL;
-                return OSIP_NOMEM;
-            }
-            message = string + size;
-        }
-        message = osip_strn_append(message, header, size_of_header);
-
-        while (!osip_list_eol(headers, pos))
-        {
-            void *elt;
-
-            elt = (void *) osip_list_get(headers, pos);
-            i   = xxx_to_str(elt, &tmp);
-            if (i != 0)
-            {
-                *_string  = string;
-                *_message = message;
-                *next     = NULL;
-                return i;
-            }
-            if (*malloc_size < message - string + strlen(tmp) + 100)
-            {
-                size_t size = message - string;
-
-                *malloc_size = message - string + (int) strlen(tmp) + 100;
-                string       = osip_realloc(string, *malloc_size);
-                if (string == NULL)
-                {
-                    *_string  = NULL;
-                    *_message = NULL;
-                    return OSIP_NOMEM;
-                }
-                message = string + size;
-            }
-
-            message = osip_str_append(message, tmp);
-            osip_free(tmp);
-
-            pos++;
-            if (!osip_list_eol(headers, pos))
-            {
-                message = osip_strn_append(message, ", ", 2);
-            }
-        }
-        message = osip_strn_append(message, CRLF, 2);
-    }
-    *_string  = string;
-    *_message = message;
-    *next     = message;
-    return OSIP_SUCCESS;
-}
-
-#endif
-
 /* return values:
    1: structure and buffer "message" are identical.
    2: buffer "message" is not up to date with the structure info (call osip_message_to_str to update it).
@@ -444,378 +185,418 @@ osip_message_force_update(
     return OSIP_SUCCESS;
 }
 
+
+/*
+   The message is built in two passes: every part of it (start line,
+   header names and values, bodies) is first collected as a list of
+   (pointer, length) pieces, which gives the exact size of the result.
+   Then the pieces are copied into a single buffer allocated once.
+   Values already available as plain strings in the structure (generic
+   headers, single part bodies) are referenced instead of being copied.
+ */
+#define OSIP_MESSAGE_LOCAL_PIECES 96
+
+typedef struct __osip_message_piece __osip_message_piece_t;
+
+struct __osip_message_piece {
+    const char *str;
+    size_t     len;
+    char       *to_free;        /* non NULL when str must be released */
+};
+
+typedef struct __osip_message_writer __osip_message_writer_t;
+
+struct __osip_message_writer {
+    __osip_message_piece_t *pieces;
+    int                    nb_pieces;
+    int                    max_pieces;
+    size_t                 length;
+    __osip_message_piece_t local_pieces[OSIP_MESSAGE_LOCAL_PIECES];
+
+    /* storage for the generated values referenced by pieces */
+    char                   content_length[16];
+    char                   boundary[MIME_MAX_BOUNDARY_LEN + 5];
+};
+
+static const char *__osip_message_uppercase = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+static void
+__osip_message_writer_init(
+    __osip_message_writer_t *writer)
+{
+    writer->pieces     = writer->local_pieces;
+    writer->nb_pieces  = 0;
+    writer->max_pieces = OSIP_MESSAGE_LOCAL_PIECES;
+    writer->length     = 0;
+}
+
+static void
+__osip_message_writer_release(
+    __osip_message_writer_t *writer)
+{
+    int pos;
+
+    for (pos = 0; pos < writer->nb_pieces; pos++)
+    {
+        osip_free(writer->pieces[pos].to_free);
+    }
+    if (writer->pieces != writer->local_pieces)
+    {
+        osip_free(writer->pieces);
+    }
+    __osip_message_writer_init(writer);
+}
+
+/* "to_free" is always taken in charge by the writer, even on error. */
 static int
-_osip_message_realloc(
-    char   **message,
-    char   **dest,
-    size_t needed,
-    size_t *malloc_size)
+__osip_message_writer_add(
+    __osip_message_writer_t *writer,
+    const char              *str,
+    size_t                  len,
+    char                    *to_free)
 {
-    size_t size = *message - *dest;
+    __osip_message_piece_t *piece;
 
-    if (*malloc_size < (size_t) (size + needed + 100))
+    if (writer->nb_pieces == writer->max_pieces)
     {
-        *malloc_size = size + needed + 100;
-        *dest        = osip_realloc(*dest, *malloc_size);
-        if (*dest == NULL)
+        __osip_message_piece_t *pieces;
+
+        pieces = (__osip_message_piece_t *)
+                 osip_malloc(2 * writer->max_pieces * sizeof(__osip_message_piece_t));
+        if (pieces == NULL)
+        {
+            osip_free(to_free);
             return OSIP_NOMEM;
-        *message     = *dest + size;
+        }
+        memcpy(pieces, writer->pieces,
+               writer->nb_pieces * sizeof(__osip_message_piece_t));
+        if (writer->pieces != writer->local_pieces)
+        {
+            osip_free(writer->pieces);
+        }
+        writer->pieces      = pieces;
+        writer->max_pieces *= 2;
     }
 
+    piece           = &writer->pieces[writer->nb_pieces];
+    piece->str      = str;
+    piece->len      = len;
+    piece->to_free  = to_free;
+    writer->nb_pieces++;
+    writer->length += len;
     return OSIP_SUCCESS;
 }
 
 static int
-_osip_message_to_str(
-    osip_message_t *sip,
-    char           **dest,
-    size_t         *message_length,
-    int            sipfrag)
+__osip_message_writer_add_header(
+    __osip_message_writer_t *writer,
+    const char              *header_name,
+    size_t                  header_length,
+    void                    *header,
+    int (                   *xxx_to_str)(void *, char **))
 {
-    size_t malloc_size;
-    size_t total_length = 0;
-
-    /* Added at SIPit day1 */
-    char   *start_of_bodies;
-    char   *content_length_to_modify = NULL;
+    char *tmp;
+    int  i;
 
-    char   *message;
-    char   *next;
-    char   *tmp;
-    int    pos;
-    int    i;
-    char   *boundary = NULL;
+    i = xxx_to_str(header, &tmp);
+    if (i != 0)
+        return i;
+    i = __osip_message_writer_add(writer, header_name, header_length, NULL);
+    if (i != 0)
+    {
+        osip_free(tmp);
+        return i;
+    }
+    i = __osip_message_writer_add(writer, tmp, strlen(tmp), tmp);
+    if (i != 0)
+        return i;
+    return __osip_message_writer_add(writer, CRLF, 2, NULL);
+}
 
-    malloc_size = SIP_MESSAGE_MAX_LENGTH;
+/* same output as osip_header_to_str(), without the temporary string. */
+static int
+__osip_message_writer_add_generic_header(
+    __osip_message_writer_t *writer,
+    const osip_header_t     *header)
+{
+    const char *hname;
+    int        i;
 
-    *dest       = NULL;
-    if (sip == NULL)
+    if ((header == NULL) || (header->hname == NULL))
         return OSIP_BADPARAMETER;
 
+    hname = header->hname;
+    if (hname[0] > 'a' && hname[0] < 'z')
     {
-        if (1 == osip_message_get__property(sip))   /* message is already available in "message" */
-        {
-            *dest = osip_malloc(sip->message_length + 1);
-            if (*dest == NULL)
-                return OSIP_NOMEM;
-            memcpy(*dest, sip->message, sip->message_length);
-            (*dest)[sip->message_length] = '\0';
-            if (message_length != NULL)
-                *message_length = sip->message_length;
-            return OSIP_SUCCESS;
-        }
-        else
-        {
-            /* message should be rebuilt: delete the old one if exists. */
-            osip_free(sip->message);
-            sip->message = NULL;
-        }
+        i = __osip_message_writer_add(writer,
+                                      __osip_message_uppercase + (hname[0] - 'a'),
+                                      1, NULL);
+        if (i != 0)
+            return i;
+        hname++;
     }
-
-    message = (char *) osip_malloc(SIP_MESSAGE_MAX_LENGTH);     /* ???? message could be > 4000  */
-    if (message == NULL)
-        return OSIP_NOMEM;
-    *dest   = message;
-
-    /* add the first line of message */
-    i       = __osip_message_startline_to_str(sip, &tmp);
+    i = __osip_message_writer_add(writer, hname, strlen(hname), NULL);
+    if (i != 0)
+        return i;
+    i = __osip_message_writer_add(writer, ": ", 2, NULL);
     if (i != 0)
+        return i;
+    if (header->hvalue != NULL)
     {
-        if (!sipfrag)
-        {
-            osip_free(*dest);
-            *dest = NULL;
+        i = __osip_message_writer_add(writer, header->hvalue,
+                                      strlen(header->hvalue), NULL);
+        if (i != 0)
             return i;
-        }
-
-        /* A start-line isn't required for message/sipfrag parts. */
-    }
-    else
-    {
-        message = osip_str_append(message, tmp);
-        osip_free(tmp);
-        message = osip_strn_append(message, CRLF, 2);
     }
+    return __osip_message_writer_add(writer, CRLF, 2, NULL);
+}
 
-    {
-        struct to_str_table {
-            char        header_name[30];
-            int         header_length;
-            osip_list_t *header_list;
-            void        *header_data;
-            int         (*to_str) (void *, char **);
-        }
+static int
+__osip_message_writer_add_body(
+    __osip_message_writer_t *writer,
+    const osip_body_t       *body)
+{
+    char   *tmp;
+    size_t body_length;
+    int    i;
+
+    if (body != NULL && body->body != NULL && body->headers != NULL
+        && body->length > 0 && body->content_type == NULL
+        && osip_list_eol(body->headers, 0))
+        return __osip_message_writer_add(writer, body->body, body->length, NULL);
+
+    i = osip_body_to_str(body, &tmp, &body_length);
+    if (i != 0)
+        return i;
+    return __osip_message_writer_add(writer, tmp, body_length, tmp);
+}
+
+static int
+__osip_message_writer_add_headers(
+    __osip_message_writer_t *writer,
+    osip_message_t          *sip)
+{
+    struct to_str_table {
+        const char  *header_name;   /* pieces keep a reference on it */
+        int         header_length;
+        osip_list_t *header_list;
+        void        *header_data;
+        int         (*to_str) (void *, char **);
+    }
 #ifndef MINISIZE
-            table[25] =
+        table[25] =
 #else
-        table[15] =
+    table[15] =
 #endif
+    {
         {
-            {
-                "Via: ", 5, NULL, NULL,
-                (int (*)(void *, char **)) & osip_via_to_str
-            },
-            {
-                "Record-Route: ", 14, NULL, NULL,
-                (int (*)(void *, char **)) & osip_record_route_to_str
-            },
-            {
-                "Route: ", 7, NULL, NULL,
-                (int (*)(void *, char **)) & osip_route_to_str
-            },
-            {
-                "From: ", 6, NULL, NULL,
-                (int (*)(void *, char **)) & osip_from_to_str
-            },
-            {
-                "To: ", 4, NULL, NULL,
-                (int (*)(void *, char **)) & osip_to_to_str
-            },
-            {
-                "Call-ID: ", 9, NULL, NULL,
-                (int (*)(void *, char **)) & osip_call_id_to_str
-            },
-            {
-                "CSeq: ", 6, NULL, NULL,
-                (int (*)(void *, char **)) & osip_cseq_to_str
-            },
-            {
-                "Contact: ", 9, NULL, NULL,
-                (int (*)(void *, char **)) & osip_contact_to_str
-            },
-            {
-                "Authorization: ", 15, NULL, NULL,
-                (int (*)(void *, char **)) & osip_authorization_to_str
-            },
-            {
-                "WWW-Authenticate: ", 18, NULL, NULL,
-                (int (*)(void *, char **)) & osip_www_authenticate_to_str
-            },
-            {
-                "Proxy-Authenticate: ", 20, NULL, NULL,
-                (int (*)(void *, char **)) & osip_www_authenticate_to_str
-            },
-            {
-                "Proxy-Authorization: ", 21, NULL, NULL,
-                (int (*)(void *, char **)) & osip_authorization_to_str
-            },
-            {
-                "Content-Type: ", 14, NULL, NULL,
-                (int (*)(void *, char **)) & osip_content_type_to_str
-            },
-            {
-                "Mime-Version: ", 14, NULL, NULL,
-                (int (*)(void *, char **)) & osip_content_length_to_str
-            },
+            "Via: ", 5, NULL, NULL,
+            (int (*)(void *, char **)) & osip_via_to_str
+        },
+        {
+            "Record-Route: ", 14, NULL, NULL,
+            (int (*)(void *, char **)) & osip_record_route_to_str
+        },
+        {
+            "Route: ", 7, NULL, NULL,
+            (int (*)(void *, char **)) & osip_route_to_str
+        },
+        {
+            "From: ", 6, NULL, NULL,
+            (int (*)(void *, char **)) & osip_from_to_str
+        },
+        {
+            "To: ", 4, NULL, NULL,
+            (int (*)(void *, char **)) & osip_to_to_str
+        },
+        {
+            "Call-ID: ", 9, NULL, NULL,
+            (int (*)(void *, char **)) & osip_call_id_to_str
+        },
+        {
+            "CSeq: ", 6, NULL, NULL,
+            (int (*)(void *, char **)) & osip_cseq_to_str
+        },
+        {
+            "Contact: ", 9, NULL, NULL,
+            (int (*)(void *, char **)) & osip_contact_to_str
+        },
+        {
+            "Authorization: ", 15, NULL, NULL,
+            (int (*)(void *, char **)) & osip_authorization_to_str
+        },
+        {
+            "WWW-Authenticate: ", 18, NULL, NULL,
+            (int (*)(void *, char **)) & osip_www_authenticate_to_str
+        },
+        {
+            "Proxy-Authenticate: ", 20, NULL, NULL,
+            (int (*)(void *, char **)) & osip_www_authenticate_to_str
+        },
+        {
+            "Proxy-Authorization: ", 21, NULL, NULL,
+            (int (*)(void *, char **)) & osip_authorization_to_str
+        },
+        {
+            "Content-Type: ", 14, NULL, NULL,
+            (int (*)(void *, char **)) & osip_content_type_to_str
+        },
+        {
+            "Mime-Version: ", 14, NULL, NULL,
+            (int (*)(void *, char **)) & osip_content_length_to_str
+        },
 #ifndef MINISIZE
-            {
-                "Allow: ", 7, NULL, NULL,
-                (int (*)(void *, char **)) & osip_allow_to_str
-            },
-            {
-                "Content-Encoding: ", 18, NULL, NULL,
-                (int (*)(void *, char **)) & osip_content_encoding_to_str
-            },
-            {
-                "Call-Info: ", 11, NULL, NULL,
-                (int (*)(void *, char **)) & osip_call_info_to_str
-            },
-            {
-                "Alert-Info: ", 12, NULL, NULL,
-                (int (*)(void *, char **)) & osip_call_info_to_str
-            },
-            {
-                "Error-Info: ", 12, NULL, NULL,
-                (int (*)(void *, char **)) & osip_call_info_to_str
-            },
-            {
-                "Accept: ", 8, NULL, NULL,
-                (int (*)(void *, char **)) & osip_accept_to_str
-            },
-            {
-                "Accept-Encoding: ", 17, NULL, NULL,
-                (int (*)(void *, char **)) & osip_accept_encoding_to_str
-            },
-            {
-                "Accept-Language: ", 17, NULL, NULL,
-                (int (*)(void *, char **)) & osip_accept_language_to_str
-            },
-            {
-                "Authentication-Info: ", 21, NULL, NULL,
-                (int (*)(void *, char **)) & osip_authentication_info_to_str
-            },
-            {
-                "Proxy-Authentication-Info: ", 27, NULL, NULL,
-                (int (*)(void *, char **)) & osip_authentication_info_to_str
-            },
+        {
+            "Allow: ", 7, NULL, NULL,
+            (int (*)(void *, char **)) & osip_allow_to_str
+        },
+        {
+            "Content-Encoding: ", 18, NULL, NULL,
+            (int (*)(void *, char **)) & osip_content_encoding_to_str
+        },
+        {
+            "Call-Info: ", 11, NULL, NULL,
+            (int (*)(void *, char **)) & osip_call_info_to_str
+        },
+        {
+            "Alert-Info: ", 12, NULL, NULL,
+            (int (*)(void *, char **)) & osip_call_info_to_str
+        },
+        {
+            "Error-Info: ", 12, NULL, NULL,
+            (int (*)(void *, char **)) & osip_call_info_to_str
+        },
+        {
+            "Accept: ", 8, NULL, NULL,
+            (int (*)(void *, char **)) & osip_accept_to_str
+        },
+        {
+            "Accept-Encoding: ", 17, NULL, NULL,
+            (int (*)(void *, char **)) & osip_accept_encoding_to_str
+        },
+        {
+            "Accept-Language: ", 17, NULL, NULL,
+            (int (*)(void *, char **)) & osip_accept_language_to_str
+        },
+        {
+            "Authentication-Info: ", 21, NULL, NULL,
+            (int (*)(void *, char **)) & osip_authentication_info_to_str
+        },
+        {
+            "Proxy-Authentication-Info: ", 27, NULL, NULL,
+            (int (*)(void *, char **)) & osip_authentication_info_to_str
+        },
 #endif
-            { {
-                  '\0'
-              }, 0, NULL, NULL, NULL }
-        };
-        table[0].header_list  = &sip->vias;
-        table[1].header_list  = &sip->record_routes;
-        table[2].header_list  = &sip->routes;
-        table[3].header_data  = sip->from;
-        table[4].header_data  = sip->to;
-        table[5].header_data  = sip->call_id;
-        table[6].header_data  = sip->cseq;
-        table[7].header_list  = &sip->contacts;
-        table[8].header_list  = &sip->authorizations;
-        table[9].header_list  = &sip->www_authenticates;
-        table[10].header_list = &sip->proxy_authenticates;
-        table[11].header_list = &sip->proxy_authorizations;
-        table[12].header_data = sip->content_type;
-        table[13].header_data = sip->mime_version;
+        {
+            NULL, 0, NULL, NULL, NULL
+        }
+    };
+    int pos;
+    int i;
+
+    table[0].header_list  = &sip->vias;
+    table[1].header_list  = &sip->record_routes;
+    table[2].header_list  = &sip->routes;
+    table[3].header_data  = sip->from;
+    table[4].header_data  = sip->to;
+    table[5].header_data  = sip->call_id;
+    table[6].header_data  = sip->cseq;
+    table[7].header_list  = &sip->contacts;
+    table[8].header_list  = &sip->authorizations;
+    table[9].header_list  = &sip->www_authenticates;
+    table[10].header_list = &sip->proxy_authenticates;
+    table[11].header_list = &sip->proxy_authorizations;
+    table[12].header_data = sip->content_type;
+    table[13].header_data = sip->mime_version;
 #ifndef MINISIZE
-        table[14].header_list = &sip->allows;
-        table[15].header_list = &sip->content_encodings;
-        table[16].header_list = &sip->call_infos;
-        table[17].header_list = &sip->alert_infos;
-        table[18].header_list = &sip->error_infos;
-        table[19].header_list = &sip->accepts;
-        table[20].header_list = &sip->accept_encodings;
-        table[21].header_list = &sip->accept_languages;
-        table[22].header_list = &sip->authentication_infos;
-        table[23].header_list = &sip->proxy_authentication_infos;
+    table[14].header_list = &sip->allows;
+    table[15].header_list = &sip->content_encodings;
+    table[16].header_list = &sip->call_infos;
+    table[17].header_list = &sip->alert_infos;
+    table[18].header_list = &sip->error_infos;
+    table[19].header_list = &sip->accepts;
+    table[20].header_list = &sip->accept_encodings;
+    table[21].header_list = &sip->accept_languages;
+    table[22].header_list = &sip->authentication_infos;
+    table[23].header_list = &sip->proxy_authentication_infos;
 #endif
 
-        pos                   = 0;
-        while (table[pos].header_name[0] != '\0')
-        {
-            if (table[13].header_list == NULL)
-                i = strcat_simple_header(dest, &malloc_size, &message,
-                                         table[pos].header_data,
-                                         table[pos].header_name,
-                                         table[pos].header_length,
-                                         ((int (*)(void *, char **))
-                                          table[pos].to_str), &next);
-            i = strcat_headers_one_per_line(dest, &malloc_size, &message,
-                                            table[pos].header_list,
-                                            table[pos].header_name,
-                                            table[pos].header_length,
-                                            ((int (*)(void *, char **))
-                                             table[pos].to_str), &next);
+    for (pos = 0; table[pos].header_name != NULL; pos++)
+    {
+        if (table[pos].header_data != NULL)
+        {
+            i = __osip_message_writer_add_header(writer,
+                                                 table[pos].header_name,
+                                                 table[pos].header_length,
+                                                 table[pos].header_data,
+                                                 table[pos].to_str);
             if (i != 0)
-            {
-                osip_free(*dest);
-                *dest = NULL;
                 return i;
+        }
+        if (table[pos].header_list != NULL)
+        {
+            int elt_pos = 0;
+
+            while (!osip_list_eol(table[pos].header_list, elt_pos))
+            {
+                i = __osip_message_writer_add_header(writer,
+                                                     table[pos].header_name,
+                                                     table[pos].header_length,
+                                                     osip_list_get(table[pos].header_list, elt_pos),
+                                                     table[pos].to_str);
+                if (i != 0)
+                    return i;
+                elt_pos++;
             }
-            message = next;
-
-            pos++;
         }
     }
 
     pos = 0;
     while (!osip_list_eol(&sip->headers, pos))
     {
-        osip_header_t *header;
-        size_t        header_len = 0;
-
-        header = (osip_header_t *) osip_list_get(&sip->headers, pos);
-        i      = osip_header_to_str(header, &tmp);
+        i = __osip_message_writer_add_generic_header(writer,
+                                                     (osip_header_t *) osip_list_get(&sip->headers, pos));
         if (i != 0)
-        {
-            osip_free(*dest);
-            *dest = NULL;
             return i;
-        }
-
-        header_len = strlen(tmp);
-
-        if (_osip_message_realloc(&message, dest, header_len + 3, &malloc_size) < 0)
-        {
-            osip_free(tmp);
-            *dest = NULL;
-            return OSIP_NOMEM;
-        }
-
-        message = osip_str_append(message, tmp);
-        osip_free(tmp);
-        message = osip_strn_append(message, CRLF, 2);
-
         pos++;
     }
+    return OSIP_SUCCESS;
+}
 
-    /* we have to create the body before adding the contentlength */
-    /* add enough lenght for "Content-Length: " */
-
-    if (_osip_message_realloc(&message, dest, 16, &malloc_size) < 0)
-        return OSIP_NOMEM;
-
-    if (sipfrag && osip_list_eol(&sip->bodies, 0))
-    {
-        /* end of headers */
-        osip_strncpy(message, CRLF, 2);
-        message               = message + 2;
-
-        /* same remark as at the beginning of the method */
-        sip->message_property = 1;
-        sip->message          = osip_strdup(*dest);
-        sip->message_length   = message - *dest;
-        if (message_length != NULL)
-            *message_length = message - *dest;
-
-        return OSIP_SUCCESS;               /* it's all done */
-    }
-
-    osip_strncpy(message, "Content-Length: ", 16);
-    message = message + 16;
-
-    /* SIPit Day1
-       ALWAYS RECALCULATE?
-       if (sip->contentlength!=NULL)
-       {
-       i = osip_content_length_to_str(sip->contentlength, &tmp);
-       if (i!=0) {
-       osip_free(*dest);
-     * dest = NULL;
-       return i;
-       }
-       osip_strncpy(message,tmp,strlen(tmp));
-       osip_free(tmp);
-       }
-       else
-       { */
-    if (osip_list_eol(&sip->bodies, 0))  /* no body */
-        message = osip_strn_append(message, "0", 1);
-    else
-    {
-        /* BUG: p130 (rfc2543bis-04)
-           "No SP after last token or quoted string"
-
-           In fact, if extra spaces exist: the stack can't be used
-           to make user-agent that wants to make authentication...
-           This should be changed...
-         */
-
-        content_length_to_modify = message;
-        message                  = osip_str_append(message, "     ");
-    }
-    /*  } */
-
-    message         = osip_strn_append(message, CRLF, 2);
-
-    /* end of headers */
-    message         = osip_strn_append(message, CRLF, 2);
+static int
+__osip_message_writer_add_bodies(
+    __osip_message_writer_t *writer,
+    osip_message_t          *sip)
+{
+    char   *boundary       = writer->boundary;
+    size_t boundary_length = 0;
+    size_t start_of_bodies;
+    int    content_length_piece;
+    int    pos;
+    int    i;
 
-    start_of_bodies = message;
-    total_length    = start_of_bodies - *dest;
+    i = __osip_message_writer_add(writer, "Content-Length: ", 16, NULL);
+    if (i != 0)
+        return i;
 
     if (osip_list_eol(&sip->bodies, 0))
     {
-        /* same remark as at the beginning of the method */
-        sip->message_property = 1;
-        sip->message          = osip_strdup(*dest);
-        sip->message_length   = total_length;
-        if (message_length != NULL)
-            *message_length = total_length;
-
-        return OSIP_SUCCESS;               /* it's all done */
+        i = __osip_message_writer_add(writer, "0", 1, NULL);
+        if (i != 0)
+            return i;
+        return __osip_message_writer_add(writer, "\r\n\r\n", 4, NULL);
     }
 
+    /* the value is only known once all bodies are collected */
+    content_length_piece = writer->nb_pieces;
+    i                    = __osip_message_writer_add(writer, writer->content_length, 0, NULL);
+    if (i != 0)
+        return i;
+    i = __osip_message_writer_add(writer, "\r\n\r\n", 4, NULL);
+    if (i != 0)
+        return i;
+    start_of_bodies = writer->length;
+
     if (sip->mime_version != NULL && sip->content_type
         && sip->content_type->type
         && !osip_strcasecmp(sip->content_type->type, "multipart"))
@@ -830,19 +611,7 @@ _osip_message_to_str(
             size_t len = strlen(ct_param->gvalue);
 
             if (len > MIME_MAX_BOUNDARY_LEN)
-            {
-                osip_free(*dest);
-                *dest = NULL;
                 return OSIP_SYNTAXERROR;
-            }
-
-            boundary = osip_malloc(len + 5);
-            if (boundary == NULL)
-            {
-                osip_free(*dest);
-                *dest = NULL;
-                return OSIP_NOMEM;
-            }
 
             osip_strncpy(boundary,     CRLF, 2);
             osip_strncpy(boundary + 2, "--", 2);
@@ -851,109 +620,153 @@ _osip_message_to_str(
                 osip_strncpy(boundary + 4, ct_param->gvalue + 1, len - 2);
             else
                 osip_strncpy(boundary + 4, ct_param->gvalue, len);
+            boundary_length = strlen(boundary);
         }
     }
 
     pos = 0;
     while (!osip_list_eol(&sip->bodies, pos))
     {
-        osip_body_t *body;
-        size_t      body_length;
-
-        body = (osip_body_t *) osip_list_get(&sip->bodies, pos);
-
-        if (boundary)
+        if (boundary_length > 0)
         {
-            /* Needs at most 77 bytes,
-               last realloc allocate at least 100 bytes extra */
-            message = osip_str_append(message, boundary);
-            message = osip_strn_append(message, CRLF, 2);
+            i = __osip_message_writer_add(writer, boundary, boundary_length, NULL);
+            if (i != 0)
+                return i;
+            i = __osip_message_writer_add(writer, CRLF, 2, NULL);
+            if (i != 0)
+                return i;
         }
 
-        i = osip_body_to_str(body, &tmp, &body_length);
+        i = __osip_message_writer_add_body(writer,
+                                           (osip_body_t *) osip_list_get(&sip->bodies, pos));
         if (i != 0)
-        {
-            osip_free(*dest);
-            *dest = NULL;
-            if (boundary)
-                osip_free(boundary);
             return i;
-        }
+        pos++;
+    }
 
-        if (malloc_size < message - *dest + 100 + body_length)
-        {
-            size_t size                            = message - *dest;
-            int    offset_of_body;
-            int    offset_content_length_to_modify = 0;
+    if (boundary_length > 0)
+    {
+        i = __osip_message_writer_add(writer, boundary, boundary_length, NULL);
+        if (i != 0)
+            return i;
+        i = __osip_message_writer_add(writer, "--\r\n", 4, NULL);
+        if (i != 0)
+            return i;
+    }
 
-            offset_of_body = (int) (start_of_bodies - *dest);
-            if (content_length_to_modify != NULL)
-                offset_content_length_to_modify =
-                    (int) (content_length_to_modify - *dest);
-            malloc_size = message - *dest + body_length + 100;
-            *dest       = osip_realloc(*dest, malloc_size);
-            if (*dest == NULL)
-            {
-                osip_free(tmp); /* fixed 09/Jun/2005 */
-                if (boundary)
-                    osip_free(boundary);
-                return OSIP_NOMEM;
-            }
-            start_of_bodies = *dest + offset_of_body;
-            if (content_length_to_modify != NULL)
-                content_length_to_modify = *dest + offset_content_length_to_modify;
-            message         = *dest + size;
-        }
+    /* we NOW have the length of bodies: */
+    snprintf(writer->content_length, sizeof(writer->content_length), "%u",
+             (unsigned int) (writer->length - start_of_bodies));
+    writer->pieces[content_length_piece].len = strlen(writer->content_length);
+    writer->length                          += writer->pieces[content_length_piece].len;
+    return OSIP_SUCCESS;
+}
 
-        memcpy(message, tmp, body_length);
-        message[body_length] = '\0';
-        osip_free(tmp);
-        message              = message + body_length;
+/* rebuild sip->message: on success, the message property is set to 1. */
+static int
+_osip_message_build(
+    osip_message_t *sip,
+    int            sipfrag)
+{
+    __osip_message_writer_t writer;
+    char                    *message;
+    char                    *tmp;
+    int                     pos;
+    int                     i;
 
-        pos++;
-    }
+    /* message should be rebuilt: delete the old one if exists. */
+    osip_free(sip->message);
+    sip->message        = NULL;
+    sip->message_length = 0;
+
+    __osip_message_writer_init(&writer);
 
-    if (boundary)
+    /* add the first line of message */
+    i = __osip_message_startline_to_str(sip, &tmp);
+    if (i != 0)
     {
-        /* Needs at most 79 bytes,
-           last realloc allocate at least 100 bytes extra */
-        message  = osip_str_append(message, boundary);
-        message  = osip_strn_append(message, "--", 2);
-        message  = osip_strn_append(message, CRLF, 2);
-
-        osip_free(boundary);
-        boundary = NULL;
+        /* A start-line isn't required for message/sipfrag parts. */
+        if (!sipfrag)
+            return i;
+    }
+    else
+    {
+        i = __osip_message_writer_add(&writer, tmp, strlen(tmp), tmp);
+        if (i == 0)
+            i = __osip_message_writer_add(&writer, CRLF, 2, NULL);
+        if (i != 0)
+        {
+            __osip_message_writer_release(&writer);
+            return i;
+        }
     }
 
-    if (content_length_to_modify == NULL)
+    i = __osip_message_writer_add_headers(&writer, sip);
+    if (i != 0)
     {
-        osip_free(*dest);
-        *dest = NULL;
-        return OSIP_SYNTAXERROR;
+        __osip_message_writer_release(&writer);
+        return i;
     }
 
-    /* we NOW have the length of bodies: */
+    if (sipfrag && osip_list_eol(&sip->bodies, 0))
+        i = __osip_message_writer_add(&writer, CRLF, 2, NULL);      /* end of headers */
+    else
+        i = __osip_message_writer_add_bodies(&writer, sip);
+    if (i != 0)
     {
-        size_t size = message - start_of_bodies;
-        char   tmp2[15];
+        __osip_message_writer_release(&writer);
+        return i;
+    }
 
-        total_length += size;
-        snprintf(tmp2, 15, "%i", size);
-        /* do not use osip_strncpy here! */
-        strncpy(content_length_to_modify + 5 - strlen(tmp2), tmp2, strlen(tmp2));
+    message = (char *) osip_malloc(writer.length + 1);
+    if (message == NULL)
+    {
+        __osip_message_writer_release(&writer);
+        return OSIP_NOMEM;
     }
+    tmp = message;
+    for (pos = 0; pos < writer.nb_pieces; pos++)
+    {
+        memcpy(tmp, writer.pieces[pos].str, writer.pieces[pos].len);
+        tmp += writer.pieces[pos].len;
+    }
+    *tmp                  = '\0';
 
-    /* same remark as at the beginning of the method */
+    sip->message          = message;
+    sip->message_length   = writer.length;
     sip->message_property = 1;
-    sip->message          = osip_malloc(total_length + 1);
-    if (sip->message != NULL)
+    __osip_message_writer_release(&writer);
+    return OSIP_SUCCESS;
+}
+
+static int
+_osip_message_to_str(
+    osip_message_t *sip,
+    char           **dest,
+    size_t         *message_length,
+    int            sipfrag)
+{
+    int i;
+
+    *dest = NULL;
+    if (sip == NULL)
+        return OSIP_BADPARAMETER;
+
+    if (1 != osip_message_get__property(sip))
     {
-        memcpy(sip->message, *dest, total_length);
-        sip->message[total_length] = '\0';
-        sip->message_length        = total_length;
-        if (message_length != NULL)
-            *message_length = total_length;
+        i = _osip_message_build(sip, sipfrag);
+        if (i != 0)
+            return i;
     }
+
+    /* message is available in "message" */
+    *dest = osip_malloc(sip->message_length + 1);
+    if (*dest == NULL)
+        return OSIP_NOMEM;
+    memcpy(*dest, sip->message, sip->message_length);
+    (*dest)[sip->message_length] = '\0';
+    if (message_length != NULL)
+        *message_length = sip->message_length;
     return OSIP_SUCCESS;
 }
 
@@ -973,4 +786,29 @@ osip_message_to_str_sipfrag(
     size_t         *message_length)
 {
     return _osip_message_to_str(sip, dest, message_length, 1);
-}
\ No newline at end of file
+}
+
+int
+osip_message_to_str_cached(
+    osip_message_t *sip,
+    const char     **dest,
+    size_t         *message_length)
+{
+    int i;
+
+    *dest = NULL;
+    if (sip == NULL)
+        return OSIP_BADPARAMETER;
+
+    if (1 != osip_message_get__property(sip))
+    {
+        i = _osip_message_build(sip, 0);
+        if (i != 0)
+            return i;
+    }
+
+    *dest = sip->message;
+    if (message_length != NULL)
+        *message_length = sip->message_length;
+    return OSIP_SUCCESS;
+}
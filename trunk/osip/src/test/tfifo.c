@@ -0,0 +1,246 @@
+/*
+   The oSIP library implements the Session Initiation Protocol (SIP -rfc3261-)
+   Copyright (C) 2001,2002,2003,2004,2005,2006,2007 Aymeric MOIZARD jack@atosc.org
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+   Event throughput of the transaction fifos.
+
+   Several producer threads add events to many fifos (one per
+   transaction) while a single consumer does what osip_ict_execute()
+   and osip_timers_gettimeout() do: check each fifo for pending events
+   and drain it. The test is run with osip_fifo_t (mutex + semaphore)
+   and with osip_mpsc_fifo_t (lock-free).
+ */
+
+#ifdef ENABLE_MPATROL
+    #include <mpatrol.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <osip2/internal.h>
+#include <osip2/osip_mt.h>
+#include <osip2/osip_fifo.h>
+#include <osip2/osip_time.h>
+
+#define TFIFO_MAX_PRODUCERS 64
+
+typedef struct tfifo_test tfifo_test_t;
+
+struct tfifo_test {
+    int              use_mpsc;
+    int              nb_fifos;
+    int              nb_events;  /* per producer */
+    osip_fifo_t      **fifos;
+    osip_mpsc_fifo_t **mpsc_fifos;
+};
+
+typedef struct tfifo_producer tfifo_producer_t;
+
+struct tfifo_producer {
+    tfifo_test_t *test;
+    int          id;
+};
+
+static void
+usage(void)
+{
+    fprintf(stderr,
+            "Usage: ./tfifo [nb_transactions] [nb_producers] [nb_events_per_producer]\n");
+    exit(1);
+}
+
+static void *
+tfifo_produce(
+    void *arg)
+{
+    tfifo_producer_t *producer = (tfifo_producer_t *) arg;
+    tfifo_test_t     *test     = producer->test;
+    int              i;
+
+    for (i = 0; i < test->nb_events; i++)
+    {
+        /* spread events over the transactions, like incoming messages */
+        int idx = (i * 7 + producer->id * 13) % test->nb_fifos;
+
+        if (test->use_mpsc)
+        {
+            while (osip_mpsc_fifo_add(test->mpsc_fifos[idx], producer) != 0)
+                osip_usleep(10);
+        }
+        else
+        {
+            /* osip_fifo_t refuses elements when it holds MAX_LEN of them */
+            while (osip_fifo_add(test->fifos[idx], producer) != 0)
+                osip_usleep(10);
+        }
+    }
+    return NULL;
+}
+
+static int
+tfifo_consume(
+    tfifo_test_t *test,
+    int          expected)
+{
+    int received = 0;
+    int idx;
+
+    while (received < expected)
+    {
+        for (idx = 0; idx < test->nb_fifos; idx++)
+        {
+            void *el;
+
+            /* osip_timers_gettimeout() */
+            if (test->use_mpsc)
+            {
+                if (osip_mpsc_fifo_is_empty(test->mpsc_fifos[idx]))
+                    continue;
+            }
+            else if (osip_fifo_size(test->fifos[idx]) < 1)
+                continue;
+
+            /* osip_ict_execute() */
+            do
+            {
+                if (test->use_mpsc)
+                    el = osip_mpsc_fifo_tryget(test->mpsc_fifos[idx]);
+                else
+                    el = osip_fifo_tryget(test->fifos[idx]);
+                if (el != NULL)
+                    received++;
+            }
+            while (el != NULL);
+        }
+    }
+    return received;
+}
+
+static int
+tfifo_run(
+    tfifo_test_t *test,
+    int          nb_producers)
+{
+    tfifo_producer_t   producers[TFIFO_MAX_PRODUCERS];
+    struct osip_thread *threads[TFIFO_MAX_PRODUCERS];
+    struct timeval     start;
+    struct timeval     end;
+    double             duration;
+    int                received;
+    int                i;
+
+    for (i = 0; i < test->nb_fifos; i++)
+    {
+        if (test->use_mpsc)
+        {
+            test->mpsc_fifos[i] = (osip_mpsc_fifo_t *) osip_malloc(sizeof(osip_mpsc_fifo_t));
+            if (test->mpsc_fifos[i] == NULL || osip_mpsc_fifo_init(test->mpsc_fifos[i]) != 0)
+                return -1;
+        }
+        else
+        {
+            test->fifos[i] = (osip_fifo_t *) osip_malloc(sizeof(osip_fifo_t));
+            if (test->fifos[i] == NULL)
+                return -1;
+            osip_fifo_init(test->fifos[i]);
+        }
+    }
+
+    osip_gettimeofday(&start, NULL);
+    for (i = 0; i < nb_producers; i++)
+    {
+        producers[i].test = test;
+        producers[i].id   = i;
+        threads[i]        = osip_thread_create(20000, &tfifo_produce, &producers[i]);
+        if (threads[i] == NULL)
+        {
+            fprintf(stderr, "Error! cannot create thread\n");
+            return -1;
+        }
+    }
+
+    received = tfifo_consume(test, nb_producers * test->nb_events);
+
+    for (i = 0; i < nb_producers; i++)
+    {
+        osip_thread_join(threads[i]);
+        osip_free(threads[i]);
+    }
+    osip_gettimeofday(&end, NULL);
+
+    duration = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0;
+    fprintf(stdout, "%-16s %6i transactions %3i producers: %9i events in %.3fs (%.0f events/s)\n",
+            test->use_mpsc ? "osip_mpsc_fifo_t" : "osip_fifo_t",
+            test->nb_fifos, nb_producers, received, duration,
+            duration > 0 ? received / duration : 0);
+
+    for (i = 0; i < test->nb_fifos; i++)
+    {
+        if (test->use_mpsc)
+            osip_mpsc_fifo_free(test->mpsc_fifos[i]);
+        else
+            osip_fifo_free(test->fifos[i]);
+    }
+    return received == nb_producers * test->nb_events ? 0 : -1;
+}
+
+int
+main(
+    int  argc,
+    char **argv)
+{
+    tfifo_test_t test;
+    int          nb_producers = 4;
+    int          i;
+
+    test.nb_fifos  = 1000;
+    test.nb_events = 200000;
+
+    if (argc > 4)
+        usage();
+    if (argc > 1)
+        test.nb_fifos = atoi(argv[1]);
+    if (argc > 2)
+        nb_producers = atoi(argv[2]);
+    if (argc > 3)
+        test.nb_events = atoi(argv[3]);
+    if (test.nb_fifos <= 0 || test.nb_events <= 0
+        || nb_producers <= 0 || nb_producers > TFIFO_MAX_PRODUCERS)
+        usage();
+
+    test.fifos      = (osip_fifo_t **) osip_malloc(test.nb_fifos * sizeof(osip_fifo_t *));
+    test.mpsc_fifos = (osip_mpsc_fifo_t **) osip_malloc(test.nb_fifos * sizeof(osip_mpsc_fifo_t *));
+    if (test.fifos == NULL || test.mpsc_fifos == NULL)
+        return -1;
+
+    for (i = 0; i < 2; i++)
+    {
+        test.use_mpsc = i;
+        if (tfifo_run(&test, nb_producers) != 0)
+        {
+            fprintf(stdout, "ERROR: events lost!\n");
+            return -1;
+        }
+    }
+
+    osip_free(test.fifos);
+    osip_free(test.mpsc_fifos);
+    return 0;
+}
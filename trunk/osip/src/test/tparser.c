@@ -0,0 +1,534 @@
+/*
+   The oSIP library implements the Session Initiation Protocol (SIP -rfc3261-)
+   Copyright (C) 2001,2002,2003,2004,2005,2006,2007 Aymeric MOIZARD jack@atosc.org
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+   Parser microbenchmarks.
+
+   The messages of a corpus file (separated by lines starting with "|",
+   see res/bench_msgs) are run through osip_message_parse(),
+   osip_message_to_str() and osip_message_clone(). Their URIs, Via
+   headers and SDP bodies are extracted once and run through
+   osip_uri_parse(), osip_via_parse() and sdp_message_parse(). Each
+   benchmark reports the time and the number of osip allocations per
+   item, as a baseline for work on the parser.
+ */
+
+#ifdef ENABLE_MPATROL
+    #include <mpatrol.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <osipparser2/osip_parser.h>
+#include <osipparser2/sdp_message.h>
+
+#define TPARSER_MAX_ITEMS 1024
+
+#if !defined(WIN32) && !defined(_WIN32_WCE) && !defined(MINISIZE)
+    #define TPARSER_COUNT_ALLOCS
+#endif
+
+typedef struct tparser_corpus tparser_corpus_t;
+
+struct tparser_corpus {
+    int            nb_msgs;
+    char           *msgs[TPARSER_MAX_ITEMS];
+    size_t         lengths[TPARSER_MAX_ITEMS];
+    osip_message_t *parsed[TPARSER_MAX_ITEMS];
+    int            nb_uris;
+    char           *uris[TPARSER_MAX_ITEMS];
+    int            nb_vias;
+    char           *vias[TPARSER_MAX_ITEMS];
+    int            nb_sdps;
+    char           *sdps[TPARSER_MAX_ITEMS];
+};
+
+typedef struct tparser_bench tparser_bench_t;
+
+struct tparser_bench {
+    const char *name;
+    int        (*run)(tparser_corpus_t *corpus, int idx);
+    int        (*count)(tparser_corpus_t *corpus);
+};
+
+static long nb_allocs = 0;
+
+#ifdef TPARSER_COUNT_ALLOCS
+
+static void *
+tparser_malloc(
+    size_t size)
+{
+    nb_allocs++;
+    return malloc(size);
+}
+
+static void *
+tparser_realloc(
+    void   *ptr,
+    size_t size)
+{
+    nb_allocs++;
+    return realloc(ptr, size);
+}
+
+static void
+tparser_free(
+    void *ptr)
+{
+    free(ptr);
+}
+
+#endif
+
+static void
+usage(void)
+{
+    fprintf(stderr, "Usage: ./tparser corpus_file [iterations] [-v]\n");
+    exit(1);
+}
+
+static int
+tparser_add(
+    char **items,
+    int  *nb_items,
+    char *item)
+{
+    if (item == NULL)
+        return -1;
+    if (*nb_items >= TPARSER_MAX_ITEMS)
+    {
+        osip_free(item);
+        return -1;
+    }
+    items[(*nb_items)++] = item;
+    return 0;
+}
+
+static void
+tparser_add_uri(
+    tparser_corpus_t *corpus,
+    osip_uri_t       *uri)
+{
+    char *dest = NULL;
+
+    if (uri != NULL && osip_uri_to_str(uri, &dest) == 0)
+        tparser_add(corpus->uris, &corpus->nb_uris, dest);
+}
+
+static void
+tparser_add_uris(
+    tparser_corpus_t *corpus,
+    osip_list_t      *list)
+{
+    int pos;
+
+    /* Contact, Route and Record-Route all share the osip_from_t layout */
+    for (pos = 0; pos < osip_list_size(list); pos++)
+    {
+        osip_from_t *header = (osip_from_t *) osip_list_get(list, pos);
+
+        tparser_add_uri(corpus, header->url);
+    }
+}
+
+/* extract the URIs, Vias and SDP bodies of a parsed message */
+static void
+tparser_extract(
+    tparser_corpus_t *corpus,
+    osip_message_t   *sip)
+{
+    int pos;
+
+    tparser_add_uri(corpus, sip->req_uri);
+    if (sip->from != NULL)
+        tparser_add_uri(corpus, sip->from->url);
+    if (sip->to != NULL)
+        tparser_add_uri(corpus, sip->to->url);
+    tparser_add_uris(corpus, &sip->contacts);
+    tparser_add_uris(corpus, &sip->routes);
+    tparser_add_uris(corpus, &sip->record_routes);
+
+    for (pos = 0; pos < osip_list_size(&sip->vias); pos++)
+    {
+        char *dest = NULL;
+
+        if (osip_via_to_str((osip_via_t *) osip_list_get(&sip->vias, pos), &dest) == 0)
+            tparser_add(corpus->vias, &corpus->nb_vias, dest);
+    }
+
+    if (sip->content_type != NULL && sip->content_type->type != NULL
+        && sip->content_type->subtype != NULL
+        && osip_strcasecmp(sip->content_type->type, "application") == 0
+        && osip_strcasecmp(sip->content_type->subtype, "sdp") == 0)
+    {
+        osip_body_t *body = (osip_body_t *) osip_list_get(&sip->bodies, 0);
+
+        if (body != NULL && body->body != NULL)
+            tparser_add(corpus->sdps, &corpus->nb_sdps, osip_strdup(body->body));
+    }
+}
+
+static int
+tparser_load(
+    tparser_corpus_t *corpus,
+    const char       *filename)
+{
+    FILE   *file;
+    char   *data;
+    char   *start;
+    char   *end;
+    long   size;
+    int    i;
+
+    memset(corpus, 0, sizeof(tparser_corpus_t));
+
+    file = fopen(filename, "rb");
+    if (file == NULL)
+        return -1;
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data = (char *) osip_malloc(size + 1);
+    if (data == NULL || fread(data, 1, size, file) != (size_t) size)
+    {
+        fclose(file);
+        osip_free(data);
+        return -1;
+    }
+    fclose(file);
+    data[size] = '\0';
+
+    /* messages are separated by lines starting with "|" */
+    start = data;
+    while (*start != '\0' && corpus->nb_msgs < TPARSER_MAX_ITEMS)
+    {
+        for (end = start; *end != '\0'; end++)
+        {
+            if (*end == '|' && (end == data || end[-1] == '\n'))
+                break;
+        }
+        if (end > start)
+        {
+            char *msg = (char *) osip_malloc(end - start + 1);
+
+            if (msg == NULL)
+                break;
+            memcpy(msg, start, end - start);
+            msg[end - start]                     = '\0';
+            corpus->msgs[corpus->nb_msgs]        = msg;
+            corpus->lengths[corpus->nb_msgs++]   = end - start;
+        }
+        if (*end == '\0')
+            break;
+        /* skip the separator line */
+        while (*end != '\0' && *end != '\n')
+            end++;
+        start = (*end == '\n') ? end + 1 : end;
+    }
+    osip_free(data);
+
+    for (i = 0; i < corpus->nb_msgs; i++)
+    {
+        if (osip_message_init(&corpus->parsed[i]) != 0
+            || osip_message_parse(corpus->parsed[i], corpus->msgs[i],
+                                  corpus->lengths[i]) != 0)
+        {
+            fprintf(stderr, "Error! message %i of %s cannot be parsed\n", i, filename);
+            return -1;
+        }
+        tparser_extract(corpus, corpus->parsed[i]);
+    }
+    return corpus->nb_msgs > 0 ? 0 : -1;
+}
+
+static void
+tparser_unload(
+    tparser_corpus_t *corpus)
+{
+    int i;
+
+    for (i = 0; i < corpus->nb_msgs; i++)
+    {
+        osip_free(corpus->msgs[i]);
+        osip_message_free(corpus->parsed[i]);
+    }
+    for (i = 0; i < corpus->nb_uris; i++)
+        osip_free(corpus->uris[i]);
+    for (i = 0; i < corpus->nb_vias; i++)
+        osip_free(corpus->vias[i]);
+    for (i = 0; i < corpus->nb_sdps; i++)
+        osip_free(corpus->sdps[i]);
+}
+
+static int
+tparser_run_parse(
+    tparser_corpus_t *corpus,
+    int              idx)
+{
+    osip_message_t *sip;
+    int            i;
+
+    i = osip_message_init(&sip);
+    if (i != 0)
+        return i;
+    i = osip_message_parse(sip, corpus->msgs[idx], corpus->lengths[idx]);
+    osip_message_free(sip);
+    return i;
+}
+
+static int
+tparser_run_to_str(
+    tparser_corpus_t *corpus,
+    int              idx)
+{
+    char   *dest;
+    size_t length;
+    int    i;
+
+    /* serialize again instead of returning the parsed buffer */
+    osip_message_force_update(corpus->parsed[idx]);
+    i = osip_message_to_str(corpus->parsed[idx], &dest, &length);
+    if (i == 0)
+        osip_free(dest);
+    return i;
+}
+
+static int
+tparser_run_clone(
+    tparser_corpus_t *corpus,
+    int              idx)
+{
+    osip_message_t *copy;
+    int            i;
+
+    i = osip_message_clone(corpus->parsed[idx], &copy);
+    if (i == 0)
+        osip_message_free(copy);
+    return i;
+}
+
+static int
+tparser_run_uri(
+    tparser_corpus_t *corpus,
+    int              idx)
+{
+    osip_uri_t *uri;
+    int        i;
+
+    i = osip_uri_init(&uri);
+    if (i != 0)
+        return i;
+    i = osip_uri_parse(uri, corpus->uris[idx]);
+    osip_uri_free(uri);
+    return i;
+}
+
+static int
+tparser_run_via(
+    tparser_corpus_t *corpus,
+    int              idx)
+{
+    osip_via_t *via;
+    int        i;
+
+    i = osip_via_init(&via);
+    if (i != 0)
+        return i;
+    i = osip_via_parse(via, corpus->vias[idx]);
+    osip_via_free(via);
+    return i;
+}
+
+static int
+tparser_run_sdp(
+    tparser_corpus_t *corpus,
+    int              idx)
+{
+    sdp_message_t *sdp;
+    int           i;
+
+    i = sdp_message_init(&sdp);
+    if (i != 0)
+        return i;
+    i = sdp_message_parse(sdp, corpus->sdps[idx]);
+    sdp_message_free(sdp);
+    return i;
+}
+
+static int
+tparser_count_msgs(
+    tparser_corpus_t *corpus)
+{
+    return corpus->nb_msgs;
+}
+
+static int
+tparser_count_uris(
+    tparser_corpus_t *corpus)
+{
+    return corpus->nb_uris;
+}
+
+static int
+tparser_count_vias(
+    tparser_corpus_t *corpus)
+{
+    return corpus->nb_vias;
+}
+
+static int
+tparser_count_sdps(
+    tparser_corpus_t *corpus)
+{
+    return corpus->nb_sdps;
+}
+
+static tparser_bench_t benchs[] = {
+    {"osip_message_parse",  tparser_run_parse,  tparser_count_msgs},
+    {"osip_message_to_str", tparser_run_to_str, tparser_count_msgs},
+    {"osip_message_clone",  tparser_run_clone,  tparser_count_msgs},
+    {"osip_uri_parse",      tparser_run_uri,    tparser_count_uris},
+    {"osip_via_parse",      tparser_run_via,    tparser_count_vias},
+    {"sdp_message_parse",   tparser_run_sdp,    tparser_count_sdps},
+    {NULL,                  NULL,               NULL}
+};
+
+static double
+tparser_elapsed_ns(
+    struct timeval *start,
+    struct timeval *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1000000000.0
+           + (end->tv_usec - start->tv_usec) * 1000.0;
+}
+
+/* run one benchmark over the items [first, last[ */
+static int
+tparser_measure(
+    tparser_bench_t  *bench,
+    tparser_corpus_t *corpus,
+    int              first,
+    int              last,
+    int              iterations,
+    double           *ns,
+    double           *allocs)
+{
+    struct timeval start;
+    struct timeval end;
+    long           allocs_start;
+    int            n, idx;
+
+    allocs_start = nb_allocs;
+    gettimeofday(&start, NULL);
+    for (n = 0; n < iterations; n++)
+    {
+        for (idx = first; idx < last; idx++)
+        {
+            if (bench->run(corpus, idx) != 0)
+                return -1;
+        }
+    }
+    gettimeofday(&end, NULL);
+
+    n       = iterations * (last - first);
+    *ns     = tparser_elapsed_ns(&start, &end) / n;
+    *allocs = (double) (nb_allocs - allocs_start) / n;
+    return 0;
+}
+
+int
+main(
+    int  argc,
+    char **argv)
+{
+    tparser_corpus_t *corpus;
+    tparser_bench_t  *bench;
+    int              iterations = 10000;
+    int              verbose    = 0;
+    int              pos;
+    double           ns;
+    double           allocs;
+
+    if (argc < 2)
+        usage();
+    for (pos = 2; pos < argc; pos++)
+    {
+        if (0 == strncmp(argv[pos], "-v", 2))
+            verbose = 1;
+        else if (atoi(argv[pos]) > 0)
+            iterations = atoi(argv[pos]);
+        else
+            usage();
+    }
+
+#ifdef TPARSER_COUNT_ALLOCS
+    osip_set_allocators(tparser_malloc, tparser_realloc, tparser_free);
+#endif
+    parser_init();
+
+    corpus = (tparser_corpus_t *) osip_malloc(sizeof(tparser_corpus_t));
+    if (corpus == NULL || tparser_load(corpus, argv[1]) != 0)
+    {
+        fprintf(stderr, "Error! cannot load %s\n", argv[1]);
+        return -1;
+    }
+
+    fprintf(stdout, "%i messages, %i uris, %i vias, %i sdps, %i iterations\n",
+            corpus->nb_msgs, corpus->nb_uris, corpus->nb_vias, corpus->nb_sdps,
+            iterations);
+#ifndef TPARSER_COUNT_ALLOCS
+    fprintf(stdout, "(allocations are not counted on this platform)\n");
+#endif
+
+    for (bench = benchs; bench->name != NULL; bench++)
+    {
+        int nb_items = bench->count(corpus);
+
+        if (nb_items == 0)
+            continue;
+        if (tparser_measure(bench, corpus, 0, nb_items, iterations, &ns, &allocs) != 0)
+        {
+            fprintf(stdout, "ERROR: %s failed!\n", bench->name);
+            return -1;
+        }
+        fprintf(stdout, "%-20s %5i items: %9.0f ns/item %7.1f allocs/item\n",
+                bench->name, nb_items, ns, allocs);
+    }
+
+    if (verbose)
+    {
+        /* osip_message_parse() for each message of the corpus */
+        for (pos = 0; pos < corpus->nb_msgs; pos++)
+        {
+            osip_message_t *sip = corpus->parsed[pos];
+
+            tparser_measure(&benchs[0], corpus, pos, pos + 1, iterations, &ns, &allocs);
+            fprintf(stdout, "message %-3i %-12s %5i bytes %4i vias: %9.0f ns %7.1f allocs\n",
+                    pos, MSG_IS_REQUEST(sip) ? sip->sip_method : "response",
+                    (int) corpus->lengths[pos], osip_list_size(&sip->vias), ns, allocs);
+        }
+    }
+
+    tparser_unload(corpus);
+    osip_free(corpus);
+    return 0;
+}